@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "voxel_engine/edit_log.h"
+#include "voxel_engine/region_store.h"
+
+// Пропускная способность EditLog: правки кистью (шар радиуса brush_radius вокселей), каждая кисть -
+// один батч VoxelEditor, т.е. один append. Group commit и checkpoint работают как в игре.
+// Цель - 1M voxel edits/s с подтверждённой durability.
+//
+//   edit_log_bench [seconds] [brush_radius] [fsync_interval_ms]
+
+static constexpr int CHUNK_SIZE = 16;
+
+static std::vector<EditLog::ChunkEdit> make_brush(glm::ivec3 center, int radius, std::mt19937& rng) {
+    std::uniform_real_distribution<float> color(0.0f, 1.0f);
+    Voxel value(glm::vec3(color(rng), color(rng), color(rng)), true);
+
+    std::vector<EditLog::ChunkEdit> edits;
+    glm::ivec3 lo = center - glm::ivec3(radius), hi = center + glm::ivec3(radius);
+    for (int cz = math_utils::floor_div(lo.z, CHUNK_SIZE); cz <= math_utils::floor_div(hi.z, CHUNK_SIZE); cz++)
+    for (int cy = math_utils::floor_div(lo.y, CHUNK_SIZE); cy <= math_utils::floor_div(hi.y, CHUNK_SIZE); cy++)
+    for (int cx = math_utils::floor_div(lo.x, CHUNK_SIZE); cx <= math_utils::floor_div(hi.x, CHUNK_SIZE); cx++) {
+        EditLog::ChunkEdit edit;
+        edit.chunk_key = math_utils::pack_key(cx, cy, cz);
+        glm::ivec3 base = glm::ivec3(cx, cy, cz) * CHUNK_SIZE;
+
+        // id = x + S * (y + S * z) - обход по z, y, x даёт отсортированные id, как в VoxelEditor
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        for (int y = 0; y < CHUNK_SIZE; y++)
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            glm::ivec3 d = base + glm::ivec3(x, y, z) - center;
+            if (d.x * d.x + d.y * d.y + d.z * d.z > radius * radius) continue;
+            edit.ids.push_back((uint32_t)(x + CHUNK_SIZE * (y + CHUNK_SIZE * z)));
+            edit.values.push_back(value);
+        }
+        if (!edit.ids.empty())
+            edits.push_back(std::move(edit));
+    }
+    return edits;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::stod(argv[1]) : 5.0;
+    int brush_radius = argc > 2 ? std::stoi(argv[2]) : 4;
+    int fsync_interval_ms = argc > 3 ? std::stoi(argv[3]) : 10;
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "edit_log_bench";
+    std::filesystem::remove_all(dir);
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> pos(-256, 255);
+
+    // кисти готовим заранее: меряем лог, а не генерацию правок
+    std::vector<std::vector<EditLog::ChunkEdit>> brushes;
+    size_t brush_voxels = 0;
+    for (int i = 0; i < 256; i++) {
+        brushes.push_back(make_brush({pos(rng), pos(rng), pos(rng)}, brush_radius, rng));
+        for (const auto& edit : brushes.back()) brush_voxels += edit.ids.size();
+    }
+
+    uint64_t voxels = 0, appends = 0;
+    double append_seconds, total_seconds, max_wait_ms = 0.0;
+    {
+        RegionStore region_store(dir / "regions", glm::ivec3(CHUNK_SIZE));
+        EditLog log(dir, &region_store, fsync_interval_ms);
+
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration<double>(seconds);
+        auto next_wait = start;
+        uint64_t seq = 0;
+
+        while (true) {
+            const auto& brush = brushes[appends % brushes.size()];
+            seq = log.append(brush);
+            for (const auto& edit : brush) voxels += edit.ids.size();
+            appends++;
+
+            if ((appends & 63u) != 0) continue;
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+
+            // раз в 100 мс ждём durability, как редактор, которому нужна гарантия (например, перед сохранением)
+            if (now >= next_wait) {
+                next_wait = now + std::chrono::milliseconds(100);
+                auto t0 = std::chrono::steady_clock::now();
+                if (!log.wait_durable(seq)) {
+                    std::cout << "edit_log_bench: " << log.io_error() << std::endl;
+                    return 1;
+                }
+                max_wait_ms = std::max(max_wait_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            }
+        }
+        append_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!log.wait_durable(seq)) {
+            std::cout << "edit_log_bench: " << log.io_error() << std::endl;
+            return 1;
+        }
+        total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "brush radius " << brush_radius << ": " << (double)brush_voxels / brushes.size() << " voxels per append"
+              << ", fsync interval " << fsync_interval_ms << " ms" << std::endl;
+    std::cout << "appends: " << appends << ", voxel edits: " << voxels << std::endl;
+    std::cout << "append throughput: " << voxels / append_seconds / 1e6 << " M voxel edits/s" << std::endl;
+    std::cout << "durable throughput: " << voxels / total_seconds / 1e6 << " M voxel edits/s" << std::endl;
+    std::cout << "max wait_durable: " << max_wait_ms << " ms" << std::endl;
+    return 0;
+}
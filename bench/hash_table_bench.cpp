@@ -0,0 +1,196 @@
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "chunk_hash_table_cpu.h"
+
+// ChunkHashTableCPU в обоих режимах ChunkHashTableMode:
+//   1. конкурентный стресс - get_or_create/lookup из многих потоков по пересекающимся ключам, затем фаза
+//      вытеснения и перестройка, после каждой фазы проверка инвариантов таблицы;
+//   2. simulate_streaming с параметрами VoxelGridGPU из main.cpp - длины проб, могилы и перестройки по кадрам.
+//
+//   hash_table_bench [count_threads] [stress_rounds] [stream_frames]
+
+static const char* mode_name(ChunkHashTableMode mode) {
+    return mode == ChunkHashTableMode::Bucketed ? "bucketed" : "linear";
+}
+
+static void print_probes(const char* what, const ChunkHashTableCPU::ProbeStats& stats) {
+    std::cout << "  " << what << ": ops " << stats.count_ops << ", mean probe " << stats.mean_probe()
+              << ", p99 " << stats.percentile_probe(0.99) << ", max " << stats.max_probe()
+              << ", tombs passed " << stats.count_tombs_passed << ", locked spins " << stats.count_locked_spins
+              << ", cas retries " << stats.count_cas_retries << ", probe failed " << stats.count_probe_failed << std::endl;
+}
+
+// Инварианты между фазами: у каждого занятого id свой ключ, lookup ключа возвращает этот id,
+// живых слотов столько же, сколько занятых id, и занятые + свободные = max_chunks.
+static uint64_t check_table(ChunkHashTableCPU& table, const char* phase) {
+    uint64_t errors = 0;
+    auto fail = [&](const std::string& msg) {
+        if (errors++ < 10) std::cout << "  " << phase << ": " << msg << std::endl;
+    };
+
+    std::unordered_map<uint64_t, uint32_t> owner;
+    uint32_t count_used = 0;
+    for (uint32_t id = 0; id < table.max_chunks(); id++) {
+        const ChunkHashTableCPU::ChunkMeta& m = table.meta(id);
+        if (m.used == 0u) continue;
+        count_used++;
+
+        uint64_t key = (uint64_t)m.key_lo | ((uint64_t)m.key_hi << 32);
+        auto [it, inserted] = owner.emplace(key, id);
+        if (!inserted)
+            fail("key owned by chunks " + std::to_string(it->second) + " and " + std::to_string(id));
+
+        uint32_t found = table.lookup_chunk(glm::uvec2(m.key_lo, m.key_hi));
+        if (found != id)
+            fail("lookup of chunk " + std::to_string(id) + " returned " + std::to_string(found));
+    }
+
+    if (count_used + table.free_count() != table.max_chunks())
+        fail("used " + std::to_string(count_used) + " + free " + std::to_string(table.free_count()) + " != max_chunks");
+
+    ChunkHashTableCPU::TableStats stats = table.table_stats();
+    if (stats.count_live != count_used)
+        fail("live slots " + std::to_string(stats.count_live) + " != used chunks " + std::to_string(count_used));
+    return errors;
+}
+
+static uint64_t run_stress(ChunkHashTableMode mode, unsigned count_threads, uint32_t rounds) {
+    const uint32_t max_chunks = 4096;
+    ChunkHashTableCPU table(max_chunks, 2.0f, 0.2f, mode);
+
+    // ключей втрое больше, чем id: таблица регулярно упирается в пустой free_list
+    const int key_side = 24; // 24^3 = 13824
+    uint64_t errors = 0;
+    ChunkHashTableCPU::ProbeStats total;
+    uint64_t count_created = 0, count_evicted = 0;
+
+    for (uint32_t round = 0; round < rounds; round++) {
+        // фаза вставки: потоки пересекаются по ключам, каждый запоминает полученные id
+        std::vector<ChunkHashTableCPU::ProbeStats> thread_stats(count_threads);
+        std::vector<std::vector<std::pair<glm::ivec3, uint32_t>>> results(count_threads);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < count_threads; t++) {
+            threads.emplace_back([&, t]() {
+                std::mt19937 rng(round * 977u + t);
+                std::uniform_int_distribution<int> coord(-key_side / 2, key_side / 2 - 1);
+                for (int i = 0; i < 4000; i++) {
+                    glm::ivec3 c(coord(rng), coord(rng), coord(rng));
+                    glm::uvec2 key = ChunkHashTableCPU::pack_key_uvec2(c);
+                    if (rng() % 3u == 0u) {
+                        table.lookup_chunk(key, &thread_stats[t]);
+                        continue;
+                    }
+                    uint32_t id;
+                    bool created;
+                    if (table.get_or_create_chunk(key, id, created, &thread_stats[t]))
+                        results[t].emplace_back(c, id);
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+
+        for (const auto& s : thread_stats) {
+            total.merge(s);
+            count_created += s.count_created;
+        }
+
+        // все потоки, получившие id для ключа, получили один и тот же, и он ещё в таблице
+        for (const auto& list : results) {
+            for (const auto& [c, id] : list) {
+                uint32_t found = table.lookup_chunk(ChunkHashTableCPU::pack_key_uvec2(c));
+                if (found != id && errors++ < 10)
+                    std::cout << "  insert phase: key got id " << id << ", lookup returns " << found << std::endl;
+            }
+        }
+        errors += check_table(table, "insert phase");
+
+        // фаза вытеснения: четверть занятых id, параллельно, как evict_low_priority
+        std::vector<uint32_t> victims;
+        for (uint32_t id = 0; id < max_chunks; id++)
+            if (table.meta(id).used && (id + round) % 4u == 0u) victims.push_back(id);
+        std::atomic<uint32_t> evicted{0};
+        threads.clear();
+        for (unsigned t = 0; t < count_threads; t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < victims.size(); i += count_threads)
+                    if (table.evict_chunk(victims[i]) != ChunkHashTableCPU::INVALID_ID)
+                        evicted.fetch_add(1u, std::memory_order_relaxed);
+            });
+        }
+        for (auto& th : threads) th.join();
+        table.commit_evicted();
+        count_evicted += evicted.load();
+
+        if (evicted.load() != victims.size() && errors++ < 10)
+            std::cout << "  evict phase: evicted " << evicted.load() << " of " << victims.size() << std::endl;
+        errors += check_table(table, "evict phase");
+
+        table.rebuild_if_needed(count_threads);
+        errors += check_table(table, "rebuild");
+    }
+
+    std::cout << "stress " << mode_name(mode) << ": " << rounds << " rounds, " << count_threads << " threads, table "
+              << table.size() << " slots, created " << count_created << ", evicted " << count_evicted
+              << ", rebuilds " << table.count_rebuilds() << ", errors " << errors << std::endl;
+    print_probes("insert/lookup", total);
+    return errors;
+}
+
+static void run_streaming(ChunkHashTableMode mode, unsigned count_threads, uint32_t frames) {
+    // main.cpp: 30000 активных чанков, size factor 4, 10000 свободных, перестройка при 20% могил
+    ChunkHashTableCPU table(30'000, 4.0f, 0.2f, mode);
+
+    ChunkHashTableCPU::StreamParams params;
+    params.radius_chunks = 16; // ~17000 чанков в шаре
+    params.count_frames = frames;
+    params.min_free_chunks = 10'000;
+    params.count_threads = count_threads;
+
+    ChunkHashTableCPU::ProbeStats total;
+    std::vector<ChunkHashTableCPU::FrameStats> stats = table.simulate_streaming(params, &total);
+
+    uint64_t failed = 0;
+    double insert_ms = 0.0, lookup_ms = 0.0, max_frame_ms = 0.0;
+    uint32_t max_tomb = 0, max_probe = 0;
+    for (const auto& fs : stats) {
+        failed += fs.count_failed;
+        insert_ms += fs.insert_ms;
+        lookup_ms += fs.lookup_ms;
+        max_frame_ms = std::max(max_frame_ms, fs.frame_ms);
+        max_tomb = std::max(max_tomb, fs.count_tomb);
+        max_probe = std::max(max_probe, fs.max_probe);
+    }
+
+    std::cout << "streaming " << mode_name(mode) << ": " << stats.size() << " frames, sphere " << stats.front().count_requested
+              << " chunks, table " << table.size() << " slots, rebuilds " << table.count_rebuilds()
+              << ", max tombs " << max_tomb << ", failed " << failed << std::endl;
+    std::cout << "  per frame: insert " << insert_ms / stats.size() << " ms, lookup " << lookup_ms / stats.size()
+              << " ms, max frame " << max_frame_ms << " ms, max probe " << max_probe << std::endl;
+    for (size_t i = 0; i < stats.size(); i += std::max<size_t>(1, stats.size() / 8)) {
+        const auto& fs = stats[i];
+        std::cout << "  frame " << fs.frame << ": created " << fs.count_created << ", evicted " << fs.count_evicted
+                  << ", tombs " << fs.count_tomb << (fs.rebuilt ? " (rebuilt)" : "") << ", probe mean " << fs.mean_probe
+                  << " p99 " << fs.p99_probe << ", lookup mean " << fs.lookup_mean_probe << " p99 " << fs.lookup_p99_probe << std::endl;
+    }
+    print_probes("total", total);
+}
+
+int main(int argc, char** argv) {
+    unsigned count_threads = argc > 1 ? (unsigned)std::stoul(argv[1]) : 8;
+    uint32_t rounds = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 20;
+    uint32_t frames = argc > 3 ? (uint32_t)std::stoul(argv[3]) : 64;
+
+    uint64_t errors = 0;
+    for (ChunkHashTableMode mode : {ChunkHashTableMode::Linear, ChunkHashTableMode::Bucketed})
+        errors += run_stress(mode, count_threads, rounds);
+    for (ChunkHashTableMode mode : {ChunkHashTableMode::Linear, ChunkHashTableMode::Bucketed})
+        run_streaming(mode, count_threads, frames);
+
+    return errors == 0 ? 0 : 1;
+}
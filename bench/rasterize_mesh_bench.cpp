@@ -0,0 +1,249 @@
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "voxel_rastorizator.h"
+
+// Доля дубликатов в выходе CPU-растеризатора на меше и выигрыш от дедупликации битсетами:
+// VoxelRastorizator::rasterize_mesh против старого конвейера, где local id дописывались в бакеты чанков
+// с повторами, а voxel_generator и set_chunk_voxels получали каждое попадание треугольник-воксель.
+// Затем масштабирование rasterize_mesh_to_chunks по числу потоков 1, 2, 4, ..., max_threads.
+//
+//   rasterize_mesh_bench [mesh.vtk] [voxels_across] [repeats] [max_threads]
+
+static constexpr int CHUNK_SIZE = 16;
+
+// позиции из DATASET POLYDATA (та же перестановка осей, что в VtkMeshLoader), полигоны веером в треугольники
+static bool load_vtk_positions(const std::string& path, MeshData& mesh_data) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string tok;
+    int64_t num_points = -1;
+    while (in >> tok) {
+        if (tok == "POINTS") {
+            std::string scalar_type;
+            in >> num_points >> scalar_type;
+            mesh_data.vertices.resize((size_t)num_points * 3);
+            for (int64_t i = 0; i < num_points; i++) {
+                float x, y, z;
+                if (!(in >> x >> y >> z)) return false;
+                mesh_data.vertices[i * 3 + 0] = y;
+                mesh_data.vertices[i * 3 + 1] = z;
+                mesh_data.vertices[i * 3 + 2] = x;
+            }
+        } else if (tok == "POLYGONS") {
+            int64_t num_polys, total_ints;
+            in >> num_polys >> total_ints;
+            for (int64_t p = 0; p < num_polys; p++) {
+                int n;
+                if (!(in >> n)) return false;
+                std::vector<uint32_t> poly((size_t)n);
+                for (int i = 0; i < n; i++) in >> poly[(size_t)i];
+                for (int i = 1; i + 1 < n; i++) {
+                    mesh_data.indices.push_back(poly[0]);
+                    mesh_data.indices.push_back(poly[(size_t)i]);
+                    mesh_data.indices.push_back(poly[(size_t)i + 1]);
+                }
+            }
+            return num_points >= 0 && (bool)in;
+        }
+    }
+    return false;
+}
+
+// плотные массивы чанков, запись по local id - как применение правок к чанку
+class BenchGrid : public Gridable {
+public:
+    std::unordered_map<uint64_t, std::vector<Voxel>> chunks;
+
+    void set_voxels(const std::vector<Voxel>& voxels, const std::vector<glm::ivec3>& positions) override {
+        for (size_t i = 0; i < voxels.size(); i++) set_voxel(voxels[i], positions[i]);
+    }
+    void set_voxel(const Voxel& voxel, glm::ivec3 position) override {
+        glm::ivec3 cpos(math_utils::floor_div(position.x, CHUNK_SIZE), math_utils::floor_div(position.y, CHUNK_SIZE),
+                        math_utils::floor_div(position.z, CHUNK_SIZE));
+        glm::ivec3 l = position - cpos * CHUNK_SIZE;
+        chunk(cpos)[l.x + CHUNK_SIZE * (l.y + CHUNK_SIZE * l.z)] = voxel;
+    }
+    Voxel get_voxel(glm::ivec3) const override { return Voxel(); }
+
+    void set_chunk_voxels(glm::ivec3, const std::vector<ChunkVoxels>& edits) override {
+        for (const ChunkVoxels& edit : edits) {
+            std::vector<Voxel>& voxels = chunk(edit.chunk_pos);
+            for (size_t i = 0; i < edit.local_ids.size(); i++)
+                voxels[edit.local_ids[i]] = edit.voxels[i];
+        }
+    }
+
+private:
+    std::vector<Voxel>& chunk(glm::ivec3 cpos) {
+        std::vector<Voxel>& voxels = chunks[math_utils::pack_key(cpos.x, cpos.y, cpos.z)];
+        if (voxels.empty()) voxels.resize(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+        return voxels;
+    }
+};
+
+// старый конвейер (до битсетов): бакеты local id по чанкам с повторами, генератор на каждое попадание
+struct BucketsResult {
+    uint64_t count_points = 0;
+    double rasterize_ms = 0.0;
+    double generate_apply_ms = 0.0;
+};
+
+template <class F>
+static BucketsResult rasterize_mesh_buckets(const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+                                            F& voxel_generator, Gridable& grid)
+{
+    double t0 = math_utils::ms_now();
+    const glm::ivec3 chunk_size(CHUNK_SIZE);
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    std::vector<glm::ivec3> points;
+    uint64_t last_key = ~0ull;
+    std::vector<uint32_t>* last_bucket = nullptr;
+
+    for (size_t i = 0; i + 2 < mesh_data.indices.size(); i += 3) {
+        glm::vec3 v[3];
+        for (int k = 0; k < 3; k++) {
+            const float* p = &mesh_data.vertices[(size_t)mesh_data.indices[i + k] * 3];
+            v[k] = glm::vec3(transform * glm::vec4(p[0], p[1], p[2], 1.0f));
+        }
+        points.clear();
+        VoxelRastorizator::rasterize_triangle_to_points(v[0], v[1], v[2], voxel_size, points);
+        for (const glm::ivec3& p : points) {
+            glm::ivec3 cpos(math_utils::floor_div(p.x, CHUNK_SIZE), math_utils::floor_div(p.y, CHUNK_SIZE),
+                            math_utils::floor_div(p.z, CHUNK_SIZE));
+            uint64_t key = math_utils::pack_key(cpos.x, cpos.y, cpos.z);
+            if (key != last_key) {
+                last_bucket = &buckets[key];
+                last_key = key;
+            }
+            glm::ivec3 l = p - cpos * chunk_size;
+            last_bucket->push_back((uint32_t)(l.x + CHUNK_SIZE * (l.y + CHUNK_SIZE * l.z)));
+        }
+    }
+
+    double t1 = math_utils::ms_now();
+    BucketsResult result;
+    std::vector<ChunkVoxels> chunks;
+    chunks.reserve(buckets.size());
+    for (auto& [key, ids] : buckets) {
+        ChunkVoxels chunk;
+        chunk.chunk_pos = math_utils::unpack_key(key);
+        chunk.local_ids = std::move(ids);
+        chunk.voxels.reserve(chunk.local_ids.size());
+        glm::ivec3 origin = chunk.chunk_pos * chunk_size;
+        for (uint32_t id : chunk.local_ids) {
+            glm::ivec3 l((int)(id % CHUNK_SIZE), (int)(id / CHUNK_SIZE % CHUNK_SIZE), (int)(id / (CHUNK_SIZE * CHUNK_SIZE)));
+            chunk.voxels.push_back(voxel_generator(origin + l));
+        }
+        result.count_points += chunk.local_ids.size();
+        chunks.push_back(std::move(chunk));
+    }
+    grid.set_chunk_voxels(chunk_size, chunks);
+
+    result.rasterize_ms = t1 - t0;
+    result.generate_apply_ms = math_utils::ms_now() - t1;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "models/test_mesh.vtk";
+    float voxels_across = argc > 2 ? std::stof(argv[2]) : 256.0f;
+    int repeats = argc > 3 ? std::stoi(argv[3]) : 3;
+    unsigned max_threads = argc > 4 ? (unsigned)std::stoul(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+
+    MeshData mesh_data;
+    if (!load_vtk_positions(path, mesh_data)) {
+        std::cout << "rasterize_mesh_bench: can't read " << path << std::endl;
+        return 1;
+    }
+
+    // габариты по вершинам, на которые ссылаются треугольники (в файле бывают неиспользуемые точки)
+    glm::vec3 mn(1e30f), mx(-1e30f);
+    for (uint32_t id : mesh_data.indices) {
+        glm::vec3 p(mesh_data.vertices[id * 3 + 0], mesh_data.vertices[id * 3 + 1], mesh_data.vertices[id * 3 + 2]);
+        mn = glm::min(mn, p);
+        mx = glm::max(mx, p);
+    }
+    float extent = std::max(mx.x - mn.x, std::max(mx.y - mn.y, mx.z - mn.z));
+    float voxel_size = extent / voxels_across;
+    glm::mat4 transform(1.0f);
+
+    auto voxel_generator = [](glm::ivec3 p) {
+        return Voxel(glm::vec3(0.5f + 0.5f * std::sin(p.x * 0.1f), 0.5f + 0.5f * std::sin(p.y * 0.1f), 0.5f + 0.5f * std::sin(p.z * 0.1f)), true);
+    };
+
+    std::cout << path << ": " << mesh_data.indices.size() / 3 << " triangles, voxel size " << voxel_size
+              << " (" << voxels_across << " voxels across)" << std::endl;
+
+    double best_new = 1e30, best_old = 1e30;
+    VoxelRastorizator::RasterizeStats stats;
+    BucketsResult old_result;
+    for (int r = 0; r < repeats; r++) {
+        BenchGrid grid_new;
+        VoxelRastorizator rastorizator(&grid_new, glm::ivec3(CHUNK_SIZE));
+        double t0 = math_utils::ms_now();
+        rastorizator.rasterize_mesh(mesh_data, transform, voxel_generator, voxel_size, 0, 3);
+        double t1 = math_utils::ms_now();
+        stats = rastorizator.last_stats;
+
+        BenchGrid grid_old;
+        double t2 = math_utils::ms_now();
+        BucketsResult result = rasterize_mesh_buckets(mesh_data, transform, voxel_size, voxel_generator, grid_old);
+        double t3 = math_utils::ms_now();
+
+        best_new = std::min(best_new, t1 - t0);
+        if (t3 - t2 < best_old) {
+            best_old = t3 - t2;
+            old_result = result;
+        }
+    }
+
+    std::cout << "points: " << stats.count_points << ", unique: " << stats.count_unique_points
+              << " (duplicates " << stats.duplicate_ratio() * 100.0 << "%), chunks: " << stats.count_chunks << std::endl;
+    std::cout << "bitsets: rasterize " << stats.rasterize_ms << " ms, voxel_generator " << stats.generate_ms
+              << " ms, set_chunk_voxels " << stats.apply_ms << " ms, total " << best_new << " ms" << std::endl;
+    std::cout << "buckets: rasterize " << old_result.rasterize_ms << " ms, voxel_generator + set_chunk_voxels "
+              << old_result.generate_apply_ms << " ms (" << old_result.count_points << " calls), total " << best_old << " ms" << std::endl;
+    std::cout << "speedup: voxel_generator + set_chunk_voxels "
+              << old_result.generate_apply_ms / std::max(stats.generate_ms + stats.apply_ms, 1e-9)
+              << "x, total " << best_old / best_new << "x" << std::endl;
+
+    // Последовательная часть (merge_ms) не делится между потоками, поэтому кроме замеренного ускорения
+    // печатаем оценку по Амдалу из замера на одном потоке: T1 / ((T1 - merge1) / n + merge_n).
+    // Если ядер меньше n, потоки делят ядра и замеренное ускорение упирается в число ядер.
+    std::cout << "threads (hardware_concurrency " << std::thread::hardware_concurrency() << "):" << std::endl;
+    double t_one = 0.0, merge_one = 0.0;
+    bool same_points = true;
+    for (unsigned n = 1; n <= max_threads; n = n < max_threads && n * 2 > max_threads ? max_threads : n * 2) {
+        double best = 1e30;
+        VoxelRastorizator::RasterizeStats best_stats;
+        for (int r = 0; r < repeats; r++) {
+            VoxelRastorizator::RasterizeStats s;
+            double t0 = math_utils::ms_now();
+            std::vector<VoxelRastorizator::ChunkPoints> chunk_points = VoxelRastorizator::rasterize_mesh_to_chunks(
+                mesh_data, transform, voxel_size, 0, 3, glm::ivec3(CHUNK_SIZE), n, &s);
+            double t = math_utils::ms_now() - t0;
+            if (t < best) {
+                best = t;
+                best_stats = s;
+            }
+        }
+        same_points = same_points && best_stats.count_unique_points == stats.count_unique_points;
+        if (n == 1) {
+            t_one = best;
+            merge_one = best_stats.merge_ms;
+        }
+        double projected = t_one / std::max((t_one - merge_one) / n + best_stats.merge_ms, 1e-9);
+        std::cout << "  " << n << ": " << best << " ms (merge " << best_stats.merge_ms << " ms), speedup "
+                  << t_one / best << "x, Amdahl estimate " << projected << "x" << std::endl;
+        if (n == max_threads) break;
+    }
+
+    return old_result.count_points == stats.count_points && same_points ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "voxel_rastorizator.h"
+#include "tests/rasterize_reference.h"
+
+// rasterize_triangle_to_points на больших наклонных треугольниках: обход слоя плоскости по столбцам
+// против старого полного перебора AABB (каждый воксель через tri_box_overlap).
+// Полный перебор растёт как size^3, слой плоскости - как size^2.
+//
+//   rasterize_triangle_bench [size_in_voxels] [count_triangles]
+
+int main(int argc, char** argv) {
+    float size = argc > 1 ? std::stof(argv[1]) : 200.0f;
+    int count_triangles = argc > 2 ? std::stoi(argv[2]) : 8;
+
+    // наклонные ко всем осям: вершины на трёх осях куба size^3 плюс случайный сдвиг
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    for (int i = 0; i < count_triangles; i++) {
+        glm::vec3 o(jitter(rng) * size, jitter(rng) * size, jitter(rng) * size);
+        triangles.push_back({
+            o + glm::vec3(size * (1.0f + jitter(rng)), 0.0f, 0.0f),
+            o + glm::vec3(0.0f, size * (1.0f + jitter(rng)), 0.0f),
+            o + glm::vec3(0.0f, 0.0f, size * (1.0f + jitter(rng))),
+        });
+    }
+
+    std::cout << "tri_box_overlap_batch: " << VoxelRastorizator::tri_box_batch_isa() << std::endl;
+
+    uint64_t points_old = 0, points_new = 0;
+    bool same = true;
+    double old_ms = 0.0, new_ms = 0.0;
+    std::vector<glm::ivec3> out;
+    for (const auto& t : triangles) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<glm::ivec3> old_points = rasterize_full_aabb(t[0], t[1], t[2], 1.0f);
+        auto t1 = std::chrono::steady_clock::now();
+        out.clear();
+        VoxelRastorizator::rasterize_triangle_to_points(t[0], t[1], t[2], 1.0f, out);
+        auto t2 = std::chrono::steady_clock::now();
+
+        old_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        new_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        points_old += old_points.size();
+        points_new += out.size();
+        // порядок обхода разный, сравниваем множества
+        sort_points(old_points);
+        sort_points(out);
+        same = same && old_points.size() == out.size() && std::equal(old_points.begin(), old_points.end(), out.begin());
+    }
+
+    std::cout << "triangle size " << size << " voxels, " << count_triangles << " triangles, "
+              << points_new / std::max(1, count_triangles) << " points per triangle" << std::endl;
+    std::cout << "full AABB:   " << old_ms / count_triangles << " ms per triangle" << std::endl;
+    std::cout << "plane slab:  " << new_ms / count_triangles << " ms per triangle" << std::endl;
+    std::cout << "speedup: " << old_ms / std::max(new_ms, 1e-9) << "x" << std::endl;
+    if (!same) {
+        std::cout << "point sets differ: " << points_old << " vs " << points_new << " points" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -93,6 +93,7 @@ void BufferObject::read_binary_dump(const std::filesystem::path& file_path) {
 
 void BufferObject::realloc(GLsizeiptr size_bytes, GLenum usage, const void* data) {
     glNamedBufferData(id_, size_bytes, data, usage);
+    size_bytes_ = size_bytes;
     usage_ = usage;
 }
 
@@ -0,0 +1,835 @@
+#include "chunk_hash_table_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Делит [0, count) на блоки по block_size и раздаёт их count_threads потокам (текущий поток тоже работает).
+// fn(thread, begin, end) — thread нужен для потоковой ProbeStats.
+template <class F>
+static void parallel_blocks(size_t count, size_t block_size, unsigned count_threads, F&& fn) {
+    const size_t count_blocks = (count + block_size - 1) / block_size;
+    std::atomic<size_t> next_block{0};
+
+    auto worker = [&](unsigned thread) {
+        while (true) {
+            size_t block = next_block.fetch_add(1, std::memory_order_relaxed);
+            if (block >= count_blocks) break;
+            size_t begin = block * block_size;
+            fn(thread, begin, std::min(begin + block_size, count));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    unsigned n = (unsigned)std::max<size_t>(1, std::min<size_t>(count_threads, count_blocks));
+    workers.reserve(n - 1);
+    for (unsigned t = 1; t < n; t++)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : workers)
+        t.join();
+}
+
+// ---------- ProbeStats ----------
+
+void ChunkHashTableCPU::ProbeStats::add_probe(uint32_t probe) {
+    histogram[std::min(probe, MAX_PROBES)]++;
+}
+
+void ChunkHashTableCPU::ProbeStats::merge(const ProbeStats& other) {
+    for (size_t i = 0; i < histogram.size(); i++)
+        histogram[i] += other.histogram[i];
+
+    count_ops += other.count_ops;
+    count_found += other.count_found;
+    count_created += other.count_created;
+    count_reused_tombs += other.count_reused_tombs;
+    count_no_free_ids += other.count_no_free_ids;
+    count_probe_failed += other.count_probe_failed;
+    count_tombs_passed += other.count_tombs_passed;
+    count_locked_spins += other.count_locked_spins;
+    count_cas_retries += other.count_cas_retries;
+}
+
+double ChunkHashTableCPU::ProbeStats::mean_probe() const {
+    uint64_t count = 0, sum = 0;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        count += histogram[i];
+        sum += histogram[i] * i;
+    }
+    return count ? (double)sum / (double)count : 0.0;
+}
+
+uint32_t ChunkHashTableCPU::ProbeStats::percentile_probe(double p) const {
+    uint64_t count = 0;
+    for (uint64_t h : histogram) count += h;
+    if (count == 0) return 0;
+
+    uint64_t target = (uint64_t)std::ceil(std::clamp(p, 0.0, 1.0) * (double)count);
+    if (target == 0) target = 1;
+
+    uint64_t acc = 0;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        acc += histogram[i];
+        if (acc >= target) return (uint32_t)i;
+    }
+    return MAX_PROBES;
+}
+
+uint32_t ChunkHashTableCPU::ProbeStats::max_probe() const {
+    for (size_t i = histogram.size(); i-- > 0;)
+        if (histogram[i] != 0) return (uint32_t)i;
+    return 0;
+}
+
+// ---------- TombList ----------
+
+bool ChunkHashTableCPU::TombList::push(uint32_t slot_id) {
+    if (count >= TOMB_CHECK_LIST_SIZE)
+        return false;
+
+    if (count == 0u) {
+        head = 0u;
+        tail = 0u;
+    }
+    else {
+        head = (head + 1u) & (TOMB_CHECK_LIST_SIZE - 1u);
+    }
+
+    ids[head] = slot_id;
+    count++;
+    return true;
+}
+
+uint32_t ChunkHashTableCPU::TombList::pop_tail() {
+    if (count == 0u)
+        return INVALID_ID;
+
+    uint32_t result = ids[tail];
+    count--;
+
+    if (count == 0u) {
+        head = INVALID_ID;
+        tail = INVALID_ID;
+    } else {
+        tail = (tail + 1u) & (TOMB_CHECK_LIST_SIZE - 1u);
+    }
+
+    return result;
+}
+
+// ---------- ChunkHashTableCPU ----------
+
+ChunkHashTableCPU::ChunkHashTableCPU(uint32_t count_active_chunks, float chunk_hash_table_size_factor, float tomb_fraction_to_rebuild,
+                                     ChunkHashTableMode mode)
+    : mode(mode) {
+    if (count_active_chunks == 0) {
+        std::cout << "ChunkHashTableCPU: count_active_chunks must be > 0" << std::endl;
+        throw std::runtime_error("ChunkHashTableCPU: count_active_chunks must be > 0");
+    }
+
+    this->tomb_fraction_to_rebuild = tomb_fraction_to_rebuild;
+    max_chunks_ = count_active_chunks;
+
+    uint64_t raw = (uint64_t)std::ceil((double)chunk_hash_table_size_factor * (double)count_active_chunks);
+    uint32_t base = (raw > UINT32_MAX) ? UINT32_MAX : (uint32_t)raw;
+    size_ = math_utils::next_pow2_u32(base);
+    if (mode == ChunkHashTableMode::Bucketed)
+        size_ = std::max(size_, HASH_TABLE_BUCKET_SLOTS);
+
+    uint32_t count_overflow = mode == ChunkHashTableMode::Bucketed ? bucket_count() : 0u;
+    hash_keys_.reset(new std::atomic<uint32_t>[2ull * size_]);
+    hash_vals_.reset(new std::atomic<uint32_t>[1ull + size_ + count_overflow]);
+    free_list_.resize(max_chunks_);
+    meta_.resize(max_chunks_);
+    enqueued_.resize(max_chunks_);
+
+    init();
+}
+
+void ChunkHashTableCPU::init() {
+    for (uint32_t i = 0; i < size_; i++) {
+        val(i).store(SLOT_EMPTY, std::memory_order_relaxed);
+        store_key(i, glm::uvec2(0u, 0u));
+    }
+    hash_vals_[0].store(0u, std::memory_order_relaxed);
+    if (mode == ChunkHashTableMode::Bucketed)
+        for (uint32_t b = 0; b < bucket_count(); b++) bucket_overflow(b).store(0u, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < max_chunks_; i++) {
+        free_list_[i] = i;
+        enqueued_[i] = 0u;
+        meta_[i] = ChunkMeta{0u, 0u, 0u, 0u};
+    }
+    free_count_.store(max_chunks_, std::memory_order_release);
+    evict_freed_count_.store(0u, std::memory_order_release);
+    count_rebuilds_ = 0;
+}
+
+unsigned ChunkHashTableCPU::thread_count(unsigned count_threads, size_t work_items) const {
+    unsigned n = count_threads;
+    if (n == 0) n = std::thread::hardware_concurrency();
+    if (n == 0) n = 4;
+    return (unsigned)std::max<size_t>(1, std::min<size_t>(n, work_items));
+}
+
+// hash_uvec2 из utils.glsl
+uint32_t ChunkHashTableCPU::hash_uvec2(glm::uvec2 v) {
+    uint32_t x = v.x * 1664525u + 1013904223u;
+    uint32_t y = v.y * 22695477u + 1u;
+    uint32_t h = x ^ (y + (x << 16) + (x >> 16));
+    h ^= h >> 16; h *= 0x7feb352du;
+    h ^= h >> 15; h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// pack_key_uvec2 из utils.glsl: z с бита 0, y с бита B, x с бита 2B, 64 бита в lo/hi
+glm::uvec2 ChunkHashTableCPU::pack_key_uvec2(glm::ivec3 c, uint32_t pack_offset, uint32_t pack_bits) {
+    uint32_t B = pack_bits;
+    uint64_t m = B >= 32u ? 0xFFFFFFFFull : ((1ull << B) - 1ull);
+
+    uint64_t ux = (uint32_t)(c.x + (int32_t)pack_offset) & m;
+    uint64_t uy = (uint32_t)(c.y + (int32_t)pack_offset) & m;
+    uint64_t uz = (uint32_t)(c.z + (int32_t)pack_offset) & m;
+
+    uint64_t key = uz;
+    if (B < 64u) key |= uy << B;
+    if (2u * B < 64u) key |= ux << (2u * B);
+
+    return glm::uvec2((uint32_t)key, (uint32_t)(key >> 32));
+}
+
+bool ChunkHashTableCPU::key_equals(uint32_t idx, glm::uvec2 key) const {
+    return hash_keys_[2ull * idx].load(std::memory_order_relaxed) == key.x &&
+           hash_keys_[2ull * idx + 1].load(std::memory_order_relaxed) == key.y;
+}
+
+void ChunkHashTableCPU::store_key(uint32_t idx, glm::uvec2 key) {
+    hash_keys_[2ull * idx].store(key.x, std::memory_order_relaxed);
+    hash_keys_[2ull * idx + 1].store(key.y, std::memory_order_relaxed);
+}
+
+uint32_t ChunkHashTableCPU::pop_free_chunk_id(ProbeStats* stats) {
+    for (;;) {
+        uint32_t old_counter = free_count_.load(std::memory_order_acquire);
+        if (old_counter == 0u) return INVALID_ID;
+
+        if (free_count_.compare_exchange_strong(old_counter, old_counter - 1u, std::memory_order_acq_rel))
+            return free_list_[old_counter - 1u];
+
+        if (stats) stats->count_cas_retries++;
+    }
+}
+
+bool ChunkHashTableCPU::insert(glm::uvec2 key, uint32_t chunk_id, uint32_t& out_id, bool& created, ProbeStats* stats) {
+    const bool allocate = chunk_id == INVALID_ID; // get_or_create_chunk
+    uint32_t mask = size_ - 1u;
+    uint32_t idx  = hash_uvec2(key) & mask;
+    uint32_t last_tomb_id = INVALID_ID;
+    TombList tombs;
+
+    created = false;
+    if (stats) stats->count_ops++;
+
+    for (uint32_t probe = 0u; probe < MAX_PROBES + 1u;) {
+        // после неудачного CAS на probe == MAX_PROBES idx уже INVALID_ID, а ветка ниже берётся по probe
+        uint32_t v = idx == INVALID_ID ? SLOT_EMPTY : val(idx).load(std::memory_order_acquire);
+
+        if (v == SLOT_EMPTY || probe == MAX_PROBES) {
+            if (probe >= MAX_PROBES) idx = INVALID_ID;
+
+            // не нашли ключ, создаём (в приоритете в могилу)
+            if (last_tomb_id == INVALID_ID) last_tomb_id = tombs.pop_tail();
+
+            uint32_t idx_to_create = last_tomb_id == INVALID_ID ? idx : last_tomb_id;
+            uint32_t slot_state = last_tomb_id == INVALID_ID ? SLOT_EMPTY : SLOT_TOMB;
+
+            if (idx_to_create == INVALID_ID) {
+                if (stats) stats->count_probe_failed++;
+                return false;
+            }
+
+            uint32_t prev = slot_state;
+            if (!val(idx_to_create).compare_exchange_strong(prev, SLOT_LOCKED, std::memory_order_acq_rel)) {
+                // кто-то успел — могила занята живым ключом, берём следующую; иначе перепроверяем тот же idx
+                if (stats) stats->count_cas_retries++;
+                if (last_tomb_id != INVALID_ID && prev != SLOT_LOCKED)
+                    last_tomb_id = INVALID_ID;
+                continue;
+            }
+
+            uint32_t id = chunk_id;
+            if (allocate) {
+                id = pop_free_chunk_id(stats);
+                if (id == INVALID_ID) {
+                    val(idx_to_create).exchange(slot_state, std::memory_order_acq_rel);
+                    if (stats) stats->count_no_free_ids++;
+                    return false;
+                }
+            }
+
+            if (slot_state == SLOT_TOMB) {
+                hash_vals_[0].fetch_sub(1u, std::memory_order_acq_rel);
+                if (stats) stats->count_reused_tombs++;
+            }
+
+            if (allocate) {
+                // meta до публикации id
+                meta_[id] = ChunkMeta{1u, key.x, key.y, 0u};
+                enqueued_[id] = 0u;
+            }
+
+            store_key(idx_to_create, key);
+
+            // публикуем id (и одновременно снимаем блокировку)
+            val(idx_to_create).exchange(id, std::memory_order_acq_rel);
+
+            out_id = id;
+            created = true;
+            if (stats) {
+                stats->count_created++;
+                stats->add_probe(probe);
+            }
+            return true;
+        }
+
+        if (v == SLOT_LOCKED) {
+            if (stats) stats->count_locked_spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (v == SLOT_TOMB) {
+            tombs.push(idx);
+            idx = (idx + 1u) & mask;
+            probe++;
+            if (stats) stats->count_tombs_passed++;
+            continue;
+        }
+
+        if (key_equals(idx, key)) {
+            if (stats) {
+                stats->count_found++;
+                stats->add_probe(probe);
+            }
+            // set_chunk: ключ уже есть
+            if (!allocate) return false;
+
+            out_id = v;
+            return true;
+        }
+
+        idx = (idx + 1u) & mask;
+        probe++;
+    }
+
+    if (stats) stats->count_probe_failed++;
+    return false;
+}
+
+bool ChunkHashTableCPU::get_or_create_chunk(glm::uvec2 key, uint32_t& out_id, bool& created, ProbeStats* stats) {
+    if (mode == ChunkHashTableMode::Bucketed) return bucketed_insert(key, INVALID_ID, out_id, created, stats);
+    return insert(key, INVALID_ID, out_id, created, stats);
+}
+
+bool ChunkHashTableCPU::set_chunk(glm::uvec2 key, uint32_t chunk_id, ProbeStats* stats) {
+    if (chunk_id >= max_chunks_) {
+        std::cout << "ChunkHashTableCPU::set_chunk: chunk_id " << chunk_id << " out of range" << std::endl;
+        throw std::runtime_error("ChunkHashTableCPU::set_chunk: chunk_id out of range");
+    }
+
+    uint32_t out_id;
+    bool created;
+    if (mode == ChunkHashTableMode::Bucketed) return bucketed_insert(key, chunk_id, out_id, created, stats);
+    return insert(key, chunk_id, out_id, created, stats);
+}
+
+uint32_t ChunkHashTableCPU::lookup_chunk(glm::uvec2 key, ProbeStats* stats) {
+    if (mode == ChunkHashTableMode::Bucketed) return bucketed_lookup_chunk(key, stats);
+    return linear_lookup_chunk(key, stats);
+}
+
+bool ChunkHashTableCPU::remove_from_table(glm::uvec2 key, ProbeStats* stats) {
+    if (mode == ChunkHashTableMode::Bucketed) return bucketed_remove_from_table(key, stats);
+    return linear_remove_from_table(key, stats);
+}
+
+uint32_t ChunkHashTableCPU::linear_lookup_chunk(glm::uvec2 key, ProbeStats* stats) {
+    uint32_t mask = size_ - 1u;
+    uint32_t idx  = hash_uvec2(key) & mask;
+
+    if (stats) stats->count_ops++;
+
+    for (uint32_t probe = 0u; probe < MAX_PROBES;) {
+        uint32_t v = val(idx).load(std::memory_order_acquire);
+
+        if (v == SLOT_LOCKED) {
+            if (stats) stats->count_locked_spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (v == SLOT_TOMB) {
+            idx = (idx + 1u) & mask;
+            probe++;
+            if (stats) stats->count_tombs_passed++;
+            continue;
+        }
+
+        if (v == SLOT_EMPTY) {
+            if (stats) stats->add_probe(probe);
+            return INVALID_ID;
+        }
+
+        if (key_equals(idx, key)) {
+            if (stats) {
+                stats->count_found++;
+                stats->add_probe(probe);
+            }
+            return v;
+        }
+
+        idx = (idx + 1u) & mask;
+        probe++;
+    }
+
+    if (stats) stats->count_probe_failed++;
+    return INVALID_ID;
+}
+
+bool ChunkHashTableCPU::linear_remove_from_table(glm::uvec2 key, ProbeStats* stats) {
+    uint32_t mask = size_ - 1u;
+    uint32_t idx  = hash_uvec2(key) & mask;
+
+    if (stats) stats->count_ops++;
+
+    for (uint32_t probe = 0u; probe < MAX_PROBES;) {
+        uint32_t v = val(idx).load(std::memory_order_acquire);
+
+        if (v == SLOT_LOCKED) {
+            if (stats) stats->count_locked_spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (v == SLOT_EMPTY) {
+            if (stats) stats->add_probe(probe);
+            return false;
+        }
+
+        if (v == SLOT_TOMB) {
+            idx = (idx + 1u) & mask;
+            probe++;
+            if (stats) stats->count_tombs_passed++;
+            continue;
+        }
+
+        if (key_equals(idx, key)) {
+            val(idx).exchange(SLOT_TOMB, std::memory_order_acq_rel);
+            hash_vals_[0].fetch_add(1u, std::memory_order_acq_rel);
+            if (stats) {
+                stats->count_found++;
+                stats->add_probe(probe);
+            }
+            return true;
+        }
+
+        idx = (idx + 1u) & mask;
+        probe++;
+    }
+
+    if (stats) stats->count_probe_failed++;
+    return false;
+}
+
+// ---------- HASH_TABLE_BUCKETED ----------
+
+uint32_t ChunkHashTableCPU::secondary_hash(glm::uvec2 key) {
+    return hash_uvec2(glm::uvec2(key.y ^ 0x9e3779b9u, key.x ^ 0x85ebca6bu));
+}
+
+uint32_t ChunkHashTableCPU::primary_bucket(glm::uvec2 key) const {
+    return hash_uvec2(key) & (bucket_count() - 1u);
+}
+
+uint32_t ChunkHashTableCPU::secondary_bucket(glm::uvec2 key, uint32_t primary) const {
+    uint32_t b = secondary_hash(key) & (bucket_count() - 1u);
+    return b == primary ? ((b + 1u) & (bucket_count() - 1u)) : b;
+}
+
+uint32_t ChunkHashTableCPU::bucket_find(uint32_t b, uint32_t start, glm::uvec2 key, uint32_t& slot, uint32_t& first_empty, uint32_t& count_read, ProbeStats* stats) {
+    uint32_t base = b * HASH_TABLE_BUCKET_SLOTS;
+    slot = INVALID_ID;
+    first_empty = INVALID_ID;
+
+    for (uint32_t s = 0u; s < HASH_TABLE_BUCKET_SLOTS;) {
+        uint32_t idx = base + ((start + s) & (HASH_TABLE_BUCKET_SLOTS - 1u));
+        uint32_t v = val(idx).load(std::memory_order_acquire);
+
+        if (v == SLOT_LOCKED) {
+            if (stats) stats->count_locked_spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        count_read++;
+        if (v == SLOT_EMPTY) {
+            if (first_empty == INVALID_ID) first_empty = idx;
+        }
+        else if (key_equals(idx, key)) {
+            slot = idx;
+            return v;
+        }
+        s++;
+    }
+    return INVALID_ID;
+}
+
+ChunkHashTableCPU::BucketResult ChunkHashTableCPU::bucketed_find_or_claim(glm::uvec2 key, uint32_t& out_slot, uint32_t& out_id,
+                                                                          uint32_t& out_primary, ProbeStats* stats) {
+    uint32_t b1 = primary_bucket(key);
+    uint32_t b2 = secondary_bucket(key, b1);
+    uint32_t start1 = hash_uvec2(key) >> BUCKET_START_SHIFT;
+    uint32_t start2 = secondary_hash(key) >> BUCKET_START_SHIFT;
+    out_primary = b1;
+
+    for (;;) {
+        uint32_t slot, empty1, empty2 = INVALID_ID, count_read = 0;
+        uint32_t id = bucket_find(b1, start1, key, slot, empty1, count_read, stats);
+
+        if (id == INVALID_ID && (empty1 == INVALID_ID || bucket_overflow(b1).load(std::memory_order_acquire) != 0u))
+            id = bucket_find(b2, start2, key, slot, empty2, count_read, stats);
+
+        if (id != INVALID_ID) {
+            out_slot = slot;
+            out_id = id;
+            if (stats) {
+                stats->count_found++;
+                stats->add_probe(count_read - 1u);
+            }
+            return BucketResult::Found;
+        }
+
+        uint32_t target = empty1 != INVALID_ID ? empty1 : empty2;
+        if (target == INVALID_ID) {
+            if (stats) stats->count_probe_failed++;
+            return BucketResult::Full;
+        }
+
+        // кто-то занял слот раньше — ищем заново
+        uint32_t expected = SLOT_EMPTY;
+        if (!val(target).compare_exchange_strong(expected, SLOT_LOCKED, std::memory_order_acq_rel)) {
+            if (stats) stats->count_cas_retries++;
+            continue;
+        }
+
+        out_slot = target;
+        out_id = INVALID_ID;
+        if (stats) stats->add_probe(count_read - 1u);
+        return BucketResult::Claimed;
+    }
+}
+
+bool ChunkHashTableCPU::bucketed_insert(glm::uvec2 key, uint32_t chunk_id, uint32_t& out_id, bool& created, ProbeStats* stats) {
+    const bool allocate = chunk_id == INVALID_ID; // get_or_create_chunk
+    uint32_t slot, id, primary;
+
+    created = false;
+    if (stats) stats->count_ops++;
+
+    BucketResult res = bucketed_find_or_claim(key, slot, id, primary, stats);
+    if (res == BucketResult::Full) return false;
+
+    if (res == BucketResult::Found) {
+        // set_chunk: ключ уже есть
+        if (!allocate) return false;
+        out_id = id;
+        return true;
+    }
+
+    id = chunk_id;
+    if (allocate) {
+        id = pop_free_chunk_id(stats);
+        if (id == INVALID_ID) {
+            val(slot).exchange(SLOT_EMPTY, std::memory_order_acq_rel);
+            if (stats) stats->count_no_free_ids++;
+            return false;
+        }
+    }
+
+    // ключ ушёл в запасной бакет — поиск по основному должен туда заглянуть
+    if (slot / HASH_TABLE_BUCKET_SLOTS != primary) bucket_overflow(primary).fetch_add(1u, std::memory_order_acq_rel);
+
+    if (allocate) {
+        meta_[id] = ChunkMeta{1u, key.x, key.y, 0u};
+        enqueued_[id] = 0u;
+    }
+
+    store_key(slot, key);
+    val(slot).exchange(id, std::memory_order_acq_rel);
+
+    out_id = id;
+    created = true;
+    if (stats) stats->count_created++;
+    return true;
+}
+
+uint32_t ChunkHashTableCPU::bucketed_lookup_chunk(glm::uvec2 key, ProbeStats* stats) {
+    uint32_t b1 = primary_bucket(key);
+    uint32_t slot, empty, count_read = 0;
+
+    if (stats) stats->count_ops++;
+
+    uint32_t id = bucket_find(b1, hash_uvec2(key) >> BUCKET_START_SHIFT, key, slot, empty, count_read, stats);
+    if (id == INVALID_ID && bucket_overflow(b1).load(std::memory_order_acquire) != 0u)
+        id = bucket_find(secondary_bucket(key, b1), secondary_hash(key) >> BUCKET_START_SHIFT, key, slot, empty, count_read, stats);
+
+    if (stats) {
+        if (id != INVALID_ID) stats->count_found++;
+        stats->add_probe(count_read - 1u);
+    }
+    return id;
+}
+
+bool ChunkHashTableCPU::bucketed_remove_from_table(glm::uvec2 key, ProbeStats* stats) {
+    uint32_t b1 = primary_bucket(key);
+    uint32_t slot, empty, count_read = 0;
+    bool secondary = false;
+
+    if (stats) stats->count_ops++;
+
+    uint32_t id = bucket_find(b1, hash_uvec2(key) >> BUCKET_START_SHIFT, key, slot, empty, count_read, stats);
+    if (id == INVALID_ID && bucket_overflow(b1).load(std::memory_order_acquire) != 0u) {
+        id = bucket_find(secondary_bucket(key, b1), secondary_hash(key) >> BUCKET_START_SHIFT, key, slot, empty, count_read, stats);
+        secondary = true;
+    }
+
+    if (stats) stats->add_probe(count_read - 1u);
+    if (id == INVALID_ID) return false;
+
+    val(slot).exchange(SLOT_EMPTY, std::memory_order_acq_rel); // могила не нужна
+    if (secondary) bucket_overflow(b1).fetch_sub(1u, std::memory_order_acq_rel);
+    if (stats) stats->count_found++;
+    return true;
+}
+
+uint32_t ChunkHashTableCPU::evict_chunk(uint32_t victim) {
+    if (victim == INVALID_ID || victim >= max_chunks_) return INVALID_ID;
+    if (meta_[victim].used == 0u) return INVALID_ID;
+
+    uint32_t slot = free_count_.load(std::memory_order_acquire) + evict_freed_count_.fetch_add(1u, std::memory_order_relaxed);
+    if (slot >= max_chunks_) {
+        std::cout << "ChunkHashTableCPU::evict_chunk: free_list overflow (" << slot << " >= " << max_chunks_ << ")" << std::endl;
+        throw std::runtime_error("ChunkHashTableCPU::evict_chunk: free_list overflow");
+    }
+
+    glm::uvec2 key(meta_[victim].key_lo, meta_[victim].key_hi);
+    remove_from_table(key);
+
+    meta_[victim].used = 0u;
+    meta_[victim].dirty_flags = 0u;
+    enqueued_[victim] = 0u;
+
+    free_list_[slot] = victim;
+    return victim;
+}
+
+void ChunkHashTableCPU::commit_evicted() {
+    uint32_t count_evicted = evict_freed_count_.exchange(0u, std::memory_order_acq_rel);
+    uint32_t count = free_count_.load(std::memory_order_acquire);
+    if ((uint64_t)count + count_evicted > max_chunks_) {
+        std::cout << "ChunkHashTableCPU::commit_evicted: free_count overflow (" << count << " + " << count_evicted << ")" << std::endl;
+        throw std::runtime_error("ChunkHashTableCPU::commit_evicted: free_count overflow");
+    }
+    free_count_.store(count + count_evicted, std::memory_order_release);
+}
+
+void ChunkHashTableCPU::clear_table() {
+    for (uint32_t i = 0; i < size_; i++) {
+        store_key(i, glm::uvec2(0u, 0u));
+        val(i).store(SLOT_EMPTY, std::memory_order_relaxed);
+    }
+}
+
+void ChunkHashTableCPU::fill_table(unsigned count_threads) {
+    parallel_blocks(max_chunks_, 1024, thread_count(count_threads, max_chunks_ / 1024 + 1), [&](unsigned, size_t begin, size_t end) {
+        for (size_t id = begin; id < end; id++) {
+            const ChunkMeta& m = meta_[id];
+            if (m.used == 0u) continue;
+            set_chunk(glm::uvec2(m.key_lo, m.key_hi), (uint32_t)id);
+        }
+    });
+}
+
+bool ChunkHashTableCPU::rebuild_if_needed(unsigned count_threads) {
+    if (mode == ChunkHashTableMode::Bucketed) return false;
+    if (count_tomb() < tombs_to_rebuild()) return false;
+
+    hash_vals_[0].store(0u, std::memory_order_release);
+    clear_table();
+    fill_table(count_threads);
+    count_rebuilds_++;
+    return true;
+}
+
+ChunkHashTableCPU::TableStats ChunkHashTableCPU::table_stats() const {
+    TableStats stats;
+    stats.size = size_;
+    stats.count_tomb = count_tomb();
+
+    uint32_t mask = size_ - 1u;
+    uint32_t run = 0, first_run = 0;
+    bool wrapped_run = true; // цепочка с начала массива продолжается с конца
+
+    for (uint32_t i = 0; i < size_; i++) {
+        uint32_t v = val(i).load(std::memory_order_acquire);
+
+        if (v == SLOT_EMPTY) {
+            stats.count_empty++;
+            if (wrapped_run) { first_run = run; wrapped_run = false; }
+            stats.longest_run = std::max(stats.longest_run, run);
+            run = 0;
+            continue;
+        }
+
+        run++;
+        if (v == SLOT_TOMB || v == SLOT_LOCKED) {
+            stats.count_tomb_slots++;
+            continue;
+        }
+
+        stats.count_live++;
+        glm::uvec2 key(hash_keys_[2ull * i].load(std::memory_order_relaxed), hash_keys_[2ull * i + 1].load(std::memory_order_relaxed));
+        uint32_t home = hash_uvec2(key) & mask;
+        stats.displacement[std::min((i - home) & mask, MAX_PROBES)]++;
+    }
+
+    stats.longest_run = std::max(stats.longest_run, wrapped_run ? run : run + first_run);
+
+    if (mode == ChunkHashTableMode::Bucketed) {
+        for (uint32_t b = 0; b < bucket_count(); b++) {
+            uint32_t c = hash_vals_[1ull + size_ + b].load(std::memory_order_acquire);
+            if (c != 0u) stats.count_overflowed_buckets++;
+            stats.count_secondary_keys += c;
+        }
+    }
+    return stats;
+}
+
+std::vector<ChunkHashTableCPU::FrameStats> ChunkHashTableCPU::simulate_streaming(const StreamParams& params, ProbeStats* total) {
+    const int R = params.radius_chunks;
+    const uint32_t min_free = params.min_free_chunks ? params.min_free_chunks : max_chunks_ / 3u;
+
+    // смещения шара, как в stream_select_chunks.glsl
+    std::vector<glm::ivec3> sphere;
+    for (int z = -R; z <= R; z++)
+        for (int y = -R; y <= R; y++)
+            for (int x = -R; x <= R; x++)
+                if (x * x + y * y + z * z <= R * R) sphere.emplace_back(x, y, z);
+
+    const unsigned n_threads = thread_count(params.count_threads, sphere.size() / 256 + 1);
+
+    std::vector<FrameStats> frames;
+    frames.reserve(params.count_frames);
+
+    std::vector<ProbeStats> thread_stats(n_threads);
+    std::vector<std::pair<int64_t, uint32_t>> candidates;
+    std::vector<uint32_t> victims;
+    glm::ivec3 cam_chunk(0);
+
+    for (uint32_t frame = 0; frame < params.count_frames; frame++) {
+        double t0 = math_utils::ms_now();
+
+        FrameStats fs;
+        fs.frame = frame;
+
+        // вытеснение дальних (ensure_free_chunks_gpu), на GPU — по корзинам расстояний
+        uint32_t free_now = free_count();
+        if (free_now < min_free) {
+            uint32_t count_to_evict = min_free - free_now;
+
+            candidates.clear();
+            for (uint32_t id = 0; id < max_chunks_; id++) {
+                if (meta_[id].used == 0u) continue;
+                uint64_t packed = (uint64_t)meta_[id].key_lo | ((uint64_t)meta_[id].key_hi << 32);
+                glm::ivec3 d = math_utils::unpack_key(packed) - cam_chunk;
+                candidates.emplace_back(-((int64_t)d.x * d.x + (int64_t)d.y * d.y + (int64_t)d.z * d.z), id);
+            }
+
+            count_to_evict = std::min<uint32_t>(count_to_evict, (uint32_t)candidates.size());
+            std::partial_sort(candidates.begin(), candidates.begin() + count_to_evict, candidates.end());
+
+            victims.resize(count_to_evict);
+            for (uint32_t i = 0; i < count_to_evict; i++) victims[i] = candidates[i].second;
+
+            std::atomic<uint32_t> evicted{0};
+            parallel_blocks(victims.size(), 256, thread_count(params.count_threads, victims.size() / 256 + 1), [&](unsigned, size_t begin, size_t end) {
+                uint32_t local = 0;
+                for (size_t i = begin; i < end; i++)
+                    if (evict_chunk(victims[i]) != INVALID_ID) local++;
+                evicted.fetch_add(local, std::memory_order_relaxed);
+            });
+            commit_evicted();
+            fs.count_evicted = evicted.load();
+        }
+
+        fs.count_tomb = count_tomb();
+        fs.rebuilt = rebuild_if_needed(params.count_threads);
+
+        // stream_select_chunks
+        double t_insert = math_utils::ms_now();
+        for (auto& s : thread_stats) s = ProbeStats();
+        std::atomic<uint32_t> created{0}, failed{0};
+        parallel_blocks(sphere.size(), 256, n_threads, [&](unsigned thread, size_t begin, size_t end) {
+            ProbeStats& st = thread_stats[thread];
+            uint32_t local_created = 0, local_failed = 0;
+            for (size_t i = begin; i < end; i++) {
+                uint32_t id;
+                bool was_created;
+                if (!get_or_create_chunk(pack_key_uvec2(cam_chunk + sphere[i]), id, was_created, &st)) local_failed++;
+                else if (was_created) local_created++;
+            }
+            created.fetch_add(local_created, std::memory_order_relaxed);
+            failed.fetch_add(local_failed, std::memory_order_relaxed);
+        });
+
+        ProbeStats frame_stats;
+        for (const auto& s : thread_stats) frame_stats.merge(s);
+        if (total) total->merge(frame_stats);
+
+        // соседи для мешинга (mesh_count), на краю шара — промахи
+        double t_lookup = math_utils::ms_now();
+        static const glm::ivec3 neighbours[6] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
+        for (auto& s : thread_stats) s = ProbeStats();
+        parallel_blocks(sphere.size(), 256, n_threads, [&](unsigned thread, size_t begin, size_t end) {
+            ProbeStats& st = thread_stats[thread];
+            for (size_t i = begin; i < end; i++)
+                for (const glm::ivec3& n : neighbours)
+                    lookup_chunk(pack_key_uvec2(cam_chunk + sphere[i] + n), &st);
+        });
+
+        ProbeStats lookup_stats;
+        for (const auto& s : thread_stats) lookup_stats.merge(s);
+        if (total) total->merge(lookup_stats);
+        double t_end = math_utils::ms_now();
+
+        fs.count_requested = (uint32_t)sphere.size();
+        fs.count_created = created.load();
+        fs.count_failed = failed.load();
+        fs.count_live = max_chunks_ - free_count();
+        fs.mean_probe = frame_stats.mean_probe();
+        fs.p99_probe = frame_stats.percentile_probe(0.99);
+        fs.max_probe = frame_stats.max_probe();
+        fs.lookup_mean_probe = lookup_stats.mean_probe();
+        fs.lookup_p99_probe = lookup_stats.percentile_probe(0.99);
+        fs.insert_ms = t_lookup - t_insert;
+        fs.lookup_ms = t_end - t_lookup;
+        fs.frame_ms = t_end - t0;
+
+        frames.push_back(fs);
+        cam_chunk += params.step;
+    }
+
+    return frames;
+}
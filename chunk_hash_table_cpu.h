@@ -0,0 +1,207 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "math_utils.h"
+#include "chunk_hash_table_mode.h"
+
+// CPU-модель хеш-таблицы чанков VoxelGridGPU (shaders/voxel_grid/common/hash_table.glsl):
+// тот же алгоритм (открытая адресация, SLOT_LOCKED/SLOT_TOMB, MAX_PROBES, tomb_check_list, перестройка по
+// tomb_fraction_to_rebuild) и та же раскладка (uvec2 keys, count_tomb + vals, free_count + free_list, meta, enqueued).
+// Оба режима ChunkHashTableMode: Bucketed повторяет bucketed_* функции шейдера, счётчики переполнения — за слотами vals.
+// Методы потокобезопасны так же, как шейдеры: get_or_create/lookup/remove/set зовутся параллельно в одной фазе,
+// evict_chunk — в отдельной фазе (как evict_low_priority), commit_evicted/rebuild_if_needed — между фазами.
+// Нужна для стресс-тестов без GPU и для подбора chunk_hash_table_size_factor по длинам проб (bench/hash_table_bench),
+// в движок не линкуется.
+class ChunkHashTableCPU {
+public:
+    static constexpr uint32_t INVALID_ID = 0xFFFFFFFFu;
+
+    static constexpr uint32_t SLOT_EMPTY = 0xFFFFFFFFu;
+    static constexpr uint32_t SLOT_LOCKED = 0xFFFFFFFEu;
+    static constexpr uint32_t SLOT_TOMB = 0xFFFFFFFDu;
+
+    static constexpr uint32_t MAX_PROBES = 128u;
+    static constexpr uint32_t TOMB_CHECK_LIST_SIZE = 32u;
+    static_assert((TOMB_CHECK_LIST_SIZE & (TOMB_CHECK_LIST_SIZE - 1u)) == 0u);
+
+    // как ChunkMeta в buffer_structures.glsl
+    struct ChunkMeta {
+        uint32_t used;
+        uint32_t key_lo;
+        uint32_t key_hi;
+        uint32_t dirty_flags;
+    };
+    static_assert(sizeof(ChunkMeta) == 16);
+
+    // Статистика операций. Каждый поток копит свою, потом merge.
+    // Длина пробы — значение probe в момент выхода из цикла шейдера (число пройденных слотов, LOCKED не считаются),
+    // в Bucketed — число просмотренных слотов до найденного (или всех просмотренных при промахе) минус один.
+    struct ProbeStats {
+        std::array<uint64_t, MAX_PROBES + 1> histogram{};
+        uint64_t count_ops = 0;
+        uint64_t count_found = 0;
+        uint64_t count_created = 0;       // get_or_create/set_chunk заняли слот
+        uint64_t count_reused_tombs = 0;  // из них в слот-могилу
+        uint64_t count_no_free_ids = 0;   // слот был, free_list пуст
+        uint64_t count_probe_failed = 0;  // ни EMPTY, ни TOMB за MAX_PROBES
+        uint64_t count_tombs_passed = 0;
+        uint64_t count_locked_spins = 0;
+        uint64_t count_cas_retries = 0;
+
+        void add_probe(uint32_t probe);
+        void merge(const ProbeStats& other);
+        double mean_probe() const;
+        uint32_t percentile_probe(double p) const; // p в [0, 1]
+        uint32_t max_probe() const;
+    };
+
+    // Состояние таблицы, считается проходом по слотам — звать между фазами.
+    struct TableStats {
+        uint32_t size = 0;
+        uint32_t count_live = 0;
+        uint32_t count_tomb_slots = 0;
+        uint32_t count_empty = 0;
+        uint32_t count_tomb = 0;          // счётчик из vals[0], сбрасывается перестройкой
+        uint32_t longest_run = 0;         // самая длинная цепочка занятых слотов (live + tomb)
+        uint32_t count_overflowed_buckets = 0; // Bucketed: бакеты, часть ключей которых лежит в запасном
+        uint32_t count_secondary_keys = 0;
+        std::array<uint64_t, MAX_PROBES + 1> displacement{}; // расстояние live-ключа от домашнего слота (Linear)
+
+        double load_factor() const { return size ? (double)count_live / (double)size : 0.0; }
+        double tomb_fraction() const { return size ? (double)count_tomb_slots / (double)size : 0.0; }
+    };
+
+    // Потоковая нагрузка как в stream_chunks_sphere: шар чанков вокруг камеры, камера сдвигается на step за кадр.
+    // Кадр: вытеснение дальних чанков до min_free_chunks свободных (ensure_free_chunks_gpu), перестройка,
+    // затем get_or_create всех чанков шара в count_threads потоков и lookup 6 соседей каждого (как mesh_count).
+    struct StreamParams {
+        int radius_chunks = 8;
+        glm::ivec3 step = glm::ivec3(1, 0, 0);
+        uint32_t count_frames = 256;
+        uint32_t min_free_chunks = 0; // 0 — max_chunks / 3, как в main.cpp
+        unsigned count_threads = 0; // 0 — по числу ядер
+    };
+
+    struct FrameStats {
+        uint32_t frame = 0;
+        uint32_t count_requested = 0;
+        uint32_t count_created = 0;
+        uint32_t count_failed = 0;
+        uint32_t count_evicted = 0;
+        uint32_t count_tomb = 0;   // до перестройки
+        uint32_t count_live = 0;
+        bool rebuilt = false;
+        double mean_probe = 0.0;   // get_or_create
+        uint32_t p99_probe = 0;
+        uint32_t max_probe = 0;
+        double lookup_mean_probe = 0.0;
+        uint32_t lookup_p99_probe = 0;
+        double insert_ms = 0.0;
+        double lookup_ms = 0.0;
+        double frame_ms = 0.0;
+    };
+
+    float tomb_fraction_to_rebuild;
+    const ChunkHashTableMode mode;
+
+    // размеры как в конструкторе VoxelGridGPU
+    ChunkHashTableCPU(uint32_t count_active_chunks, float chunk_hash_table_size_factor, float tomb_fraction_to_rebuild,
+                      ChunkHashTableMode mode = ChunkHashTableMode::Linear);
+
+    // world_init.glsl: пустая таблица, все id свободны
+    void init();
+
+    static uint32_t hash_uvec2(glm::uvec2 v);
+    static glm::uvec2 pack_key_uvec2(glm::ivec3 c, uint32_t pack_offset = (uint32_t)math_utils::OFFSET, uint32_t pack_bits = math_utils::BITS);
+
+    bool get_or_create_chunk(glm::uvec2 key, uint32_t& out_id, bool& created, ProbeStats* stats = nullptr);
+    uint32_t lookup_chunk(glm::uvec2 key, ProbeStats* stats = nullptr);
+    bool remove_from_table(glm::uvec2 key, ProbeStats* stats = nullptr);
+    bool set_chunk(glm::uvec2 key, uint32_t chunk_id, ProbeStats* stats = nullptr);
+
+    // Один поток evict_low_priority: убирает чанк из таблицы и дописывает id в free_list[free_count + freed]
+    // (freed - атомарный счётчик, как evict_freed_count на GPU, поэтому промахи не оставляют дыр в free_list).
+    // Возвращает victim или INVALID_ID, если чанк уже свободен.
+    uint32_t evict_chunk(uint32_t victim);
+    // reset_evicted_list_and_buckets: free_count += freed
+    void commit_evicted();
+
+    // hash_table_conditional_dispatch_adapter + clear + fill: перестройка, если count_tomb >= tomb_fraction_to_rebuild * size.
+    // В Bucketed могил нет, всегда false.
+    bool rebuild_if_needed(unsigned count_threads = 0);
+    void clear_table();
+    void fill_table(unsigned count_threads = 0);
+
+    std::vector<FrameStats> simulate_streaming(const StreamParams& params, ProbeStats* total = nullptr);
+
+    TableStats table_stats() const;
+
+    uint32_t size() const { return size_; }
+    uint32_t bucket_count() const { return size_ / HASH_TABLE_BUCKET_SLOTS; }
+    uint32_t max_chunks() const { return max_chunks_; }
+    uint32_t free_count() const { return free_count_.load(std::memory_order_acquire); }
+    uint32_t count_tomb() const { return hash_vals_[0].load(std::memory_order_acquire); }
+    uint32_t count_rebuilds() const { return count_rebuilds_; }
+    uint32_t tombs_to_rebuild() const { return (uint32_t)(tomb_fraction_to_rebuild * size_); }
+    const ChunkMeta& meta(uint32_t chunk_id) const { return meta_[chunk_id]; }
+
+private:
+    // кольцо tomb_check_list из hash_table.glsl, у каждого вызова своё
+    struct TombList {
+        uint32_t ids[TOMB_CHECK_LIST_SIZE];
+        uint32_t head = INVALID_ID;
+        uint32_t tail = INVALID_ID;
+        uint32_t count = 0;
+
+        bool push(uint32_t slot_id);
+        uint32_t pop_tail();
+    };
+
+    uint32_t size_ = 0;
+    uint32_t max_chunks_ = 0;
+    uint32_t count_rebuilds_ = 0;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> hash_keys_; // [2 * size], uvec2: lo, hi
+    std::unique_ptr<std::atomic<uint32_t>[]> hash_vals_; // [1 + size (+ bucket_count)], [0] = count_tomb
+    std::atomic<uint32_t> free_count_{0};
+    std::atomic<uint32_t> evict_freed_count_{0};
+    std::vector<uint32_t> free_list_;
+    std::vector<ChunkMeta> meta_;
+    std::vector<uint32_t> enqueued_;
+
+    std::atomic<uint32_t>& val(uint32_t idx) { return hash_vals_[1u + idx]; }
+    const std::atomic<uint32_t>& val(uint32_t idx) const { return hash_vals_[1u + idx]; }
+    bool key_equals(uint32_t idx, glm::uvec2 key) const;
+    void store_key(uint32_t idx, glm::uvec2 key);
+
+    uint32_t pop_free_chunk_id(ProbeStats* stats);
+    // общее тело get_or_create_chunk (chunk_id == INVALID_ID) и set_chunk
+    bool insert(glm::uvec2 key, uint32_t chunk_id, uint32_t& out_id, bool& created, ProbeStats* stats);
+    uint32_t linear_lookup_chunk(glm::uvec2 key, ProbeStats* stats);
+    bool linear_remove_from_table(glm::uvec2 key, ProbeStats* stats);
+
+    // HASH_TABLE_BUCKETED
+    enum class BucketResult { Found, Claimed, Full };
+
+    std::atomic<uint32_t>& bucket_overflow(uint32_t b) { return hash_vals_[1ull + size_ + b]; }
+    static constexpr uint32_t BUCKET_START_SHIFT = 27u;
+    static uint32_t secondary_hash(glm::uvec2 key);
+    uint32_t primary_bucket(glm::uvec2 key) const;
+    uint32_t secondary_bucket(glm::uvec2 key, uint32_t primary) const;
+    uint32_t bucket_find(uint32_t b, uint32_t start, glm::uvec2 key, uint32_t& slot, uint32_t& first_empty, uint32_t& count_read, ProbeStats* stats);
+    BucketResult bucketed_find_or_claim(glm::uvec2 key, uint32_t& out_slot, uint32_t& out_id, uint32_t& out_primary, ProbeStats* stats);
+    bool bucketed_insert(glm::uvec2 key, uint32_t chunk_id, uint32_t& out_id, bool& created, ProbeStats* stats);
+    uint32_t bucketed_lookup_chunk(glm::uvec2 key, ProbeStats* stats);
+    bool bucketed_remove_from_table(glm::uvec2 key, ProbeStats* stats);
+
+    unsigned thread_count(unsigned count_threads, size_t work_items) const;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+
+// Устройство хеш-таблицы чанков, значения совпадают с HASH_TABLE_* в shaders/voxel_grid/common/hash_table.glsl.
+// По умолчанию Linear: на GPU (llvmpipe, 65536 ключей) Bucketed вставляет в ~4 раза и промахивается в ~10 раз
+// медленнее - и вставка, и промах просматривают бакет целиком. Выигрыш Bucketed - нет перестроек от могил.
+enum class ChunkHashTableMode : uint32_t {
+    Linear = 0u,   // линейное пробирование с могилами и периодической перестройкой
+    Bucketed = 1u, // бакеты по HASH_TABLE_BUCKET_SLOTS, два бакета на ключ, удаление без могил, не пересекается со вставкой
+};
+
+static constexpr uint32_t HASH_TABLE_BUCKET_SLOTS = 32u;
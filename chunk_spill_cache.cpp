@@ -0,0 +1,111 @@
+#include "chunk_spill_cache.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// Формат: последовательность (длина серии varint, значение 8 байт little-endian)
+
+static void write_varint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80u) {
+        out.push_back((uint8_t)(v | 0x80u));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool read_varint(const std::vector<uint8_t>& in, size_t& pos, uint32_t& v) {
+    v = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        if (pos >= in.size()) return false;
+        uint8_t b = in[pos++];
+        v |= (uint32_t)(b & 0x7Fu) << shift;
+        if ((b & 0x80u) == 0) return true;
+    }
+    return false;
+}
+
+void ChunkSpillCache::compress(const uint64_t* voxels, uint32_t count_voxels, std::vector<uint8_t>& out) {
+    out.clear();
+
+    uint32_t i = 0;
+    while (i < count_voxels) {
+        uint64_t value = voxels[i];
+        uint32_t run = 1;
+        while (i + run < count_voxels && voxels[i + run] == value) run++;
+
+        write_varint(out, run);
+        for (int b = 0; b < 8; b++) out.push_back((uint8_t)(value >> (8 * b)));
+        i += run;
+    }
+    out.shrink_to_fit();
+}
+
+bool ChunkSpillCache::decompress(const std::vector<uint8_t>& data, uint64_t* voxels, uint32_t count_voxels) {
+    size_t pos = 0;
+    uint32_t i = 0;
+
+    while (pos < data.size()) {
+        uint32_t run;
+        if (!read_varint(data, pos, run)) return false;
+        if (pos + 8 > data.size() || (uint64_t)i + run > count_voxels) return false;
+
+        uint64_t value = 0;
+        for (int b = 0; b < 8; b++) value |= (uint64_t)data[pos + b] << (8 * b);
+        pos += 8;
+
+        for (uint32_t r = 0; r < run; r++) voxels[i + r] = value;
+        i += run;
+    }
+    return i == count_voxels;
+}
+
+void ChunkSpillCache::store(uint64_t key, const uint64_t* voxels, uint32_t count_voxels) {
+    auto it = chunks_.find(key);
+    if (it != chunks_.end()) {
+        stats_.raw_bytes -= (size_t)it->second.count_voxels * sizeof(uint64_t);
+        stats_.compressed_bytes -= it->second.data.size();
+    }
+
+    Entry& entry = chunks_[key];
+    entry.count_voxels = count_voxels;
+    compress(voxels, count_voxels, entry.data);
+
+    stats_.raw_bytes += (size_t)count_voxels * sizeof(uint64_t);
+    stats_.compressed_bytes += entry.data.size();
+    stats_.count_chunks = chunks_.size();
+    stats_.count_stored++;
+}
+
+bool ChunkSpillCache::load(uint64_t key, uint64_t* voxels, uint32_t count_voxels) const {
+    auto it = chunks_.find(key);
+    if (it == chunks_.end()) return false;
+
+    if (it->second.count_voxels != count_voxels) {
+        std::cout << "ChunkSpillCache::load: chunk has " << it->second.count_voxels << " voxels, requested " << count_voxels << std::endl;
+        throw std::runtime_error("ChunkSpillCache::load: voxel count mismatch");
+    }
+
+    if (!decompress(it->second.data, voxels, count_voxels)) {
+        std::cout << "ChunkSpillCache::load: corrupted chunk data (key " << key << ")" << std::endl;
+        throw std::runtime_error("ChunkSpillCache::load: corrupted chunk data");
+    }
+    return true;
+}
+
+void ChunkSpillCache::erase(uint64_t key, bool restored) {
+    auto it = chunks_.find(key);
+    if (it == chunks_.end()) return;
+
+    stats_.raw_bytes -= (size_t)it->second.count_voxels * sizeof(uint64_t);
+    stats_.compressed_bytes -= it->second.data.size();
+    chunks_.erase(it);
+
+    stats_.count_chunks = chunks_.size();
+    if (restored) stats_.count_restored++;
+}
+
+void ChunkSpillCache::clear() {
+    chunks_.clear();
+    stats_ = Stats();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+// Хранилище выселенных из VoxelGridGPU чанков с правками пользователя (DIRTY_FLAG_USER_MODIFIED).
+// Ключ - упакованные координаты чанка ((key_hi << 32) | key_lo, как в ChunkMeta), значение - воксели чанка,
+// сжатые RLE по 8-байтным VoxelData: чанки в основном из длинных полос воздуха/одного материала.
+class ChunkSpillCache {
+public:
+    struct Stats {
+        size_t count_chunks = 0;
+        size_t raw_bytes = 0;
+        size_t compressed_bytes = 0;
+        uint64_t count_stored = 0;
+        uint64_t count_restored = 0;
+    };
+
+    // Перезаписывает чанк, если он уже есть
+    void store(uint64_t key, const uint64_t* voxels, uint32_t count_voxels);
+    // false, если чанка нет; count_voxels должен совпадать с сохранённым
+    bool load(uint64_t key, uint64_t* voxels, uint32_t count_voxels) const;
+    void erase(uint64_t key, bool restored = false);
+    bool contains(uint64_t key) const { return chunks_.find(key) != chunks_.end(); }
+    void clear();
+
+    template<class F>
+    void for_each_key(F&& f) const {
+        for (const auto& it : chunks_) f(it.first);
+    }
+
+    const Stats& stats() const { return stats_; }
+    size_t size() const { return chunks_.size(); }
+
+private:
+    struct Entry {
+        uint32_t count_voxels = 0;
+        std::vector<uint8_t> data;
+    };
+
+    std::unordered_map<uint64_t, Entry> chunks_;
+    Stats stats_;
+
+    static void compress(const uint64_t* voxels, uint32_t count_voxels, std::vector<uint8_t>& out);
+    static bool decompress(const std::vector<uint8_t>& data, uint64_t* voxels, uint32_t count_voxels);
+};
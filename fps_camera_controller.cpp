@@ -1,5 +1,6 @@
 #include "fps_camera_controller.h"
 #include "imgui_layer.h"
+#include <cmath>
 
 
 FPSCameraController::FPSCameraController(Camera* camera) {
@@ -70,6 +71,20 @@ void FPSCameraController::update_mouse(Window* window, float delta_time) {
     camera->front = glm::normalize(front);
 }
 
+void FPSCameraController::update_velocity(float delta_time) {
+    if (!has_last_position || delta_time <= 0.0f) {
+        last_position = camera->position;
+        has_last_position = true;
+        return;
+    }
+
+    glm::vec3 frame_velocity = (camera->position - last_position) / delta_time;
+    last_position = camera->position;
+
+    float a = velocity_smoothing_time > 0.0f ? 1.0f - std::exp(-delta_time / velocity_smoothing_time) : 1.0f;
+    velocity += (frame_velocity - velocity) * a;
+}
+
 void FPSCameraController::update(Window* window, float delta_time) {
     ImGuiIO& io = ImGui::GetIO();
 
@@ -80,4 +95,7 @@ void FPSCameraController::update(Window* window, float delta_time) {
         update_keyboard(window, delta_time);
         update_mouse(window, delta_time);
     }
+
+    // камеру могут двигать и в обход клавиатуры, поэтому скорость считаем всегда
+    update_velocity(delta_time);
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <string>
 #include <chrono>
 #include "window.h"
+#include "stream_focus.h"
 
 class FPSCameraController {
 public:
@@ -25,11 +26,21 @@ public:
     float mouse_sensitivity = 0.15f;
     float speed = 5.0f;
 
+    // Скорость камеры по смещению за кадр, сглаженная экспонентой (velocity_smoothing_time - постоянная времени, с)
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float velocity_smoothing_time = 0.15f;
+
     FPSCameraController(Camera* camera);
     void update_keyboard(Window* window, float delta_time);
     void update_mouse(Window* window, float delta_time);
+    void update_velocity(float delta_time);
     void update(Window* window, float delta_time);
 
+    // Позиция камеры, предсказанная через lookahead_seconds, для подгрузки чанков
+    StreamFocus stream_focus(float lookahead_seconds) const {
+        return StreamFocus::predict(camera->position, velocity, camera->front, lookahead_seconds);
+    }
+
 
     void move_forward(float dt) {
         camera->position += camera->front * speed * dt;
@@ -56,4 +67,8 @@ public:
     void move_down(float dt) {
         camera->position -= camera->up * speed * dt;
     }
+
+private:
+    glm::vec3 last_position = glm::vec3(0.0f);
+    bool has_last_position = false;
 };
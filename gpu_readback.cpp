@@ -0,0 +1,127 @@
+#include "gpu_readback.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#include "math_utils.h"
+
+GPUReadback::GPUReadback(std::size_t capacity_bytes) {
+    create_ring(capacity_bytes);
+}
+
+GPUReadback::~GPUReadback() {
+    for (Request& r : requests_) glDeleteSync(r.fence);
+    requests_.clear();
+    release();
+}
+
+void GPUReadback::release() {
+    if (ring_) {
+        glUnmapNamedBuffer(ring_);
+        glDeleteBuffers(1, &ring_);
+    }
+    ring_ = 0;
+    mapped_ = nullptr;
+    capacity_ = 0;
+    head_ = 0;
+}
+
+void GPUReadback::create_ring(std::size_t capacity_bytes) {
+    release();
+
+    glCreateBuffers(1, &ring_);
+    if (ring_ == 0) {
+        std::string message = "GPUReadback::create_ring: failed to create buffer";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(ring_, (GLsizeiptr)capacity_bytes, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+    mapped_ = static_cast<const std::byte*>(glMapNamedBufferRange(ring_, 0, (GLsizeiptr)capacity_bytes, flags));
+    if (mapped_ == nullptr) {
+        std::string message = "GPUReadback::create_ring: failed to map " + std::to_string(capacity_bytes) + " bytes";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    capacity_ = capacity_bytes;
+    head_ = 0;
+}
+
+std::size_t GPUReadback::find_space(std::size_t size_bytes) const {
+    if (requests_.empty()) return size_bytes <= capacity_ ? 0 : NO_SPACE;
+
+    std::size_t tail = requests_.front().offset;
+    if (head_ > tail) {
+        if (head_ + size_bytes <= capacity_) return head_;
+        // с начала кольца; строго меньше, чтобы head_ == tail значило только "пусто"
+        if (size_bytes < tail) return 0;
+        return NO_SPACE;
+    }
+    if (head_ + size_bytes < tail) return head_;
+    return NO_SPACE;
+}
+
+void GPUReadback::request(const BufferObject& src, GLintptr offset_bytes, GLsizeiptr size_bytes, Callback callback) {
+    if (size_bytes <= 0) {
+        std::string message = "GPUReadback::request: size_bytes must be positive";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    std::size_t size = (std::size_t)size_bytes;
+    std::size_t aligned = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    std::size_t offset;
+    while ((offset = find_space(aligned)) == NO_SPACE) {
+        if (requests_.empty()) {
+            create_ring(math_utils::next_pow2_u32((uint32_t)aligned));
+            continue;
+        }
+        // кольцо переполнено - единственное место, где запрос ждёт GPU
+        complete_front(GL_TIMEOUT_IGNORED);
+    }
+
+    // запись шейдером -> копия, копия -> чтение через отображение
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(src.id(), ring_, offset_bytes, (GLintptr)offset, size_bytes);
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    Request r;
+    r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r.offset = offset;
+    r.size = size;
+    r.callback = std::move(callback);
+    requests_.push_back(std::move(r));
+
+    head_ = offset + aligned;
+}
+
+bool GPUReadback::complete_front(GLuint64 timeout_ns) {
+    Request& r = requests_.front();
+
+    GLbitfield flags = timeout_ns == 0 ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT;
+    GLenum state = glClientWaitSync(r.fence, flags, timeout_ns);
+    if (state == GL_TIMEOUT_EXPIRED) return false;
+    if (state == GL_WAIT_FAILED) {
+        std::cout << "GPUReadback::complete_front: glClientWaitSync failed" << std::endl;
+        throw std::runtime_error("GPUReadback::complete_front: glClientWaitSync failed");
+    }
+
+    glDeleteSync(r.fence);
+    if (r.callback) r.callback(mapped_ + r.offset, r.size);
+
+    requests_.pop_front();
+    if (requests_.empty()) head_ = 0;
+    return true;
+}
+
+void GPUReadback::poll() {
+    // копии завершаются по порядку - дальше первого незавершённого смотреть незачем
+    while (!requests_.empty() && complete_front(0)) {}
+}
+
+void GPUReadback::wait_all() {
+    while (!requests_.empty()) complete_front(GL_TIMEOUT_IGNORED);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "buffer_object.h"
+
+// Асинхронное чтение буферов GPU без остановки конвейера.
+// Диапазон копируется (glCopyNamedBufferSubData) в кольцо из persistent-mapped буфера, за копией ставится fence.
+// poll() раз в кадр отдаёт готовые данные в callback/future - обычно через 1-3 кадра после запроса.
+// Ждать GPU приходится только при переполнении кольца (самые старые запросы) и в wait_all().
+class GPUReadback {
+public:
+    // data живёт только внутри вызова; новые запросы из callback делать нельзя
+    using Callback = std::function<void(const void* data, std::size_t size_bytes)>;
+
+    explicit GPUReadback(std::size_t capacity_bytes = 1u << 20);
+    ~GPUReadback();
+
+    GPUReadback(const GPUReadback&) = delete;
+    GPUReadback& operator=(const GPUReadback&) = delete;
+
+    // Запрос больше кольца пересоздаёт его (с ожиданием уже поставленных)
+    void request(const BufferObject& src, GLintptr offset_bytes, GLsizeiptr size_bytes, Callback callback);
+
+    template<class T>
+    std::future<T> request_scalar(const BufferObject& src, std::size_t offset_bytes = 0) {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        auto promise = std::make_shared<std::promise<T>>();
+        std::future<T> future = promise->get_future();
+
+        request(src, offset_bytes, sizeof(T), [promise](const void* data, std::size_t) {
+            T v{};
+            std::memcpy(&v, data, sizeof(T));
+            promise->set_value(v);
+        });
+        return future;
+    }
+
+    template<class T>
+    std::future<std::vector<T>> request_array(const BufferObject& src, std::size_t offset_bytes, std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        auto promise = std::make_shared<std::promise<std::vector<T>>>();
+        std::future<std::vector<T>> future = promise->get_future();
+
+        if (count == 0) {
+            promise->set_value({});
+            return future;
+        }
+
+        request(src, offset_bytes, sizeof(T) * count, [promise, count](const void* data, std::size_t) {
+            std::vector<T> v(count);
+            std::memcpy(v.data(), data, sizeof(T) * count);
+            promise->set_value(std::move(v));
+        });
+        return future;
+    }
+
+    // Без ожидания: завершает готовые запросы по порядку постановки
+    void poll();
+    // С ожиданием GPU - для замеров, которым данные нужны сразу
+    void wait_all();
+
+    std::size_t pending() const { return requests_.size(); }
+    std::size_t capacity_bytes() const { return capacity_; }
+
+private:
+    static constexpr std::size_t ALIGNMENT = 16;
+    static constexpr std::size_t NO_SPACE = ~std::size_t(0);
+
+    struct Request {
+        GLsync fence = nullptr;
+        std::size_t offset = 0;
+        std::size_t size = 0;
+        Callback callback;
+    };
+
+    GLuint ring_ = 0;
+    const std::byte* mapped_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t head_ = 0; // следующая запись; хвост - offset самого старого запроса
+    std::deque<Request> requests_;
+
+    void create_ring(std::size_t capacity_bytes);
+    void release();
+    std::size_t find_space(std::size_t size_bytes) const;
+    // false - fence ещё не сработал за timeout_ns
+    bool complete_front(GLuint64 timeout_ns);
+};
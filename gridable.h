@@ -1,9 +1,38 @@
 #pragma once
+#include <cstdint>
+#include <vector>
 #include "voxel_engine/voxel.h"
 
+// Воксели одного чанка: local id = x + sx * (y + sy * z)
+struct ChunkVoxels {
+    glm::ivec3 chunk_pos;
+    std::vector<uint32_t> local_ids;
+    std::vector<Voxel> voxels;
+};
+
 class Gridable {
 public:
     virtual void set_voxels(const std::vector<Voxel>& voxels, const std::vector<glm::ivec3>& positions) = 0;
     virtual void set_voxel(const Voxel& voxel, glm::ivec3 position) = 0;
     virtual Voxel get_voxel(glm::ivec3 position) const = 0;
-};
\ No newline at end of file
+
+    // Пачка правок, уже разложенная по чанкам. По умолчанию разворачивается в set_voxels,
+    // сетки с чанками могут применять её одной правкой на чанк.
+    virtual void set_chunk_voxels(glm::ivec3 chunk_size, const std::vector<ChunkVoxels>& chunks) {
+        std::vector<Voxel> voxels;
+        std::vector<glm::ivec3> positions;
+        for (const ChunkVoxels& chunk : chunks) {
+            glm::ivec3 origin = chunk.chunk_pos * chunk_size;
+            for (size_t i = 0; i < chunk.local_ids.size(); i++) {
+                uint32_t id = chunk.local_ids[i];
+                uint32_t lx = id % (uint32_t)chunk_size.x;
+                uint32_t t  = id / (uint32_t)chunk_size.x;
+                uint32_t ly = t % (uint32_t)chunk_size.y;
+                uint32_t lz = t / (uint32_t)chunk_size.y;
+                positions.push_back(origin + glm::ivec3((int)lx, (int)ly, (int)lz));
+                voxels.push_back(chunk.voxels[i]);
+            }
+        }
+        set_voxels(voxels, positions);
+    }
+};
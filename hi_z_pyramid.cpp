@@ -0,0 +1,92 @@
+#include "hi_z_pyramid.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "math_utils.h"
+
+HiZPyramid::~HiZPyramid() {
+    release();
+}
+
+void HiZPyramid::release() {
+    if (depth_texture_) glDeleteTextures(1, &depth_texture_);
+    if (hiz_texture_) glDeleteTextures(1, &hiz_texture_);
+    depth_texture_ = 0;
+    hiz_texture_ = 0;
+    size_ = glm::ivec2(0);
+    levels_ = 0;
+}
+
+void HiZPyramid::resize(const glm::ivec2& size) {
+    release();
+
+    levels_ = 1;
+    while ((std::max(size.x, size.y) >> levels_) > 0) levels_++;
+    size_ = size;
+
+    glGenTextures(1, &depth_texture_);
+    glGenTextures(1, &hiz_texture_);
+    if (depth_texture_ == 0 || hiz_texture_ == 0) {
+        std::string message = "HiZPyramid::resize: failed to create textures";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, depth_texture_);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, size.x, size.y);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glBindTexture(GL_TEXTURE_2D, hiz_texture_);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levels_, GL_R32F, size.x, size.y);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HiZPyramid::build(ComputeProgram& copy_depth_prog, ComputeProgram& downsample_prog) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glm::ivec2 size(viewport[2], viewport[3]);
+    if (size.x <= 0 || size.y <= 0) return;
+    if (size != size_) resize(size);
+
+    // default framebuffer нельзя прочитать из шейдера - сначала копия глубины в текстуру
+    glBindTexture(GL_TEXTURE_2D, depth_texture_);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], size.x, size.y);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // ---- level 0 ----
+    copy_depth_prog.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depth_texture_);
+    glUniform1i(glGetUniformLocation(copy_depth_prog.id, "u_depth"), 0);
+    glUniform2i(glGetUniformLocation(copy_depth_prog.id, "u_size"), size.x, size.y);
+    glBindImageTexture(0, hiz_texture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+    copy_depth_prog.dispatch_compute(math_utils::div_up_u32(size.x, 8u), math_utils::div_up_u32(size.y, 8u), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // ---- level 1.. ----
+    downsample_prog.use();
+    for (uint32_t level = 1; level < levels_; level++) {
+        glm::ivec2 src_size = glm::max(size >> (int)(level - 1), glm::ivec2(1));
+        glm::ivec2 dst_size = glm::max(size >> (int)level, glm::ivec2(1));
+
+        glBindImageTexture(0, hiz_texture_, (GLint)level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, hiz_texture_, (GLint)level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform2i(glGetUniformLocation(downsample_prog.id, "u_src_size"), src_size.x, src_size.y);
+        glUniform2i(glGetUniformLocation(downsample_prog.id, "u_dst_size"), dst_size.x, dst_size.y);
+
+        downsample_prog.dispatch_compute(math_utils::div_up_u32(dst_size.x, 8u), math_utils::div_up_u32(dst_size.y, 8u), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#include "compute_program.h"
+
+// Пирамида глубины (Hi-Z) для occlusion culling.
+// Level 0 - копия глубины текущего framebuffer (в пределах viewport), каждый следующий уровень -
+// максимум (самая дальняя глубина) по 2x2 texel предыдущего. Формат R32F, глубина окна [0, 1].
+class HiZPyramid {
+public:
+    HiZPyramid() = default;
+    ~HiZPyramid();
+
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+    // Копирует глубину из текущего read framebuffer и строит все уровни.
+    // При смене размера viewport текстуры пересоздаются.
+    void build(ComputeProgram& copy_depth_prog, ComputeProgram& downsample_prog);
+
+    bool valid() const { return hiz_texture_ != 0; }
+    GLuint texture() const { return hiz_texture_; }
+    glm::ivec2 size() const { return size_; }
+    uint32_t levels() const { return levels_; }
+
+private:
+    GLuint depth_texture_ = 0;
+    GLuint hiz_texture_ = 0;
+    glm::ivec2 size_ = glm::ivec2(0);
+    uint32_t levels_ = 0;
+
+    void resize(const glm::ivec2& size);
+    void release();
+};
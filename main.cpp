@@ -46,13 +46,17 @@ int main() {
         0.2f, // tomb_fraction_to_rebuild
         chunk_size * voxel_size * 1, // eviction_bucket_shell_thickness
         10, // vb_page_size_order_of_two
-        10, // ib_page_size_order_of_two
         1.0, // buddy_allocator_nodes_factor
-        chunk_size * voxel_size * 30,
+        chunk_size * voxel_size * 128,
         shader_manager
     );
+    // 5 колец по 8 чанков (stream_radius_chunks отладчика) - до 8 * 2^4 = 128 чанков уровня 0, в 4 с лишним раза
+    // дальше прежних 30. Неподвижная камера, llvmpipe: 7597 чанков, воксели 237 МБ, меш 37 МБ против 14147 чанков,
+    // 442 МБ и 32 МБ у одного уровня с R 15
+    voxel_grid_gpu->lod_levels = 5;
 
     VoxelGridGPUDebugger voxel_grid_debugger(voxel_grid_gpu, window);
+    voxel_grid_debugger.camera_controller = &camera_controller;
 
     glm::vec3 prev_cam_pos = camera_controller.camera->position;
 
@@ -84,7 +88,7 @@ int main() {
 
         window->clear_color({clear_col[0], clear_col[1], clear_col[2], clear_col[3]});
 
-        // voxel_grid_gpu->stream_chunks_sphere(camera_controller.camera->position, 10, 45345345);
+        // voxel_grid_gpu->stream_chunks_sphere(camera_controller.stream_focus(0.5f), 10, 45345345);
         window->draw(voxel_grid_gpu.get(), &camera);
 
         voxel_grid_debugger.dispay_debug_window();
@@ -167,6 +167,29 @@ namespace math_utils {
     #endif
     }
 
+    // x != 0
+    static inline uint32_t ctz_u64(uint64_t x) {
+    #if MATHUTILS_HAS_STD_BIT
+        return static_cast<uint32_t>(std::countr_zero(x));
+    #elif defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanForward64(&idx, x);
+        return static_cast<uint32_t>(idx);
+    #else
+        return static_cast<uint32_t>(__builtin_ctzll(x));
+    #endif
+    }
+
+    static inline uint32_t popcount_u64(uint64_t x) {
+    #if MATHUTILS_HAS_STD_BIT
+        return static_cast<uint32_t>(std::popcount(x));
+    #elif defined(_MSC_VER)
+        return static_cast<uint32_t>(__popcnt64(x));
+    #else
+        return static_cast<uint32_t>(__builtin_popcountll(x));
+    #endif
+    }
+
     static inline uint32_t log2_pow2_u32(uint32_t x) {
         return log2_floor_u32(x);
     }
@@ -25,6 +25,8 @@ void ShaderManager::init_shaders(const std::filesystem::path& root_path) {
     roi_reduce_pairs_cs = ComputeShader(p / "shaders" / "voxel_rasterization" / "roi_reduce_pairs.glsl", include_directories);
     build_active_chunks_cs = ComputeShader(p / "shaders" / "voxel_rasterization" / "build_active_chunks.glsl");
     roi_finalize_cs = ComputeShader(p / "shaders" / "voxel_rasterization" / "roi_finalize.glsl", include_directories);
+    gather_instance_triangles_cs = ComputeShader(p / "shaders" / "voxel_rasterization" / "gather_instance_triangles.glsl", include_directories);
+    voxelize_to_grid_cs = ComputeShader(p / "shaders" / "voxel_rasterization" / "voxelize_to_grid.glsl", include_directories);
 
     clear_chunks_cs = ComputeShader(p / "shaders" / "voxel_grid" / "clear_chunks.glsl", include_directories);
     world_init_cs = ComputeShader(p / "shaders" / "voxel_grid" / "world_init.glsl", include_directories);
@@ -35,12 +37,21 @@ void ShaderManager::init_shaders(const std::filesystem::path& root_path) {
     mesh_emit_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_emit.glsl", include_directories);
     mesh_finalize_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_finalize.glsl", include_directories);
     build_indirect_cmds_cs = ComputeShader(p / "shaders" / "voxel_grid" / "build_indirect_cmds.glsl", include_directories);
+    clear_indirect_cmds_tail_cs = ComputeShader(p / "shaders" / "voxel_grid" / "clear_indirect_cmds_tail.glsl", include_directories);
     reset_dirty_count_cs = ComputeShader(p / "shaders" / "voxel_grid" / "reset_dirty_count.glsl", include_directories);
     evict_buckets_build_cs = ComputeShader(p / "shaders" / "voxel_grid" / "evict_buckets_build.glsl", include_directories);
     evict_low_priority_cs = ComputeShader(p / "shaders" / "voxel_grid" / "evict_low_priority.glsl", include_directories);
     evict_low_priority_dispatch_adapter_cs = ComputeShader(p / "shaders" / "voxel_grid" / "evict_low_priority_dispatch_adapter.glsl", include_directories);
     stream_select_chunks_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_select_chunks.glsl", include_directories);
+    stream_select_dispatch_adapter_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_select_dispatch_adapter.glsl", include_directories);
     stream_generate_terrain_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_generate_terrain.glsl", include_directories);
+    stream_hole_stats_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_hole_stats.glsl", include_directories);
+    stream_restore_select_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_restore_select.glsl", include_directories);
+    stream_restore_copy_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_restore_copy.glsl", include_directories);
+    stream_lod_visibility_cs = ComputeShader(p / "shaders" / "voxel_grid" / "stream_lod_visibility.glsl", include_directories);
+    evict_spill_copy_cs = ComputeShader(p / "shaders" / "voxel_grid" / "evict_spill_copy.glsl", include_directories);
+    hiz_copy_depth_cs = ComputeShader(p / "shaders" / "voxel_grid" / "hiz_copy_depth.glsl", include_directories);
+    hiz_downsample_cs = ComputeShader(p / "shaders" / "voxel_grid" / "hiz_downsample.glsl", include_directories);
     mark_all_user_chunks_as_dirty_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mark_all_user_chunks_as_dirty.glsl", include_directories);
     mesh_pool_clear_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_clear.glsl", include_directories);
     mesh_pool_seed_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_seed.glsl", include_directories);
@@ -52,6 +63,10 @@ void ShaderManager::init_shaders(const std::filesystem::path& root_path) {
     clear_chunk_hash_table_cs = ComputeShader(p / "shaders" / "voxel_grid" / "clear_chunk_hash_table.glsl", include_directories);
     reset_evicted_list_and_buckets_cs = ComputeShader(p / "shaders" / "voxel_grid" / "reset_evicted_list_and_buckets.glsl", include_directories);
     hash_table_conditional_dispatch_adapter_cs = ComputeShader(p / "shaders" / "voxel_grid" / "hash_table_conditional_dispatch_adapter.glsl", include_directories);
+    mesh_pool_stats_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_stats.glsl", include_directories);
+    mesh_pool_defrag_plan_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_defrag_plan.glsl", include_directories);
+    mesh_pool_defrag_copy_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_defrag_copy.glsl", include_directories);
+    mesh_pool_defrag_free_cs = ComputeShader(p / "shaders" / "voxel_grid" / "mesh_pool_defrag_free.glsl", include_directories);
     voxel_mesh_vs = VertexShader(p / "shaders" / "voxel_grid" / "voxel_mesh.vert", include_directories);
     voxel_mesh_fs = FragmentShader(p / "shaders" / "voxel_grid" / "voxel_mesh.frag", include_directories);
 }
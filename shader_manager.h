@@ -33,6 +33,8 @@ public:
     ComputeShader roi_reduce_pairs_cs;
     ComputeShader build_active_chunks_cs;
     ComputeShader roi_finalize_cs;
+    ComputeShader gather_instance_triangles_cs;
+    ComputeShader voxelize_to_grid_cs;
 
     //voxel_grid
     ComputeShader clear_chunks_cs;
@@ -45,12 +47,21 @@ public:
     ComputeShader mesh_emit_cs;
     ComputeShader mesh_finalize_cs;
     ComputeShader build_indirect_cmds_cs;
+    ComputeShader clear_indirect_cmds_tail_cs;
     ComputeShader reset_dirty_count_cs;
     ComputeShader evict_buckets_build_cs;
     ComputeShader evict_low_priority_cs;
     ComputeShader evict_low_priority_dispatch_adapter_cs;
     ComputeShader stream_select_chunks_cs;
+    ComputeShader stream_select_dispatch_adapter_cs;
     ComputeShader stream_generate_terrain_cs;
+    ComputeShader stream_hole_stats_cs;
+    ComputeShader stream_restore_select_cs;
+    ComputeShader stream_restore_copy_cs;
+    ComputeShader stream_lod_visibility_cs;
+    ComputeShader evict_spill_copy_cs;
+    ComputeShader hiz_copy_depth_cs;
+    ComputeShader hiz_downsample_cs;
     ComputeShader mark_all_user_chunks_as_dirty_cs;
     ComputeShader mesh_pool_clear_cs;
     ComputeShader mesh_pool_seed_cs;
@@ -62,6 +73,10 @@ public:
     ComputeShader clear_chunk_hash_table_cs;
     ComputeShader reset_evicted_list_and_buckets_cs;
     ComputeShader hash_table_conditional_dispatch_adapter_cs;
+    ComputeShader mesh_pool_stats_cs;
+    ComputeShader mesh_pool_defrag_plan_cs;
+    ComputeShader mesh_pool_defrag_copy_cs;
+    ComputeShader mesh_pool_defrag_free_cs;
     VertexShader voxel_mesh_vs;
     FragmentShader voxel_mesh_fs;
 
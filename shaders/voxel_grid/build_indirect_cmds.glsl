@@ -7,7 +7,10 @@ layout(local_size_x = 256) in;
 
 layout(std430, binding=0) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=1) buffer ChunkMeshAllocBuf { ChunkMeshAlloc chunk_mesh_alloc[]; }; 
-layout(std430, binding=2) buffer IndirectCmdBuf { uint cmd_count; DrawElementsIndirectCommand cmds[]; };
+layout(std430, binding=2) buffer IndirectCmdBuf { uint cmd_count; DrawArraysIndirectCommand cmds[]; };
+layout(std430, binding=3) writeonly buffer ChunkLastVisibleBuf { uint last_visible_frame[]; };
+layout(std430, binding=4) buffer ChunkVisibleBuf { uint chunk_visible[]; }; // 1 - прошёл Hi-Z тест в последней фазе 2
+layout(std430, binding=5) buffer OcclusionStatsBuf { OcclusionStats occlusion_stats; };
 
 uniform uint  u_max_chunks;
 
@@ -19,17 +22,36 @@ uniform vec3  u_voxel_size;    // (sx,sy,sz)
 uniform uint u_pack_bits;
 uniform int  u_pack_offset;
 
-uniform uint u_vb_page_verts;
-uniform uint u_ib_page_inds;
+uniform uint u_vb_page_verts; // степень двойки >= 4: меш начинается с целого квада
 
 uniform vec3 cam_pos;
 uniform float render_distance;
+uniform uint u_frame_index;
 
 // 6 плоскостей фрустума в world space: ax+by+cz+d >= 0 (внутри)
 uniform vec4 u_frustum_planes[6];
 
+// Двухфазный occlusion culling:
+// CULL_PHASE_FRUSTUM - только расстояние и фрустум (одна фаза, как без Hi-Z),
+// CULL_PHASE_VISIBLE_LAST_FRAME - рисуем чанки, видимые в прошлом кадре (они строят глубину для Hi-Z),
+// CULL_PHASE_OCCLUSION - тест всех чанков по Hi-Z, рисуем ставшие видимыми, обновляем chunk_visible
+#define CULL_PHASE_FRUSTUM            0u
+#define CULL_PHASE_VISIBLE_LAST_FRAME 1u
+#define CULL_PHASE_OCCLUSION          2u
+
+uniform uint u_cull_phase;
+
+uniform sampler2D u_hiz;           // R32F, самая дальняя глубина по уровням
+uniform ivec2 u_hiz_size;          // размер level 0 в пикселях
+uniform int   u_hiz_levels;        // 0 - пирамиды нет, все чанки видимы
+uniform mat4  u_occlusion_view_proj; // proj * view * world, координаты грида -> clip
+
+// 1 - рисовать только диапазоны направлений граней, которые могут смотреть на камеру
+uniform uint u_face_culling;
+
 // ----- include -----
 #include "../utils.glsl"
+#include "common/lod.glsl"
 // -------------------
 
 // Быстрый тест сферы против плоскостей (false positives допустимы)
@@ -42,38 +64,153 @@ bool sphere_in_frustum(vec3 center, float radius) {
     return true;
 }
 
+// true, если AABB целиком за глубиной пирамиды. Консервативно: при пересечении плоскости камеры - видим.
+bool occluded_by_hiz(vec3 minP, vec3 maxP) {
+    if (u_hiz_levels <= 0) return false;
+
+    vec2 uv_min = vec2(1.0);
+    vec2 uv_max = vec2(0.0);
+    float nearest = 1.0;
+
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = mix(minP, maxP, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = u_occlusion_view_proj * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+
+    // вне экрана глубины нет, а невидимую часть рисовать и не нужно
+    uv_min = clamp(uv_min, vec2(0.0), vec2(1.0));
+    uv_max = clamp(uv_max, vec2(0.0), vec2(1.0));
+
+    vec2 px_min = uv_min * vec2(u_hiz_size);
+    vec2 px_max = uv_max * vec2(u_hiz_size);
+
+    // уровень, на котором прямоугольник занимает не больше 2x2 texel
+    vec2 extent = px_max - px_min;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    level = clamp(level, 0, u_hiz_levels - 1);
+
+    ivec2 level_size = max(u_hiz_size >> level, ivec2(1));
+    ivec2 p0 = clamp(ivec2(px_min) >> level, ivec2(0), level_size - 1);
+    ivec2 p1 = clamp(ivec2(px_max) >> level, ivec2(0), level_size - 1);
+
+    float farthest = 0.0;
+    for (int y = p0.y; y <= p1.y; ++y)
+        for (int x = p0.x; x <= p1.x; ++x)
+            farthest = max(farthest, texelFetch(u_hiz, ivec2(x, y), level).r);
+
+    return nearest > farthest;
+}
+
 void main() {
     uint chunkId = gl_GlobalInvocationID.x;
     if (chunkId >= u_max_chunks) return;
 
     if (meta[chunkId].used == 0u) return;
+    // кусок рисует другой уровень клипмапа; видимым не отмечаем - пусть выселяется первым
+    if ((meta[chunkId].dirty_flags & DIRTY_FLAG_LOD_HIDDEN) != 0u) return;
 
-    ChunkMeshAlloc mesh_alloc = chunk_mesh_alloc[chunkId];
-
-    if (mesh_alloc.v_startPage == INVALID_ID || mesh_alloc.i_startPage == INVALID_ID) return;
-    if (mesh_alloc.needV == 0 || mesh_alloc.needI == 0) return;
-
+    uvec2 key = uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi);
+    ivec3 chunkCoord = unpack_key_to_coord(key, u_pack_offset, u_pack_bits);
 
-    ivec3 chunkCoord = unpack_key_to_coord(uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi), u_pack_offset, u_pack_bits);
+    // размеры чанка уровня LOD - в 2^lod раз больше, отсечения ниже работают без изменений
+    vec3 chunkSize = vec3(u_chunk_dim) * u_voxel_size * lod_scale(key_lod(key));
 
-    vec3 chunkSize = vec3(u_chunk_dim) * u_voxel_size;
-
-    vec3 minP = vec3(chunkCoord * u_chunk_dim) * u_voxel_size;
+    vec3 minP = vec3(chunkCoord) * chunkSize;
     vec3 center = minP + 0.5 * chunkSize;
 
+    // фаза 1 рисует подмножество того, что проверит фаза 2, - считаем отсечения только один раз
+    bool count_culled = u_cull_phase != CULL_PHASE_VISIBLE_LAST_FRAME;
+
     vec3 diff = center - cam_pos;
     float distance_to_chunk_2 = dot(diff, diff);
-    if (distance_to_chunk_2 > render_distance * render_distance) return;
+    if (distance_to_chunk_2 > render_distance * render_distance) {
+        if (count_culled) atomicAdd(occlusion_stats.distance_culled, 1u);
+        return;
+    }
 
     float radius = length(chunkSize) * 0.5;
 
-    if (!sphere_in_frustum(center, radius)) return;
+    if (!sphere_in_frustum(center, radius)) {
+        if (count_culled) atomicAdd(occlusion_stats.frustum_culled, 1u);
+        return;
+    }
+
+    // видимость отмечаем и у чанков без меша (воздух), для приоритета выселения
+    // загороженные чанки тоже отмечаются: иначе пещеры рядом с камерой выселялись бы первыми
+    if (count_culled) last_visible_frame[chunkId] = u_frame_index;
+
+    ChunkMeshAlloc mesh_alloc = chunk_mesh_alloc[chunkId];
 
-    uint cmdIdx = atomicAdd(cmd_count, 1u);
+    if (mesh_alloc.v_startPage == INVALID_ID) return;
+    if (mesh_alloc.needV == 0) return;
+
+    if (u_cull_phase == CULL_PHASE_VISIBLE_LAST_FRAME) {
+        if (chunk_visible[chunkId] == 0u) return;
+        atomicAdd(occlusion_stats.drawn_first_pass, 1u);
+    } else if (u_cull_phase == CULL_PHASE_OCCLUSION) {
+        uint was_visible = chunk_visible[chunkId];
+        bool visible = !occluded_by_hiz(minP, minP + chunkSize);
+        chunk_visible[chunkId] = visible ? 1u : 0u;
+
+        if (!visible) {
+            atomicAdd(occlusion_stats.occlusion_culled, 1u);
+            return;
+        }
+        if (was_visible == 1u) return; // уже нарисован в фазе 1
+        atomicAdd(occlusion_stats.drawn_second_pass, 1u);
+    } else {
+        atomicAdd(occlusion_stats.drawn_first_pass, 1u);
+    }
+
+    // Грань +X чанка видна только если камера правее хотя бы одной плоскости x этого чанка, т.е. cam.x > minP.x.
+    // Соседние видимые диапазоны склеиваются: на чанк не больше 3 команд
+    vec3 maxP = minP + chunkSize;
+    bool face_visible[FACE_COUNT];
+    face_visible[0] = cam_pos.x > minP.x;
+    face_visible[1] = cam_pos.x < maxP.x;
+    face_visible[2] = cam_pos.y > minP.y;
+    face_visible[3] = cam_pos.y < maxP.y;
+    face_visible[4] = cam_pos.z > minP.z;
+    face_visible[5] = cam_pos.z < maxP.z;
+
+    // номер первого квада меша во всём VB; вершина draw-вызова k -> квад k / 6
+    uint quad_base = mesh_alloc.v_startPage * u_vb_page_verts / 4u;
+    uint first_quad = 0u;
+    uint run_first = 0u;
+    uint run_quads = 0u;
+    uint culled_quads = 0u;
+
+    for (uint f = 0u; f <= FACE_COUNT; ++f) {
+        bool open_run = f < FACE_COUNT && (u_face_culling == 0u || face_visible[f]);
+        uint quads = f < FACE_COUNT ? mesh_alloc.face_quads[f] : 0u;
+
+        if (open_run) {
+            if (run_quads == 0u) run_first = first_quad;
+            run_quads += quads;
+        } else {
+            culled_quads += quads;
+
+            if (run_quads != 0u) {
+                uint cmdIdx = atomicAdd(cmd_count, 1u);
+
+                cmds[cmdIdx].count         = run_quads * 6u;
+                cmds[cmdIdx].instanceCount = 1u;
+                cmds[cmdIdx].first         = (quad_base + run_first) * 6u;
+                cmds[cmdIdx].baseInstance  = chunkId;
+
+                atomicAdd(occlusion_stats.drawn_quads, run_quads);
+                run_quads = 0u;
+            }
+        }
+        first_quad += quads;
+    }
 
-    cmds[cmdIdx].count         = mesh_alloc.needI;
-    cmds[cmdIdx].instanceCount = 1u;
-    cmds[cmdIdx].firstIndex    = mesh_alloc.i_startPage * u_ib_page_inds;
-    cmds[cmdIdx].baseVertex    = 0;
-    cmds[cmdIdx].baseInstance  = chunkId;
+    if (culled_quads != 0u) atomicAdd(occlusion_stats.face_culled_quads, culled_quads);
 }
@@ -0,0 +1,19 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) buffer IndirectCmdBuf { uint cmd_count; DrawArraysIndirectCommand cmds[]; };
+
+uniform uint u_max_draws; // count_active_chunks * max_draws_per_chunk
+
+// Без ARB_indirect_parameters рисуется u_max_draws команд, а не cmd_count.
+// Запускается после build_indirect_cmds.glsl: команды после cmd_count обнуляем, пустые ничего не рисуют.
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_max_draws || i < cmd_count) return;
+
+    cmds[i] = DrawArraysIndirectCommand(0u, 0u, 0u, 0u);
+}
@@ -243,6 +243,47 @@ bool P(free_pages)(uint start, uint order) {
     return result;
 }
 
+// Достаёт свободный блок ровно order (большие не делит) под перенос блока source того же order.
+// Подходит только блок, buddy которого не может встречно переехать на место buddy source:
+//  - buddy поделён (в его начале состояние меньшего order) - целиком он не переносится;
+//  - buddy занят целиком и начинается после source - ему это же правило запрещает брать блоки с buddy левее.
+// Иначе два застрявших блока менялись бы местами каждый кадр и оставались застрявшими.
+// Собственный buddy source сюда не проходит (его buddy - сам source). Неподходящие блоки возвращаются в список.
+#define MOVE_DEST_MAX_TRIES 4u
+uint P(pop_free_move_dest)(uint order, uint source) {
+    uint rejected[MOVE_DEST_MAX_TRIES];
+    uint count_rejected = 0u;
+    uint result = INVALID_ID;
+
+    for (uint attempt = 0u; attempt < MOVE_DEST_MAX_TRIES; attempt++) {
+        uint page = P(pop_free)(order);
+        if (page == INVALID_ID) break;
+
+        uint buddy_state = atomicAdd(P(state)[page ^ (1u << order)], 0u);
+        uint buddy_order = buddy_state >> ST_MASK_BITS;
+        bool buddy_split = buddy_order < order;
+        bool buddy_alloc_after = buddy_state == pack_state(order, ST_ALLOC) && (page ^ (1u << order)) > source;
+        if (buddy_split || buddy_alloc_after) {
+            result = page;
+            break;
+        }
+        rejected[count_rejected++] = page;
+    }
+
+    // после pop_free страницы ST_ALLOC, как и требует push_free
+    for (uint i = 0u; i < count_rejected; i++)
+        P(push_free)(order, rejected[i]);
+    return result;
+}
+
+// Свободен ли buddy блока: если блок перенести, освобождённое место сразу сольётся в блок order + 1
+bool P(is_block_stranded)(uint start, uint order) {
+    if (start == INVALID_ID || order >= P(max_order)) return false;
+
+    uint buddy = start ^ (1u << order);
+    return atomicAdd(P(state)[buddy], 0u) == pack_state(order, ST_FREE);
+}
+
 #undef P
 #undef PREFIX
 #endif
\ No newline at end of file
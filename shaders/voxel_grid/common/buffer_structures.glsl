@@ -7,14 +7,57 @@ struct ChunkMeta {
     uint dirty_flags; 
 };
 
+// биты ChunkMeta.dirty_flags
+#define DIRTY_FLAG_MESH          1u // меш нужно перестроить, снимается в mesh_finalize
+#define DIRTY_FLAG_USER_MODIFIED 2u // воксели отличаются от сгенерированных, снимается только при выселении
+#define DIRTY_FLAG_LOD_HIDDEN    4u // чанк вне своего кольца клипмапа: не рисуется, для соседей - воздух
+
+// Уровень LOD чанка - старшие биты ChunkMeta.key_hi, см. common/lod.glsl
+#define CHUNK_KEY_LOD_SHIFT 29u
+#define MAX_LOD_LEVELS      8u
+
+// Выселяемый чанк с правками: evict_low_priority пишет запись, evict_spill_copy копирует воксели в партию спилла
+struct SpillRecord {
+    uint chunk_id;
+    uint key_lo;
+    uint key_hi;
+    uint pad0;
+};
+
+// Восстановление чанка из ChunkSpillCache: stream_restore_select заполняет chunk_id и status
+#define RESTORE_FAILED  0u // нет свободного id, попробовать позже
+#define RESTORE_OK      1u
+#define RESTORE_SKIPPED 2u // чанк уже есть и с новыми правками - данные из кеша устарели
+
+struct RestoreRecord {
+    uint key_lo;
+    uint key_hi;
+    uint chunk_id;
+    uint status;
+};
+
+// Счётчики отсечения build_indirect_cmds за кадр
+struct OcclusionStats {
+    uint distance_culled;
+    uint frustum_culled;
+    uint occlusion_culled;   // чанки с мешем за Hi-Z
+    uint drawn_first_pass;   // CULL_PHASE_FRUSTUM или CULL_PHASE_VISIBLE_LAST_FRAME
+    uint drawn_second_pass;  // стали видимыми в CULL_PHASE_OCCLUSION
+    uint drawn_quads;
+    uint face_culled_quads;  // квады направлений, которые не могут смотреть на камеру
+    uint pad0;
+};
+
+// Направления граней: 0:+X 1:-X 2:+Y 3:-Y 4:+Z 5:-Z.
+// Квады в меше чанка сгруппированы по направлению в этом же порядке
+#define FACE_COUNT 6u
+
 struct ChunkMeshAlloc {
     uint v_startPage;
     uint v_order;
     uint needV;
-    uint i_startPage;
-    uint i_order;
-    uint needI;
     uint need_rebuild;
+    uint face_quads[FACE_COUNT]; // квадов каждого направления; начало диапазона - сумма предыдущих
 };
 
 struct Node {
@@ -22,6 +65,27 @@ struct Node {
     uint next;
 };
 
+#define MESH_POOL_MAX_ORDERS 32u
+
+// Статистика buddy-аллокатора, считается mesh_pool_stats.glsl по головам блоков в state
+struct MeshPoolStats {
+    uint free_blocks[MESH_POOL_MAX_ORDERS];
+    uint alloc_blocks[MESH_POOL_MAX_ORDERS];
+    uint free_pages;
+    uint alloc_pages;
+    uint largest_free_order; // order + 1, 0 - свободных блоков нет
+    uint stranded_blocks;    // ST_ALLOC блоки со свободным buddy того же order (кандидаты на перенос)
+};
+
+// Перенос меша чанка в другие страницы (mesh_pool_defrag_*)
+struct MeshDefragMove {
+    uint chunk_id;
+    uint old_v_startPage;
+    uint new_v_startPage;
+    uint v_order;
+    uint needV;
+};
+
 #define TYPE_SHIFT 16u
 #define VIS_SHIFT  8u
 #define TYPE_MASK  0xFFu
@@ -38,22 +102,38 @@ struct VoxelWrite {
     uint     _pad1;
 };
 
+// Упакованная вершина меша чанка (8 байт). Позиция - угол вокселя в координатах чанка (0..chunk_dim),
+// начало чанка voxel_mesh.vert берёт из ChunkMeta по baseInstance = chunkId.
+// pos_face: биты 0-7 x, 8-15 y, 16-23 z, 24-26 face (0:+X 1:-X 2:+Y 3:-Y 4:+Z 5:-Z),
+// бит 27 у первой вершины квада - диагональ 1-3 вместо 0-2 (по AO)
+// color: RGB8 в старших 24 битах, AO в младших 8
+#define VERTEX_POS_BITS   8u
+#define VERTEX_POS_MASK   0xFFu
+#define VERTEX_FACE_SHIFT 24u
+#define VERTEX_FLIP_BIT   (1u << 27)
+
 struct Vertex {
-    vec4 pos;
+    uint pos_face;
     uint color;
-    uint face;
-    uint pad0;
-    uint pad1;
 };
 
-struct DrawElementsIndirectCommand {
+// Индексного буфера нет: квад q рисуется вершинами 6q..6q+5, voxel_mesh.vert достаёт углы из vb[4q..4q+3]
+struct DrawArraysIndirectCommand {
     uint count;
     uint instanceCount;
-    uint firstIndex;
-    int  baseVertex;
+    uint first;
     uint baseInstance;
 };
 
+// Состояние потоковой загрузки (stream_select_chunks.glsl), по одному на уровень LOD
+struct StreamState {
+    ivec4 center;          // чанк камеры последнего отбора, w = 1 - отбор уже был
+    int   radius;
+    uint  full_pass;       // 1 - текущий отбор идёт по всему кубу, 0 - только по новой оболочке
+    uint  rescan_requested; // 1 - внутри последней сферы пропал чанк, нужен полный отбор
+    uint  pad0;
+};
+
 struct BucketHead {
     uint id;
     uint count;
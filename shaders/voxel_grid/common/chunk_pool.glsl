@@ -3,6 +3,7 @@
 
 #define NOT_INCLUDE_GET_OR_CREATE
 #include "hash_table.glsl"
+#include "lod.glsl"
 
 /*
 Для настройки #include можно определить следующие дефайны (не обязательно):
@@ -14,7 +15,7 @@
 coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
 coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
 buffer FreeList { uint free_list[]; }; (только если подключён get_or_create_chunk())
-buffer ChunkMetaBuf { ChunkMeta meta[]; }; (только если подключён get_or_create_chunk())
+buffer ChunkMetaBuf { ChunkMeta meta[]; }; (уровень LOD и DIRTY_FLAG_LOD_HIDDEN соседей)
 
 readonly buffer ChunkVoxels { VoxelData voxels[]; };
 
@@ -38,10 +39,12 @@ uint voxel_color_in_chunk(uint chunkId, ivec3 p) {
     return voxels[idx].color;
 }
 
-uint voxel_type_world(ivec3 chunkCoord, ivec3 local) {
-    uvec2 key = pack_key_uvec2(chunkCoord, u_pack_offset, u_pack_bits);
+// соседей ищем на том же уровне LOD; спрятанный сосед - как воздух, чтобы на границе колец остались юбки
+uint voxel_type_world(ivec3 chunkCoord, uint lod, ivec3 local) {
+    uvec2 key = pack_lod_key(chunkCoord, lod, u_pack_offset, u_pack_bits);
     uint cid = lookup_chunk(key);
     if (cid == INVALID_ID) return 0u;
+    if ((meta[cid].dirty_flags & DIRTY_FLAG_LOD_HIDDEN) != 0u) return 0u;
     return voxel_type_in_chunk(cid, local);
 }
 
@@ -65,7 +68,7 @@ uint neighbor_type(uint chunkId, ivec3 chunkCoord, ivec3 p, ivec3 d) {
     if (nLocal.z < 0) { nChunk.z -= 1; nLocal.z += u_chunk_dim.z; }
     if (nLocal.z >= u_chunk_dim.z) { nChunk.z += 1; nLocal.z -= u_chunk_dim.z; }
 
-    return voxel_type_world(nChunk, nLocal);
+    return voxel_type_world(nChunk, key_lod(uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi)), nLocal);
 }
 
 // 0/1 занятость
@@ -17,6 +17,17 @@ buffer ChunkMetaBuf { ChunkMeta meta[]; }; (только если подключ
 
 Юниформы:
 uniform uint u_hash_table_size;
+uniform uint u_hash_table_mode; (объявлен здесь, по умолчанию 0 = HASH_TABLE_LINEAR)
+
+Режимы (выбираются в VoxelGridGPU при создании):
+HASH_TABLE_LINEAR   — линейное пробирование, удаление оставляет SLOT_TOMB, таблицу периодически перестраивают.
+HASH_TABLE_BUCKETED — бакеты по BUCKET_SLOTS слотов, у ключа два бакета (основной и запасной), удаление сразу
+                      ставит SLOT_EMPTY. Поиск просматривает бакет целиком, поэтому могилы не нужны.
+                      hash_vals[u_hash_table_size + b] — число ключей с основным бакетом b, лежащих в запасном.
+                      remove_from_table() нельзя запускать одновременно со вставкой (get_or_create_chunk, set_chunk):
+                      освободившийся слот раньше по обходу даст второму потоку с тем же ключом занять его, пока первый
+                      держит более поздний, — ключ попадёт в таблицу дважды. Удаляет только evict_low_priority,
+                      отдельным dispatch'ем за glMemoryBarrier, поиск (lookup_chunk) с удалением пересекаться может.
 */
 
 #ifndef HASH_TABLE_COMMON
@@ -27,6 +38,13 @@ uniform uint u_hash_table_size;
 #define SLOT_TOMB    0xFFFFFFFDu
 #define MAX_PROBES   128u
 
+#define HASH_TABLE_LINEAR   0u
+#define HASH_TABLE_BUCKETED 1u
+#define BUCKET_SLOTS        32u
+#define BUCKET_START_SHIFT  27u // старшие 5 бит хеша — слот бакета, с которого начинается обход
+
+uniform uint u_hash_table_mode;
+
 #ifndef TOMB_CHECK_LIST_SIZE
 #define TOMB_CHECK_LIST_SIZE 32u
 #endif
@@ -73,6 +91,100 @@ uint pop_tail_tomb_id() {
 
     return result;
 }
+
+// ---------- HASH_TABLE_BUCKETED ----------
+
+uint bucket_count() {
+    return u_hash_table_size / BUCKET_SLOTS;
+}
+
+uint secondary_hash(uvec2 key) {
+    return hash_uvec2(uvec2(key.y, key.x) ^ uvec2(0x9e3779b9u, 0x85ebca6bu));
+}
+
+uint primary_bucket(uvec2 key) {
+    return hash_uvec2(key) & (bucket_count() - 1u);
+}
+
+uint secondary_bucket(uvec2 key, uint primary) {
+    uint b = secondary_hash(key) & (bucket_count() - 1u);
+    return b == primary ? ((b + 1u) & (bucket_count() - 1u)) : b;
+}
+
+uint bucket_overflow(uint b) {
+    return atomicAdd(hash_vals[u_hash_table_size + b], 0u);
+}
+
+// Ищет key в бакете b, обход со слота start по кругу. Возвращает id (или INVALID_ID),
+// slot — слот ключа, first_empty — первый по обходу SLOT_EMPTY.
+uint bucket_find(uint b, uint start, uvec2 key, bool read_only, out uint slot, out uint first_empty) {
+    uint base = b * BUCKET_SLOTS;
+    slot = INVALID_ID;
+    first_empty = INVALID_ID;
+
+    for (uint s = 0u; s < BUCKET_SLOTS;) {
+        uint idx = base + ((start + s) & (BUCKET_SLOTS - 1u));
+        uint v = read_only ? atomicAdd(hash_vals[idx], 0u) : hash_vals[idx];
+
+        if (v == SLOT_LOCKED) continue;
+
+        if (v == SLOT_EMPTY) {
+            if (first_empty == INVALID_ID) first_empty = idx;
+        }
+        else {
+            if (read_only)
+                memoryBarrierBuffer();
+
+            if (all(equal(hash_keys[idx], key))) {
+                slot = idx;
+                return v;
+            }
+        }
+        s++;
+    }
+    return INVALID_ID;
+}
+
+#define BUCKET_FOUND   0u
+#define BUCKET_CLAIMED 1u
+#define BUCKET_FULL    2u
+
+// Ищет key в основном и (если нужно) запасном бакете; если ключа нет — лочит первый SLOT_EMPTY (сначала в основном).
+// Все потоки с одним ключом идут по слотам в одном порядке и берут первый пустой, поэтому дубликатов не бывает
+// (пока в том же dispatch никто не удаляет - см. HASH_TABLE_BUCKETED в начале файла).
+// BUCKET_CLAIMED: слот в SLOT_LOCKED, вызывающий публикует id или возвращает SLOT_EMPTY.
+uint bucketed_find_or_claim(uvec2 key, out uint out_slot, out uint out_id, out uint out_primary) {
+    uint b1 = primary_bucket(key);
+    uint b2 = secondary_bucket(key, b1);
+    uint start1 = hash_uvec2(key) >> BUCKET_START_SHIFT;
+    uint start2 = secondary_hash(key) >> BUCKET_START_SHIFT;
+    out_primary = b1;
+
+    for (;;) {
+        uint slot, empty1, empty2 = INVALID_ID;
+        uint id = bucket_find(b1, start1, key, true, slot, empty1);
+
+        if (id == INVALID_ID && (empty1 == INVALID_ID || bucket_overflow(b1) != 0u))
+            id = bucket_find(b2, start2, key, true, slot, empty2);
+
+        if (id != INVALID_ID) {
+            out_slot = slot;
+            out_id = id;
+            return BUCKET_FOUND;
+        }
+
+        uint target = empty1 != INVALID_ID ? empty1 : empty2;
+        if (target == INVALID_ID) return BUCKET_FULL;
+
+        // кто-то занял слот раньше — ищем заново
+        if (atomicCompSwap(hash_vals[target], SLOT_EMPTY, SLOT_LOCKED) != SLOT_EMPTY) continue;
+
+        out_slot = target;
+        out_id = INVALID_ID;
+        return BUCKET_CLAIMED;
+    }
+    return BUCKET_FULL;
+}
 #endif
 
 #ifndef NOT_INCLUDE_GET_OR_CREATE
@@ -91,7 +203,7 @@ uint pop_free_chunk_id() {
     }
 }
 
-bool get_or_create_chunk(uvec2 key, out uint outId, out bool created) {
+bool linear_get_or_create_chunk(uvec2 key, out uint outId, out bool created) {
     uint mask = u_hash_table_size - 1u;
     uint idx  = hash_uvec2(key) & mask;
     uint last_tomb_id = INVALID_ID;
@@ -182,13 +294,54 @@ bool get_or_create_chunk(uvec2 key, out uint outId, out bool created) {
 
     return false;
 }
+
+bool bucketed_get_or_create_chunk(uvec2 key, out uint outId, out bool created) {
+    uint slot, id, primary;
+    uint res = bucketed_find_or_claim(key, slot, id, primary);
+    created = false;
+
+    if (res == BUCKET_FULL) return false;
+
+    if (res == BUCKET_FOUND) {
+        outId = id;
+        return true;
+    }
+
+    id = pop_free_chunk_id();
+    if (id == INVALID_ID) {
+        atomicExchange(hash_vals[slot], SLOT_EMPTY);
+        return false;
+    }
+
+    // ключ ушёл в запасной бакет — поиск по основному должен туда заглянуть
+    if (slot / BUCKET_SLOTS != primary) atomicAdd(hash_vals[u_hash_table_size + primary], 1u);
+
+    meta[id].used       = 1u;
+    meta[id].key_lo     = key.x;
+    meta[id].key_hi     = key.y;
+    meta[id].dirty_flags= 0u;
+    enqueued[id]        = 0u;
+
+    hash_keys[slot] = key;
+    memoryBarrierBuffer();
+    atomicExchange(hash_vals[slot], id);
+
+    outId = id;
+    created = true;
+    return true;
+}
+
+bool get_or_create_chunk(uvec2 key, out uint outId, out bool created) {
+    if (u_hash_table_mode == HASH_TABLE_BUCKETED) return bucketed_get_or_create_chunk(key, outId, created);
+    return linear_get_or_create_chunk(key, outId, created);
+}
 #endif
 #endif
 
 #ifndef NOT_INCLUDE_LOOKUP_REMOVE
 #ifndef HASH_TABLE_LOOKUP_REMOVE_CHUNK
 #define HASH_TABLE_LOOKUP_REMOVE_CHUNK
-uint lookup_chunk(uvec2 key, bool read_only = true) {
+uint linear_lookup_chunk(uvec2 key, bool read_only) {
     uint mask = u_hash_table_size - 1u;
     uint idx  = hash_uvec2(key) & mask;
 
@@ -220,7 +373,7 @@ uint lookup_chunk(uvec2 key, bool read_only = true) {
     return INVALID_ID;
 }
 
-bool remove_from_table(uvec2 key) {
+bool linear_remove_from_table(uvec2 key) {
     uint mask = u_hash_table_size - 1u;
     uint idx  = hash_uvec2(key) & mask;
 
@@ -264,7 +417,7 @@ bool remove_from_table(uvec2 key) {
     return false;
 }
 
-bool set_chunk(uvec2 key, uint chunk_id) {
+bool linear_set_chunk(uvec2 key, uint chunk_id) {
     uint mask = u_hash_table_size - 1u;
     uint idx  = hash_uvec2(key) & mask;
     uint last_tomb_id = INVALID_ID;
@@ -351,5 +504,61 @@ bool set_chunk(uvec2 key, uint chunk_id) {
 
     return false;
 }
+
+uint bucketed_lookup_chunk(uvec2 key, bool read_only) {
+    uint b1 = primary_bucket(key);
+    uint slot, empty;
+
+    uint id = bucket_find(b1, hash_uvec2(key) >> BUCKET_START_SHIFT, key, read_only, slot, empty);
+    if (id == INVALID_ID && bucket_overflow(b1) != 0u)
+        id = bucket_find(secondary_bucket(key, b1), secondary_hash(key) >> BUCKET_START_SHIFT, key, read_only, slot, empty);
+
+    return id;
+}
+
+bool bucketed_remove_from_table(uvec2 key) {
+    uint b1 = primary_bucket(key);
+    uint slot, empty;
+    bool secondary = false;
+
+    uint id = bucket_find(b1, hash_uvec2(key) >> BUCKET_START_SHIFT, key, true, slot, empty);
+    if (id == INVALID_ID && bucket_overflow(b1) != 0u) {
+        id = bucket_find(secondary_bucket(key, b1), secondary_hash(key) >> BUCKET_START_SHIFT, key, true, slot, empty);
+        secondary = true;
+    }
+
+    if (id == INVALID_ID) return false;
+
+    atomicExchange(hash_vals[slot], SLOT_EMPTY); // могила не нужна, пока удаление не пересекается со вставкой
+    if (secondary) atomicAdd(hash_vals[u_hash_table_size + b1], 0xFFFFFFFFu);
+    return true;
+}
+
+bool bucketed_set_chunk(uvec2 key, uint chunk_id) {
+    uint slot, id, primary;
+    if (bucketed_find_or_claim(key, slot, id, primary) != BUCKET_CLAIMED) return false;
+
+    if (slot / BUCKET_SLOTS != primary) atomicAdd(hash_vals[u_hash_table_size + primary], 1u);
+
+    hash_keys[slot] = key;
+    memoryBarrierBuffer();
+    atomicExchange(hash_vals[slot], chunk_id);
+    return true;
+}
+
+uint lookup_chunk(uvec2 key, bool read_only = true) {
+    if (u_hash_table_mode == HASH_TABLE_BUCKETED) return bucketed_lookup_chunk(key, read_only);
+    return linear_lookup_chunk(key, read_only);
+}
+
+bool remove_from_table(uvec2 key) {
+    if (u_hash_table_mode == HASH_TABLE_BUCKETED) return bucketed_remove_from_table(key);
+    return linear_remove_from_table(key);
+}
+
+bool set_chunk(uvec2 key, uint chunk_id) {
+    if (u_hash_table_mode == HASH_TABLE_BUCKETED) return bucketed_set_chunk(key, chunk_id);
+    return linear_set_chunk(key, chunk_id);
+}
 #endif
 #endif
\ No newline at end of file
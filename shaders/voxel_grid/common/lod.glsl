@@ -0,0 +1,60 @@
+#pragma once
+#include "../../utils.glsl"
+
+/*
+Клипмап LOD. Чанк уровня lod - те же u_chunk_dim вокселей, но воксель в (1 << lod) раз больше,
+координаты чанка - в чанках своего уровня. Уровень хранится в старших битах ключа (key.y >> CHUNK_KEY_LOD_SHIFT),
+поэтому чанки разных уровней в хеш-таблице не пересекаются, а pack_key_uvec2 даёт ключи уровня 0.
+
+Центр уровня lod - чанк камеры уровня 0, делённый на 2^lod (floor). Уровень lod берёт чанки шара радиуса R
+вокруг своего центра, кроме тех, что целиком закрыты уровнем lod - 1 (все 8 детей в его шаре), и тех,
+чей родитель не закрыт (этот кусок рисует уровень lod + 1). Уровни не пересекаются и без щелей покрывают
+шар самого крупного уровня. Вышедшие из кольца чанки не удаляются, а прячутся (DIRTY_FLAG_LOD_HIDDEN,
+stream_lod_visibility.glsl) и уходят первыми при выселении.
+
+Швы. Сосед другого уровня в таблице не находится, спрятанный считается воздухом, поэтому граничные воксели
+с обеих сторон шва строят к нему грани, как к воздуху. Чанк уровня lod - ровно 2x2x2 чанка уровня lod - 1,
+так что эти стенки лежат в одной плоскости и закрывают её до поверхности своего уровня - сквозных щелей нет.
+Не закрыто:
+- перепад высоты до 2^lod вокселей между уровнями виден вертикальной ступенькой, наклонных юбок нет;
+- родитель прячется, как только его дети попали в кольцо, а не когда они сгенерированы и построены: пока
+  подгрузка догоняет, на месте детей дыра (её считает stream_hole_stats);
+- AO у шва считается по воздуху, а правки (apply_writes) есть только на уровне 0.
+*/
+
+uvec2 pack_lod_key(ivec3 c, uint lod, int pack_offset, uint pack_bits) {
+    uvec2 key = pack_key_uvec2(c, pack_offset, pack_bits);
+    key.y |= lod << CHUNK_KEY_LOD_SHIFT;
+    return key;
+}
+
+uint key_lod(uvec2 key) {
+    return key.y >> CHUNK_KEY_LOD_SHIFT;
+}
+
+float lod_scale(uint lod) {
+    return float(1u << lod);
+}
+
+bool lod_in_sphere(ivec3 c, ivec3 center, int R) {
+    ivec3 d = c - center;
+    return d.x*d.x + d.y*d.y + d.z*d.z <= R*R;
+}
+
+// все 8 детей чанка c (на уровень мельче) лежат в шаре уровня детей
+bool lod_children_in_sphere(ivec3 c, ivec3 finer_center, int R) {
+    for (int i = 0; i < 8; ++i) {
+        ivec3 child = c * 2 + ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        if (!lod_in_sphere(child, finer_center, R)) return false;
+    }
+    return true;
+}
+
+// center - центр уровня lod, finer_center - уровня lod - 1 (при lod == 0 не используется)
+bool lod_chunk_selected(ivec3 c, uint lod, uint lod_levels, ivec3 center, ivec3 finer_center, int R) {
+    if (!lod_in_sphere(c, center, R)) return false;
+    if (lod > 0u && lod_children_in_sphere(c, finer_center, R)) return false;
+    // >> на int арифметический - это floor деление на 2
+    if (lod + 1u < lod_levels && !lod_children_in_sphere(c >> 1, center, R)) return false;
+    return true;
+}
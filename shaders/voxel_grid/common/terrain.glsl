@@ -0,0 +1,52 @@
+#pragma once
+
+// Генерация рельефа чанка: stream_generate_terrain и voxelize_to_grid (новый чанк сначала получает рельеф,
+// потом попадания меша). Нужны utils.glsl (hash_ivec2, pack_color) и buffer_structures.glsl (VoxelData).
+
+// ---- noise (value noise + fbm) ----
+float valueNoise(vec2 x, uint seed) {
+    ivec2 i = ivec2(floor(x));
+    vec2  f = fract(x);
+    vec2  u = f*f*(3.0 - 2.0*f);
+
+    float a = hash_ivec2(i + ivec2(0,0), seed);
+    float b = hash_ivec2(i + ivec2(1,0), seed);
+    float c = hash_ivec2(i + ivec2(0,1), seed);
+    float d = hash_ivec2(i + ivec2(1,1), seed);
+
+    return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);
+}
+
+float fbm(vec2 p, uint seed) {
+    float s = 0.0;
+    float a = 0.5;
+    for (int o=0; o<5; ++o) {
+        s += a * valueNoise(p, seed);
+        p *= 2.0;
+        a *= 0.5;
+    }
+    return s;
+}
+
+// воксель local чанка chunkCoord уровня lod: чанк уровня lod генерируется сразу крупными вокселями,
+// шум берётся в центре воксела уровня 0
+VoxelData terrain_voxel(ivec3 chunkCoord, uint lod, ivec3 local, ivec3 chunk_dim, uint seed) {
+    int scale = 1 << lod;
+    ivec3 worldVoxel = (chunkCoord * chunk_dim + local) * scale + ivec3(scale / 2);
+
+    // // ---- terrain height from fbm(xz) ----
+    vec2 xz = vec2(worldVoxel.x, worldVoxel.z) * 0.03; // частота
+    float n = fbm(xz, seed); // 0..~1
+    // float n = 0.5f;
+    float height = 20.0 + n * 30.0; // базовый уровень + амплитуда
+
+    uint type = (float(worldVoxel.y) <= height) ? 1u : 0u;
+    uint vis  = (type != 0u) ? 1u : 0u;
+
+    VoxelData vd;
+    vd.type_vis_flags = (type << TYPE_SHIFT) | (vis << VIS_SHIFT);
+    // цвет: чуть меняем по высоте
+    vec3 col = (type != 0u) ? mix(vec3(0.15,0.35,0.10), vec3(0.45,0.30,0.15), n) : vec3(0.0);
+    vd.color = pack_color(col);
+    return vd;
+}
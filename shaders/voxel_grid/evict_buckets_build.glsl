@@ -8,6 +8,7 @@ layout(local_size_x = 256) in;
 layout(std430, binding=0) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=1) coherent buffer BucketHeads { BucketHead bucket_heads[]; };
 layout(std430, binding=2) coherent buffer BucketNext  { uint bucket_next[]; };
+layout(std430, binding=3) readonly buffer ChunkLastVisibleBuf { uint last_visible_frame[]; };
 
 uniform uint  u_max_chunks;
 uniform uint  u_bucket_count;
@@ -21,8 +22,22 @@ uniform int  u_pack_offset;
 
 uniform float f_eviction_bucket_shell_thickness;
 
+// Направление движения камеры (0 - не задано). Чанки позади считаются дальше в (1 + u_behind_weight) раз
+// по оси, поэтому выселяются раньше чанков той же дальности впереди.
+uniform vec3  u_focus_dir;
+uniform float u_behind_weight;
+
+// Давно не видимые чанки уходят дальше: +1 оболочка за каждые u_visibility_frames_per_shell кадров
+// невидимости, не больше u_max_visibility_shells. 0 - только по расстоянию.
+uniform uint u_frame_index;
+uniform uint u_visibility_frames_per_shell;
+uniform uint u_max_visibility_shells;
+
+uniform uint u_spill_capacity;
+
 // ----- include -----
 #include "../utils.glsl"
+#include "common/lod.glsl"
 // -------------------
 
 void push_bucket(uint b, uint chunkId) {
@@ -42,15 +57,27 @@ void push_bucket(uint b, uint chunkId) {
     // }
 }
 
-uint bucket_for_coord(ivec3 chunkCoord) {
-    vec3 chunkSize = vec3(u_chunk_dim) * u_voxel_size;
-    vec3 minP = vec3(chunkCoord * u_chunk_dim) * u_voxel_size;
+uint bucket_for_coord(ivec3 chunkCoord, uint lod, uint chunkId) {
+    float scale = lod_scale(lod);
+    vec3 chunkSize = vec3(u_chunk_dim) * u_voxel_size * scale;
+    vec3 minP = vec3(chunkCoord) * chunkSize;
     vec3 center = minP + 0.5 * chunkSize;
 
+    // расстояние в чанках своего уровня: кольца клипмапа одинаково далеки от выселения
     vec3 d = center - u_cam_pos;
-    float dist = sqrt(dot(d, d));
+    float dist = sqrt(dot(d, d)) / scale;
+
+    if (dist > 0.0 && dot(u_focus_dir, u_focus_dir) > 0.0) {
+        float behind = max(0.0, -dot(d / dist, u_focus_dir));
+        dist *= 1.0 + u_behind_weight * behind;
+    }
 
     uint b = uint(dist / f_eviction_bucket_shell_thickness);
+
+    if (u_visibility_frames_per_shell > 0u) {
+        uint age = u_frame_index - last_visible_frame[chunkId];
+        b += min(age / u_visibility_frames_per_shell, u_max_visibility_shells);
+    }
     if (b >= u_bucket_count) b = u_bucket_count - 1u;
     return b;
 }
@@ -60,9 +87,18 @@ void main() {
     if (chunkId >= u_max_chunks) return;
     if (meta[chunkId].used == 0u) return;
 
+    // чанки с правками выселяются только через спилл, без места в партии - не попадают в корзины
+    if (u_spill_capacity == 0u && (meta[chunkId].dirty_flags & DIRTY_FLAG_USER_MODIFIED) != 0u) return;
+
+    // чанк вне своего кольца клипмапа не рисуется - выселяется первым
+    if ((meta[chunkId].dirty_flags & DIRTY_FLAG_LOD_HIDDEN) != 0u) {
+        push_bucket(u_bucket_count - 1u, chunkId);
+        return;
+    }
+
     uvec2 key2 = uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi);
     ivec3 cc = unpack_key_to_coord(key2, u_pack_offset, u_pack_bits);
 
-    uint b = bucket_for_coord(cc);
+    uint b = bucket_for_coord(cc, key_lod(key2), chunkId);
     push_bucket(b, chunkId);
 }
@@ -14,15 +14,23 @@ layout(std430, binding=5) coherent buffer BucketHeads { BucketHead bucket_heads[
 layout(std430, binding=6) coherent buffer BucketNext  { uint bucket_next[]; };
 layout(std430, binding=7) buffer ChunkMeshAllocBuf { ChunkMeshAlloc chunk_alloc[]; };
 layout(std430, binding=8) buffer EvictedChunksList { uint evicted_chunks_counter; uint evicted_chunks_list[]; };
+layout(std430, binding=9) buffer StreamStateBuf { StreamState stream_states[]; }; // [MAX_LOD_LEVELS]
+layout(std430, binding=10) buffer SpillBatchBuf { uint spill_count; uint spill_overflow; uint spill_pad0; uint spill_pad1; SpillRecord spill_records[]; };
+layout(std430, binding=11) buffer EvictFreedCount { uint freed_count; };
 
 uniform uint u_hash_table_size;
 uniform uint u_bucket_count;
+uniform uint u_spill_capacity; // свободные места в партии спилла, 0 - партий нет, чанки с правками не выселяются
+
+uniform uint u_pack_bits;
+uniform int  u_pack_offset;
 
 // ----- include -----
 #include "../utils.glsl"
 
 #define NOT_INCLUDE_GET_OR_CREATE
 #include "common/hash_table.glsl"
+#include "common/lod.glsl"
 // -------------------
 
 // ABA проблемы не будет, так как везде используется либо только pop, либо только push (поэтому теги на heads пока не нужны)
@@ -66,6 +74,26 @@ void main() {
 
     uvec2 key = uvec2(meta[victim].key_lo, meta[victim].key_hi);
 
+    // правки пользователя не теряем: воксели уходят в партию спилла, без места в ней чанк остаётся
+    if ((meta[victim].dirty_flags & DIRTY_FLAG_USER_MODIFIED) != 0u) {
+        uint spill_idx = u_spill_capacity == 0u ? INVALID_ID : atomicAdd(spill_count, 1u);
+        if (spill_idx >= u_spill_capacity) {
+            if (u_spill_capacity != 0u) atomicAdd(spill_overflow, 1u);
+            evicted_chunks_list[enviction_id] = INVALID_ID;
+            return;
+        }
+        spill_records[spill_idx] = SpillRecord(victim, key.x, key.y, 0u);
+    }
+
+    // выселяем чанк внутри сферы последнего отбора - отбор по одной оболочке его уже не вернёт.
+    // Спрятанный чанк клипмапа отбор и не должен возвращать
+    uint lod = key_lod(key);
+    if (stream_states[lod].center.w == 1 && (meta[victim].dirty_flags & DIRTY_FLAG_LOD_HIDDEN) == 0u) {
+        ivec3 d = unpack_key_to_coord(key, u_pack_offset, u_pack_bits) - stream_states[lod].center.xyz;
+        if (d.x*d.x + d.y*d.y + d.z*d.z <= stream_states[lod].radius * stream_states[lod].radius)
+            atomicExchange(stream_states[lod].rescan_requested, 1u);
+    }
+
     // выкидываем из таблицы
     remove_from_table(key);
 
@@ -75,7 +103,8 @@ void main() {
     enqueued[victim] = 0u;
 
     // пушим обратно в free_list
-    free_list[free_count + enviction_id] = victim;
+    // промахи выше не должны оставлять дыр, поэтому отдельный счётчик, а не enviction_id
+    free_list[free_count + atomicAdd(freed_count, 1u)] = victim;
     
     evicted_chunks_list[enviction_id] = victim;
 }
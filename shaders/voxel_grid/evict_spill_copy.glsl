@@ -0,0 +1,27 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Копирует воксели выселенных чанков с правками в партию спилла до того, как их id переиспользуют.
+// x - воксель, y - запись спилла
+
+layout(std430, binding=0) readonly buffer ChunkVoxels { VoxelData voxels[]; };
+layout(std430, binding=1) readonly buffer SpillBatchBuf { uint spill_count; uint spill_overflow; uint spill_pad0; uint spill_pad1; SpillRecord spill_records[]; };
+layout(std430, binding=2) writeonly buffer SpillVoxels { VoxelData spill_voxels[]; };
+
+uniform uint u_voxels_per_chunk;
+uniform uint u_spill_capacity;
+
+void main() {
+    uint voxelId = gl_GlobalInvocationID.x;
+    uint spillIdx = gl_GlobalInvocationID.y;
+
+    if (voxelId >= u_voxels_per_chunk) return;
+    if (spillIdx >= min(spill_count, u_spill_capacity)) return;
+
+    uint chunkId = spill_records[spillIdx].chunk_id;
+    spill_voxels[spillIdx * u_voxels_per_chunk + voxelId] = voxels[chunkId * u_voxels_per_chunk + voxelId];
+}
@@ -0,0 +1,16 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// Level 0 пирамиды Hi-Z: глубина framebuffer как есть
+
+uniform sampler2D u_depth;
+uniform ivec2 u_size;
+
+layout(r32f, binding=0) writeonly uniform image2D u_dst;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, u_size))) return;
+
+    imageStore(u_dst, p, vec4(texelFetch(u_depth, p, 0).r));
+}
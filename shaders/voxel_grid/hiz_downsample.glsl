@@ -0,0 +1,32 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// Следующий уровень Hi-Z: самая дальняя глубина по 2x2. При нечётном размере источника последний
+// столбец/строка уровня захватывает и лишний texel, иначе он не попал бы ни в один texel уровня.
+
+layout(r32f, binding=0) readonly uniform image2D u_src;
+layout(r32f, binding=1) writeonly uniform image2D u_dst;
+
+uniform ivec2 u_src_size;
+uniform ivec2 u_dst_size;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, u_dst_size))) return;
+
+    ivec2 base = p * 2;
+    ivec2 extra = ivec2(
+        (p.x == u_dst_size.x - 1 && (u_src_size.x & 1) == 1) ? 1 : 0,
+        (p.y == u_dst_size.y - 1 && (u_src_size.y & 1) == 1) ? 1 : 0
+    );
+
+    float d = 0.0;
+    for (int y = 0; y <= 1 + extra.y; ++y) {
+        for (int x = 0; x <= 1 + extra.x; ++x) {
+            ivec2 s = min(base + ivec2(x, y), u_src_size - 1);
+            d = max(d, imageLoad(u_src, s).r);
+        }
+    }
+
+    imageStore(u_dst, p, vec4(d));
+}
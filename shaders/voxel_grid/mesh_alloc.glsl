@@ -5,9 +5,9 @@ layout(local_size_x = 256) in;
 #include "common/buffer_structures.glsl"
 // -------------------
 
-layout(std430, binding=0) buffer MeshBuffersStatusBuf { uint is_vb_full; uint is_ib_full; }; // y = dirtyCount
+layout(std430, binding=0) buffer MeshBuffersStatusBuf { uint is_vb_full; };
 layout(std430, binding=1) readonly buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
-layout(std430, binding=2) readonly buffer DirtyQuadCountBuf { uint dirty_quad_count[]; };
+layout(std430, binding=2) readonly buffer DirtyQuadCountBuf { uint dirty_quad_count[]; }; // [dirtyIdx * FACE_COUNT + face]
 layout(std430, binding=3) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=4) buffer ChunkMeshAllocLocalBuf { ChunkMeshAlloc chunk_alloc_local[]; }; 
 layout(std430, binding=5) readonly buffer ChunkMeshAllocGlobalBuf { ChunkMeshAlloc chunk_alloc_global[]; }; 
@@ -21,7 +21,6 @@ uniform uint bb_pages;
 uniform uint bb_page_elements;  // например 256
 uniform uint bb_max_order;   // log2(u_bb_pages)
 uniform uint bb_quad_size;
-uniform uint u_is_vb_phase;
 
 // ----- include -----
 #include "../utils.glsl"
@@ -30,7 +29,12 @@ uniform uint u_is_vb_phase;
 #include "common/allocator.glsl"
 // -------------------
 
-bool is_vb_phase = u_is_vb_phase == 1u;
+void set_no_mesh(uint dirtyIdx) {
+    chunk_alloc_local[dirtyIdx].v_startPage = INVALID_ID;
+    chunk_alloc_local[dirtyIdx].v_order = 0u;
+    chunk_alloc_local[dirtyIdx].needV = 0u;
+    chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+}
 
 void main() {
     uint dirtyIdx = gl_GlobalInvocationID.x;
@@ -39,52 +43,24 @@ void main() {
     
     uint chunkId = dirty_list[dirtyIdx];
 
-    if (is_vb_full == 1u || is_ib_full == 1u) {
-        if (is_vb_phase){
-            chunk_alloc_local[dirtyIdx].v_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].v_order = 0u;
-            chunk_alloc_local[dirtyIdx].needV = 0u;
-        } else {
-            chunk_alloc_local[dirtyIdx].i_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].i_order = 0u;
-            chunk_alloc_local[dirtyIdx].needI = 0u;
-        }
-
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+    if (is_vb_full == 1u) {
+        set_no_mesh(dirtyIdx);
         return;
     }
 
     // мог быть уже выселен
     if (meta[chunkId].used == 0u) {
-        if (is_vb_phase){
-            chunk_alloc_local[dirtyIdx].v_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].v_order = 0u;
-            chunk_alloc_local[dirtyIdx].needV = 0u;
-        } else {
-            chunk_alloc_local[dirtyIdx].i_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].i_order = 0u;
-            chunk_alloc_local[dirtyIdx].needI = 0u;
-        }
-        
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+        set_no_mesh(dirtyIdx);
         return;
     }
 
-    uint quads = dirty_quad_count[dirtyIdx];
+    uint quads = 0u;
+    for (uint f = 0u; f < FACE_COUNT; ++f)
+        quads += dirty_quad_count[dirtyIdx * FACE_COUNT + f];
 
     // пустой меш
     if (quads == 0u) {
-        if (is_vb_phase){
-            chunk_alloc_local[dirtyIdx].v_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].v_order = 0u;
-            chunk_alloc_local[dirtyIdx].needV = 0u;
-        } else {
-            chunk_alloc_local[dirtyIdx].i_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].i_order = 0u;
-            chunk_alloc_local[dirtyIdx].needI = 0u;
-        }
-        
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+        set_no_mesh(dirtyIdx);
         return;
     }
 
@@ -94,31 +70,17 @@ void main() {
 
     uint bStart = bb_alloc_pages(bOrder);
     if (bStart == INVALID_ID) {
-        if (is_vb_phase){
-            atomicExchange(is_vb_full, 1u);
-            chunk_alloc_local[dirtyIdx].v_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].v_order = 0u;
-            chunk_alloc_local[dirtyIdx].needV = 0u;
-        } else {
-            atomicExchange(is_ib_full, 1u);
-            chunk_alloc_local[dirtyIdx].i_startPage = INVALID_ID;
-            chunk_alloc_local[dirtyIdx].i_order = 0u;
-            chunk_alloc_local[dirtyIdx].needI = 0u;
-        }
-        
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+        atomicExchange(is_vb_full, 1u);
+        set_no_mesh(dirtyIdx);
         return;
     }
 
-    if (is_vb_phase) {
-        chunk_alloc_local[dirtyIdx].v_startPage = bStart;
-        chunk_alloc_local[dirtyIdx].v_order = bOrder;
-        chunk_alloc_local[dirtyIdx].needV = needB;
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
-    } else {
-        chunk_alloc_local[dirtyIdx].i_startPage = bStart;
-        chunk_alloc_local[dirtyIdx].i_order = bOrder;
-        chunk_alloc_local[dirtyIdx].needI = needB;
-        chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
-    }
+    chunk_alloc_local[dirtyIdx].v_startPage = bStart;
+    chunk_alloc_local[dirtyIdx].v_order = bOrder;
+    chunk_alloc_local[dirtyIdx].needV = needB;
+    chunk_alloc_local[dirtyIdx].need_rebuild = 1u;
+
+    // диапазоны направлений для mesh_emit и build_indirect_cmds
+    for (uint f = 0u; f < FACE_COUNT; ++f)
+        chunk_alloc_local[dirtyIdx].face_quads[f] = dirty_quad_count[dirtyIdx * FACE_COUNT + f];
 }
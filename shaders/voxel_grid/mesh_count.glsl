@@ -9,7 +9,7 @@ layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
 layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
 layout(std430, binding=2) readonly buffer ChunkVoxels { VoxelData voxels[]; };
 layout(std430, binding=3) readonly buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
-layout(std430, binding=4) buffer DirtyQuadCountBuf { uint dirty_quad_count[]; };
+layout(std430, binding=4) buffer DirtyQuadCountBuf { uint dirty_quad_count[]; }; // [dirtyIdx * FACE_COUNT + face]
 layout(std430, binding=5) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
 
 uniform uint  u_hash_table_size;
@@ -45,10 +45,10 @@ void main() {
     uint t = voxel_type_in_chunk(chunkId, p);
     if (t == 0u) return;
 
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 1, 0, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3(-1, 0, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 1, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0,-1, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 0, 1)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
-    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 0,-1)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 1, 0, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 0u], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3(-1, 0, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 1u], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 1, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 2u], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0,-1, 0)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 3u], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 0, 1)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 4u], 1u);
+    if (neighbor_type(chunkId, chunkCoord, p, ivec3( 0, 0,-1)) == 0u) atomicAdd(dirty_quad_count[dirtyIdx * FACE_COUNT + 5u], 1u);
 }
@@ -8,25 +8,22 @@ layout(local_size_x = 256) in;
 layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
 layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
 layout(std430, binding=2) readonly buffer ChunkVoxels { VoxelData voxels[]; };
-layout(std430, binding=3) buffer MeshBuffersStatusBuf { uint is_vb_full; uint is_ib_full; };
+layout(std430, binding=3) buffer MeshBuffersStatusBuf { uint is_vb_full; };
 layout(std430, binding=4) readonly buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
-layout(std430, binding=5) buffer EmitCounterBuf { uint emit_counter[]; };
+layout(std430, binding=5) buffer EmitCounterBuf { uint emit_counter[]; }; // [chunkId * FACE_COUNT + face]
 layout(std430, binding=6) buffer ChunkMeshAllocBuf { ChunkMeshAlloc chunk_alloc[]; }; 
 layout(std430, binding=7) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=8) buffer GlobalVB { Vertex vb[]; };
-layout(std430, binding=9) buffer GlobalIB { uint ib[]; };
 
 // ===== uniforms =====
 uniform uint  u_hash_table_size;
 uniform ivec3 u_chunk_dim;
 uniform uint  u_voxels_per_chunk;
-uniform vec3  u_voxel_size;
 
 uniform uint u_pack_bits;
 uniform int  u_pack_offset;
 
 uniform uint u_vb_page_verts;
-uniform uint u_ib_page_inds;
 
 // ----- include -----
 #include "../utils.glsl"
@@ -61,76 +58,86 @@ uint ao_corner(uint chunkId, ivec3 chunkCoord, ivec3 p,
     return s1 + s2 + c; // 0..3
 }
 
+// см. Vertex в buffer_structures.glsl
+uint pack_vertex_pos_face(ivec3 lp, uint face) {
+    uvec3 u = uvec3(lp) & VERTEX_POS_MASK;
+    return u.x | (u.y << VERTEX_POS_BITS) | (u.z << (2u * VERTEX_POS_BITS)) | (face << VERTEX_FACE_SHIFT);
+}
+
 // ===== emit quad =====
 void emit_quad(uint chunkId, ivec3 chunkCoord, ivec3 p, uint face, uint colorRGB) {
-    uint maxQuads = chunk_alloc[chunkId].needI / 6u;
-    uint q = atomicAdd(emit_counter[chunkId], 1u);
-    if (q >= maxQuads) return;
+    // квады граней одного направления лежат подряд: +X, -X, +Y, -Y, +Z, -Z
+    uint faceFirst = 0u;
+    for (uint f = 0u; f < face; ++f) faceFirst += chunk_alloc[chunkId].face_quads[f];
+
+    uint local = atomicAdd(emit_counter[chunkId * FACE_COUNT + face], 1u);
+    if (local >= chunk_alloc[chunkId].face_quads[face]) return;
+
+    uint q = faceFirst + local;
+    if (q >= chunk_alloc[chunkId].needV / 4u) return;
 
     uint baseV = chunk_alloc[chunkId].v_startPage * u_vb_page_verts + q * 4u;
-    uint baseI = chunk_alloc[chunkId].i_startPage * u_ib_page_inds + q * 6u;
 
-    vec3 wp = vec3(chunkCoord * u_chunk_dim + p) * u_voxel_size;
 
     // Определяем базис плоскости грани: нормаль N и два тангенса U,V (в воксельных шагах)
     ivec3 N, U, V;
 
-    // и 4 вершины как раньше
-    vec3 v0, v1, v2, v3;
+    // и 4 вершины - углы вокселя в координатах чанка
+    ivec3 v0, v1, v2, v3;
 
     if (face == 0u) { // +X
         N = ivec3( 1, 0, 0);
         U = ivec3( 0, 1, 0); // v1-v0
         V = ivec3( 0, 0, 1); // v3-v0
-        v0 = wp + vec3(u_voxel_size.x, 0, 0);
-        v1 = wp + vec3(u_voxel_size.x, u_voxel_size.y, 0);
-        v2 = wp + vec3(u_voxel_size.x, u_voxel_size.y, u_voxel_size.z);
-        v3 = wp + vec3(u_voxel_size.x, 0, u_voxel_size.z);
+        v0 = p + ivec3(1, 0, 0);
+        v1 = p + ivec3(1, 1, 0);
+        v2 = p + ivec3(1, 1, 1);
+        v3 = p + ivec3(1, 0, 1);
 
     } else if (face == 1u) { // -X
         N = ivec3(-1, 0, 0);
         U = ivec3( 0, 0, 1);
         V = ivec3( 0, 1, 0);
-        v0 = wp + vec3(0, 0, 0);
-        v1 = wp + vec3(0, 0, u_voxel_size.z);
-        v2 = wp + vec3(0, u_voxel_size.y, u_voxel_size.z);
-        v3 = wp + vec3(0, u_voxel_size.y, 0);
+        v0 = p + ivec3(0, 0, 0);
+        v1 = p + ivec3(0, 0, 1);
+        v2 = p + ivec3(0, 1, 1);
+        v3 = p + ivec3(0, 1, 0);
 
     } else if (face == 2u) { // +Y
         N = ivec3( 0, 1, 0);
         U = ivec3( 0, 0, 1);
         V = ivec3( 1, 0, 0);
-        v0 = wp + vec3(0, u_voxel_size.y, 0);
-        v1 = wp + vec3(0, u_voxel_size.y, u_voxel_size.z);
-        v2 = wp + vec3(u_voxel_size.x, u_voxel_size.y, u_voxel_size.z);
-        v3 = wp + vec3(u_voxel_size.x, u_voxel_size.y, 0);
+        v0 = p + ivec3(0, 1, 0);
+        v1 = p + ivec3(0, 1, 1);
+        v2 = p + ivec3(1, 1, 1);
+        v3 = p + ivec3(1, 1, 0);
 
     } else if (face == 3u) { // -Y
         N = ivec3( 0,-1, 0);
         U = ivec3( 1, 0, 0);
         V = ivec3( 0, 0, 1);
-        v0 = wp + vec3(0, 0, 0);
-        v1 = wp + vec3(u_voxel_size.x, 0, 0);
-        v2 = wp + vec3(u_voxel_size.x, 0, u_voxel_size.z);
-        v3 = wp + vec3(0, 0, u_voxel_size.z);
+        v0 = p + ivec3(0, 0, 0);
+        v1 = p + ivec3(1, 0, 0);
+        v2 = p + ivec3(1, 0, 1);
+        v3 = p + ivec3(0, 0, 1);
 
     } else if (face == 4u) { // +Z
         N = ivec3( 0, 0, 1);
         U = ivec3( 1, 0, 0);
         V = ivec3( 0, 1, 0);
-        v0 = wp + vec3(0, 0, u_voxel_size.z);
-        v1 = wp + vec3(u_voxel_size.x, 0, u_voxel_size.z);
-        v2 = wp + vec3(u_voxel_size.x, u_voxel_size.y, u_voxel_size.z);
-        v3 = wp + vec3(0, u_voxel_size.y, u_voxel_size.z);
+        v0 = p + ivec3(0, 0, 1);
+        v1 = p + ivec3(1, 0, 1);
+        v2 = p + ivec3(1, 1, 1);
+        v3 = p + ivec3(0, 1, 1);
 
     } else { // -Z
         N = ivec3( 0, 0,-1);
         U = ivec3( 0, 1, 0);
         V = ivec3( 1, 0, 0);
-        v0 = wp + vec3(0, 0, 0);
-        v1 = wp + vec3(0, u_voxel_size.y, 0);
-        v2 = wp + vec3(u_voxel_size.x, u_voxel_size.y, 0);
-        v3 = wp + vec3(u_voxel_size.x, 0, 0);
+        v0 = p + ivec3(0, 0, 0);
+        v1 = p + ivec3(0, 1, 0);
+        v2 = p + ivec3(1, 1, 0);
+        v3 = p + ivec3(1, 0, 0);
     }
 
     // --- AO для 4 углов ---
@@ -147,46 +154,19 @@ void emit_quad(uint chunkId, ivec3 chunkCoord, ivec3 p, uint face, uint colorRGB
     uint c2 = pack_ao_in_alpha(colorRGB, oc2);
     uint c3 = pack_ao_in_alpha(colorRGB, oc3);
 
-    vb[baseV + 0u].pos = vec4(v0, 1.0); vb[baseV + 0u].color = c0; vb[baseV + 0u].face = face;
-    vb[baseV + 1u].pos = vec4(v1, 1.0); vb[baseV + 1u].color = c1; vb[baseV + 1u].face = face;
-    vb[baseV + 2u].pos = vec4(v2, 1.0); vb[baseV + 2u].color = c2; vb[baseV + 2u].face = face;
-    vb[baseV + 3u].pos = vec4(v3, 1.0); vb[baseV + 3u].color = c3; vb[baseV + 3u].face = face;
-
-
-    ib[baseI + 0u] = baseV + 0u;
-    ib[baseI + 1u] = baseV + 1u;
-    ib[baseI + 2u] = baseV + 2u;
-    ib[baseI + 3u] = baseV + 0u;
-    ib[baseI + 4u] = baseV + 2u;
-    ib[baseI + 5u] = baseV + 3u;
-
     // --- диагональ по AO (убирает "шахматные" швы) ---
-    // сравниваем суммы окклюзий по диагоналям: меньше окклюзия -> светлее -> лучше выбрать соответствующую диагональ
-
-    uint s02 = oc0 + oc2;
-    uint s13 = oc1 + oc3;
-
-    if (s02 <= s13) {
-        // диагональ 0-2
-        ib[baseI + 0u] = baseV + 0u;
-        ib[baseI + 1u] = baseV + 1u;
-        ib[baseI + 2u] = baseV + 2u;
-        ib[baseI + 3u] = baseV + 0u;
-        ib[baseI + 4u] = baseV + 2u;
-        ib[baseI + 5u] = baseV + 3u;
-    } else {
-        // диагональ 1-3
-        ib[baseI + 0u] = baseV + 0u;
-        ib[baseI + 1u] = baseV + 1u;
-        ib[baseI + 2u] = baseV + 3u;
-        ib[baseI + 3u] = baseV + 1u;
-        ib[baseI + 4u] = baseV + 2u;
-        ib[baseI + 5u] = baseV + 3u;
-    }
+    // сравниваем суммы окклюзий по диагоналям: меньше окклюзия -> светлее -> лучше выбрать соответствующую диагональ.
+    // Треугольники собирает voxel_mesh.vert, выбор диагонали хранится в VERTEX_FLIP_BIT первой вершины
+    uint flip = (oc0 + oc2 <= oc1 + oc3) ? 0u : VERTEX_FLIP_BIT;
+
+    vb[baseV + 0u].pos_face = pack_vertex_pos_face(v0, face) | flip; vb[baseV + 0u].color = c0;
+    vb[baseV + 1u].pos_face = pack_vertex_pos_face(v1, face); vb[baseV + 1u].color = c1;
+    vb[baseV + 2u].pos_face = pack_vertex_pos_face(v2, face); vb[baseV + 2u].color = c2;
+    vb[baseV + 3u].pos_face = pack_vertex_pos_face(v3, face); vb[baseV + 3u].color = c3;
 }
 
 void main() {
-    if (is_vb_full == 1u || is_ib_full == 1u)
+    if (is_vb_full == 1u)
         return;
 
     uint voxelId  = gl_GlobalInvocationID.x;
@@ -197,7 +177,7 @@ void main() {
     if (voxelId >= u_voxels_per_chunk) return;
 
     uint chunkId = dirty_list[dirtyIdx];
-    if (chunk_alloc[chunkId].v_startPage == INVALID_ID || chunk_alloc[chunkId].i_startPage == INVALID_ID) return;
+    if (chunk_alloc[chunkId].v_startPage == INVALID_ID) return;
 
     uvec2 key2 = uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi);
     ivec3 chunkCoord = unpack_key_to_coord(key2, u_pack_offset, u_pack_bits);
@@ -0,0 +1,32 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) readonly buffer DefragMovesBuf { uint move_count; MeshDefragMove moves[]; };
+layout(std430, binding=1) buffer VertexBuf { Vertex vb[]; };
+
+uniform uint u_vb_page_verts;
+
+// ----- include -----
+#include "../utils.glsl"
+// -------------------
+
+// y - номер переноса, x - все группы по x идут по вершинам одного меша с шагом.
+// Индексов нет, а команды рисования каждый кадр строятся по v_startPage - достаточно скопировать вершины
+void main() {
+    uint move_idx = gl_WorkGroupID.y;
+    if (move_idx >= move_count) return;
+
+    MeshDefragMove move = moves[move_idx];
+    uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+
+    if (move.new_v_startPage != move.old_v_startPage) {
+        uint src = move.old_v_startPage * u_vb_page_verts;
+        uint dst = move.new_v_startPage * u_vb_page_verts;
+        for (uint i = gl_GlobalInvocationID.x; i < move.needV; i += stride)
+            vb[dst + i] = vb[src + i];
+    }
+}
@@ -0,0 +1,32 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) readonly buffer DefragMovesBuf { uint move_count; MeshDefragMove moves[]; };
+layout(std430, binding=1) coherent buffer VBHeads { uint vb_heads[]; };
+layout(std430, binding=2) coherent buffer VBState { uint vb_state[]; };
+layout(std430, binding=3) coherent buffer VBNodes  { Node vb_nodes[];  };
+layout(std430, binding=4) coherent buffer VBFreeNodesList  { uint vb_free_nodes_counter; uint vb_free_nodes_list[];  };
+layout(std430, binding=5) coherent buffer VBReturnedNodesList  { uint vb_returned_nodes_counter; uint vb_returned_nodes_list[]; };
+
+uniform uint vb_max_order;
+
+// ----- include -----
+#include "../utils.glsl"
+
+#define PREFIX vb
+#include "common/allocator.glsl"
+// -------------------
+
+void main() {
+    uint move_idx = gl_GlobalInvocationID.x;
+    if (move_idx >= move_count) return;
+
+    MeshDefragMove move = moves[move_idx];
+
+    // free_pages сливает освобождённый блок со свободным buddy - так и собираются большие блоки
+    if (move.new_v_startPage != move.old_v_startPage) vb_free_pages(move.old_v_startPage, move.v_order);
+}
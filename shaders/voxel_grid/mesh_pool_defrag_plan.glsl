@@ -0,0 +1,67 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) buffer GlobalChunkMeshAllocBuf { ChunkMeshAlloc chunk_alloc_global[]; }; 
+layout(std430, binding=1) coherent buffer VBHeads { uint vb_heads[]; };
+layout(std430, binding=2) coherent buffer VBState { uint vb_state[]; };
+layout(std430, binding=3) coherent buffer VBNodes  { Node vb_nodes[];  };
+layout(std430, binding=4) coherent buffer VBFreeNodesList  { uint vb_free_nodes_counter; uint vb_free_nodes_list[];  };
+layout(std430, binding=5) coherent buffer VBReturnedNodesList  { uint vb_returned_nodes_counter; uint vb_returned_nodes_list[]; };
+layout(std430, binding=6) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=7) readonly buffer EnqueuedBuf { uint enqueued[]; };
+layout(std430, binding=8) buffer DefragMovesBuf { uint move_count; MeshDefragMove moves[]; };
+
+uniform uint vb_max_order;
+uniform uint u_max_chunks;
+uniform uint u_max_moves; // бюджет кадра
+
+// ----- include -----
+#include "../utils.glsl"
+
+#define PREFIX vb
+#include "common/allocator.glsl"
+// -------------------
+
+// Выбор переносов. Переносим только блоки, чей buddy свободен (старое место сольётся с buddy в блок order + 1),
+// и только в свободный блок того же order, выбранный vb_pop_free_move_dest: buddy назначения либо поделён,
+// либо занят блоком, начинающимся после источника. Поэтому встречных переносов (A на место buddy B,
+// B на место buddy A) не бывает, а у источника с наименьшим началом за кадр buddy никто не займёт.
+// Значит каждый кадр с переносами уменьшает число свободных блоков хотя бы на один: назначение -1,
+// старое место +1, слияние с buddy -1. Процесс сходится и при постоянном запуске не гоняет меши по кругу.
+void main() {
+    uint chunk_id = gl_GlobalInvocationID.x;
+    if (chunk_id >= u_max_chunks) return;
+    if (meta[chunk_id].used == 0u) return;
+    if (enqueued[chunk_id] != 0u) return; // меш всё равно будет перевыделен в build_mesh_from_dirty
+
+    ChunkMeshAlloc chunk_alloc = chunk_alloc_global[chunk_id];
+    if (chunk_alloc.v_startPage == INVALID_ID) return;
+
+    if (!vb_is_block_stranded(chunk_alloc.v_startPage, chunk_alloc.v_order)) return;
+
+    if (atomicAdd(move_count, 0u) >= u_max_moves) return;
+
+    uint new_v = vb_pop_free_move_dest(chunk_alloc.v_order, chunk_alloc.v_startPage);
+    if (new_v == INVALID_ID) return;
+
+    uint move_idx = atomicAdd(move_count, 1u);
+    if (move_idx >= u_max_moves) {
+        // Бюджет уже выбран другими потоками - отдаём страницы назад
+        atomicAdd(move_count, 0xFFFFFFFFu);
+        vb_free_pages(new_v, chunk_alloc.v_order);
+        return;
+    }
+
+    moves[move_idx].chunk_id = chunk_id;
+    moves[move_idx].old_v_startPage = chunk_alloc.v_startPage;
+    moves[move_idx].new_v_startPage = new_v;
+    moves[move_idx].v_order = chunk_alloc.v_order;
+    moves[move_idx].needV = chunk_alloc.needV;
+
+    // Старые страницы освободит mesh_pool_defrag_free.glsl после копирования
+    chunk_alloc_global[chunk_id].v_startPage = new_v;
+}
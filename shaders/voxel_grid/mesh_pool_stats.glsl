@@ -0,0 +1,44 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) readonly buffer BBState { uint bb_state[]; };
+layout(std430, binding=1) buffer MeshPoolStatsBuf { MeshPoolStats pool_stats[]; }; // [u_pool_index]
+
+uniform uint bb_pages;
+uniform uint bb_max_order;
+uniform uint u_pool_index;
+
+// ----- include -----
+#include "../utils.glsl"
+#include "common/allocator.glsl"
+// -------------------
+
+void main() {
+    uint page = gl_GlobalInvocationID.x;
+    if (page >= bb_pages) return;
+
+    // Состояние осмысленно только у первой страницы блока, у остальных ST_MERGED
+    uint state = bb_state[page];
+    uint kind = state & ST_MASK;
+    uint order = state >> ST_MASK_BITS;
+    if (order >= MESH_POOL_MAX_ORDERS) return;
+
+    if (kind == ST_FREE) {
+        atomicAdd(pool_stats[u_pool_index].free_blocks[order], 1u);
+        atomicAdd(pool_stats[u_pool_index].free_pages, 1u << order);
+        atomicMax(pool_stats[u_pool_index].largest_free_order, order + 1u);
+    } else if (kind == ST_ALLOC) {
+        atomicAdd(pool_stats[u_pool_index].alloc_blocks[order], 1u);
+        atomicAdd(pool_stats[u_pool_index].alloc_pages, 1u << order);
+
+        if (order < bb_max_order) {
+            uint buddy = page ^ (1u << order);
+            if (bb_state[buddy] == pack_state(order, ST_FREE))
+                atomicAdd(pool_stats[u_pool_index].stranded_blocks, 1u);
+        }
+    }
+}
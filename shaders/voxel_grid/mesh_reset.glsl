@@ -6,8 +6,8 @@ layout(local_size_x = 256) in;
 // -------------------
 
 layout(std430, binding=0) readonly buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
-layout(std430, binding=1) buffer DirtyQuadCountBuf { uint dirty_quad_count[]; };
-layout(std430, binding=2) buffer EmitCounterBuf { uint emit_counter[]; };
+layout(std430, binding=1) buffer DirtyQuadCountBuf { uint dirty_quad_count[]; }; // [dirtyIdx * FACE_COUNT + face]
+layout(std430, binding=2) buffer EmitCounterBuf { uint emit_counter[]; };         // [chunkId * FACE_COUNT + face]
 
 // ----- include -----
 #include "../utils.glsl"
@@ -18,8 +18,10 @@ void main() {
     uint dirtyCount = dirty_count;
     if (dirtyIdx >= dirtyCount) return;
 
-    dirty_quad_count[dirtyIdx] = 0u;
-
     uint chunkId = dirty_list[dirtyIdx];
-    emit_counter[chunkId] = 0u;
+
+    for (uint f = 0u; f < FACE_COUNT; ++f) {
+        dirty_quad_count[dirtyIdx * FACE_COUNT + f] = 0u;
+        emit_counter[chunkId * FACE_COUNT + f] = 0u;
+    }
 }
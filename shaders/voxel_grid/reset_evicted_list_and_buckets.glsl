@@ -8,12 +8,14 @@ layout(local_size_x = 256) in;
 layout(std430, binding=0) coherent buffer BucketHeads { BucketHead bucket_heads[]; };
 layout(std430, binding=1) buffer EvictedChunksList { uint evicted_chunks_counter; uint evicted_chunks_list[]; };
 layout(std430, binding=2) buffer FreeList { uint free_count; uint free_list[]; };
+layout(std430, binding=3) buffer EvictFreedCount { uint freed_count; };
 
 uniform uint u_bucket_count;
 
 void main() {
     if (gl_GlobalInvocationID.x == 0u) {
-        free_count += evicted_chunks_counter;
+        free_count += freed_count;
+        freed_count = 0u;
         evicted_chunks_counter = 0u;
     }
 
@@ -12,6 +12,7 @@ layout(std430, binding=3) writeonly restrict buffer ChunkVoxels { VoxelData voxe
 layout(std430, binding=4) buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=5) buffer EnqueuedBuf { uint enqueued[]; };
 layout(std430, binding=6) buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
+layout(std430, binding=7) writeonly buffer ChunkLastVisibleBuf { uint last_visible_frame[]; };
 
 uniform ivec3 u_chunk_dim;
 uniform uint  u_voxels_per_chunk;
@@ -21,6 +22,7 @@ uniform int  u_pack_offset;
 
 uniform uint u_set_dirty_flag_bits; // 1u
 uniform uint u_seed;
+uniform uint u_frame_index;
 
 uniform uint u_hash_table_size;
 
@@ -29,6 +31,8 @@ uniform uint u_hash_table_size;
 
 #define NOT_INCLUDE_GET_OR_CREATE
 #include "common/hash_table.glsl"
+#include "common/lod.glsl"
+#include "common/terrain.glsl"
 // -------------------
 
 
@@ -37,31 +41,6 @@ uint voxel_index(ivec3 p) {
     return uint((p.z * u_chunk_dim.y + p.y) * u_chunk_dim.x + p.x);
 }
 
-// ---- noise (value noise + fbm) ----
-float valueNoise(vec2 x) {
-    ivec2 i = ivec2(floor(x));
-    vec2  f = fract(x);
-    vec2  u = f*f*(3.0 - 2.0*f);
-
-    float a = hash_ivec2(i + ivec2(0,0), u_seed);
-    float b = hash_ivec2(i + ivec2(1,0), u_seed);
-    float c = hash_ivec2(i + ivec2(0,1), u_seed);
-    float d = hash_ivec2(i + ivec2(1,1), u_seed);
-
-    return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);
-}
-
-float fbm(vec2 p) {
-    float s = 0.0;
-    float a = 0.5;
-    for (int o=0; o<5; ++o) {
-        s += a * valueNoise(p);
-        p *= 2.0;
-        a *= 0.5;
-    }
-    return s;
-}
-
 void mark_dirty(uint chunkId) {
     uint was = atomicCompSwap(enqueued[chunkId], 0u, 1u);
     if (was == 0u) {
@@ -71,8 +50,8 @@ void mark_dirty(uint chunkId) {
     }
 }
 
-void try_mark_neighbor(ivec3 ncoord) {
-    uint id = lookup_chunk(pack_key_uvec2(ncoord, u_pack_offset, u_pack_bits), false);
+void try_mark_neighbor(ivec3 ncoord, uint lod) {
+    uint id = lookup_chunk(pack_lod_key(ncoord, lod, u_pack_offset, u_pack_bits), false);
     if (id == INVALID_ID) return;
 
     // (опционально) "атомарное чтение", чтобы избежать странностей кеша
@@ -92,29 +71,16 @@ void main() {
 
     uint chunkId = load_list[listIdx];
 
-    ivec3 chunkCoord = unpack_key_to_coord(uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi), u_pack_offset, u_pack_bits);
+    uvec2 key = uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi);
+    ivec3 chunkCoord = unpack_key_to_coord(key, u_pack_offset, u_pack_bits);
+
+    uint lod = key_lod(key);
 
     int lx = int(voxelId % uint(u_chunk_dim.x));
     int ly = int((voxelId / uint(u_chunk_dim.x)) % uint(u_chunk_dim.y));
     int lz = int(voxelId / uint(u_chunk_dim.x * u_chunk_dim.y));
-    ivec3 local = ivec3(lx, ly, lz);
-
-    ivec3 worldVoxel = chunkCoord * u_chunk_dim + local;
-
-    // // ---- terrain height from fbm(xz) ----
-    vec2 xz = vec2(worldVoxel.x, worldVoxel.z) * 0.03; // частота
-    float n = fbm(xz); // 0..~1
-    // float n = 0.5f;
-    float height = 20.0 + n * 30.0; // базовый уровень + амплитуда
-
-    uint type = (float(worldVoxel.y) <= height) ? 1u : 0u;
-    uint vis  = (type != 0u) ? 1u : 0u;
 
-    VoxelData vd;
-    vd.type_vis_flags = (type << TYPE_SHIFT) | (vis << VIS_SHIFT);
-    // цвет: чуть меняем по высоте
-    vec3 col = (type != 0u) ? mix(vec3(0.15,0.35,0.10), vec3(0.45,0.30,0.15), n) : vec3(0.0);
-    vd.color = pack_color(col);
+    VoxelData vd = terrain_voxel(chunkCoord, lod, ivec3(lx, ly, lz), u_chunk_dim, u_seed);
 
     uint base = chunkId * u_voxels_per_chunk;
     voxels[base + voxelId] = vd;
@@ -122,13 +88,14 @@ void main() {
     // один раз на чанк
     if (voxelId == 0u) {
         mark_dirty(chunkId); // Заставляем перестроить меш у себя
+        last_visible_frame[chunkId] = u_frame_index; // новый чанк не должен сразу считаться давно невидимым
 
         // А также у всех чанков вокруг
-        try_mark_neighbor(chunkCoord + ivec3( 1, 0, 0));
-        try_mark_neighbor(chunkCoord + ivec3(-1, 0, 0));
-        try_mark_neighbor(chunkCoord + ivec3( 0, 1, 0));
-        try_mark_neighbor(chunkCoord + ivec3( 0,-1, 0));
-        try_mark_neighbor(chunkCoord + ivec3( 0, 0, 1));
-        try_mark_neighbor(chunkCoord + ivec3( 0, 0,-1));
+        try_mark_neighbor(chunkCoord + ivec3( 1, 0, 0), lod);
+        try_mark_neighbor(chunkCoord + ivec3(-1, 0, 0), lod);
+        try_mark_neighbor(chunkCoord + ivec3( 0, 1, 0), lod);
+        try_mark_neighbor(chunkCoord + ivec3( 0,-1, 0), lod);
+        try_mark_neighbor(chunkCoord + ivec3( 0, 0, 1), lod);
+        try_mark_neighbor(chunkCoord + ivec3( 0, 0,-1), lod);
     }
 }
@@ -0,0 +1,72 @@
+#version 430
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Дыры подгрузки: видимые чанки (в render_distance и во фрустуме), у которых ещё нет готового меша.
+// missing - чанка нет в таблице, unmeshed - чанк есть, но ещё грязный (меш не построен).
+
+layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
+layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
+layout(std430, binding=2) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=3) buffer HoleStatsBuf { uint visible_count; uint missing_count; uint unmeshed_count; uint pad0; };
+
+uniform uint  u_hash_table_size;
+
+uniform ivec3 u_cam_chunk;
+uniform ivec3 u_radius_chunks; // полуразмер куба обхода по осям
+
+uniform ivec3 u_chunk_dim;
+uniform vec3  u_voxel_size;
+
+uniform uint u_pack_bits;
+uniform int  u_pack_offset;
+
+uniform vec3 cam_pos;
+uniform float render_distance;
+uniform vec4 u_frustum_planes[6];
+
+// ----- include -----
+#include "../utils.glsl"
+
+#define NOT_INCLUDE_GET_OR_CREATE
+#include "common/hash_table.glsl"
+// -------------------
+
+bool sphere_in_frustum(vec3 center, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        vec4 p = u_frustum_planes[i];
+        float dist = dot(p.xyz, center) + p.w;
+        if (dist < -radius) return false;
+    }
+    return true;
+}
+
+void main() {
+    uvec3 side = uvec3(2 * u_radius_chunks + 1);
+    uvec3 gid = gl_GlobalInvocationID.xyz;
+    if (any(greaterThanEqual(gid, side))) return;
+
+    ivec3 chunkCoord = u_cam_chunk + ivec3(gid) - u_radius_chunks;
+
+    // тот же отбор, что в build_indirect_cmds
+    vec3 chunkSize = vec3(u_chunk_dim) * u_voxel_size;
+    vec3 center = vec3(chunkCoord * u_chunk_dim) * u_voxel_size + 0.5 * chunkSize;
+
+    vec3 diff = center - cam_pos;
+    if (dot(diff, diff) > render_distance * render_distance) return;
+    if (!sphere_in_frustum(center, length(chunkSize) * 0.5)) return;
+
+    atomicAdd(visible_count, 1u);
+
+    uint chunkId = lookup_chunk(pack_key_uvec2(chunkCoord, u_pack_offset, u_pack_bits), true);
+    if (chunkId == INVALID_ID) {
+        atomicAdd(missing_count, 1u);
+        return;
+    }
+
+    if ((meta[chunkId].dirty_flags & DIRTY_FLAG_MESH) != 0u)
+        atomicAdd(unmeshed_count, 1u);
+}
@@ -0,0 +1,82 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Клипмап: по всем активным чанкам ставит/снимает DIRTY_FLAG_LOD_HIDDEN по кольцу своего уровня
+// (после сдвига центров, телепорта или восстановления из спилла). Чанк, у которого флаг поменялся,
+// меняет для соседей своего уровня воздух на воксели или наоборот - им нужен новый меш.
+
+layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
+layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
+layout(std430, binding=2) buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=3) buffer EnqueuedBuf { uint enqueued[]; };
+layout(std430, binding=4) buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
+
+uniform uint u_hash_table_size;
+uniform uint u_max_chunks;
+
+uniform uint  u_lod_levels;
+uniform ivec3 u_lod_centers[MAX_LOD_LEVELS]; // центр уровня в чанках этого уровня
+uniform int   u_radius_chunks;
+
+uniform uint u_pack_bits;
+uniform int  u_pack_offset;
+
+// ----- include -----
+#include "../utils.glsl"
+
+#define NOT_INCLUDE_GET_OR_CREATE
+#include "common/hash_table.glsl"
+#include "common/lod.glsl"
+// -------------------
+
+void mark_dirty(uint chunkId) {
+    atomicOr(meta[chunkId].dirty_flags, DIRTY_FLAG_MESH);
+
+    uint was = atomicExchange(enqueued[chunkId], 1u);
+    if (was == 0u) {
+        uint di = atomicAdd(dirty_count, 1u);
+        dirty_list[di] = chunkId;
+    }
+}
+
+void try_mark_neighbor(ivec3 ncoord, uint lod) {
+    uint id = lookup_chunk(pack_lod_key(ncoord, lod, u_pack_offset, u_pack_bits), true);
+    if (id == INVALID_ID) return;
+
+    if (atomicAdd(meta[id].used, 0u) == 1u)
+        mark_dirty(id);
+}
+
+void main() {
+    uint chunkId = gl_GlobalInvocationID.x;
+    if (chunkId >= u_max_chunks) return;
+    if (meta[chunkId].used == 0u) return;
+
+    uvec2 key = uvec2(meta[chunkId].key_lo, meta[chunkId].key_hi);
+    uint lod = key_lod(key);
+    ivec3 chunkCoord = unpack_key_to_coord(key, u_pack_offset, u_pack_bits);
+
+    bool selected = lod < u_lod_levels &&
+        lod_chunk_selected(chunkCoord, lod, u_lod_levels, u_lod_centers[lod], u_lod_centers[max(lod, 1u) - 1u], u_radius_chunks);
+
+    uint was;
+    if (selected) was = atomicAnd(meta[chunkId].dirty_flags, ~DIRTY_FLAG_LOD_HIDDEN);
+    else          was = atomicOr(meta[chunkId].dirty_flags, DIRTY_FLAG_LOD_HIDDEN);
+
+    bool was_hidden = (was & DIRTY_FLAG_LOD_HIDDEN) != 0u;
+    if (was_hidden != selected) return; // флаг не поменялся
+
+    // меш показанного чанка строился, пока он был спрятан, - соседей на его границе могло не быть
+    if (selected) mark_dirty(chunkId);
+
+    try_mark_neighbor(chunkCoord + ivec3( 1, 0, 0), lod);
+    try_mark_neighbor(chunkCoord + ivec3(-1, 0, 0), lod);
+    try_mark_neighbor(chunkCoord + ivec3( 0, 1, 0), lod);
+    try_mark_neighbor(chunkCoord + ivec3( 0,-1, 0), lod);
+    try_mark_neighbor(chunkCoord + ivec3( 0, 0, 1), lod);
+    try_mark_neighbor(chunkCoord + ivec3( 0, 0,-1), lod);
+}
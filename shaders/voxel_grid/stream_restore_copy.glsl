@@ -0,0 +1,78 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Пишет воксели из ChunkSpillCache в чанки, выбранные stream_restore_select. x - воксель, y - запись
+
+layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
+layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
+layout(std430, binding=2) readonly buffer RestoreRecords { RestoreRecord records[]; };
+layout(std430, binding=3) readonly buffer RestoreVoxels { VoxelData restore_voxels[]; };
+layout(std430, binding=4) writeonly buffer ChunkVoxels { VoxelData voxels[]; };
+layout(std430, binding=5) buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=6) buffer EnqueuedBuf { uint enqueued[]; };
+layout(std430, binding=7) buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
+layout(std430, binding=8) writeonly buffer ChunkLastVisibleBuf { uint last_visible_frame[]; };
+
+uniform uint u_hash_table_size;
+uniform uint u_restore_count;
+uniform uint u_voxels_per_chunk;
+uniform uint u_frame_index;
+
+uniform uint u_pack_bits;
+uniform int  u_pack_offset;
+
+// ----- include -----
+#include "../utils.glsl"
+
+#define NOT_INCLUDE_GET_OR_CREATE
+#include "common/hash_table.glsl"
+// -------------------
+
+void mark_dirty(uint chunkId, uint flags) {
+    atomicOr(meta[chunkId].dirty_flags, flags);
+
+    uint was = atomicExchange(enqueued[chunkId], 1u);
+    if (was == 0u) {
+        uint di = atomicAdd(dirty_count, 1u);
+        dirty_list[di] = chunkId;
+    }
+}
+
+void try_mark_neighbor(ivec3 ncoord) {
+    uint id = lookup_chunk(pack_key_uvec2(ncoord, u_pack_offset, u_pack_bits), false);
+    if (id == INVALID_ID) return;
+
+    if (atomicAdd(meta[id].used, 0u) == 1u)
+        mark_dirty(id, DIRTY_FLAG_MESH);
+}
+
+void main() {
+    uint voxelId = gl_GlobalInvocationID.x;
+    uint i = gl_GlobalInvocationID.y;
+
+    if (i >= u_restore_count) return;
+    if (voxelId >= u_voxels_per_chunk) return;
+    if (records[i].status != RESTORE_OK) return;
+
+    uint chunkId = records[i].chunk_id;
+    voxels[chunkId * u_voxels_per_chunk + voxelId] = restore_voxels[i * u_voxels_per_chunk + voxelId];
+
+    // один раз на чанк
+    if (voxelId == 0u) {
+        // правки снова только в этом чанке - при следующем выселении он опять уйдёт в спилл
+        mark_dirty(chunkId, DIRTY_FLAG_MESH | DIRTY_FLAG_USER_MODIFIED);
+        last_visible_frame[chunkId] = u_frame_index;
+
+        ivec3 chunkCoord = unpack_key_to_coord(uvec2(records[i].key_lo, records[i].key_hi), u_pack_offset, u_pack_bits);
+        try_mark_neighbor(chunkCoord + ivec3( 1, 0, 0));
+        try_mark_neighbor(chunkCoord + ivec3(-1, 0, 0));
+        try_mark_neighbor(chunkCoord + ivec3( 0, 1, 0));
+        try_mark_neighbor(chunkCoord + ivec3( 0,-1, 0));
+        try_mark_neighbor(chunkCoord + ivec3( 0, 0, 1));
+        try_mark_neighbor(chunkCoord + ivec3( 0, 0,-1));
+    }
+}
@@ -0,0 +1,50 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Находит или создаёт чанки для восстановления из ChunkSpillCache. Идёт до stream_select_chunks,
+// поэтому восстановленные чанки отбор уже не создаёт и не генерирует.
+
+layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
+layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
+layout(std430, binding=2) buffer FreeList { uint free_count; uint free_list[]; };
+layout(std430, binding=3) buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=4) buffer EnqueuedBuf { uint enqueued[]; };
+layout(std430, binding=5) buffer RestoreRecords { RestoreRecord records[]; };
+
+uniform uint u_hash_table_size;
+uniform uint u_restore_count;
+
+// ----- include -----
+#include "../utils.glsl"
+#include "common/hash_table.glsl"
+// -------------------
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_restore_count) return;
+
+    uvec2 key = uvec2(records[i].key_lo, records[i].key_hi);
+
+    uint chunkId;
+    bool created;
+
+    if (!get_or_create_chunk(key, chunkId, created)) {
+        records[i].chunk_id = INVALID_ID;
+        records[i].status = RESTORE_FAILED;
+        return;
+    }
+
+    // чанк успели сгенерировать заново и поправить - новые правки важнее
+    if (!created && (meta[chunkId].dirty_flags & DIRTY_FLAG_USER_MODIFIED) != 0u) {
+        records[i].chunk_id = INVALID_ID;
+        records[i].status = RESTORE_SKIPPED;
+        return;
+    }
+
+    records[i].chunk_id = chunkId;
+    records[i].status = RESTORE_OK;
+}
@@ -11,14 +11,20 @@ layout(std430, binding=2) buffer FreeList { uint free_count; uint free_list[]; }
 layout(std430, binding=3) buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=4) buffer EnqueuedBuf { uint enqueued[]; };
 layout(std430, binding=5) buffer LoadList { uint load_list_counter; uint load_list[]; };
+layout(std430, binding=6) buffer StreamStateBuf { StreamState stream_states[]; }; // [MAX_LOD_LEVELS]
+layout(std430, binding=7) readonly buffer ShellOffsets { ivec4 shell_offsets[]; }; // смещения от u_cam_chunk, w не используется
 
 uniform uint  u_hash_table_size;   // pow2
 uniform uint  u_max_load_entries;  // обычно = count_active_chunks
-uniform ivec3 u_chunk_dim;
-uniform vec3  u_voxel_size;
 
-uniform vec3  u_cam_pos_local;    // камера в локальных координатах грида
+uniform ivec3 u_cam_chunk;        // чанк камеры в локальных координатах грида, в чанках уровня u_lod
 uniform int   u_radius_chunks;    // R в чанках
+uniform uint  u_shell_count;
+
+// Клипмап (common/lod.glsl): при u_lod_levels > 1 полный отбор берёт только кольцо уровня u_lod
+uniform uint  u_lod;
+uniform uint  u_lod_levels;
+uniform ivec3 u_finer_cam_chunk;  // центр уровня u_lod - 1
 
 uniform uint u_pack_bits;
 uniform int  u_pack_offset;
@@ -26,31 +32,52 @@ uniform int  u_pack_offset;
 // ----- include -----
 #include "../utils.glsl"
 #include "common/hash_table.glsl"
+#include "common/lod.glsl"
 // -------------------
 
 void main() {
-    uvec3 gid = gl_GlobalInvocationID.xyz;
-
     int R = u_radius_chunks;
-    uint side = uint(2 * R + 1);
+    ivec3 off;
 
-    if (gid.x >= side || gid.y >= side || gid.z >= side) return;
+    if (stream_states[u_lod].full_pass == 1u) {
+        // весь куб (2R+1)^3, лишнее отсекаем по сфере (или по кольцу клипмапа)
+        uvec3 gid = gl_GlobalInvocationID.xyz;
+        uint side = uint(2 * R + 1);
 
-    ivec3 off = ivec3(gid) - ivec3(R);
-    int d2 = off.x*off.x + off.y*off.y + off.z*off.z;
-    if (d2 > R*R) return;
-    // if (d2 > 0.5) return;
+        if (gid.x >= side || gid.y >= side || gid.z >= side) return;
 
-    vec3 chunkWorldSize = vec3(u_chunk_dim) * u_voxel_size;
-    ivec3 camChunk = ivec3(floor(u_cam_pos_local / chunkWorldSize));
+        off = ivec3(gid) - ivec3(R);
 
-    ivec3 chunkCoord = camChunk + off;
-    uvec2 key = pack_key_uvec2(chunkCoord, u_pack_offset, u_pack_bits);
+        if (u_lod_levels > 1u) {
+            if (!lod_chunk_selected(u_cam_chunk + off, u_lod, u_lod_levels, u_cam_chunk, u_finer_cam_chunk, R)) return;
+        } else {
+            int d2 = off.x*off.x + off.y*off.y + off.z*off.z;
+            if (d2 > R*R) return;
+        }
+    } else {
+        // только чанки, вошедшие в сферу после сдвига камеры (список собран на CPU)
+        uint shell_idx = gl_WorkGroupID.x * (gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z) + gl_LocalInvocationIndex;
+        if (shell_idx >= u_shell_count) return;
+
+        off = shell_offsets[shell_idx].xyz;
+
+        // с клипмапом оболочку уровня 0 дополняют соседи по родителю, в кольцо входят не все
+        if (u_lod_levels > 1u) {
+            if (!lod_chunk_selected(u_cam_chunk + off, u_lod, u_lod_levels, u_cam_chunk, u_finer_cam_chunk, R)) return;
+        }
+    }
+
+    ivec3 chunkCoord = u_cam_chunk + off;
+    uvec2 key = pack_lod_key(chunkCoord, u_lod, u_pack_offset, u_pack_bits);
 
     uint chunkId;
     bool created;
 
-    if (!get_or_create_chunk(key, chunkId, created)) return;
+    if (!get_or_create_chunk(key, chunkId, created)) {
+        // чанк не создан (нет свободных id) - в следующий раз оболочки не хватит, нужен полный отбор
+        atomicExchange(stream_states[u_lod].rescan_requested, 1u);
+        return;
+    }
 
     if (created) {
         uint i = atomicAdd(load_list_counter, 1u);
@@ -0,0 +1,40 @@
+#version 430
+layout(local_size_x = 1) in;
+
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) buffer StreamStateBuf { StreamState stream_states[]; }; // [MAX_LOD_LEVELS]
+layout(std430, binding=1) buffer DispatchArgs { uvec3 dispatch_args; };
+
+uniform ivec3 u_cam_chunk;
+uniform int   u_radius_chunks;
+uniform uint  u_shell_count;
+uniform uint  u_force_full;  // CPU: первый отбор, смена радиуса или телепорт
+uniform uint  u_lod;         // уровень клипмапа, у каждого своё состояние
+
+// ----- include -----
+#include "../utils.glsl"
+// -------------------
+
+// Выбирает между полным отбором и отбором только по оболочке. Флаг rescan_requested ставят
+// evict_low_priority.glsl (выселен чанк внутри сферы) и stream_select_chunks.glsl (чанк не создался).
+void main() {
+    if (gl_GlobalInvocationID.x != 0u) return;
+
+    bool full = u_force_full == 1u || stream_states[u_lod].rescan_requested == 1u;
+
+    stream_states[u_lod].full_pass = full ? 1u : 0u;
+    stream_states[u_lod].rescan_requested = 0u;
+    stream_states[u_lod].center = ivec4(u_cam_chunk, 1);
+    stream_states[u_lod].radius = u_radius_chunks;
+
+    if (full) {
+        uint side = uint(2 * u_radius_chunks + 1);
+        uint groups = div_up_u32(side, 8u);
+        dispatch_args = uvec3(groups, groups, groups);
+    } else {
+        dispatch_args = uvec3(div_up_u32(u_shell_count, 512u), 1u, 1u);
+    }
+}
@@ -1,17 +1,34 @@
-#version 330 core
+#version 430 core
 
-layout(location = 0) in vec4 aPos;      // из vb[].pos (vec4)
-layout(location = 1) in uint aColor;    // из vb[].color (RGBA8)
-layout(location = 2) in uint aFace;     // из vb[].face (0..5)
+// ----- include -----
+#include "common/buffer_structures.glsl"
+// -------------------
+
+// Vertex pulling: вершина k draw-вызова - угол квада k / 6, треугольники квада задаёт k % 6
+layout(location = 0) in uint aChunkId;  // divisor 1, = baseInstance команды
+
+layout(std430, binding=0) readonly buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=1) readonly buffer GlobalVB { Vertex vb[]; };
 
 uniform mat4 uWorld;
 uniform mat4 uProjView;
 
+uniform ivec3 u_chunk_dim;
+uniform vec3  u_voxel_size;
+
+uniform uint u_pack_bits;
+uniform int  u_pack_offset;
+
 out vec3 vNormal;
 out vec3 vFragPos;
 out vec3 vColor;
 out float vAO;
 
+// ----- include -----
+#include "../utils.glsl"
+#include "common/lod.glsl"
+// -------------------
+
 vec3 face_normal(uint f) {
     // face: 0=+X,1=-X,2=+Y,3=-Y,4=+Z,5=-Z
     if (f == 0u) return vec3( 1, 0, 0);
@@ -29,15 +46,38 @@ vec3 unpack_rgb(uint rgba8) {
     return vec3(r, g, b);
 }
 
+// углы квада для 6 вершин двух треугольников: диагональ 0-2 и 1-3
+const uint QUAD_CORNERS[6]      = uint[6](0u, 1u, 2u, 0u, 2u, 3u);
+const uint QUAD_CORNERS_FLIP[6] = uint[6](0u, 1u, 3u, 1u, 2u, 3u);
+
 void main() {
-    vec4 worldPos4 = uWorld * aPos;
+    uint quad = uint(gl_VertexID) / 6u;
+    uint k = uint(gl_VertexID) % 6u;
+
+    bool flip = (vb[quad * 4u].pos_face & VERTEX_FLIP_BIT) != 0u;
+    Vertex v = vb[quad * 4u + (flip ? QUAD_CORNERS_FLIP[k] : QUAD_CORNERS[k])];
+    uint posFace = v.pos_face;
+    uint color = v.color;
+
+    uvec2 key = uvec2(meta[aChunkId].key_lo, meta[aChunkId].key_hi);
+    ivec3 chunkCoord = unpack_key_to_coord(key, u_pack_offset, u_pack_bits);
+
+    ivec3 lp = ivec3(posFace & VERTEX_POS_MASK,
+                     (posFace >> VERTEX_POS_BITS) & VERTEX_POS_MASK,
+                     (posFace >> (2u * VERTEX_POS_BITS)) & VERTEX_POS_MASK);
+    uint face = (posFace >> VERTEX_FACE_SHIFT) & 7u;
+
+    // воксель чанка уровня LOD в 2^lod раз больше
+    vec3 gridPos = vec3(chunkCoord * u_chunk_dim + lp) * u_voxel_size * lod_scale(key_lod(key));
+
+    vec4 worldPos4 = uWorld * vec4(gridPos, 1.0);
     vFragPos = worldPos4.xyz;
 
     mat3 normalMat = mat3(transpose(inverse(uWorld)));
-    vNormal = normalize(normalMat * face_normal(aFace));
+    vNormal = normalize(normalMat * face_normal(face));
 
-    vColor = unpack_rgb(aColor);
-    vAO = float(aColor & 0xFFu) / 255.0;
+    vColor = unpack_rgb(color);
+    vAO = float(color & 0xFFu) / 255.0;
 
     gl_Position = uProjView * worldPos4;
 }
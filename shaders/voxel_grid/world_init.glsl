@@ -8,12 +8,12 @@ layout(local_size_x = 256) in;
 layout(std430, binding=0) coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
 layout(std430, binding=1) coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
 layout(std430, binding=2) buffer FreeList { uint free_count; uint free_list[]; };
-layout(std430, binding=3) buffer MeshBuffersStatusBuf { uint is_vb_full; uint is_ib_full; };
+layout(std430, binding=3) buffer MeshBuffersStatusBuf { uint is_vb_full; };
 layout(std430, binding=4) buffer ChunkMetaBuf { ChunkMeta meta[]; };
 layout(std430, binding=5) buffer EnqueuedBuf { uint enqueued[]; };
 layout(std430, binding=6) buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
 layout(std430, binding=7) buffer VoxelWriteList { uint write_count; VoxelWrite writes[]; };
-layout(std430, binding=8) buffer IndirectCmdBuf { uint cmd_count; DrawElementsIndirectCommand cmds[]; };
+layout(std430, binding=8) buffer IndirectCmdBuf { uint cmd_count; DrawArraysIndirectCommand cmds[]; };
 layout(std430, binding=9) buffer FailedDirtyListBuf { uint failed_dirty_count; uint failed_dirty_list[]; }; 
 
 uniform uint u_hash_table_size;
@@ -33,6 +33,10 @@ void main() {
         hash_keys[i] = uvec2(0u, 0u);
     }
 
+    // счётчики переполнения бакетов лежат за слотами
+    if (u_hash_table_mode == HASH_TABLE_BUCKETED && i < u_hash_table_size / BUCKET_SLOTS)
+        hash_vals[u_hash_table_size + i] = 0u;
+
     if (i < u_max_chunks) {
         free_list[i]   = i;
         enqueued[i]    = 0u;
@@ -51,6 +55,5 @@ void main() {
         failed_dirty_count = 0u;
         
         is_vb_full = 0u;
-        is_ib_full = 0u;
     }
 }
@@ -2,10 +2,17 @@
 layout(local_size_x = 256) in;
 
 layout(std430, binding=0) readonly buffer Counters    { uint counters[]; };
-layout(std430, binding=1) buffer ActiveChunks         { uint activeChunks[]; }; // capacity >= uN
+layout(std430, binding=1) buffer ActiveChunks         { uint activeChunks[]; }; // capacity = uActiveCapacity
 layout(std430, binding=2) buffer ActiveCount          { coherent uint activeCount[]; }; // [1]
+layout(std430, binding=3) buffer Status {
+    coherent uint overflow; // биты OVERFLOW_*
+    uint needChunks;
+    uint needPairs;
+    coherent uint needActive;
+};
 
 uniform uint uN;
+uniform uint uActiveCapacity;
 
 void main() {
     uint i = gl_GlobalInvocationID.x;
@@ -14,5 +21,7 @@ void main() {
     if (counters[i] == 0u) return;
 
     uint dst = atomicAdd(activeCount[0], 1u);
-    activeChunks[dst] = i;
+    atomicMax(needActive, dst + 1u);
+    if (dst < uActiveCapacity) activeChunks[dst] = i;
+    else atomicOr(overflow, 4u); // OVERFLOW_ACTIVE
 }
@@ -2,15 +2,22 @@
 layout(local_size_x=256) in;
 
 layout(std430, binding=0) buffer OutVoxels { uint outVoxels[]; };
+layout(std430, binding=1) readonly buffer ActiveCount { uint activeCount[]; }; // [1]
+layout(std430, binding=2) readonly buffer Status {
+    uint overflow; // биты OVERFLOW_*
+    uint needChunks;
+    uint needPairs;
+    uint needActive;
+};
 
 uniform uint uChunkVoxelCount;
-uniform uint uActiveCount;
 
 void main(){
     uint voxel = gl_GlobalInvocationID.x;
     uint a = gl_WorkGroupID.y;
     if (voxel >= uChunkVoxelCount) return;
-    if (a >= uActiveCount) return;
+    if (overflow != 0u) return;
+    if (a >= activeCount[0]) return;
 
     outVoxels[a * uChunkVoxelCount + voxel] = 0u;
 }
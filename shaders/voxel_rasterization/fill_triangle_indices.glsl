@@ -5,12 +5,20 @@ layout(std430, binding=0) readonly buffer Vert   { float v[]; };
 layout(std430, binding=1) readonly buffer Ind    { uint  idx[]; };
 layout(std430, binding=2) buffer Cursor          { coherent uint cursor[]; };
 layout(std430, binding=3) buffer OutTriIds       { uint outTriIds[]; };
+layout(std430, binding=4) readonly buffer Roi {
+    ivec4 roiOrigin; // xyz
+    uvec4 roiDim;    // xyz, w = число чанков
+};
+layout(std430, binding=5) readonly buffer Status {
+    uint overflow; // биты OVERFLOW_*
+    uint needChunks;
+    uint needPairs;
+    uint needActive;
+};
 
 uniform mat4  uTransform;
 uniform float uVoxelSize;
 uniform int   uChunkSize;
-uniform ivec3 uChunkOrigin;
-uniform uvec3 uGridDim;
 uniform uint  uTriCount;
 uniform uint  uOutCapacity;
 
@@ -31,16 +39,17 @@ vec3 load_pos(uint vid) {
 }
 
 bool in_roi(ivec3 c, out uint idxOut) {
-    ivec3 rel = c - uChunkOrigin;
-    ivec3 dim = ivec3(uGridDim);
+    ivec3 rel = c - roiOrigin.xyz;
+    ivec3 dim = ivec3(roiDim.xyz);
     if (any(lessThan(rel, ivec3(0))) || any(greaterThanEqual(rel, dim))) return false;
-    idxOut = (uint(rel.z) * uGridDim.y + uint(rel.y)) * uGridDim.x + uint(rel.x);
+    idxOut = (uint(rel.z) * roiDim.y + uint(rel.y)) * roiDim.x + uint(rel.x);
     return true;
 }
 
 void main() {
     uint tid = gl_GlobalInvocationID.x;
     if (tid >= uTriCount) return;
+    if ((overflow & 1u) != 0u) return; // ROI не влезла в counters
 
     uint i0 = idx[tid*3u + 0u];
     uint i1 = idx[tid*3u + 1u];
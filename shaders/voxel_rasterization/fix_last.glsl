@@ -4,8 +4,15 @@ layout(local_size_x = 1) in;
 layout(std430, binding=0) readonly buffer Counters { uint counters[]; };
 layout(std430, binding=1) buffer Offsets          { uint offsets[]; }; // n+1
 layout(std430, binding=2) buffer TotalPairs       { uint totalPairs[]; }; // [1]
+layout(std430, binding=3) buffer Status {
+    coherent uint overflow; // биты OVERFLOW_*
+    uint needChunks;
+    uint needPairs;
+    uint needActive;
+};
 
 uniform uint uN;
+uniform uint uPairCapacity;
 
 void main(){
     if (uN == 0u) {
@@ -16,4 +23,7 @@ void main(){
     uint last = offsets[uN - 1u] + counters[uN - 1u];
     offsets[uN] = last;
     totalPairs[0] = last;
+
+    needPairs = last;
+    if (last > uPairCapacity) atomicOr(overflow, 2u); // OVERFLOW_PAIRS
 }
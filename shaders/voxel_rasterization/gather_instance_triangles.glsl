@@ -0,0 +1,32 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// Один инстанс батча -> общий поток треугольников.
+// Выход: вершина = vec4(xyz в world, w = id генератора), индексы общего потока тождественные.
+layout(std430, binding=0) readonly buffer Vert  { float v[]; };   // VBO инстанса as float[]
+layout(std430, binding=1) readonly buffer Ind   { uint  idx[]; }; // EBO инстанса as uint[]
+layout(std430, binding=2) writeonly buffer Out  { vec4  outVert[]; };
+
+uniform mat4 uTransform;
+uniform uint uTriCount;
+uniform uint uBaseTri;      // первый треугольник инстанса в общем потоке
+uniform uint uGeneratorId;  // < 2^24, точно представим во float
+
+uniform uint uStrideF;
+uniform uint uPosOffF;
+
+vec3 load_pos(uint vid) {
+    uint base = vid * uStrideF + uPosOffF;
+    return vec3(v[base+0u], v[base+1u], v[base+2u]);
+}
+
+void main() {
+    uint tid = gl_GlobalInvocationID.x;
+    if (tid >= uTriCount) return;
+
+    uint dst = (uBaseTri + tid) * 3u;
+    for (uint k = 0u; k < 3u; ++k) {
+        vec3 p = (uTransform * vec4(load_pos(idx[tid*3u + k]), 1.0)).xyz;
+        outVert[dst + k] = vec4(p, float(uGeneratorId));
+    }
+}
@@ -6,9 +6,18 @@ layout(std430, binding=0) readonly buffer InFinalPairs { vec4 inPairs[]; };
 // пишем ROI сюда (потом можно readback или читать в других compute)
 layout(std430, binding=1) buffer RoiOut {
     ivec4 roiOrigin; // xyz
-    uvec4 roiDim;    // xyz
+    uvec4 roiDim;    // xyz, w = число чанков
 };
 
+layout(std430, binding=2) buffer Status {
+    coherent uint overflow; // биты OVERFLOW_*: какой буфер мал, результат кадра отбрасывается
+    uint needChunks;
+    uint needPairs;
+    uint needActive;
+};
+
+uniform uint uChunkCapacity;
+
 uniform int  uChunkSize;
 uniform int  uPadVoxels;
 uniform float uEps; // например 1e-4
@@ -30,6 +39,7 @@ void main(){
     if (!finite3(mn) || !finite3(mx) || any(greaterThan(mn, mx))) {
         roiOrigin = ivec4(0);
         roiDim    = uvec4(0);
+        needChunks = 0u;
         return;
     }
 
@@ -59,6 +69,11 @@ void main(){
     ivec3 dim = cmax - cmin + ivec3(1);
     dim = max(dim, ivec3(0));
 
+    uint chunkCount = uint(dim.x) * uint(dim.y) * uint(dim.z);
+
     roiOrigin = ivec4(cmin, 0);
-    roiDim    = uvec4(dim, 0u);
+    roiDim    = uvec4(dim, chunkCount);
+
+    needChunks = chunkCount;
+    if (chunkCount > uChunkCapacity) atomicOr(overflow, 1u); // OVERFLOW_CHUNKS
 }
@@ -0,0 +1,219 @@
+#version 430
+layout(local_size_x = 256) in;
+
+// voxelize.glsl, но попадания пишутся прямо в пул чанков VoxelGridGPU:
+// чанк берётся из общей хеш-таблицы (get_or_create_chunk) и ставится в dirty_list, как в apply_writes_to_world.
+// Один workgroup = один активный чанк ROI целиком: сначала ищется хоть одно попадание (чанк создаётся только тогда),
+// потом чанк резолвится и воксели пишутся. Новый чанк (id из free_list, там воксели выселенного) сначала
+// получает рельеф, как в stream_generate_terrain, - иначе отбор потоковой подгрузки его уже не сгенерирует.
+// Не нашёлся и не создался чанк - его попадания теряются, счётчик failedChunks в Status.
+
+// ----- include -----
+#include "../voxel_grid/common/buffer_structures.glsl"
+// -------------------
+
+layout(std430, binding=0) readonly buffer Vertices { float vertex_data[]; };
+layout(std430, binding=1) readonly buffer Ind       { uint idx[]; };
+
+layout(std430, binding=2) readonly buffer Offsets   { uint offsets[]; };
+layout(std430, binding=3) readonly buffer TriIds    { uint triIds[]; };
+layout(std430, binding=4) readonly buffer ActiveChunks { uint activeChunk[]; };
+layout(std430, binding=5) readonly buffer Roi {
+    ivec4 roiOrigin; // xyz
+    uvec4 roiDim;    // xyz, w = число чанков
+};
+layout(std430, binding=6) buffer Status {
+    uint overflow; // биты OVERFLOW_*
+    uint needChunks;
+    uint needPairs;
+    uint needActive; // = activeCount
+    uint failedChunks; // чанки с попаданиями без id: free_list пуст или бакет полон
+};
+layout(std430, binding=7) readonly buffer Palette { VoxelData palette[]; }; // по id генератора
+
+// VoxelGridGPU
+layout(std430, binding=8)  coherent buffer ChunkHashKeys { uvec2 hash_keys[]; };
+layout(std430, binding=9)  coherent buffer ChunkHashVals { uint count_tomb; uint  hash_vals[]; };
+layout(std430, binding=10) buffer ChunkVoxels { VoxelData voxels[]; };
+layout(std430, binding=11) buffer FreeList { uint free_count; uint free_list[]; };
+layout(std430, binding=12) buffer ChunkMetaBuf { ChunkMeta meta[]; };
+layout(std430, binding=13) buffer EnqueuedBuf { uint enqueued[]; };
+layout(std430, binding=14) buffer DirtyListBuf { uint dirty_count; uint dirty_list[]; };
+layout(std430, binding=15) writeonly buffer ChunkLastVisibleBuf { uint last_visible_frame[]; };
+
+uniform mat4  uTransform;
+uniform float uVoxelSize;
+uniform int   uChunkSize;
+uniform uint  uChunkVoxelCount;
+uniform uint vertex_stride_f;
+uniform uint pos_offset_f;
+uniform uint generator_id_offset_f; // id генератора в вершине (float), 0xFFFFFFFF — id нет, берётся palette[0]
+
+uniform uint  u_hash_table_size;
+uniform uint  u_set_dirty_flag_bits;
+uniform uint  u_pack_bits;
+uniform int   u_pack_offset;
+uniform uint  u_seed;        // рельеф новых чанков, seed потоковой подгрузки grid
+uniform uint  u_frame_index;
+
+#define NO_GENERATOR_ID 0xFFFFFFFFu
+
+// ----- include -----
+#include "../utils.glsl"
+#include "../voxel_grid/common/hash_table.glsl"
+#include "../voxel_grid/common/terrain.glsl"
+#include "tri_box_overlap.glsl"
+// -------------------
+
+shared uint s_hit;
+shared uint s_chunk_id;
+shared uint s_created;
+
+void mark_dirty(uint chunkId) {
+    atomicOr(meta[chunkId].dirty_flags, u_set_dirty_flag_bits);
+
+    uint was = atomicExchange(enqueued[chunkId], 1u);
+    if (was == 0u) {
+        uint di = atomicAdd(dirty_count, 1u);
+        dirty_list[di] = chunkId;
+    }
+}
+
+// соседи нового чанка строили грани к нему как к пустоте - перестроить меш, как в stream_generate_terrain
+void try_mark_neighbor(ivec3 ncoord) {
+    uint id = lookup_chunk(pack_key_uvec2(ncoord, u_pack_offset, u_pack_bits), false);
+    if (id == INVALID_ID) return;
+    if (atomicAdd(meta[id].used, 0u) != 1u) return;
+
+    uint was = atomicCompSwap(enqueued[id], 0u, 1u);
+    if (was == 0u) {
+        atomicOr(meta[id].dirty_flags, DIRTY_FLAG_MESH);
+        uint di = atomicAdd(dirty_count, 1u);
+        dirty_list[di] = id;
+    }
+}
+
+ivec3 local_voxel(uint voxelIndex) {
+    uint cs = uint(uChunkSize);
+    uint z = voxelIndex / (cs*cs);
+    uint rem = voxelIndex - z*(cs*cs);
+    uint y = rem / cs;
+    uint x = rem - y*cs;
+    return ivec3(int(x), int(y), int(z));
+}
+
+// первый треугольник чанка [begin, end), задевший воксель
+bool voxel_hit(uint voxelIndex, ivec3 chunkOriginVox, uint begin, uint end, out uint generatorId) {
+    generatorId = 0u;
+
+    vec3 boxcenter = vec3(local_voxel(voxelIndex)) + vec3(0.5);
+    vec3 halfsize  = vec3(0.5001);
+
+    for (uint it = begin; it < end; ++it) {
+        uint tid = triIds[it];
+        uint i0 = idx[tid*3u + 0u];
+        uint i1 = idx[tid*3u + 1u];
+        uint i2 = idx[tid*3u + 2u];
+
+        uint v0_base = i0 * vertex_stride_f + pos_offset_f;
+        uint v1_base = i1 * vertex_stride_f + pos_offset_f;
+        uint v2_base = i2 * vertex_stride_f + pos_offset_f;
+
+        vec4 v0 = vec4(vertex_data[v0_base + 0], vertex_data[v0_base + 1], vertex_data[v0_base + 2], 1.0f);
+        vec4 v1 = vec4(vertex_data[v1_base + 0], vertex_data[v1_base + 1], vertex_data[v1_base + 2], 1.0f);
+        vec4 v2 = vec4(vertex_data[v2_base + 0], vertex_data[v2_base + 1], vertex_data[v2_base + 2], 1.0f);
+
+        vec3 p0 = (uTransform * v0).xyz / uVoxelSize - vec3(chunkOriginVox);
+        vec3 p1 = (uTransform * v1).xyz / uVoxelSize - vec3(chunkOriginVox);
+        vec3 p2 = (uTransform * v2).xyz / uVoxelSize - vec3(chunkOriginVox);
+
+        if (!triBoxOverlap(boxcenter, halfsize, p0, p1, p2)) continue;
+
+        if (generator_id_offset_f != NO_GENERATOR_ID)
+            generatorId = uint(vertex_data[i0 * vertex_stride_f + generator_id_offset_f]);
+        return true;
+    }
+    return false;
+}
+
+void main() {
+    // оба условия одинаковы для всего workgroup, выход до barrier() безопасен
+    if (overflow != 0u) return;
+
+    uint activeIdx = gl_WorkGroupID.y;
+    if (activeIdx >= needActive) return;
+
+    uint lid = gl_LocalInvocationIndex;
+    if (lid == 0u) {
+        s_hit = 0u;
+        s_chunk_id = INVALID_ID;
+        s_created = 0u;
+    }
+    barrier();
+
+    uint chunkIndex = activeChunk[activeIdx]; // индекс в dense ROI
+
+    uint xy = roiDim.x * roiDim.y;
+    uint cz = chunkIndex / xy;
+    uint rem = chunkIndex - cz * xy;
+    uint cy = rem / roiDim.x;
+    uint cx = rem - cy * roiDim.x;
+
+    ivec3 chunkCoord = roiOrigin.xyz + ivec3(int(cx), int(cy), int(cz));
+    ivec3 chunkOriginVox = chunkCoord * uChunkSize;
+
+    uint begin = offsets[chunkIndex];
+    uint end   = offsets[chunkIndex + 1u];
+
+    // 1) есть ли попадание: поиск обрывается на первом, s_hit читается без barrier - только как подсказка
+    for (uint v = lid; v < uChunkVoxelCount && s_hit == 0u; v += gl_WorkGroupSize.x) {
+        uint generatorId;
+        if (voxel_hit(v, chunkOriginVox, begin, end, generatorId)) {
+            atomicOr(s_hit, 1u);
+            break;
+        }
+    }
+    barrier();
+
+    if (s_hit == 0u) return;
+
+    // 2) один поток на workgroup резолвит чанк
+    if (lid == 0u) {
+        uvec2 key = pack_key_uvec2(chunkCoord, u_pack_offset, u_pack_bits);
+
+        uint chunkId;
+        bool created;
+        if (get_or_create_chunk(key, chunkId, created) && chunkId != INVALID_ID) {
+            s_chunk_id = chunkId;
+            s_created = created ? 1u : 0u;
+            mark_dirty(chunkId);
+
+            if (created) {
+                last_visible_frame[chunkId] = u_frame_index; // новый чанк не должен сразу считаться давно невидимым
+                try_mark_neighbor(chunkCoord + ivec3( 1, 0, 0));
+                try_mark_neighbor(chunkCoord + ivec3(-1, 0, 0));
+                try_mark_neighbor(chunkCoord + ivec3( 0, 1, 0));
+                try_mark_neighbor(chunkCoord + ivec3( 0,-1, 0));
+                try_mark_neighbor(chunkCoord + ivec3( 0, 0, 1));
+                try_mark_neighbor(chunkCoord + ivec3( 0, 0,-1));
+            }
+        } else {
+            atomicAdd(failedChunks, 1u);
+        }
+    }
+    barrier();
+
+    uint chunkId = s_chunk_id;
+    if (chunkId == INVALID_ID) return;
+    bool created = s_created != 0u;
+
+    // 3) запись: попадание - палитра; у нового чанка остальное - рельеф
+    uint base = chunkId * uChunkVoxelCount;
+    for (uint v = lid; v < uChunkVoxelCount; v += gl_WorkGroupSize.x) {
+        uint generatorId;
+        if (voxel_hit(v, chunkOriginVox, begin, end, generatorId))
+            voxels[base + v] = palette[generatorId];
+        else if (created)
+            voxels[base + v] = terrain_voxel(chunkCoord, 0u, local_voxel(v), ivec3(uChunkSize), u_seed);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+
+// Куда вести подгрузку чанков: текущая позиция камеры и предсказанная через lookahead секунд.
+// position - где камера сейчас, predicted_position - куда она придёт, direction - единичный вектор "вперёд"
+// (направление движения, если камера движется, иначе взгляд). Без движения predicted_position == position.
+struct StreamFocus {
+    glm::vec3 position;
+    glm::vec3 predicted_position;
+    glm::vec3 direction;
+
+    StreamFocus() : position(0.0f), predicted_position(0.0f), direction(0.0f) {}
+
+    explicit StreamFocus(const glm::vec3& position)
+        : position(position), predicted_position(position), direction(0.0f) {}
+
+    static StreamFocus predict(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& view_dir, float lookahead_seconds) {
+        StreamFocus focus(position);
+        float speed = glm::length(velocity);
+
+        if (speed > 1e-4f) {
+            focus.direction = velocity / speed;
+            focus.predicted_position = position + velocity * std::max(lookahead_seconds, 0.0f);
+        } else if (glm::dot(view_dir, view_dir) > 1e-8f) {
+            focus.direction = glm::normalize(view_dir);
+        }
+        return focus;
+    }
+
+    // Центр шара подгрузки: сдвиг к предсказанной точке не больше max_shift, чтобы камера оставалась внутри шара
+    glm::vec3 stream_center(float max_shift) const {
+        glm::vec3 d = predicted_position - position;
+        float len = glm::length(d);
+        if (len <= max_shift || len <= 0.0f) return predicted_position;
+        return position + d * (max_shift / len);
+    }
+};
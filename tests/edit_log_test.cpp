@@ -0,0 +1,64 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "voxel_engine/edit_log.h"
+#include "voxel_engine/region_store.h"
+
+// Порядок WAL и регионов: снапшот чанка с правкой seq не пишется в регион, пока запись seq
+// не стала durable в логе, а seq после перезапуска продолжается с последней записи старых сегментов.
+//
+//   edit_log_test
+
+int main() {
+    glm::ivec3 chunk_size(16);
+    uint32_t voxel_count = chunk_size.x * chunk_size.y * chunk_size.z;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "edit_log_test";
+    std::filesystem::remove_all(dir);
+
+    uint64_t key = math_utils::pack_key(1, 2, 3);
+    auto voxels = std::make_shared<std::vector<Voxel>>(voxel_count, Voxel(glm::vec3(0.5f), true));
+
+    bool ok = true;
+    uint64_t last_seq = 0;
+    uint64_t written_before_durable = 0, written_after_durable = 0;
+    {
+        RegionStore store(dir / "regions", chunk_size);
+        store.write_batch_size = 1;
+        store.write_interval_ms = 10;
+        // group commit раз в секунду - у I/O потока региона есть время записать снапшот раньше лога
+        EditLog log(dir / "wal", &store, 1000, 1ull << 40);
+
+        uint64_t seq = log.append_snapshot(key, *voxels);
+        store.enqueue_write(key, voxels, seq);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        written_before_durable = store.chunks_written();
+
+        ok = ok && log.wait_durable(seq) && store.flush();
+        written_after_durable = store.chunks_written();
+
+        for (int i = 0; i < 4; i++)
+            last_seq = log.append_snapshot(key, *voxels);
+        ok = ok && log.wait_durable(last_seq);
+    }
+    std::cout << "chunks written before the log record is durable: " << written_before_durable
+              << ", after: " << written_after_durable << std::endl;
+
+    // сегмент не дошёл до checkpoint и остался на диске
+    uint64_t restored_seq = 0, next_seq = 0;
+    {
+        RegionStore store(dir / "regions", chunk_size);
+        EditLog log(dir / "wal", &store, 10, 1ull << 40);
+        restored_seq = log.last_seq();
+        next_seq = log.append_snapshot(key, *voxels);
+        ok = ok && log.wait_durable(next_seq);
+    }
+    std::filesystem::remove_all(dir);
+    std::cout << "last seq " << last_seq << ", after restart " << restored_seq << ", next append " << next_seq << std::endl;
+
+    ok = ok && written_before_durable == 0 && written_after_durable == 1 && restored_seq == last_seq && next_seq == last_seq + 1;
+    std::cout << (ok ? "OK" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
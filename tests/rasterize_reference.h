@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "voxel_rastorizator.h"
+
+// Эталон для rasterize_triangle_to_points: старый полный перебор AABB, каждый воксель через tri_box_overlap.
+// Общий для rasterize_triangle_test и rasterize_triangle_bench, чтобы тест и бенчмарк сравнивали с одним и тем же.
+
+inline std::vector<glm::ivec3> rasterize_full_aabb(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float voxel_size) {
+    glm::vec3 p0 = v0 / voxel_size;
+    glm::vec3 p1 = v1 / voxel_size;
+    glm::vec3 p2 = v2 / voxel_size;
+
+    glm::vec3 mn = glm::min(p0, glm::min(p1, p2));
+    glm::vec3 mx = glm::max(p0, glm::max(p1, p2));
+
+    glm::ivec3 imin = glm::ivec3(glm::floor(mn)) - glm::ivec3(1);
+    glm::ivec3 imax = glm::ivec3(glm::floor(mx)) + glm::ivec3(1);
+
+    const glm::vec3 half(0.5f);
+    std::vector<glm::ivec3> out;
+    for (int x = imin.x; x <= imax.x; ++x)
+    for (int y = imin.y; y <= imax.y; ++y)
+    for (int z = imin.z; z <= imax.z; ++z) {
+        glm::vec3 center = glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f);
+        if (VoxelRastorizator::tri_box_overlap(center, half, p0, p1, p2))
+            out.emplace_back(x, y, z);
+    }
+    return out;
+}
+
+// порядок обхода у реализаций разный, множества сравниваются после сортировки
+inline void sort_points(std::vector<glm::ivec3>& points) {
+    std::sort(points.begin(), points.end(), [](const glm::ivec3& a, const glm::ivec3& b) {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    });
+}
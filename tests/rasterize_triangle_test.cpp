@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "voxel_rastorizator.h"
+#include "tests/rasterize_reference.h"
+
+// rasterize_triangle_to_points (обход слоя плоскости по столбцам) против старого полного перебора AABB:
+// множества вокселей должны совпадать. Случаи: обычные, вырожденные и почти вырожденные треугольники,
+// вершины на сетке, большие наклонные треугольники и размер вокселя != 1.
+//
+//   rasterize_triangle_test [count_triangles] [seed]
+
+int main(int argc, char** argv) {
+    uint32_t count_triangles = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 5000;
+    uint32_t seed = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 1;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> kind_dist(0, 6);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float voxel_sizes[4] = {1.0f, 0.1f, 0.37f, 2.5f};
+
+    uint64_t points = 0, mismatches = 0;
+    for (uint32_t n = 0; n < count_triangles; n++) {
+        float voxel_size = voxel_sizes[n % 4];
+        glm::vec3 base = glm::vec3(unit(rng), unit(rng), unit(rng)) * 100.0f * voxel_size;
+        auto rand_point = [&](float scale) {
+            return base + glm::vec3(unit(rng), unit(rng), unit(rng)) * scale * voxel_size;
+        };
+
+        glm::vec3 v0, v1, v2;
+        switch (kind_dist(rng)) {
+        case 0: // обычный
+            v0 = rand_point(8.0f); v1 = rand_point(8.0f); v2 = rand_point(8.0f);
+            break;
+        case 1: // вершины на сетке
+            v0 = glm::floor(rand_point(8.0f) / voxel_size) * voxel_size;
+            v1 = glm::floor(rand_point(8.0f) / voxel_size) * voxel_size;
+            v2 = glm::floor(rand_point(8.0f) / voxel_size) * voxel_size;
+            break;
+        case 2: // вырожденный: отрезок
+            v0 = rand_point(8.0f); v1 = rand_point(8.0f); v2 = v0 + (v1 - v0) * 0.25f;
+            break;
+        case 3: // почти вырожденный: третья вершина чуть в стороне от ребра
+            v0 = rand_point(8.0f); v1 = rand_point(8.0f); v2 = v0 + (v1 - v0) * 0.5f + glm::vec3(unit(rng), unit(rng), unit(rng)) * 1e-4f * voxel_size;
+            break;
+        case 4: // в плоскости, параллельной грани вокселя
+        {
+            v0 = rand_point(8.0f); v1 = rand_point(8.0f); v2 = rand_point(8.0f);
+            int q = n % 3;
+            v1[q] = v0[q]; v2[q] = v0[q];
+            break;
+        }
+        case 5: // большой наклонный - здесь у слоя плоскости больше всего шансов потерять воксель
+            v0 = rand_point(60.0f); v1 = rand_point(60.0f); v2 = rand_point(60.0f);
+            break;
+        default: // вытянутый: длинное ребро и короткая высота
+            v0 = rand_point(40.0f); v1 = rand_point(40.0f); v2 = v0 + glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.3f * voxel_size;
+            break;
+        }
+
+        std::vector<glm::ivec3> expected = rasterize_full_aabb(v0, v1, v2, voxel_size);
+        std::vector<glm::ivec3> got = VoxelRastorizator::rasterize_triangle_to_points(v0, v1, v2, voxel_size);
+        sort_points(expected);
+        sort_points(got);
+        points += expected.size();
+
+        if (expected.size() == got.size() && std::equal(expected.begin(), expected.end(), got.begin()))
+            continue;
+        if (mismatches++ < 5) {
+            std::cout << "mismatch on triangle " << n << " (voxel size " << voxel_size << "): expected "
+                      << expected.size() << " points, got " << got.size() << std::endl;
+        }
+    }
+
+    std::cout << count_triangles << " triangles, " << points << " points, " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "voxel_engine/region_store.h"
+
+// Сжатие региона: чанк много раз перезаписывается, файл региона не должен расти без предела,
+// а последние версии всех чанков читаются и до, и после переоткрытия хранилища.
+//
+//   region_store_test [count_rewrites]
+
+static std::shared_ptr<const std::vector<Voxel>> make_chunk(uint32_t voxel_count, int version) {
+    auto voxels = std::make_shared<std::vector<Voxel>>(voxel_count);
+    // разные цвета через воксель - чтобы RLE не сжал чанк в один run
+    for (uint32_t i = 0; i < voxel_count; i++)
+        (*voxels)[i] = Voxel(glm::vec3((float)version, (float)(i % 7), 0.0f), (i + version) % 2 == 0);
+    return voxels;
+}
+
+static bool same(const std::shared_ptr<std::vector<Voxel>>& got, const std::shared_ptr<const std::vector<Voxel>>& expected) {
+    if (!got || got->size() != expected->size()) return false;
+    for (size_t i = 0; i < got->size(); i++)
+        if ((*got)[i].visible != (*expected)[i].visible || (*got)[i].color != (*expected)[i].color) return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int count_rewrites = argc > 1 ? std::stoi(argv[1]) : 64;
+
+    glm::ivec3 chunk_size(16);
+    uint32_t voxel_count = chunk_size.x * chunk_size.y * chunk_size.z;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "region_store_test";
+    std::filesystem::remove_all(dir);
+
+    uint64_t hot = math_utils::pack_key(1, 2, 3);
+    uint64_t cold = math_utils::pack_key(4, 5, 6); // тот же регион, пишется один раз
+    auto cold_voxels = make_chunk(voxel_count, -1);
+    std::shared_ptr<const std::vector<Voxel>> hot_voxels;
+
+    bool ok = true;
+    uint64_t chunk_bytes = 0, region_bytes = 0, compacted = 0;
+    {
+        RegionStore store(dir, chunk_size);
+        store.compact_min_dead_bytes = 0;
+
+        store.enqueue_write(cold, cold_voxels);
+        ok = ok && store.flush();
+        for (int i = 0; i < count_rewrites; i++) {
+            hot_voxels = make_chunk(voxel_count, i);
+            store.enqueue_write(hot, hot_voxels);
+            ok = ok && store.flush();
+        }
+        chunk_bytes = store.bytes_written() / (count_rewrites + 1);
+        compacted = store.regions_compacted();
+
+        ok = ok && same(store.load(hot), hot_voxels) && same(store.load(cold), cold_voxels);
+        region_bytes = std::filesystem::file_size(dir / "r.0.0.0.vxr");
+    }
+    {
+        RegionStore store(dir, chunk_size);
+        ok = ok && same(store.load(hot), hot_voxels) && same(store.load(cold), cold_voxels);
+    }
+    std::filesystem::remove_all(dir);
+
+    // живых два чанка: с порогом 0.5 мусора не больше, чем живых данных, плюс одна дописанная версия
+    uint64_t table_bytes = sizeof(RegionStore::RegionHeader) + sizeof(RegionStore::Entry) * RegionStore::REGION_CHUNKS;
+    uint64_t payload_bytes = region_bytes - table_bytes;
+    std::cout << count_rewrites << " rewrites of a " << chunk_bytes << " byte chunk: region payload " << payload_bytes
+              << " bytes, " << compacted << " compactions" << std::endl;
+    ok = ok && compacted > 0 && payload_bytes <= 5 * chunk_bytes;
+
+    std::cout << (ok ? "OK" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "voxel_rastorizator.h"
+
+// Каждое доступное ядро tri_box_overlap_batch против скалярного tri_box_overlap на случайных треугольниках.
+// Результат должен совпадать бит в бит, включая касания граней, вырожденные треугольники и хвосты count < 16.
+//
+//   tri_box_overlap_test [count_triangles] [seed]
+
+struct Case {
+    glm::vec3 v0, v1, v2;
+    glm::vec3 half;
+    float cx[VoxelRastorizator::TRI_BOX_BATCH], cy[VoxelRastorizator::TRI_BOX_BATCH], cz[VoxelRastorizator::TRI_BOX_BATCH];
+    uint32_t count;
+};
+
+static Case make_case(std::mt19937& rng) {
+    std::uniform_int_distribution<int> kind_dist(0, 5);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> cell(-4, 4);
+    std::uniform_int_distribution<int> half_dist(0, 3);
+
+    Case c;
+    c.count = std::uniform_int_distribution<uint32_t>(1, VoxelRastorizator::TRI_BOX_BATCH)(rng);
+
+    // боксы как в растеризаторе: столбец центров вокселей вдоль случайной оси
+    int axis = std::uniform_int_distribution<int>(0, 2)(rng);
+    glm::vec3 base(cell(rng) + 0.5f, cell(rng) + 0.5f, cell(rng) + 0.5f);
+    for (uint32_t i = 0; i < VoxelRastorizator::TRI_BOX_BATCH; i++) {
+        glm::vec3 center = base;
+        center[axis] += (float)i - 8.0f;
+        c.cx[i] = center.x; c.cy[i] = center.y; c.cz[i] = center.z;
+    }
+    const float halves[4] = {0.5f, 0.25f, 1.0f, 0.5000001f};
+    c.half = glm::vec3(halves[half_dist(rng)]);
+
+    auto rand_point = [&](float scale) {
+        return base + glm::vec3(unit(rng), unit(rng), unit(rng)) * scale;
+    };
+
+    switch (kind_dist(rng)) {
+    case 0: // обычный треугольник около столбца
+        c.v0 = rand_point(6.0f); c.v1 = rand_point(6.0f); c.v2 = rand_point(6.0f);
+        break;
+    case 1: // вершины на сетке - касания граней и рёбер боксов
+        c.v0 = glm::floor(rand_point(6.0f)); c.v1 = glm::floor(rand_point(6.0f)); c.v2 = glm::floor(rand_point(6.0f));
+        break;
+    case 2: // вырожденный: отрезок
+        c.v0 = rand_point(6.0f); c.v1 = rand_point(6.0f); c.v2 = c.v0 + (c.v1 - c.v0) * 0.5f;
+        break;
+    case 3: // вырожденный: точка
+        c.v0 = rand_point(6.0f); c.v1 = c.v0; c.v2 = c.v0;
+        break;
+    case 4: // большой и вытянутый, далеко от начала координат
+    {
+        glm::vec3 offset(1.0e5f, -3.0e4f, 7.0e4f);
+        base += offset;
+        for (uint32_t i = 0; i < VoxelRastorizator::TRI_BOX_BATCH; i++) {
+            c.cx[i] += offset.x; c.cy[i] += offset.y; c.cz[i] += offset.z;
+        }
+        c.v0 = rand_point(200.0f); c.v1 = rand_point(200.0f); c.v2 = rand_point(3.0f);
+        break;
+    }
+    default: // почти параллелен грани бокса
+    {
+        c.v0 = rand_point(6.0f); c.v1 = rand_point(6.0f); c.v2 = rand_point(6.0f);
+        float plane = std::floor(base[axis == 2 ? 0 : 2]) + (std::uniform_int_distribution<int>(0, 1)(rng) ? 0.0f : 1e-6f);
+        int q = axis == 2 ? 0 : 2;
+        c.v0[q] = plane; c.v1[q] = plane; c.v2[q] = plane + unit(rng) * 1e-5f;
+        break;
+    }
+    }
+    return c;
+}
+
+static uint32_t reference_mask(const Case& c) {
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < c.count; i++) {
+        if (VoxelRastorizator::tri_box_overlap(glm::vec3(c.cx[i], c.cy[i], c.cz[i]), c.half, c.v0, c.v1, c.v2))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count_triangles = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 200000;
+    uint32_t seed = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 1;
+
+    std::vector<const char*> isas = VoxelRastorizator::tri_box_batch_isas();
+    std::cout << "kernels:";
+    for (const char* isa : isas) std::cout << " " << isa;
+    std::cout << " (selected: " << VoxelRastorizator::tri_box_batch_isa() << ")" << std::endl;
+
+    std::mt19937 rng(seed);
+    std::vector<uint64_t> mismatches(isas.size(), 0);
+    uint64_t hits = 0, boxes = 0;
+
+    for (uint32_t n = 0; n < count_triangles; n++) {
+        Case c = make_case(rng);
+        uint32_t expected = reference_mask(c);
+        hits += math_utils::popcount_u64(expected);
+        boxes += c.count;
+
+        for (size_t k = 0; k < isas.size(); k++) {
+            uint32_t got = VoxelRastorizator::tri_box_overlap_batch_isa(isas[k], c.cx, c.cy, c.cz, c.count, c.half, c.v0, c.v1, c.v2);
+            if (got == expected) continue;
+            if (mismatches[k]++ < 5) {
+                std::cout << isas[k] << ": mismatch on triangle " << n << ": expected 0x" << std::hex << expected
+                          << ", got 0x" << got << std::dec << " (count " << c.count << ")" << std::endl;
+            }
+        }
+    }
+
+    std::cout << count_triangles << " triangles, " << boxes << " boxes, " << hits << " overlaps" << std::endl;
+
+    bool ok = true;
+    for (size_t k = 0; k < isas.size(); k++) {
+        std::cout << isas[k] << ": " << mismatches[k] << " mismatches" << std::endl;
+        ok = ok && mismatches[k] == 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include "edit_journal.h"
+#include "voxel_grid.h"
+
+static bool same_voxel(const Voxel& a, const Voxel& b) {
+    return a.visible == b.visible && a.color == b.color;
+}
+
+static void write_varint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80u) {
+        out.push_back((uint8_t)(v | 0x80u));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static uint32_t read_varint(const std::vector<uint8_t>& in, size_t& pos) {
+    uint32_t v = 0;
+    uint32_t shift = 0;
+    while (pos < in.size()) {
+        uint8_t b = in[pos++];
+        v |= (uint32_t)(b & 0x7Fu) << shift;
+        if ((b & 0x80u) == 0u) break;
+        shift += 7;
+    }
+    return v;
+}
+
+size_t EditJournal::ChunkDelta::memory_bytes() const {
+    size_t bytes = sizeof(ChunkDelta);
+    bytes += encoded_ids.capacity();
+    bytes += (prev_runs.capacity() + next_runs.capacity()) * sizeof(std::pair<uint32_t, Voxel>);
+    // next_snapshot обычно живёт в чанке, а prev держит только журнал
+    if (prev_snapshot) bytes += prev_snapshot->size() * sizeof(Voxel);
+    return bytes;
+}
+
+EditJournal::EditJournal(size_t memory_limit_bytes) {
+    this->memory_limit_bytes = memory_limit_bytes;
+}
+
+void EditJournal::encode_ids(const std::vector<uint32_t>& sorted_ids, std::vector<uint8_t>& out) {
+    out.clear();
+    uint32_t prev_end = 0; // id после конца прошлой серии
+    size_t i = 0;
+    while (i < sorted_ids.size()) {
+        uint32_t start = sorted_ids[i];
+        uint32_t run = 1;
+        while (i + run < sorted_ids.size() && sorted_ids[i + run] == start + run)
+            run++;
+
+        write_varint(out, start - prev_end);
+        write_varint(out, run);
+
+        prev_end = start + run;
+        i += run;
+    }
+}
+
+void EditJournal::decode_ids(const std::vector<uint8_t>& encoded, uint32_t count, std::vector<uint32_t>& out) {
+    out.clear();
+    out.reserve(count);
+    size_t pos = 0;
+    uint32_t prev_end = 0;
+    while (pos < encoded.size() && out.size() < count) {
+        uint32_t start = prev_end + read_varint(encoded, pos);
+        uint32_t run = read_varint(encoded, pos);
+        for (uint32_t k = 0; k < run; k++)
+            out.push_back(start + k);
+        prev_end = start + run;
+    }
+}
+
+void EditJournal::encode_values(const std::vector<Voxel>& values, std::vector<std::pair<uint32_t, Voxel>>& out) {
+    out.clear();
+    for (const Voxel& v : values) {
+        if (!out.empty() && same_voxel(out.back().second, v))
+            out.back().first++;
+        else
+            out.emplace_back(1u, v);
+    }
+    out.shrink_to_fit();
+}
+
+void EditJournal::decode_values(const std::vector<std::pair<uint32_t, Voxel>>& runs, std::vector<Voxel>& out) {
+    out.clear();
+    for (const auto& run : runs)
+        out.insert(out.end(), run.first, run.second);
+}
+
+void EditJournal::begin_batch() {
+    if (batch_is_open) {
+        std::cout << "EditJournal::begin_batch: batch is already open" << std::endl;
+        throw std::runtime_error("EditJournal::begin_batch: batch is already open");
+    }
+    pending = Batch();
+    batch_is_open = true;
+}
+
+void EditJournal::record_voxels(uint64_t chunk_key,
+                                const std::vector<uint32_t>& ids,
+                                const std::vector<Voxel>& prev_values,
+                                const std::vector<Voxel>& next_values) {
+    if (!batch_is_open) {
+        std::cout << "EditJournal::record_voxels: no open batch" << std::endl;
+        throw std::runtime_error("EditJournal::record_voxels: no open batch");
+    }
+    if (ids.size() != prev_values.size() || ids.size() != next_values.size()) {
+        std::cout << "EditJournal::record_voxels: size mismatch" << std::endl;
+        throw std::runtime_error("EditJournal::record_voxels: size mismatch");
+    }
+    if (ids.empty()) return;
+
+    ChunkDelta delta;
+    delta.chunk_key = chunk_key;
+    delta.count = (uint32_t)ids.size();
+    encode_ids(ids, delta.encoded_ids);
+    delta.encoded_ids.shrink_to_fit();
+    encode_values(prev_values, delta.prev_runs);
+    encode_values(next_values, delta.next_runs);
+
+    pending.bytes += delta.memory_bytes();
+    pending.chunks.push_back(std::move(delta));
+}
+
+void EditJournal::record_snapshot(uint64_t chunk_key,
+                                  std::shared_ptr<const std::vector<Voxel>> prev_snapshot,
+                                  std::shared_ptr<const std::vector<Voxel>> next_snapshot) {
+    if (!batch_is_open) {
+        std::cout << "EditJournal::record_snapshot: no open batch" << std::endl;
+        throw std::runtime_error("EditJournal::record_snapshot: no open batch");
+    }
+
+    ChunkDelta delta;
+    delta.chunk_key = chunk_key;
+    delta.prev_snapshot = std::move(prev_snapshot);
+    delta.next_snapshot = std::move(next_snapshot);
+
+    pending.bytes += delta.memory_bytes();
+    pending.chunks.push_back(std::move(delta));
+}
+
+void EditJournal::commit_batch() {
+    if (!batch_is_open) {
+        std::cout << "EditJournal::commit_batch: no open batch" << std::endl;
+        throw std::runtime_error("EditJournal::commit_batch: no open batch");
+    }
+    batch_is_open = false;
+
+    if (pending.chunks.empty())
+        return;
+
+    // новая правка обрезает ветку redo
+    for (const Batch& b : redo_stack)
+        used_bytes_ -= b.bytes;
+    redo_stack.clear();
+
+    used_bytes_ += pending.bytes;
+    undo_stack.push_back(std::move(pending));
+    pending = Batch();
+
+    trim_to_limit();
+}
+
+void EditJournal::trim_to_limit() {
+    // последний батч не трогаем, даже если он один больше лимита
+    while (used_bytes_ > memory_limit_bytes && undo_stack.size() > 1) {
+        used_bytes_ -= undo_stack.front().bytes;
+        undo_stack.pop_front();
+    }
+}
+
+void EditJournal::apply_batch(VoxelGrid& voxel_grid, const Batch& batch, bool use_prev) {
+    std::vector<uint32_t> ids;
+    std::vector<Voxel> values;
+    std::vector<EditLog::ChunkEdit> log_edits;
+    std::vector<uint64_t> dirty_keys;
+
+    for (size_t n = 0; n < batch.chunks.size(); n++) {
+        // undo идёт в обратном порядке, redo — в прямом
+        const ChunkDelta& delta = use_prev ? batch.chunks[batch.chunks.size() - 1 - n] : batch.chunks[n];
+
+        auto chunk_it = voxel_grid.chunks.find(delta.chunk_key);
+        if (chunk_it == voxel_grid.chunks.end())
+            continue;
+        Chunk* chunk = chunk_it->second;
+
+        if (delta.prev_snapshot || delta.next_snapshot) {
+            const auto& snapshot = use_prev ? delta.prev_snapshot : delta.next_snapshot;
+            chunk->update_voxels(snapshot);
+            if (voxel_grid.edit_log && snapshot) {
+                EditLog::ChunkEdit edit{delta.chunk_key, std::vector<uint32_t>(snapshot->size()), *snapshot};
+                for (uint32_t i = 0; i < (uint32_t)snapshot->size(); i++)
+                    edit.ids[i] = i;
+                log_edits.push_back(std::move(edit));
+            }
+        } else {
+            decode_ids(delta.encoded_ids, delta.count, ids);
+            decode_values(use_prev ? delta.prev_runs : delta.next_runs, values);
+
+            chunk->edit_voxels([&](std::vector<Voxel>& voxels){
+                for (size_t i = 0; i < ids.size() && i < values.size(); i++) {
+                    if (ids[i] < voxels.size())
+                        voxels[ids[i]] = values[i];
+                }
+            });
+            if (voxel_grid.edit_log)
+                log_edits.push_back(EditLog::ChunkEdit{delta.chunk_key, ids, values});
+        }
+
+        dirty_keys.push_back(delta.chunk_key);
+
+        glm::ivec3 chunk_pos = math_utils::unpack_key(delta.chunk_key);
+        voxel_grid.chunks_to_update.insert(delta.chunk_key);
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x-1, chunk_pos.y, chunk_pos.z)); // left
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z-1)); // back
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x+1, chunk_pos.y, chunk_pos.z)); // right
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z+1)); // front
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y+1, chunk_pos.z)); // top
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y-1, chunk_pos.z)); // bottom
+    }
+
+    // undo/redo тоже меняет мир, поэтому пишется в лог как обычный батч
+    uint64_t seq = voxel_grid.edit_log ? voxel_grid.edit_log->append(log_edits) : 0;
+    for (uint64_t key : dirty_keys)
+        voxel_grid.mark_chunk_dirty(key, seq);
+}
+
+bool EditJournal::undo(VoxelGrid& voxel_grid) {
+    if (undo_stack.empty() || batch_is_open)
+        return false;
+
+    Batch batch = std::move(undo_stack.back());
+    undo_stack.pop_back();
+
+    apply_batch(voxel_grid, batch, true);
+    redo_stack.push_back(std::move(batch));
+    return true;
+}
+
+bool EditJournal::redo(VoxelGrid& voxel_grid) {
+    if (redo_stack.empty() || batch_is_open)
+        return false;
+
+    Batch batch = std::move(redo_stack.back());
+    redo_stack.pop_back();
+
+    apply_batch(voxel_grid, batch, false);
+    undo_stack.push_back(std::move(batch));
+    return true;
+}
+
+void EditJournal::clear() {
+    undo_stack.clear();
+    redo_stack.clear();
+    pending = Batch();
+    batch_is_open = false;
+    used_bytes_ = 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include "voxel.h"
+
+class VoxelGrid;
+
+// Журнал правок для undo/redo.
+// Каждый закоммиченный батч хранит по каждому затронутому чанку:
+//  - отсортированные local id (delta + RLE, varint),
+//  - старые и новые значения вокселей (RLE по одинаковым значениям),
+//  - либо пару снапшотов чанка (для правок всего чанка) — без копирования.
+class EditJournal {
+public:
+    struct ChunkDelta {
+        uint64_t chunk_key = 0;
+        uint32_t count = 0;                               // число затронутых вокселей
+        std::vector<uint8_t> encoded_ids;                 // varint пары (gap, run)
+        std::vector<std::pair<uint32_t, Voxel>> prev_runs; // (длина серии, значение)
+        std::vector<std::pair<uint32_t, Voxel>> next_runs;
+
+        // правка всего чанка: просто храним старый/новый снапшот
+        std::shared_ptr<const std::vector<Voxel>> prev_snapshot;
+        std::shared_ptr<const std::vector<Voxel>> next_snapshot;
+
+        size_t memory_bytes() const;
+    };
+
+    struct Batch {
+        std::vector<ChunkDelta> chunks;
+        size_t bytes = 0;
+    };
+
+    size_t memory_limit_bytes;
+
+    EditJournal(size_t memory_limit_bytes = 64u * 1024u * 1024u);
+
+    void begin_batch();
+    // ids должны быть отсортированы по возрастанию, prev/next той же длины
+    void record_voxels(uint64_t chunk_key,
+                       const std::vector<uint32_t>& ids,
+                       const std::vector<Voxel>& prev_values,
+                       const std::vector<Voxel>& next_values);
+    void record_snapshot(uint64_t chunk_key,
+                         std::shared_ptr<const std::vector<Voxel>> prev_snapshot,
+                         std::shared_ptr<const std::vector<Voxel>> next_snapshot);
+    void commit_batch();
+
+    bool undo(VoxelGrid& voxel_grid);
+    bool redo(VoxelGrid& voxel_grid);
+
+    bool can_undo() const { return !undo_stack.empty(); }
+    bool can_redo() const { return !redo_stack.empty(); }
+    bool batch_open() const { return batch_is_open; }
+
+    size_t used_bytes() const { return used_bytes_; }
+    size_t undo_size() const { return undo_stack.size(); }
+    size_t redo_size() const { return redo_stack.size(); }
+
+    void clear();
+
+    static void encode_ids(const std::vector<uint32_t>& sorted_ids, std::vector<uint8_t>& out);
+    static void decode_ids(const std::vector<uint8_t>& encoded, uint32_t count, std::vector<uint32_t>& out);
+    static void encode_values(const std::vector<Voxel>& values, std::vector<std::pair<uint32_t, Voxel>>& out);
+    static void decode_values(const std::vector<std::pair<uint32_t, Voxel>>& runs, std::vector<Voxel>& out);
+
+private:
+    std::deque<Batch> undo_stack;   // front — самый старый
+    std::vector<Batch> redo_stack;
+    Batch pending;
+    bool batch_is_open = false;
+    size_t used_bytes_ = 0;
+
+    void apply_batch(VoxelGrid& voxel_grid, const Batch& batch, bool use_prev);
+    void trim_to_limit();
+};
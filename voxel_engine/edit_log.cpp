@@ -0,0 +1,520 @@
+#include "edit_log.h"
+#include "edit_journal.h"
+#include "voxel_grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+template<class T>
+static void put_pod(std::vector<uint8_t>& out, const T& value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template<class T>
+static bool get_pod(const uint8_t* data, size_t size, size_t& pos, T& value) {
+    if (pos + sizeof(T) > size) return false;
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static bool sync_stdio_file(std::FILE* file) {
+    if (std::fflush(file) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return ::fdatasync(fileno(file)) == 0;
+#endif
+}
+
+uint32_t EditLog::crc32(const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool table_ready = [](){
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)table_ready;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+EditLog::EditLog(const std::filesystem::path& directory, RegionStore* region_store,
+                 int fsync_interval_ms, uint64_t checkpoint_bytes) {
+    this->directory = directory;
+    this->region_store = region_store;
+    this->fsync_interval_ms = fsync_interval_ms;
+    this->checkpoint_bytes = checkpoint_bytes;
+
+    if (!region_store) {
+        std::string message = "EditLog: region_store is required for checkpoints";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    // сегменты с прошлого запуска: wal.<N>.log
+    uint64_t max_index = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() < 9 || name.rfind("wal.", 0) != 0 || name.substr(name.size() - 4) != ".log")
+            continue;
+        std::string digits = name.substr(4, name.size() - 8);
+        if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            continue;
+        uint64_t index = std::stoull(name.substr(4, name.size() - 8));
+        max_index = std::max(max_index, index);
+        old_segments.push_back(entry.path());
+    }
+    std::sort(old_segments.begin(), old_segments.end(), [](const std::filesystem::path& a, const std::filesystem::path& b) {
+        std::string na = a.filename().string(), nb = b.filename().string();
+        return std::stoull(na.substr(4, na.size() - 8)) < std::stoull(nb.substr(4, nb.size() - 8));
+    });
+
+    // seq продолжается с последней записи старых сегментов: replay упорядочивает правки по seq,
+    // а region_store ждёт durable seq, поэтому новые записи не должны получить номера меньше старых
+    uint64_t max_seq = 0;
+    std::vector<uint8_t> data;
+    std::vector<RecordRef> records;
+    for (const auto& segment : old_segments) {
+        if (!read_segment(segment, data, records))
+            continue;
+        for (const RecordRef& record : records)
+            max_seq = std::max(max_seq, record.seq);
+    }
+    last_seq_.store(max_seq, std::memory_order_relaxed);
+    durable_seq_.store(max_seq, std::memory_order_release);
+    buffer_last_seq = max_seq;
+    region_store->set_durable_seq(max_seq);
+
+    if (!open_segment(max_index + 1)) {
+        std::string message = "EditLog: failed to open " + segment_path(max_index + 1).string();
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    running = true;
+    flush_thread = std::thread(&EditLog::flush_loop, this);
+    checkpoint_thread = std::thread(&EditLog::checkpoint_loop, this);
+}
+
+EditLog::~EditLog() {
+    {
+        std::lock_guard<std::mutex> lk(mx);
+        running = false;
+    }
+    flush_cv.notify_all();
+    if (flush_thread.joinable())
+        flush_thread.join();
+
+    // flush поток остановлен, не durable правки так и не попали в лог - их снапшоты нельзя писать,
+    // иначе checkpoint поток ждал бы их в region_store->flush() вечно
+    region_store->discard_undurable_writes();
+
+    {
+        std::lock_guard<std::mutex> lk(checkpoint_mx);
+    }
+    checkpoint_cv.notify_all();
+    if (checkpoint_thread.joinable())
+        checkpoint_thread.join();
+
+    if (segment_file)
+        std::fclose(segment_file);
+}
+
+std::filesystem::path EditLog::segment_path(uint64_t index) const {
+    return directory / ("wal." + std::to_string(index) + ".log");
+}
+
+bool EditLog::open_segment(uint64_t index) {
+    segment_index = index;
+    segment_bytes = 0;
+    segment_file = std::fopen(segment_path(index).string().c_str(), "ab");
+    return segment_file != nullptr;
+}
+
+void EditLog::set_io_error(const std::string& message) {
+    std::cout << message << std::endl;
+    {
+        std::lock_guard<std::mutex> lk(mx);
+        io_error_ = message;
+        io_error_count_++;
+    }
+    durable_cv.notify_all();
+}
+
+std::string EditLog::io_error() {
+    std::lock_guard<std::mutex> lk(mx);
+    return io_error_;
+}
+
+uint64_t EditLog::append(const std::vector<ChunkEdit>& edits) {
+    if (edits.empty()) return last_seq();
+
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> encoded;
+    put_pod<uint32_t>(payload, (uint32_t)edits.size());
+    for (const ChunkEdit& edit : edits) {
+        put_pod<uint64_t>(payload, edit.chunk_key);
+        put_pod<uint32_t>(payload, (uint32_t)edit.ids.size());
+
+        EditJournal::encode_ids(edit.ids, encoded);
+        put_pod<uint32_t>(payload, (uint32_t)encoded.size());
+        payload.insert(payload.end(), encoded.begin(), encoded.end());
+
+        RegionStore::encode_voxels(edit.values, encoded);
+        put_pod<uint32_t>(payload, (uint32_t)encoded.size());
+        payload.insert(payload.end(), encoded.begin(), encoded.end());
+    }
+
+    RecordHeader header{RECORD_MAGIC, (uint32_t)payload.size(), 0, crc32(payload.data(), payload.size()), 0};
+
+    std::lock_guard<std::mutex> lk(mx);
+    header.seq = last_seq_.load(std::memory_order_relaxed) + 1;
+    last_seq_.store(header.seq, std::memory_order_relaxed);
+
+    put_pod(buffer, header);
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    buffer_last_seq = header.seq;
+    return header.seq;
+}
+
+uint64_t EditLog::append_snapshot(uint64_t chunk_key, const std::vector<Voxel>& voxels) {
+    std::vector<ChunkEdit> edits(1);
+    edits[0].chunk_key = chunk_key;
+    edits[0].ids.resize(voxels.size());
+    for (uint32_t i = 0; i < (uint32_t)voxels.size(); i++)
+        edits[0].ids[i] = i;
+    edits[0].values = voxels; // ids подряд — в логе это одна RLE серия
+    return append(edits);
+}
+
+bool EditLog::wait_durable(uint64_t seq) {
+    std::unique_lock<std::mutex> lk(mx);
+    uint64_t errors = io_error_count_;
+    flush_cv.notify_one();
+    durable_cv.wait(lk, [&]{ return durable_seq_.load(std::memory_order_acquire) >= seq || !running || io_error_count_ != errors; });
+    return durable_seq_.load(std::memory_order_acquire) >= seq;
+}
+
+void EditLog::checkpoint_now() {
+    std::lock_guard<std::mutex> lk(mx);
+    rotate_requested = true;
+    flush_cv.notify_one();
+}
+
+void EditLog::flush_loop() {
+    std::vector<uint8_t> local;
+
+    while (true) {
+        uint64_t seq;
+        bool rotate;
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lk(mx);
+            flush_cv.wait_for(lk, std::chrono::milliseconds(fsync_interval_ms), [&]{ return !running || rotate_requested; });
+
+            // local не пуст, если прошлый group commit не удался - новые записи идут после него
+            local.insert(local.end(), buffer.begin(), buffer.end());
+            buffer.clear();
+            seq = buffer_last_seq;
+            rotate = rotate_requested;
+            rotate_requested = false;
+            stop = !running;
+        }
+
+        // group commit: всё, что накопилось за интервал, пишем одним write + fsync
+        if (local.empty() || write_segment(local)) {
+            local.clear();
+            {
+                std::lock_guard<std::mutex> lk(mx);
+                io_error_.clear();
+            }
+            durable_seq_.store(seq, std::memory_order_release);
+            durable_cv.notify_all();
+            region_store->set_durable_seq(seq);
+        }
+
+        if (stop) {
+            if (!local.empty())
+                std::cout << "EditLog: " << local.size() << " bytes of edits were not written to disk" << std::endl;
+            break;
+        }
+
+        if (rotate || segment_bytes >= checkpoint_bytes)
+            rotate_segment();
+    }
+}
+
+bool EditLog::write_segment(const std::vector<uint8_t>& data) {
+    if (!segment_file && !open_segment(segment_index + 1)) {
+        set_io_error("EditLog: failed to open " + segment_path(segment_index).string());
+        return false;
+    }
+
+    if (std::fwrite(data.data(), 1, data.size(), segment_file) == data.size() && sync_stdio_file(segment_file)) {
+        segment_bytes += data.size();
+        return true;
+    }
+
+    // в сегменте могла остаться оборванная запись, а read_segment отбрасывает всё после неё -
+    // дописывать сюда нельзя. Записи до неё целы, сегмент уходит в checkpoint,
+    // а data повторяется целиком в следующем
+    set_io_error("EditLog: failed to write " + segment_path(segment_index).string());
+    close_segment();
+    return false;
+}
+
+void EditLog::close_segment() {
+    std::fclose(segment_file);
+    segment_file = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lk(checkpoint_mx);
+        segments_to_checkpoint.push_back(segment_path(segment_index));
+    }
+    checkpoint_cv.notify_one();
+}
+
+void EditLog::rotate_segment() {
+    if (!segment_file || segment_bytes == 0)
+        return;
+
+    close_segment();
+    if (!open_segment(segment_index + 1))
+        set_io_error("EditLog: failed to open " + segment_path(segment_index).string());
+}
+
+void EditLog::checkpoint_loop() {
+    while (true) {
+        std::filesystem::path segment;
+        {
+            std::unique_lock<std::mutex> lk(checkpoint_mx);
+            checkpoint_cv.wait(lk, [&]{ return !running || !segments_to_checkpoint.empty(); });
+            if (segments_to_checkpoint.empty())
+                break;
+            segment = segments_to_checkpoint.front();
+            segments_to_checkpoint.pop_front();
+        }
+
+        // все правки из закрытого сегмента уже стоят в очереди region_store (mark_chunk_dirty
+        // вызывается сразу после append), поэтому после успешного flush сегмент больше не нужен.
+        // flush ждёт и снапшоты с правками текущего сегмента - до их group commit
+        if (!region_store->flush()) {
+            // сегмент остаётся первым: удалить более новый раньше нельзя - replay проиграл бы
+            // старые правки поверх уже записанных новых
+            std::cout << "EditLog: region store did not confirm checkpoint, keeping " << segment.string() << std::endl;
+            std::unique_lock<std::mutex> lk(checkpoint_mx);
+            segments_to_checkpoint.push_front(segment);
+            if (checkpoint_cv.wait_for(lk, std::chrono::milliseconds(checkpoint_retry_ms), [&]{ return !running; }))
+                break; // оставшиеся сегменты проиграет replay при следующем запуске
+            continue;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(segment, ec);
+    }
+}
+
+bool EditLog::read_segment(const std::filesystem::path& path, std::vector<uint8_t>& data,
+                           std::vector<RecordRef>& records) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    size_t size = (size_t)in.tellg();
+    data.resize(size);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data.data()), size);
+
+    records.clear();
+    size_t pos = 0;
+    while (pos < size) {
+        RecordHeader header;
+        if (!get_pod(data.data(), size, pos, header)) break;
+        if (header.magic != RECORD_MAGIC || pos + header.payload_size > size) break;
+        if (crc32(data.data() + pos, header.payload_size) != header.crc) break;
+
+        records.push_back(RecordRef{pos, header.payload_size, header.seq});
+        pos += header.payload_size;
+    }
+
+    // хвост после первой битой записи — недописанный group commit, отбрасываем
+    if (pos < size)
+        std::cout << "EditLog: dropped torn tail of " << (size - pos) << " bytes in " << path.string() << std::endl;
+    return true;
+}
+
+size_t EditLog::replay(VoxelGrid& voxel_grid) {
+    struct PendingEdit {
+        uint64_t seq;
+        uint32_t count;
+        std::vector<uint8_t> ids;
+        std::vector<uint8_t> values;
+    };
+
+    std::unordered_map<uint64_t, std::vector<PendingEdit>> per_chunk;
+    size_t records_applied = 0;
+    uint64_t max_seq = 0;
+
+    std::vector<uint8_t> data;
+    std::vector<RecordRef> records;
+    for (const auto& segment : old_segments) {
+        if (!read_segment(segment, data, records))
+            continue;
+
+        for (const RecordRef& record : records) {
+            const uint8_t* p = data.data() + record.offset;
+            size_t size = record.size;
+            size_t pos = 0;
+
+            uint32_t chunk_count = 0;
+            get_pod(p, size, pos, chunk_count);
+            for (uint32_t c = 0; c < chunk_count; c++) {
+                PendingEdit edit;
+                uint64_t key = 0;
+                uint32_t ids_bytes = 0, values_bytes = 0;
+                edit.seq = record.seq;
+
+                if (!get_pod(p, size, pos, key) || !get_pod(p, size, pos, edit.count) ||
+                    !get_pod(p, size, pos, ids_bytes) || pos + ids_bytes > size)
+                    break;
+                edit.ids.assign(p + pos, p + pos + ids_bytes);
+                pos += ids_bytes;
+
+                if (!get_pod(p, size, pos, values_bytes) || pos + values_bytes > size)
+                    break;
+                edit.values.assign(p + pos, p + pos + values_bytes);
+                pos += values_bytes;
+
+                per_chunk[key].push_back(std::move(edit));
+            }
+
+            max_seq = std::max(max_seq, record.seq);
+            records_applied++;
+        }
+    }
+
+    if (per_chunk.empty()) {
+        for (const auto& segment : old_segments) {
+            std::error_code ec;
+            std::filesystem::remove(segment, ec);
+        }
+        old_segments.clear();
+        return 0;
+    }
+
+    std::vector<uint64_t> keys;
+    keys.reserve(per_chunk.size());
+    for (auto& kv : per_chunk)
+        keys.push_back(kv.first);
+
+    std::vector<std::shared_ptr<std::vector<Voxel>>> results(keys.size());
+    std::atomic<size_t> next_key{0};
+
+    // каждый чанк проигрывается независимо, внутри чанка — строго по seq
+    auto replay_worker = [&]() {
+        std::vector<uint32_t> ids;
+        std::vector<Voxel> values;
+        while (true) {
+            size_t i = next_key.fetch_add(1, std::memory_order_relaxed);
+            if (i >= keys.size()) break;
+
+            uint64_t key = keys[i];
+            auto voxels = region_store->load(key);
+            if (!voxels)
+                voxels = voxel_grid.generate_chunk(math_utils::unpack_key(key), voxel_grid.chunk_size);
+
+            auto& edits = per_chunk.at(key);
+            std::sort(edits.begin(), edits.end(), [](const PendingEdit& a, const PendingEdit& b) { return a.seq < b.seq; });
+            for (const PendingEdit& edit : edits) {
+                EditJournal::decode_ids(edit.ids, edit.count, ids);
+                if (!RegionStore::decode_voxels(edit.values.data(), edit.values.size(), edit.count, values))
+                    continue;
+                for (size_t k = 0; k < ids.size() && k < values.size(); k++) {
+                    if (ids[k] < voxels->size())
+                        (*voxels)[ids[k]] = values[k];
+                }
+            }
+            results[i] = voxels;
+        }
+    };
+
+    unsigned n = std::thread::hardware_concurrency();
+    if (n == 0) n = 4;
+    n = std::max(1u, std::min<unsigned>(n, (unsigned)keys.size()));
+
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (unsigned t = 0; t < n; t++)
+        workers.emplace_back(replay_worker);
+    for (auto& t : workers)
+        t.join();
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        uint64_t key = keys[i];
+        region_store->enqueue_write(key, results[i]);
+
+        auto it = voxel_grid.chunks.find(key);
+        if (it == voxel_grid.chunks.end())
+            continue;
+
+        it->second->update_voxels(results[i]);
+        glm::ivec3 cpos = math_utils::unpack_key(key);
+        voxel_grid.chunks_to_update.insert(key);
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x-1, cpos.y, cpos.z)); // left
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x, cpos.y, cpos.z-1)); // back
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x+1, cpos.y, cpos.z)); // right
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x, cpos.y, cpos.z+1)); // front
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x, cpos.y+1, cpos.z)); // top
+        voxel_grid.chunks_to_update.insert(math_utils::pack_key(cpos.x, cpos.y-1, cpos.z)); // bottom
+    }
+
+    // лог свёрнут в region_store — старые сегменты больше не нужны
+    if (region_store->flush()) {
+        for (const auto& segment : old_segments) {
+            std::error_code ec;
+            std::filesystem::remove(segment, ec);
+        }
+    } else {
+        // правки уже в очереди region_store: сегменты удалит checkpoint поток, когда запись пройдёт.
+        // В очередь - первыми, раньше них удалять новые сегменты нельзя
+        std::cout << "EditLog::replay: region store did not confirm the replayed chunks, old segments are kept" << std::endl;
+        {
+            std::lock_guard<std::mutex> lk(checkpoint_mx);
+            segments_to_checkpoint.insert(segments_to_checkpoint.begin(), old_segments.begin(), old_segments.end());
+        }
+        checkpoint_cv.notify_one();
+    }
+    old_segments.clear();
+
+    {
+        std::lock_guard<std::mutex> lk(mx);
+        if (last_seq_.load(std::memory_order_relaxed) < max_seq) {
+            last_seq_.store(max_seq, std::memory_order_relaxed);
+            buffer_last_seq = max_seq;
+            durable_seq_.store(max_seq, std::memory_order_release);
+            region_store->set_durable_seq(max_seq);
+        }
+    }
+
+    return records_applied;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "voxel.h"
+#include "region_store.h"
+
+class VoxelGrid;
+
+// Write-ahead лог правок мира.
+// Каждый закоммиченный батч VoxelEditor дописывается в текущий сегмент wal.<N>.log
+// записью [RecordHeader][payload], payload защищён crc32.
+// fsync делается группой раз в fsync_interval_ms на отдельном потоке.
+// Когда сегмент вырос до checkpoint_bytes, он закрывается, region_store сбрасывается на диск
+// и старый сегмент удаляется — это и есть checkpoint.
+// region_store пишет снапшот чанка только после group commit записи с его последней правкой.
+class EditLog {
+public:
+    static constexpr uint32_t RECORD_MAGIC = 0x4C575856u; // "VXWL"
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t payload_size;
+        uint64_t seq;
+        uint32_t crc;
+        uint32_t reserved;
+    };
+
+    // правка одного чанка: отсортированные local id и новые значения
+    struct ChunkEdit {
+        uint64_t chunk_key;
+        std::vector<uint32_t> ids;
+        std::vector<Voxel> values;
+    };
+
+    std::filesystem::path directory;
+    int fsync_interval_ms;
+    uint64_t checkpoint_bytes;
+    int checkpoint_retry_ms = 1000; // пауза перед повтором checkpoint, если region_store не смог записать
+
+    EditLog(const std::filesystem::path& directory, RegionStore* region_store,
+            int fsync_interval_ms = 10, uint64_t checkpoint_bytes = 64ull * 1024ull * 1024ull);
+    ~EditLog();
+
+    // возвращает seq записи; запись станет durable после ближайшего group commit
+    uint64_t append(const std::vector<ChunkEdit>& edits);
+    // правка всего чанка
+    uint64_t append_snapshot(uint64_t chunk_key, const std::vector<Voxel>& voxels);
+
+    // false - запись не durable: лог остановлен или group commit после начала ожидания не удался (см. io_error)
+    bool wait_durable(uint64_t seq);
+    uint64_t durable_seq() const { return durable_seq_.load(std::memory_order_acquire); }
+    // пусто, пока запись на диск идёт без ошибок; неудачный group commit повторяется в новом сегменте
+    std::string io_error();
+    uint64_t last_seq() const { return last_seq_.load(std::memory_order_relaxed); }
+
+    // Проигрывает хвост лога, оставшийся с прошлого запуска: параллельно по чанкам,
+    // результат уходит в region_store (и в уже загруженные чанки voxel_grid).
+    // Звать до первого append. Возвращает число применённых записей.
+    size_t replay(VoxelGrid& voxel_grid);
+
+    void checkpoint_now();
+
+    static uint32_t crc32(const uint8_t* data, size_t size);
+
+private:
+    RegionStore* region_store = nullptr;
+
+    std::mutex mx;
+    std::condition_variable flush_cv;
+    std::condition_variable durable_cv;
+    std::vector<uint8_t> buffer;      // ещё не записанные записи
+    uint64_t buffer_last_seq = 0;
+    bool rotate_requested = false;
+    std::string io_error_;
+    uint64_t io_error_count_ = 0;
+
+    std::atomic<uint64_t> last_seq_{0};
+    std::atomic<uint64_t> durable_seq_{0};
+
+    std::FILE* segment_file = nullptr; // nullptr - сегмент не открылся, flush поток повторит
+    uint64_t segment_index = 0;
+    uint64_t segment_bytes = 0;
+    std::vector<std::filesystem::path> old_segments; // с прошлого запуска, ждут replay
+
+    std::mutex checkpoint_mx;
+    std::condition_variable checkpoint_cv;
+    std::deque<std::filesystem::path> segments_to_checkpoint;
+
+    std::thread flush_thread;
+    std::thread checkpoint_thread;
+    std::atomic<bool> running{false};
+
+    std::filesystem::path segment_path(uint64_t index) const;
+    bool open_segment(uint64_t index);
+    // под flush потоком
+    void rotate_segment();
+    void close_segment();
+    bool write_segment(const std::vector<uint8_t>& data);
+    void set_io_error(const std::string& message);
+
+    void flush_loop();
+    void checkpoint_loop();
+
+    struct RecordRef {
+        size_t offset; // начало payload в данных сегмента
+        size_t size;
+        uint64_t seq;
+    };
+    static bool read_segment(const std::filesystem::path& path, std::vector<uint8_t>& data,
+                             std::vector<RecordRef>& records);
+};
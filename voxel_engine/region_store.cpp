@@ -0,0 +1,579 @@
+#include "region_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+static void write_varint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80u) {
+        out.push_back((uint8_t)(v | 0x80u));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static bool read_varint(const uint8_t* data, size_t size, size_t& pos, uint32_t& v) {
+    v = 0;
+    uint32_t shift = 0;
+    while (pos < size && shift < 35) {
+        uint8_t b = data[pos++];
+        v |= (uint32_t)(b & 0x7Fu) << shift;
+        if ((b & 0x80u) == 0u) return true;
+        shift += 7;
+    }
+    return false;
+}
+
+// начало payload: заголовок и таблица
+static constexpr uint64_t REGION_DATA_START = sizeof(RegionStore::RegionHeader) + sizeof(RegionStore::Entry) * RegionStore::REGION_CHUNKS;
+
+// fstream не делает fsync, а без него запись может потеряться при падении ОС
+static bool sync_file(const std::filesystem::path& path) {
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    return true;
+#endif
+}
+
+RegionStore::MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (data) ::munmap((void*)data, size);
+#else
+    delete[] data;
+#endif
+}
+
+RegionStore::RegionStore(const std::filesystem::path& directory, glm::ivec3 chunk_size) {
+    this->directory = directory;
+    this->chunk_size = chunk_size;
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        std::string message = "RegionStore: failed to create directory " + directory.string();
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
+    io_thread_running = true;
+    io_thread = std::thread(&RegionStore::io_worker_loop, this);
+}
+
+RegionStore::~RegionStore() {
+    {
+        std::lock_guard<std::mutex> lk(writes_mx);
+        io_thread_running = false;
+    }
+    writes_cv.notify_all();
+
+    if (io_thread.joinable())
+        io_thread.join();
+}
+
+glm::ivec3 RegionStore::region_of(glm::ivec3 chunk_pos) {
+    return {
+        math_utils::floor_div(chunk_pos.x, REGION_SIZE),
+        math_utils::floor_div(chunk_pos.y, REGION_SIZE),
+        math_utils::floor_div(chunk_pos.z, REGION_SIZE),
+    };
+}
+
+uint32_t RegionStore::entry_index(glm::ivec3 chunk_pos) {
+    uint32_t lx = (uint32_t)math_utils::floor_mod(chunk_pos.x, REGION_SIZE);
+    uint32_t ly = (uint32_t)math_utils::floor_mod(chunk_pos.y, REGION_SIZE);
+    uint32_t lz = (uint32_t)math_utils::floor_mod(chunk_pos.z, REGION_SIZE);
+    return lx + (uint32_t)REGION_SIZE * (ly + (uint32_t)REGION_SIZE * lz);
+}
+
+std::filesystem::path RegionStore::region_path(glm::ivec3 region_pos) const {
+    return directory / ("r." + std::to_string(region_pos.x) + "." + std::to_string(region_pos.y) + "." + std::to_string(region_pos.z) + ".vxr");
+}
+
+void RegionStore::encode_voxels(const std::vector<Voxel>& voxels, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < voxels.size()) {
+        const Voxel& v = voxels[i];
+        uint32_t run = 1;
+        while (i + run < voxels.size() &&
+               voxels[i + run].visible == v.visible &&
+               voxels[i + run].color == v.color)
+            run++;
+
+        write_varint(out, run);
+        out.push_back(v.visible ? 1u : 0u);
+        size_t at = out.size();
+        out.resize(at + sizeof(float) * 3);
+        std::memcpy(out.data() + at, &v.color.x, sizeof(float));
+        std::memcpy(out.data() + at + sizeof(float), &v.color.y, sizeof(float));
+        std::memcpy(out.data() + at + sizeof(float) * 2, &v.color.z, sizeof(float));
+
+        i += run;
+    }
+}
+
+bool RegionStore::decode_voxels(const uint8_t* data, size_t size, uint32_t count, std::vector<Voxel>& out) {
+    out.clear();
+    out.reserve(count);
+    size_t pos = 0;
+    while (pos < size && out.size() < count) {
+        uint32_t run;
+        if (!read_varint(data, size, pos, run)) return false;
+        if (pos + 1 + sizeof(float) * 3 > size) return false;
+
+        Voxel v;
+        v.visible = data[pos] != 0;
+        std::memcpy(&v.color.x, data + pos + 1, sizeof(float));
+        std::memcpy(&v.color.y, data + pos + 1 + sizeof(float), sizeof(float));
+        std::memcpy(&v.color.z, data + pos + 1 + sizeof(float) * 2, sizeof(float));
+        pos += 1 + sizeof(float) * 3;
+
+        if (out.size() + run > count) return false;
+        out.insert(out.end(), run, v);
+    }
+    return out.size() == count;
+}
+
+RegionStore::Region* RegionStore::get_region(glm::ivec3 region_pos) {
+    uint64_t region_key = math_utils::pack_key(region_pos.x, region_pos.y, region_pos.z);
+    auto it = regions.find(region_key);
+    if (it != regions.end())
+        return it->second.get(); // nullptr - файл битый, уже сообщали
+
+    auto region = std::make_unique<Region>();
+    region->path = region_path(region_pos);
+    region->table.assign(REGION_CHUNKS, Entry{0, 0, 0});
+
+    std::error_code ec;
+    if (std::filesystem::exists(region->path, ec)) {
+        std::ifstream in(region->path, std::ios::binary);
+        RegionHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(RegionHeader));
+        in.read(reinterpret_cast<char*>(region->table.data()), sizeof(Entry) * REGION_CHUNKS);
+
+        if (!in || header.magic != MAGIC || header.version != VERSION ||
+            header.region_size != (uint32_t)REGION_SIZE ||
+            header.chunk_size[0] != chunk_size.x || header.chunk_size[1] != chunk_size.y || header.chunk_size[2] != chunk_size.z) {
+            // зовётся из gen воркеров - исключение здесь завершило бы программу.
+            // Чанки региона считаем отсутствующими (будут сгенерированы), файл не трогаем
+            std::cout << "RegionStore: bad region file " << region->path.string() << ", treating its chunks as absent" << std::endl;
+            regions.emplace(region_key, nullptr);
+            return nullptr;
+        }
+        region->file_end = (uint64_t)std::filesystem::file_size(region->path, ec);
+        for (const Entry& entry : region->table)
+            if (entry.offset != 0) region->live_bytes += entry.size;
+    }
+    // если файла нет — кэшируем пустую таблицу (file_end = 0), чтобы не дёргать ФС на каждый чанк,
+    // сам файл создаст I/O поток при первой записи
+
+    Region* raw = region.get();
+    regions.emplace(region_key, std::move(region));
+    return raw;
+}
+
+std::shared_ptr<RegionStore::MappedFile> RegionStore::map_region(Region& region) {
+    if (region.map && region.map->size >= region.file_end)
+        return region.map;
+
+    auto map = std::make_shared<MappedFile>();
+#if !defined(_WIN32)
+    int fd = ::open(region.path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* ptr = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) return nullptr;
+
+    map->data = static_cast<const uint8_t*>(ptr);
+    map->size = (size_t)st.st_size;
+#else
+    std::ifstream in(region.path, std::ios::binary | std::ios::ate);
+    if (!in) return nullptr;
+    size_t size = (size_t)in.tellg();
+    uint8_t* buffer = new uint8_t[size];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer), size);
+    map->data = buffer;
+    map->size = size;
+#endif
+
+    region.map = map;
+    return map;
+}
+
+std::shared_ptr<std::vector<Voxel>> RegionStore::load(uint64_t chunk_key) {
+    {
+        // ещё не записанная версия новее той, что на диске
+        std::lock_guard<std::mutex> lk(writes_mx);
+        auto it = pending.find(chunk_key);
+        if (it != pending.end())
+            return std::make_shared<std::vector<Voxel>>(*it->second.voxels);
+
+        auto flight_it = in_flight.find(chunk_key);
+        if (flight_it != in_flight.end())
+            return std::make_shared<std::vector<Voxel>>(*flight_it->second);
+    }
+
+    glm::ivec3 chunk_pos = math_utils::unpack_key(chunk_key);
+    Entry entry;
+    std::shared_ptr<MappedFile> map;
+    {
+        std::lock_guard<std::mutex> lk(regions_mx);
+        Region* region = get_region(region_of(chunk_pos));
+        if (!region)
+            return nullptr;
+        entry = region->table[entry_index(chunk_pos)];
+        if (entry.offset == 0)
+            return nullptr;
+        map = map_region(*region);
+    }
+
+    if (!map || entry.offset + entry.size > map->size) {
+        std::cout << "RegionStore::load: chunk payload is out of file bounds" << std::endl;
+        return nullptr;
+    }
+
+    // распаковка вне лока — mmap живёт, пока жив shared_ptr
+    auto voxels = std::make_shared<std::vector<Voxel>>();
+    if (!decode_voxels(map->data + entry.offset, entry.size, entry.count, *voxels)) {
+        std::cout << "RegionStore::load: corrupted chunk payload" << std::endl;
+        return nullptr;
+    }
+    return voxels;
+}
+
+void RegionStore::enqueue_write(uint64_t chunk_key, std::shared_ptr<const std::vector<Voxel>> voxels, uint64_t seq) {
+    if (!voxels) return;
+    {
+        std::lock_guard<std::mutex> lk(writes_mx);
+        PendingWrite& write = pending[chunk_key];
+        // новый снапшот содержит и правки старого - ждёт самую позднюю из них
+        write.seq = std::max(write.seq, seq);
+        write.voxels = std::move(voxels);
+    }
+    writes_cv.notify_one();
+}
+
+void RegionStore::set_durable_seq(uint64_t seq) {
+    {
+        std::lock_guard<std::mutex> lk(writes_mx);
+        if (seq <= durable_seq) return;
+        durable_seq = seq;
+    }
+    writes_cv.notify_one();
+}
+
+void RegionStore::discard_undurable_writes() {
+    size_t discarded = 0;
+    {
+        std::lock_guard<std::mutex> lk(writes_mx);
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.seq > durable_seq) {
+                it = pending.erase(it);
+                discarded++;
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (discarded != 0)
+        std::cout << "RegionStore: discarded " << discarded << " chunks with edits that never became durable in the log" << std::endl;
+    flushed_cv.notify_all();
+}
+
+size_t RegionStore::count_ready_writes() {
+    size_t ready = 0;
+    for (auto& item : pending)
+        if (item.second.seq <= durable_seq) ready++;
+    return ready;
+}
+
+bool RegionStore::flush() {
+    std::unique_lock<std::mutex> lk(writes_mx);
+    uint64_t failures = write_failures;
+    flush_requested = true;
+    writes_cv.notify_one();
+    // снапшоты с ещё не durable правками ждут лог: flush вернётся, когда они запишутся
+    // или будут выброшены discard_undurable_writes()
+    flushed_cv.wait(lk, [&]{ return (pending.empty() && in_flight.empty()) || write_failures != failures; });
+    return write_failures == failures;
+}
+
+size_t RegionStore::pending_writes() {
+    std::lock_guard<std::mutex> lk(writes_mx);
+    return pending.size() + in_flight.size();
+}
+
+void RegionStore::io_worker_loop() {
+    std::vector<std::pair<uint64_t, PendingWrite>> batch;
+    std::vector<size_t> failed;
+    bool retry_later = false;
+
+    while (true) {
+        batch.clear();
+        failed.clear();
+        {
+            std::unique_lock<std::mutex> lk(writes_mx);
+            // после ошибки не повторяем сразу, даже если очередь полная, - ждём интервал или flush.
+            // Снапшоты, чьи правки ещё не durable в логе, не считаются - их будит set_durable_seq
+            writes_cv.wait_for(lk, std::chrono::milliseconds(write_interval_ms), [&]{
+                if (!io_thread_running) return true;
+                size_t ready = count_ready_writes();
+                return (flush_requested && ready != 0) || (!retry_later && ready >= write_batch_size);
+            });
+            retry_later = false;
+
+            if (pending.empty()) {
+                flush_requested = false;
+                flushed_cv.notify_all();
+                if (!io_thread_running) break;
+                continue;
+            }
+
+            // при flush/остановке забираем всё готовое, иначе — пачку
+            bool take_all = flush_requested || !io_thread_running;
+            for (auto it = pending.begin(); it != pending.end() && (take_all || batch.size() < write_batch_size);) {
+                if (it->second.seq > durable_seq) {
+                    ++it;
+                    continue;
+                }
+                in_flight[it->first] = it->second.voxels;
+                batch.emplace_back(it->first, std::move(it->second));
+                it = pending.erase(it);
+            }
+
+            if (batch.empty()) {
+                // всё ждёт лог; при остановке EditLog уже не продвинется
+                if (!io_thread_running) {
+                    std::cout << "RegionStore: " << pending.size() << " chunks with edits not durable in the log were not written on shutdown" << std::endl;
+                    pending.clear();
+                    flushed_cv.notify_all();
+                    break;
+                }
+                continue;
+            }
+        }
+
+        write_batch(batch, failed);
+
+        {
+            std::lock_guard<std::mutex> lk(writes_mx);
+            for (auto& item : batch) {
+                auto it = in_flight.find(item.first);
+                if (it != in_flight.end() && it->second == item.second.voxels)
+                    in_flight.erase(it);
+            }
+
+            if (!failed.empty()) {
+                // незаписанные чанки возвращаются в очередь, если за это время не пришла версия новее
+                for (size_t i : failed)
+                    pending.emplace(batch[i].first, batch[i].second);
+                write_failures++;
+                retry_later = true;
+                flush_requested = false;
+                flushed_cv.notify_all();
+
+                if (!io_thread_running) {
+                    std::cout << "RegionStore: " << pending.size() << " chunks were not written on shutdown" << std::endl;
+                    pending.clear();
+                    break;
+                }
+            } else if (pending.empty() && in_flight.empty()) {
+                flush_requested = false;
+                flushed_cv.notify_all();
+            }
+        }
+    }
+}
+
+bool RegionStore::write_batch(std::vector<std::pair<uint64_t, PendingWrite>>& batch, std::vector<size_t>& failed) {
+    // группируем по регионам, чтобы открыть каждый файл один раз
+    std::unordered_map<uint64_t, std::vector<size_t>> by_region;
+    for (size_t i = 0; i < batch.size(); i++) {
+        glm::ivec3 region_pos = region_of(math_utils::unpack_key(batch[i].first));
+        by_region[math_utils::pack_key(region_pos.x, region_pos.y, region_pos.z)].push_back(i);
+    }
+
+    std::vector<uint8_t> payload;
+    for (auto& [region_key, items] : by_region) {
+        glm::ivec3 region_pos = math_utils::unpack_key(region_key);
+
+        Region* region;
+        uint64_t file_end;
+        {
+            std::lock_guard<std::mutex> lk(regions_mx);
+            region = get_region(region_pos);
+            file_end = region ? region->file_end : 0;
+        }
+        if (!region) {
+            std::cout << "RegionStore: region file " << region_path(region_pos).string() << " is unreadable, chunks are not written" << std::endl;
+            failed.insert(failed.end(), items.begin(), items.end());
+            continue;
+        }
+
+        std::fstream out;
+        if (file_end == 0) {
+            out.open(region->path, std::ios::binary | std::ios::out | std::ios::trunc);
+            RegionHeader header{MAGIC, VERSION, {chunk_size.x, chunk_size.y, chunk_size.z}, (uint32_t)REGION_SIZE};
+            std::vector<Entry> empty_table(REGION_CHUNKS, Entry{0, 0, 0});
+            out.write(reinterpret_cast<const char*>(&header), sizeof(RegionHeader));
+            out.write(reinterpret_cast<const char*>(empty_table.data()), sizeof(Entry) * REGION_CHUNKS);
+            out.close();
+            if (out.fail()) {
+                std::cout << "RegionStore: failed to create " << region->path.string() << std::endl;
+                failed.insert(failed.end(), items.begin(), items.end());
+                continue;
+            }
+            file_end = REGION_DATA_START;
+        }
+
+        out.open(region->path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!out) {
+            std::cout << "RegionStore: failed to open " << region->path.string() << " for writing" << std::endl;
+            failed.insert(failed.end(), items.begin(), items.end());
+            continue;
+        }
+
+        std::vector<std::pair<uint32_t, Entry>> new_entries;
+        new_entries.reserve(items.size());
+
+        // payload дописываем в конец, старые версии остаются мусором в файле
+        out.seekp((std::streamoff)file_end);
+        for (size_t i : items) {
+            const auto& voxels = *batch[i].second.voxels;
+            encode_voxels(voxels, payload);
+            out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+            Entry entry{file_end, (uint32_t)payload.size(), (uint32_t)voxels.size()};
+            new_entries.emplace_back(entry_index(math_utils::unpack_key(batch[i].first)), entry);
+            file_end += payload.size();
+            bytes_written_.fetch_add(payload.size(), std::memory_order_relaxed);
+        }
+        out.flush();
+        // ОС может сбросить страницы в любом порядке: без fsync между ними таблица могла бы
+        // попасть на диск раньше payload и после падения ссылаться на мусор
+        if (!out || !sync_file(region->path)) {
+            std::cout << "RegionStore: failed to write chunk data to " << region->path.string() << std::endl;
+            failed.insert(failed.end(), items.begin(), items.end());
+            continue;
+        }
+
+        for (auto& [idx, entry] : new_entries) {
+            out.seekp((std::streamoff)(sizeof(RegionHeader) + sizeof(Entry) * idx));
+            out.write(reinterpret_cast<const char*>(&entry), sizeof(Entry));
+        }
+        out.close();
+        // таблица на диске могла обновиться частично и ссылаться на новый payload, поэтому
+        // его место больше не занимаем; чанки будут записаны заново
+        if (out.fail() || !sync_file(region->path)) {
+            std::cout << "RegionStore: failed to write chunk table of " << region->path.string() << std::endl;
+            failed.insert(failed.end(), items.begin(), items.end());
+            std::lock_guard<std::mutex> lk(regions_mx);
+            region->file_end = file_end;
+            continue;
+        }
+
+        bool compact;
+        {
+            std::lock_guard<std::mutex> lk(regions_mx);
+            for (auto& [idx, entry] : new_entries) {
+                if (region->table[idx].offset != 0) region->live_bytes -= region->table[idx].size;
+                region->live_bytes += entry.size;
+                region->table[idx] = entry;
+            }
+            region->file_end = file_end;
+
+            uint64_t dead = region->file_end - REGION_DATA_START - region->live_bytes;
+            compact = dead >= compact_min_dead_bytes && dead > compact_dead_ratio * (region->file_end - REGION_DATA_START);
+        }
+        chunks_written_.fetch_add(items.size(), std::memory_order_relaxed);
+
+        // чанки уже записаны, неудачное сжатие только оставляет мусор до следующей попытки
+        if (compact)
+            compact_region(*region);
+    }
+    return failed.empty();
+}
+
+bool RegionStore::compact_region(Region& region) {
+    // таблицу меняет только I/O поток, копия под локом не устареет
+    std::vector<Entry> table;
+    std::shared_ptr<MappedFile> map;
+    uint64_t old_end;
+    {
+        std::lock_guard<std::mutex> lk(regions_mx);
+        table = region.table;
+        old_end = region.file_end;
+        map = map_region(region);
+    }
+    if (!map || map->size < old_end) {
+        std::cout << "RegionStore: failed to map " << region.path.string() << " for compaction" << std::endl;
+        return false;
+    }
+
+    std::vector<Entry> new_table(REGION_CHUNKS, Entry{0, 0, 0});
+    uint64_t new_end = REGION_DATA_START;
+    for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+        if (table[i].offset == 0) continue;
+        new_table[i] = Entry{new_end, table[i].size, table[i].count};
+        new_end += table[i].size;
+    }
+
+    // новый файл пишется рядом и подменяет старый rename'ом: до него на диске цел старый, после - полный новый.
+    // Читатели со старым mmap дочитывают старый файл
+    std::filesystem::path tmp_path = region.path;
+    tmp_path += ".compact";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    RegionHeader header{MAGIC, VERSION, {chunk_size.x, chunk_size.y, chunk_size.z}, (uint32_t)REGION_SIZE};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(RegionHeader));
+    out.write(reinterpret_cast<const char*>(new_table.data()), sizeof(Entry) * REGION_CHUNKS);
+    for (uint32_t i = 0; i < REGION_CHUNKS; i++) {
+        if (table[i].offset == 0) continue;
+        out.write(reinterpret_cast<const char*>(map->data + table[i].offset), table[i].size);
+    }
+    out.close();
+
+    std::error_code ec;
+    if (out.fail() || !sync_file(tmp_path)) {
+        std::cout << "RegionStore: failed to write compacted " << tmp_path.string() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    std::filesystem::rename(tmp_path, region.path, ec);
+    if (ec) {
+        std::cout << "RegionStore: failed to replace " << region.path.string() << " with its compacted copy" << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    sync_file(directory); // запись в каталоге о rename
+
+    {
+        std::lock_guard<std::mutex> lk(regions_mx);
+        region.table = std::move(new_table);
+        region.file_end = new_end;
+        region.map = nullptr; // старый mmap длиннее нового файла, map_region его бы не заменил
+    }
+    regions_compacted_.fetch_add(1, std::memory_order_relaxed);
+    bytes_reclaimed_.fetch_add(old_end - new_end, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "voxel.h"
+#include "../math_utils.h"
+
+// Хранилище чанков на диске.
+// Чанки группируются в регионы REGION_SIZE^3, один регион = один файл:
+//   [RegionHeader][Entry table[REGION_SIZE^3]][payloads...]
+// payload — RLE по вокселям. Новые версии чанка дописываются в конец файла,
+// в таблице обновляется только offset/size. Когда мёртвых (перезаписанных) байт в регионе
+// становится больше compact_dead_ratio, I/O поток переписывает его файл заново.
+// Чтение через mmap, запись — пачками на отдельном I/O потоке.
+// С EditLog снапшот помечается seq правки и пишется только после того, как она стала durable в логе:
+// иначе после падения регион содержал бы правку, которой нет в логе, и replay проиграл бы поверх неё старые.
+class RegionStore {
+public:
+    static constexpr int REGION_SIZE = 32;
+    static constexpr uint32_t REGION_CHUNKS = REGION_SIZE * REGION_SIZE * REGION_SIZE;
+    static constexpr uint32_t MAGIC = 0x47525856u; // "VXRG"
+    static constexpr uint32_t VERSION = 1u;
+
+    struct RegionHeader {
+        uint32_t magic;
+        uint32_t version;
+        int32_t chunk_size[3];
+        uint32_t region_size;
+    };
+
+    struct Entry {
+        uint64_t offset;     // 0 — чанка нет
+        uint32_t size;       // байт payload
+        uint32_t count;      // вокселей после распаковки
+    };
+
+    std::filesystem::path directory;
+    glm::ivec3 chunk_size;
+    size_t write_batch_size = 256;   // сколько чанков I/O поток пишет за раз
+    int write_interval_ms = 500;     // как часто будить I/O поток без flush
+    float compact_dead_ratio = 0.5f;           // доля мёртвых байт payload, после которой регион сжимается
+    uint64_t compact_min_dead_bytes = 1u << 20; // маленькие регионы не сжимаем
+
+    RegionStore(const std::filesystem::path& directory, glm::ivec3 chunk_size);
+    ~RegionStore();
+
+    // потокобезопасно, можно звать из gen воркеров
+    std::shared_ptr<std::vector<Voxel>> load(uint64_t chunk_key);
+
+    // ставит последний снапшот чанка в очередь на запись; seq - последняя правка лога в снапшоте (0 - без лога)
+    void enqueue_write(uint64_t chunk_key, std::shared_ptr<const std::vector<Voxel>> voxels, uint64_t seq = 0);
+    // EditLog: правки до seq включительно durable, их снапшоты можно писать
+    void set_durable_seq(uint64_t seq);
+    // EditLog остановлен: снапшоты с правками, не ставшими durable, уже не запишутся - выбросить
+    void discard_undurable_writes();
+    // блокирует до тех пор, пока очередь не будет записана.
+    // false - запись не удалась, незаписанные чанки остались в очереди и будут повторены
+    bool flush();
+
+    size_t pending_writes();
+    uint64_t bytes_written() const { return bytes_written_.load(std::memory_order_relaxed); }
+    uint64_t chunks_written() const { return chunks_written_.load(std::memory_order_relaxed); }
+    uint64_t regions_compacted() const { return regions_compacted_.load(std::memory_order_relaxed); }
+    uint64_t bytes_reclaimed() const { return bytes_reclaimed_.load(std::memory_order_relaxed); }
+
+    static void encode_voxels(const std::vector<Voxel>& voxels, std::vector<uint8_t>& out);
+    static bool decode_voxels(const uint8_t* data, size_t size, uint32_t count, std::vector<Voxel>& out);
+
+    static glm::ivec3 region_of(glm::ivec3 chunk_pos);
+    static uint32_t entry_index(glm::ivec3 chunk_pos);
+
+private:
+    struct MappedFile {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        ~MappedFile();
+    };
+
+    struct Region {
+        std::filesystem::path path;
+        std::vector<Entry> table;
+        uint64_t file_end = 0;
+        uint64_t live_bytes = 0; // сумма size по таблице, остальное после таблицы - мусор
+        std::shared_ptr<MappedFile> map; // пересоздаётся, если файл вырос
+    };
+
+    std::mutex regions_mx;
+    std::unordered_map<uint64_t, std::unique_ptr<Region>> regions;
+
+    std::mutex writes_mx;
+    std::condition_variable writes_cv;
+    std::condition_variable flushed_cv;
+    struct PendingWrite {
+        std::shared_ptr<const std::vector<Voxel>> voxels;
+        uint64_t seq = 0;
+    };
+
+    std::unordered_map<uint64_t, PendingWrite> pending;
+    std::unordered_map<uint64_t, std::shared_ptr<const std::vector<Voxel>>> in_flight; // пишутся прямо сейчас
+    bool flush_requested = false;
+    uint64_t write_failures = 0; // число неудачных пачек, под writes_mx
+    uint64_t durable_seq = 0;    // под writes_mx
+
+    std::thread io_thread;
+    std::atomic<bool> io_thread_running{false};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> chunks_written_{0};
+    std::atomic<uint64_t> regions_compacted_{0};
+    std::atomic<uint64_t> bytes_reclaimed_{0};
+
+    std::filesystem::path region_path(glm::ivec3 region_pos) const;
+    Region* get_region(glm::ivec3 region_pos); // под regions_mx; nullptr - файл региона битый или чужой
+    std::shared_ptr<MappedFile> map_region(Region& region);  // под regions_mx
+
+    void io_worker_loop();
+    size_t count_ready_writes(); // под writes_mx: pending, которые уже можно писать
+    // индексы незаписанных элементов batch - в failed
+    bool write_batch(std::vector<std::pair<uint64_t, PendingWrite>>& batch, std::vector<size_t>& failed);
+    // только I/O поток: переписывает файл региона без мёртвых payload
+    bool compact_region(Region& region);
+};
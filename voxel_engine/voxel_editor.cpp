@@ -1,7 +1,19 @@
 #include "voxel_editor.h"
 #include "voxel_grid.h"
+#include <algorithm>
 
 void VoxelEditor::update_and_schedule() {
+    EditJournal* journal = voxel_grid->edit_journal;
+    EditLog* edit_log = voxel_grid->edit_log;
+    bool own_batch = journal && !journal->batch_open();
+    if (own_batch) journal->begin_batch();
+
+    std::vector<uint32_t> journal_ids;
+    std::vector<Voxel> journal_prev;
+    std::vector<Voxel> journal_next;
+    std::vector<EditLog::ChunkEdit> log_edits;
+    std::vector<uint64_t> dirty_keys;
+
     for (auto chunk_map_it = edited_voxels.begin(); chunk_map_it != edited_voxels.end();) {
         uint64_t chunk_key = chunk_map_it->first;
         glm::ivec3 chunk_pos = math_utils::unpack_key(chunk_key);
@@ -16,6 +28,28 @@ void VoxelEditor::update_and_schedule() {
         
         Chunk* chunk_to_edit = this->voxel_grid->chunks[chunk_key];
 
+        if (journal || edit_log) {
+            // журналу и логу нужны отсортированные id и значения до/после
+            auto& voxel_map = chunk_map_it->second;
+            journal_ids.clear();
+            journal_ids.reserve(voxel_map.size());
+            for (auto& kv : voxel_map)
+                journal_ids.push_back(kv.first);
+            std::sort(journal_ids.begin(), journal_ids.end());
+
+            auto cur = std::atomic_load(&chunk_to_edit->voxels);
+            journal_prev.clear();
+            journal_next.clear();
+            for (uint32_t id : journal_ids) {
+                journal_prev.push_back((*cur)[id]);
+                journal_next.push_back(voxel_map[id]);
+            }
+            if (journal)
+                journal->record_voxels(chunk_key, journal_ids, journal_prev, journal_next);
+            if (edit_log)
+                log_edits.push_back(EditLog::ChunkEdit{chunk_key, journal_ids, journal_next});
+        }
+
         chunk_to_edit->edit_voxels([&](std::vector<Voxel>& voxels){
             auto& voxel_map = chunk_map_it->second;
 
@@ -29,6 +63,8 @@ void VoxelEditor::update_and_schedule() {
             }
         });
 
+        dirty_keys.push_back(chunk_key);
+
         voxel_grid->chunks_to_update.insert(chunk_key);
         voxel_grid->chunks_to_update.insert(math_utils::pack_key(chunk_pos.x-1, chunk_pos.y, chunk_pos.z)); // left
         voxel_grid->chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z-1)); // back
@@ -39,6 +75,12 @@ void VoxelEditor::update_and_schedule() {
 
         chunk_map_it = edited_voxels.erase(chunk_map_it);
     }
+
+    if (own_batch) journal->commit_batch();
+    // весь батч — одна запись лога; снапшоты чанков region_store запишет только после неё
+    uint64_t seq = edit_log ? edit_log->append(log_edits) : 0;
+    for (uint64_t key : dirty_keys)
+        voxel_grid->mark_chunk_dirty(key, seq);
 }
 
 void VoxelEditor::set(glm::ivec3 pos, const Voxel& voxel) {
@@ -70,6 +112,23 @@ void VoxelEditor::set(glm::ivec3 pos, const Voxel& voxel) {
     // edited_voxels[chunk_key][local_voxel_key] = voxel;
 }
 
+void VoxelEditor::set_chunk(glm::ivec3 chunk_pos, const std::vector<uint32_t>& local_ids, const std::vector<Voxel>& voxels) {
+    uint64_t chunk_key = math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z);
+    uint32_t count_chunk_voxels = (uint32_t)(voxel_grid->chunk_size.x * voxel_grid->chunk_size.y * voxel_grid->chunk_size.z);
+
+    auto [it, inserted] = edited_voxels.try_emplace(chunk_key);
+    auto& voxel_map = it->second;
+    voxel_map.reserve(voxel_map.size() + local_ids.size());
+
+    for (size_t i = 0; i < local_ids.size(); i++) {
+        if (local_ids[i] >= count_chunk_voxels) {
+            std::cout << "BAD LOCAL ID: " << local_ids[i] << " chunk=(" << chunk_pos.x << "," << chunk_pos.y << "," << chunk_pos.z << ")\n";
+            std::abort();
+        }
+        voxel_map[local_ids[i]] = voxels[i];
+    }
+}
+
 Voxel VoxelEditor::get(glm::ivec3 pos) const{
     glm::ivec3 chunk_pos = VoxelGrid::get_chunk_pos(pos, voxel_grid->chunk_size);
     uint64_t chunk_key = math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z);
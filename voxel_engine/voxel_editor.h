@@ -10,6 +10,7 @@
 #include <atomic>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 #include "voxel.h"
 
 class VoxelGrid;
@@ -30,6 +31,8 @@ public:
     void edit_chunk(glm::ivec3 chunk_pos);
 
     void set(glm::ivec3 pos, const Voxel& voxel);
+    // пачка вокселей одного чанка по local id, без пересчёта ключа на каждый воксель
+    void set_chunk(glm::ivec3 chunk_pos, const std::vector<uint32_t>& local_ids, const std::vector<Voxel>& voxels);
     Voxel get(glm::ivec3 pos) const;
 
     static glm::ivec3 unpack_local_id(uint32_t id, glm::ivec3 chunk_size){
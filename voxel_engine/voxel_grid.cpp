@@ -1,4 +1,5 @@
 #include "voxel_grid.h"
+#include <algorithm>
 
 VoxelGrid::VoxelGrid(glm::ivec3 chunk_size, float voxel_size, glm::ivec3 chunk_render_size) {
     this->chunk_render_size = chunk_render_size;
@@ -248,7 +249,12 @@ void VoxelGrid::gen_worker_loop() {
 
         gen_result.cpos = gen_job.cpos;
         gen_result.key = gen_job.key;
-        gen_result.voxels = generate_chunk(gen_job.cpos, gen_job.chunk_size);
+        // сохранённый чанк с диска дешевле генерации
+        if (region_store)
+            gen_result.voxels = region_store->load(gen_job.key);
+        gen_result.from_store = gen_result.voxels != nullptr;
+        if (!gen_result.voxels)
+            gen_result.voxels = generate_chunk(gen_job.cpos, gen_job.chunk_size);
 
         {
             std::unique_lock<std::mutex> lk(gen_results_mx);
@@ -284,6 +290,9 @@ void VoxelGrid::drain_gen_results() {
         Chunk* chunk = it->second;
 
         chunk->update_voxels(r.voxels);
+        if (region_store && store_generated_chunks && !r.from_store)
+            region_store->enqueue_write(r.key, r.voxels);
+
         chunks_to_update.insert(r.key);
         chunks_to_update.insert(math_utils::pack_key(r.cpos.x-1, r.cpos.y, r.cpos.z)); // left
         chunks_to_update.insert(math_utils::pack_key(r.cpos.x, r.cpos.y, r.cpos.z-1)); // back
@@ -294,6 +303,17 @@ void VoxelGrid::drain_gen_results() {
     }
 }
 
+void VoxelGrid::mark_chunk_dirty(uint64_t key, uint64_t seq) {
+    if (!region_store)
+        return;
+
+    auto it = chunks.find(key);
+    if (it == chunks.end())
+        return;
+
+    region_store->enqueue_write(key, std::atomic_load(&it->second->voxels), seq);
+}
+
 bool VoxelGrid::is_voxel_free(glm::ivec3 pos) {
     int cx = pos.x / chunk_size.x + (pos.x % chunk_size.x < 0 ? -1 : 0);
     int cy = pos.y / chunk_size.y + (pos.y % chunk_size.y < 0 ? -1 : 0);
@@ -319,32 +339,59 @@ bool VoxelGrid::is_voxel_free(glm::ivec3 pos) {
 }
 
 void VoxelGrid::update(Window* window, Camera* camera) {
-    glm::vec3 cam_pos = camera->position;
-    glm::ivec3 center_voxel_pos = glm::ivec3(glm::floor(cam_pos / voxel_size));
-    glm::ivec3 center_chunk_pos = VoxelGrid::get_chunk_pos(center_voxel_pos, chunk_size);
-
-    // glm::ivec3 center_chunk_pos = glm::ivec3(cam_pos.x / chunk_size.x, cam_pos.y / chunk_size.y, cam_pos.z / chunk_size.z);
+    update(window, camera, StreamFocus(camera->position));
+}
 
-    glm::ivec3 front_left_bottom_chunk_pos = center_chunk_pos - chunk_render_size / 2;
-    bool to_update_mesh = false;
+void VoxelGrid::update(Window* window, Camera* camera, const StreamFocus& focus) {
+    auto box_origin = [&](const glm::vec3& pos) {
+        glm::ivec3 center_voxel_pos = glm::ivec3(glm::floor(pos / voxel_size));
+        glm::ivec3 center_chunk_pos = VoxelGrid::get_chunk_pos(center_voxel_pos, chunk_size);
+        return center_chunk_pos - chunk_render_size / 2; // front_left_bottom_chunk_pos
+    };
 
-    for (int x = 0; x < chunk_render_size.x; x++)
-        for (int y = 0; y < chunk_render_size.y; y++)
-            for (int z = 0; z < chunk_render_size.z; z++) {
-                glm::ivec3 cpos = front_left_bottom_chunk_pos + glm::ivec3(x, y, z);
-                uint64_t key = math_utils::pack_key(cpos.x, cpos.y, cpos.z);
+    // Недостающие чанки из куба вокруг камеры и куба вокруг предсказанной позиции (если она в другом чанке)
+    std::vector<glm::ivec3> missing;
+    std::unordered_set<uint64_t> seen;
 
-                auto it = chunks.find(key);
+    auto collect_missing = [&](const glm::ivec3& front_left_bottom_chunk_pos) {
+        for (int x = 0; x < chunk_render_size.x; x++)
+            for (int y = 0; y < chunk_render_size.y; y++)
+                for (int z = 0; z < chunk_render_size.z; z++) {
+                    glm::ivec3 cpos = front_left_bottom_chunk_pos + glm::ivec3(x, y, z);
+                    uint64_t key = math_utils::pack_key(cpos.x, cpos.y, cpos.z);
 
-                if (it != chunks.end())
-                    continue;
-                else {
-                    Chunk* new_chunk = new Chunk(chunk_size, {1, 1, 1});
-                    new_chunk->position = glm::vec3(cpos.x * chunk_size.x, cpos.y * chunk_size.y, cpos.z * chunk_size.z);
-                    chunks[key] = new_chunk;
-                    enqueue_gen_job(key, cpos, chunk_size);
+                    if (chunks.find(key) != chunks.end() || !seen.insert(key).second)
+                        continue;
+                    missing.push_back(cpos);
                 }
-            }
+    };
+
+    glm::ivec3 cam_origin = box_origin(focus.position);
+    glm::ivec3 predicted_origin = box_origin(focus.predicted_position);
+    collect_missing(cam_origin);
+    if (predicted_origin != cam_origin)
+        collect_missing(predicted_origin);
+
+    // очередь генерации FIFO, поэтому порядок постановки = порядок загрузки
+    if (focus.predicted_position != focus.position) {
+        glm::vec3 target = focus.predicted_position;
+        glm::vec3 chunk_world_size = glm::vec3(chunk_size) * voxel_size;
+        auto dist2 = [&](const glm::ivec3& cpos) {
+            glm::vec3 d = (glm::vec3(cpos) + 0.5f) * chunk_world_size - target;
+            return glm::dot(d, d);
+        };
+        std::sort(missing.begin(), missing.end(), [&](const glm::ivec3& a, const glm::ivec3& b) {
+            return dist2(a) < dist2(b);
+        });
+    }
+
+    for (const glm::ivec3& cpos : missing) {
+        uint64_t key = math_utils::pack_key(cpos.x, cpos.y, cpos.z);
+        Chunk* new_chunk = new Chunk(chunk_size, {1, 1, 1});
+        new_chunk->position = glm::vec3(cpos.x * chunk_size.x, cpos.y * chunk_size.y, cpos.z * chunk_size.z);
+        chunks[key] = new_chunk;
+        enqueue_gen_job(key, cpos, chunk_size);
+    }
     
     drain_gen_results();
     
@@ -383,6 +430,19 @@ void VoxelGrid::set_voxel(const Voxel& voxel, glm::ivec3 position) {
     });
 }
 
+void VoxelGrid::set_chunk_voxels(glm::ivec3 chunk_size, const std::vector<ChunkVoxels>& chunks) {
+    if (chunk_size != this->chunk_size) {
+        Gridable::set_chunk_voxels(chunk_size, chunks);
+        return;
+    }
+
+    // один батч, одна правка на чанк
+    edit_voxels([&](VoxelEditor& editor){
+        for (const ChunkVoxels& chunk : chunks)
+            editor.set_chunk(chunk.chunk_pos, chunk.local_ids, chunk.voxels);
+    });
+}
+
 // TODO
 Voxel VoxelGrid::get_voxel(glm::ivec3 position) const {
     throw std::runtime_error("VoxelGrid::get_voxel not implemented yet");
@@ -12,8 +12,12 @@
 #include <utility>
 #include "../window.h"
 #include "voxel_editor.h"
+#include "edit_journal.h"
+#include "region_store.h"
+#include "edit_log.h"
 #include "../gridable.h"
 #include "../math_utils.h"
+#include "../stream_focus.h"
 
 struct MeshJob {
     uint64_t key;
@@ -46,6 +50,7 @@ struct GenResult {
     uint64_t key;
     glm::ivec3 cpos;
     std::shared_ptr<const std::vector<Voxel>> voxels;
+    bool from_store = false;
 };
 
 class VoxelGrid;
@@ -58,6 +63,10 @@ public:
     float voxel_size;
     std::unordered_map<uint64_t, Chunk*> chunks;
     std::set<uint64_t> chunks_to_update;
+    EditJournal* edit_journal = nullptr; // если задан — правки пишутся в журнал undo/redo
+    RegionStore* region_store = nullptr; // если задан — чанки грузятся с диска, правки пишутся на диск
+    bool store_generated_chunks = false; // писать в region_store и сгенерированные чанки
+    EditLog* edit_log = nullptr; // write-ahead лог правок, должен использовать тот же region_store
     // bool placed = false;
     
     VoxelGrid(glm::ivec3 chunk_size, float voxel_size, glm::ivec3 chunk_render_size = {16, 6, 16});
@@ -86,11 +95,24 @@ public:
     void edit_chunk(glm::ivec3 chunk_pos, Chunk* chunk, F&& apply_edits) {
         uint64_t key = math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z);   
 
+        auto prev_snapshot = std::atomic_load(&chunk->voxels);
+
         chunk->edit_voxels([&](std::vector<Voxel>& voxels){
             apply_edits(voxels);
         });
 
+        if (edit_journal) {
+            // правка всего чанка — храним снапшоты, без копирования
+            bool own_batch = !edit_journal->batch_open();
+            if (own_batch) edit_journal->begin_batch();
+            edit_journal->record_snapshot(key, prev_snapshot, std::atomic_load(&chunk->voxels));
+            if (own_batch) edit_journal->commit_batch();
+        }
+
         chunks[key] = chunk;
+        uint64_t seq = edit_log ? edit_log->append_snapshot(key, *std::atomic_load(&chunk->voxels)) : 0;
+        mark_chunk_dirty(key, seq);
+
         chunks_to_update.insert(key);
         chunks_to_update.insert(math_utils::pack_key(chunk_pos.x-1, chunk_pos.y, chunk_pos.z)); // left
         chunks_to_update.insert(math_utils::pack_key(chunk_pos.x, chunk_pos.y, chunk_pos.z-1)); // back
@@ -124,6 +146,10 @@ public:
         return hash32(seed);
     }
 
+    // отдаёт последний снапшот чанка в region_store на фоновую запись;
+    // seq - запись edit_log с последней правкой чанка, раньше её durable снапшот на диск не попадёт
+    void mark_chunk_dirty(uint64_t key, uint64_t seq = 0);
+
     bool enqueue_mesh_job(uint64_t key, glm::ivec3 cpos, Chunk* chunk);
     void mesh_worker_loop();
     void drain_mesh_results();
@@ -149,7 +175,10 @@ public:
     virtual void set_voxels(const std::vector<Voxel>& voxels, const std::vector<glm::ivec3>& positions) override;
     virtual void set_voxel(const Voxel& voxel, glm::ivec3 position) override;
     virtual Voxel get_voxel(glm::ivec3 position) const override;
+    virtual void set_chunk_voxels(glm::ivec3 chunk_size, const std::vector<ChunkVoxels>& chunks) override;
 
     void update(Window* window, Camera* camera);
+    // Подгрузка с упреждением: куб чанков и вокруг камеры, и вокруг focus.predicted_position, ближние к предсказанной позиции - первыми
+    void update(Window* window, Camera* camera, const StreamFocus& focus);
     void draw(RenderState state) override;
 };
\ No newline at end of file
@@ -11,10 +11,10 @@ VoxelGridGPU::VoxelGridGPU(
     float tomb_fraction_to_rebuild,
     float eviction_bucket_shell_thickness,
     uint32_t vb_page_size_order_of_two,
-    uint32_t ib_page_size_order_of_two,
     float buddy_allocator_nodes_factor,
     float render_distance,
-    ShaderManager& shader_manager)
+    ShaderManager& shader_manager,
+    ChunkHashTableMode hash_table_mode)
  {
     assert(chunk_hash_table_size_factor >= 1.0f);
 
@@ -24,15 +24,24 @@ VoxelGridGPU::VoxelGridGPU(
     this->count_evict_buckets = count_evict_buckets;
     this->min_free_chunks = min_free_chunks;
     this->tomb_fraction_to_rebuild = tomb_fraction_to_rebuild;
+    this->hash_table_mode = hash_table_mode;
     this->eviction_bucket_shell_thickness = eviction_bucket_shell_thickness;
     this->render_distance = render_distance;
     this->shader_manager = &shader_manager;
 
     vox_per_chunk = (uint32_t)(chunk_size.x * chunk_size.y * chunk_size.z);
 
+    if (chunk_size.x > max_vertex_chunk_dim || chunk_size.y > max_vertex_chunk_dim || chunk_size.z > max_vertex_chunk_dim) {
+        std::string message = "VoxelGridGPU: chunk_size does not fit packed vertex coordinates (max " + std::to_string(max_vertex_chunk_dim) + ")";
+        std::cout << message << std::endl;
+        throw std::runtime_error(message);
+    }
+
     uint64_t raw = (uint64_t)std::ceil((double)chunk_hash_table_size_factor * (double)count_active_chunks);
     uint32_t base = (raw > UINT32_MAX) ? UINT32_MAX : (uint32_t)raw;
     this->chunk_hash_table_size = math_utils::next_pow2_u32(base);
+    if (hash_table_mode == ChunkHashTableMode::Bucketed)
+        chunk_hash_table_size = std::max(chunk_hash_table_size, HASH_TABLE_BUCKET_SLOTS);
     assert((chunk_hash_table_size & (chunk_hash_table_size - 1)) == 0);
 
     init_programs(shader_manager);
@@ -42,9 +51,9 @@ VoxelGridGPU::VoxelGridGPU(
     
     chunk_meta_ = BufferObject(sizeof(ChunkMetaGPU) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
     free_list_ = BufferObject(sizeof(uint32_t) * (size_t)(1 + count_active_chunks), GL_DYNAMIC_DRAW);
-    indirect_cmds_ = BufferObject(sizeof(uint32_t) + sizeof(DrawElementsIndirectCommand) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
+    indirect_cmds_ = BufferObject(sizeof(uint32_t) + sizeof(DrawArraysIndirectCommand) * (size_t)count_active_chunks * max_draws_per_chunk, GL_DYNAMIC_DRAW);
 
-    mesh_buffers_status_ = BufferObject::from_fill(sizeof(uint32_t) * 2, GL_DYNAMIC_DRAW, 0u, shader_manager);
+    mesh_buffers_status_ = BufferObject::from_fill(sizeof(uint32_t), GL_DYNAMIC_DRAW, 0u, shader_manager);
 
     enqueued_ = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
     dirty_list_ = BufferObject::from_fill(sizeof(uint32_t) * (size_t)(1 + count_active_chunks), GL_DYNAMIC_DRAW, 0u, shader_manager);
@@ -52,8 +61,9 @@ VoxelGridGPU::VoxelGridGPU(
 
     chunk_meta_ = BufferObject(sizeof(ChunkMetaGPU) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
 
-    dirty_quad_count_ = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
-    emit_counters_     = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
+    // по счётчику на направление грани
+    dirty_quad_count_ = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks * 6u, GL_DYNAMIC_DRAW);
+    emit_counters_     = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks * 6u, GL_DYNAMIC_DRAW);
 
     BucketHead bucket_head;
     bucket_head.id = INVALID_ID;
@@ -65,6 +75,7 @@ VoxelGridGPU::VoxelGridGPU(
     verify_debug_stack_.update_subdata_fill(0, 0u, sizeof(uint32_t) * 2, shader_manager);
 
     evicted_chunks_list_ = BufferObject::from_fill(sizeof(uint32_t) * (count_active_chunks + 1), GL_DYNAMIC_DRAW, 0u, shader_manager);
+    evict_freed_count_ = BufferObject::from_fill(sizeof(uint32_t), GL_DYNAMIC_DRAW, 0u, shader_manager);
 
     vb_page_size_ = 1 << vb_page_size_order_of_two;
     count_vb_pages_ = math_utils::next_pow2_u32(math_utils::div_up_u32((max_quads * 4u), vb_page_size_));
@@ -77,6 +88,7 @@ VoxelGridGPU::VoxelGridGPU(
     std::cout << "count_vb_nodes_: " << count_vb_nodes_ << std::endl;
     std::cout << "vb_order_: " << vb_order_ << std::endl;
     std::cout << "max_mesh_vertices_: " << max_mesh_vertices_ << std::endl;
+    std::cout << "global_vertex_buffer_ MB: " << (double)sizeof(VertexGPU) * (double)max_mesh_vertices_ / (1024.0 * 1024.0) << std::endl;
     std::cout << std::endl;
 
     global_vertex_buffer_ = BufferObject(sizeof(VertexGPU) * (size_t)max_mesh_vertices_, GL_DYNAMIC_DRAW);
@@ -86,50 +98,65 @@ VoxelGridGPU::VoxelGridGPU(
     vb_returned_nodes_list = BufferObject::from_fill(sizeof(uint32_t) * (size_t)(1u + count_vb_nodes_), GL_DYNAMIC_DRAW, 0u, shader_manager);
     vb_state_ = BufferObject(sizeof(uint32_t) * (size_t)count_vb_pages_, GL_DYNAMIC_DRAW);
 
-    ib_page_size_ = 1 << ib_page_size_order_of_two;
-    count_ib_pages_ = math_utils::next_pow2_u32(math_utils::div_up_u32((max_quads * 6u), ib_page_size_));
-    count_ib_nodes_ = ceil(count_ib_pages_ * buddy_allocator_nodes_factor);
-    ib_order_ = math_utils::log2_floor_u32(count_ib_pages_);
-    max_mesh_indices_ = count_ib_pages_ * ib_page_size_;
-
-    std::cout << "ib_page_size_: " << ib_page_size_ << std::endl;
-    std::cout << "count_ib_pages_: " << count_ib_pages_ << std::endl;
-    std::cout << "count_ib_nodes_: " << count_ib_nodes_ << std::endl;
-    std::cout << "ib_order_: " << ib_order_ << std::endl;
-    std::cout << "max_mesh_indices_: " << max_mesh_indices_ << std::endl;
-    std::cout << std::endl;
-    
-    global_index_buffer_ = BufferObject(sizeof(uint32_t) * (size_t)max_mesh_indices_, GL_DYNAMIC_DRAW);
-    ib_heads_ = BufferObject(sizeof(uint32_t) * (size_t)(ib_order_ + 1), GL_DYNAMIC_DRAW);
-    ib_nodes_ = BufferObject(sizeof(AllocNode) * (size_t)(count_ib_nodes_), GL_DYNAMIC_DRAW);
-    ib_free_nodes_list_ = BufferObject(sizeof(uint32_t) * (size_t)(1u + count_ib_nodes_), GL_DYNAMIC_DRAW);
-    ib_returned_nodes_list = BufferObject::from_fill(sizeof(uint32_t) * (size_t)(1u + count_ib_nodes_), GL_DYNAMIC_DRAW, 0u, shader_manager);
-    ib_state_ = BufferObject(sizeof(uint32_t) * (size_t)count_ib_pages_, GL_DYNAMIC_DRAW);
-
     chunk_mesh_alloc_ = BufferObject(sizeof(ChunkMeshAlloc) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
     chunk_mesh_alloc_local_ = BufferObject(sizeof(ChunkMeshAlloc) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW);
 
+    mesh_pool_stats_ = BufferObject::from_fill(sizeof(MeshPoolStatsGPU), GL_DYNAMIC_DRAW, 0u, shader_manager);
+    mesh_defrag_moves_ = BufferObject::from_fill(sizeof(uint32_t) + sizeof(MeshDefragMoveGPU) * (size_t)max_mesh_defrag_moves, GL_DYNAMIC_DRAW, 0u, shader_manager);
+
     voxel_prifab_ = BufferObject(sizeof(VoxelDataGPU), GL_DYNAMIC_DRAW);
 
     load_list_ = BufferObject(sizeof(uint32_t) * (size_t)(1 + count_active_chunks), GL_DYNAMIC_DRAW);
+    stream_state_ = BufferObject::from_fill(sizeof(StreamStateGPU) * MAX_LOD_LEVELS, GL_DYNAMIC_DRAW, 0u, shader_manager);
+    stream_shell_offsets_ = BufferObject(sizeof(glm::ivec4), GL_DYNAMIC_DRAW);
+    stream_hole_stats_ = BufferObject::from_fill(sizeof(StreamHoleStatsGPU), GL_DYNAMIC_DRAW, 0u, shader_manager);
+    chunk_last_visible_ = BufferObject::from_fill(sizeof(uint32_t) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW, 0u, shader_manager);
+
+    chunk_visible_ = BufferObject::from_fill(sizeof(uint32_t) * (size_t)count_active_chunks, GL_DYNAMIC_DRAW, 0u, shader_manager);
+    occlusion_stats_ = BufferObject::from_fill(sizeof(OcclusionStatsGPU), GL_DYNAMIC_DRAW, 0u, shader_manager);
+
+    spill_batches_.resize(count_spill_batches);
+    for (SpillBatch& batch : spill_batches_) {
+        batch.records = BufferObject::from_fill(sizeof(SpillBatchHeaderGPU) + sizeof(SpillRecordGPU) * (size_t)spill_batch_slots, GL_DYNAMIC_DRAW, 0u, shader_manager);
+        batch.voxels = BufferObject(sizeof(VoxelDataGPU) * (size_t)spill_batch_slots * vox_per_chunk, GL_DYNAMIC_DRAW);
+    }
+    restore_records_ = BufferObject(sizeof(RestoreRecordGPU) * (size_t)max_restores_per_frame, GL_DYNAMIC_DRAW);
+    restore_voxels_ = BufferObject(sizeof(VoxelDataGPU) * (size_t)max_restores_per_frame * vox_per_chunk, GL_DYNAMIC_DRAW);
 
     VoxelDataGPU voxel_prifab(0u, 0u, 0u, glm::ivec3(255));
     uint32_t count_voxels_in_chunk = chunk_size.x * chunk_size.y * chunk_size.z;
     voxels_ = BufferObject::from_fill(sizeof(VoxelDataGPU) * count_voxels_in_chunk * count_active_chunks, GL_DYNAMIC_DRAW, voxel_prifab, shader_manager);
 
     chunk_hash_keys_ = BufferObject(sizeof(glm::uvec2) * chunk_hash_table_size, GL_DYNAMIC_DRAW);
-    chunk_hash_vals_ = BufferObject(sizeof(uint32_t) * (1 + chunk_hash_table_size), GL_DYNAMIC_DRAW);
+    // Bucketed: за слотами лежат счётчики переполнения бакетов
+    uint32_t count_hash_overflow = hash_table_mode == ChunkHashTableMode::Bucketed ? chunk_hash_table_size / HASH_TABLE_BUCKET_SLOTS : 0u;
+    chunk_hash_vals_ = BufferObject(sizeof(uint32_t) * (1 + chunk_hash_table_size + count_hash_overflow), GL_DYNAMIC_DRAW);
 
     world_init_gpu();
     init_draw_buffers();
     init_mesh_pool();
 }
 
+VoxelGridGPU::~VoxelGridGPU() {
+    for (SpillBatch& batch : spill_batches_)
+        if (batch.fence) glDeleteSync(batch.fence);
+    if (restore_fence_) glDeleteSync(restore_fence_);
+}
+
 void VoxelGridGPU::draw(RenderState state) {
     state.transform *= get_model_matrix();
+    readback.poll();
+
+    if (mesh_defrag_budget > 0)
+        defrag_mesh_pool(mesh_defrag_budget);
+    build_mesh_from_dirty(CHUNK_KEY_BITS, CHUNK_KEY_OFFSET);
+
+    if (occlusion_culling) {
+        draw_occlusion_culled(state.transform, state.vp, state.camera->position, CHUNK_KEY_BITS, CHUNK_KEY_OFFSET);
+        return;
+    }
 
-    build_mesh_from_dirty(math_utils::BITS, math_utils::OFFSET);
-    build_indirect_draw_commands_frustum(state.vp, state.camera->position, math_utils::BITS, math_utils::OFFSET);
+    build_indirect_draw_commands_frustum(state.vp, state.camera->position, CHUNK_KEY_BITS, CHUNK_KEY_OFFSET);
     draw_indirect(vao.id, state.transform, state.vp, state.camera->position);
 }
 
@@ -145,12 +172,21 @@ void VoxelGridGPU::init_programs(ShaderManager& shader_manager) {
     prog_mesh_emit_ = ComputeProgram(&shader_manager.mesh_emit_cs);
     prog_mesh_finalize_ = ComputeProgram(&shader_manager.mesh_finalize_cs);
     prog_build_indirect_cmds_ = ComputeProgram(&shader_manager.build_indirect_cmds_cs);
+    prog_clear_indirect_cmds_tail_ = ComputeProgram(&shader_manager.clear_indirect_cmds_tail_cs);
     prog_reset_dirty_count_ = ComputeProgram(&shader_manager.reset_dirty_count_cs);
     prog_evict_buckets_build_ = ComputeProgram(&shader_manager.evict_buckets_build_cs);
     prog_evict_low_priority_ = ComputeProgram(&shader_manager.evict_low_priority_cs);
     prog_evict_low_priority_dispatch_adapter_ = ComputeProgram(&shader_manager.evict_low_priority_dispatch_adapter_cs);
     prog_stream_select_chunks_ = ComputeProgram(&shader_manager.stream_select_chunks_cs);
+    prog_stream_select_dispatch_adapter_ = ComputeProgram(&shader_manager.stream_select_dispatch_adapter_cs);
     prog_stream_generate_terrain_ = ComputeProgram(&shader_manager.stream_generate_terrain_cs);
+    prog_stream_hole_stats_ = ComputeProgram(&shader_manager.stream_hole_stats_cs);
+    prog_stream_restore_select_ = ComputeProgram(&shader_manager.stream_restore_select_cs);
+    prog_stream_restore_copy_ = ComputeProgram(&shader_manager.stream_restore_copy_cs);
+    prog_stream_lod_visibility_ = ComputeProgram(&shader_manager.stream_lod_visibility_cs);
+    prog_evict_spill_copy_ = ComputeProgram(&shader_manager.evict_spill_copy_cs);
+    prog_hiz_copy_depth_ = ComputeProgram(&shader_manager.hiz_copy_depth_cs);
+    prog_hiz_downsample_ = ComputeProgram(&shader_manager.hiz_downsample_cs);
     prog_mark_all_user_chunks_as_dirty_ = ComputeProgram(&shader_manager.mark_all_user_chunks_as_dirty_cs);
     prog_mesh_pool_clear_ = ComputeProgram(&shader_manager.mesh_pool_clear_cs);
     prog_mesh_pool_seed_ = ComputeProgram(&shader_manager.mesh_pool_seed_cs);
@@ -162,6 +198,10 @@ void VoxelGridGPU::init_programs(ShaderManager& shader_manager) {
     prog_clear_chunk_hash_table_ = ComputeProgram(&shader_manager.clear_chunk_hash_table_cs);
     prog_reset_evicted_list_and_buckets_ = ComputeProgram(&shader_manager.reset_evicted_list_and_buckets_cs);
     prog_hash_table_conditional_dispatch_adapter_ = ComputeProgram(&shader_manager.hash_table_conditional_dispatch_adapter_cs);
+    prog_mesh_pool_stats_ = ComputeProgram(&shader_manager.mesh_pool_stats_cs);
+    prog_mesh_pool_defrag_plan_ = ComputeProgram(&shader_manager.mesh_pool_defrag_plan_cs);
+    prog_mesh_pool_defrag_copy_ = ComputeProgram(&shader_manager.mesh_pool_defrag_copy_cs);
+    prog_mesh_pool_defrag_free_ = ComputeProgram(&shader_manager.mesh_pool_defrag_free_cs);
 
     prog_vf_voxel_mesh_diffusion_spec_ = VfProgram(&shader_manager.voxel_mesh_vs, &shader_manager.voxel_mesh_fs);
 }
@@ -180,6 +220,7 @@ void VoxelGridGPU::world_init_gpu() {
 
     prog_world_init_.use();
     glUniform1ui(glGetUniformLocation(prog_world_init_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_world_init_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform1ui(glGetUniformLocation(prog_world_init_.id, "u_max_chunks"), count_active_chunks);
 
     uint32_t maxItems = std::max(chunk_hash_table_size, count_active_chunks);
@@ -194,24 +235,16 @@ void VoxelGridGPU::init_mesh_pool() {
     vb_heads_.bind_base_as_ssbo(0);
     vb_state_.bind_base_as_ssbo(1);
     vb_free_nodes_list_.bind_base_as_ssbo(2);
-
-    ib_heads_.bind_base_as_ssbo(3);
-    ib_state_.bind_base_as_ssbo(4);
-    ib_free_nodes_list_.bind_base_as_ssbo(5);
-
-    chunk_mesh_alloc_.bind_base_as_ssbo(6);
+    chunk_mesh_alloc_.bind_base_as_ssbo(3);
 
     prog_mesh_pool_clear_.use();
 
     glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_vb_pages"), count_vb_pages_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_ib_pages"), count_ib_pages_);
     glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_vb_nodes"), count_vb_nodes_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_ib_nodes"), count_ib_nodes_);
     glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_vb_heads_count"), vb_order_ + 1);
-    glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_ib_heads_count"), ib_order_ + 1);
     glUniform1ui(glGetUniformLocation(prog_mesh_pool_clear_.id, "u_max_chunks"), count_active_chunks);
 
-    uint32_t max_count = std::max({count_vb_pages_, count_ib_pages_, count_active_chunks, count_vb_nodes_, count_ib_nodes_});
+    uint32_t max_count = std::max({count_vb_pages_, count_active_chunks, count_vb_nodes_});
     uint32_t groups_x = math_utils::div_up_u32(max_count, 256u);
     prog_mesh_pool_clear_.dispatch_compute(groups_x, 1, 1);
     
@@ -223,15 +256,9 @@ void VoxelGridGPU::init_mesh_pool() {
     vb_state_.bind_base_as_ssbo(2);
     vb_free_nodes_list_.bind_base_as_ssbo(3);
 
-    ib_heads_.bind_base_as_ssbo(4);
-    ib_nodes_.bind_base_as_ssbo(5);
-    ib_state_.bind_base_as_ssbo(6);
-    ib_free_nodes_list_.bind_base_as_ssbo(7);
-
     prog_mesh_pool_seed_.use();
 
     glUniform1ui(glGetUniformLocation(prog_mesh_pool_seed_.id, "u_vb_max_order"), vb_order_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_pool_seed_.id, "u_ib_max_order"), ib_order_);
 
     prog_mesh_pool_seed_.dispatch_compute(1, 1, 1);
 
@@ -263,6 +290,7 @@ void VoxelGridGPU::fill_chunk_hash_table(const BufferObject& dispatch_args, uint
     prog_fill_chunk_hash_table_.use();
     glUniform1ui(glGetUniformLocation(prog_fill_chunk_hash_table_.id, "u_max_chunks"), count_active_chunks);
     glUniform1ui(glGetUniformLocation(prog_fill_chunk_hash_table_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_fill_chunk_hash_table_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform1ui(glGetUniformLocation(prog_fill_chunk_hash_table_.id, "u_pack_bits"), pack_bits);
     glUniform1ui(glGetUniformLocation(prog_fill_chunk_hash_table_.id, "u_pack_offset"), pack_offset);
 
@@ -289,6 +317,8 @@ void VoxelGridGPU::conditional_prepare_rebuild(BufferObject& clear_dispatch_args
 }
 
 void VoxelGridGPU::rebuild_chunk_hash_table(uint32_t pack_bits, uint32_t pack_offset) {
+    if (hash_table_mode == ChunkHashTableMode::Bucketed) return; // могил нет, перестраивать нечего
+
     conditional_prepare_rebuild(dispatch_args, dispatch_args_additional);
 
     clear_chunk_hash_table(dispatch_args);
@@ -333,10 +363,17 @@ void VoxelGridGPU::reset_heads() {
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::build_bucket_lists(const glm::vec3& cam_pos) {
+uint32_t VoxelGridGPU::visibility_age_shells(uint32_t last_visible_frame) const {
+    if (eviction_visibility_frames_per_shell == 0) return 0;
+    uint32_t age = frame_index_ - last_visible_frame;
+    return std::min(age / eviction_visibility_frames_per_shell, eviction_max_visibility_shells);
+}
+
+void VoxelGridGPU::build_bucket_lists(const glm::vec3& cam_pos, const glm::vec3& focus_dir) {
     chunk_meta_.bind_base_as_ssbo(0);
     bucket_heads_.bind_base_as_ssbo(1);
     bucket_next_.bind_base_as_ssbo(2);
+    chunk_last_visible_.bind_base_as_ssbo(3);
 
     prog_evict_buckets_build_.use();
     glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_max_chunks"), count_active_chunks);
@@ -345,10 +382,16 @@ void VoxelGridGPU::build_bucket_lists(const glm::vec3& cam_pos) {
     glUniform3i(glGetUniformLocation(prog_evict_buckets_build_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
     glUniform3f(glGetUniformLocation(prog_evict_buckets_build_.id, "u_voxel_size"), voxel_size.x, voxel_size.y, voxel_size.z);
 
-    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_pack_bits"), math_utils::BITS);
-    glUniform1i(glGetUniformLocation(prog_evict_buckets_build_.id, "u_pack_offset"), math_utils::OFFSET);
+    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_evict_buckets_build_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
 
     glUniform1f(glGetUniformLocation(prog_evict_buckets_build_.id, "f_eviction_bucket_shell_thickness"), eviction_bucket_shell_thickness);
+    glUniform3f(glGetUniformLocation(prog_evict_buckets_build_.id, "u_focus_dir"), focus_dir.x, focus_dir.y, focus_dir.z);
+    glUniform1f(glGetUniformLocation(prog_evict_buckets_build_.id, "u_behind_weight"), stream_behind_eviction_weight);
+    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_frame_index"), frame_index_);
+    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_visibility_frames_per_shell"), eviction_visibility_frames_per_shell);
+    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_max_visibility_shells"), eviction_max_visibility_shells);
+    glUniform1ui(glGetUniformLocation(prog_evict_buckets_build_.id, "u_spill_capacity"), spill_capacity_);
 
     uint32_t gx = math_utils::div_up_u32(count_active_chunks, 256u);
     prog_evict_buckets_build_.dispatch_compute(gx, 1, 1);
@@ -377,12 +420,19 @@ void VoxelGridGPU::evict_lowpriority_chunks(const BufferObject& dispatch_args) {
     bucket_next_.bind_base_as_ssbo(6);
     chunk_mesh_alloc_.bind_base_as_ssbo(7);
     evicted_chunks_list_.bind_base_as_ssbo(8);
+    stream_state_.bind_base_as_ssbo(9);
+    spill_batches_[spill_batch_current_].records.bind_base_as_ssbo(10);
+    evict_freed_count_.bind_base_as_ssbo(11);
 
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_evict_low_priority_.use();
     glUniform1ui(glGetUniformLocation(prog_evict_low_priority_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_evict_low_priority_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform1ui(glGetUniformLocation(prog_evict_low_priority_.id, "u_bucket_count"), count_evict_buckets);
+    glUniform1ui(glGetUniformLocation(prog_evict_low_priority_.id, "u_spill_capacity"), spill_capacity_);
+    glUniform1ui(glGetUniformLocation(prog_evict_low_priority_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_evict_low_priority_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
 
     glDispatchComputeIndirect(0);
 
@@ -398,19 +448,12 @@ void VoxelGridGPU::free_evicted_chunks_mesh(const BufferObject& dispatch_args) {
     vb_free_nodes_list_.bind_base_as_ssbo(4);
     vb_returned_nodes_list.bind_base_as_ssbo(5);
 
-    ib_heads_.bind_base_as_ssbo(6);
-    ib_state_.bind_base_as_ssbo(7);
-    ib_nodes_.bind_base_as_ssbo(8);
-    ib_free_nodes_list_.bind_base_as_ssbo(9);
-    ib_returned_nodes_list.bind_base_as_ssbo(10);
-
-    evicted_chunks_list_.bind_base_as_ssbo(11);
+    evicted_chunks_list_.bind_base_as_ssbo(6);
 
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_free_evicted_chunks_mesh_.use();
     glUniform1ui(glGetUniformLocation(prog_free_evicted_chunks_mesh_.id, "vb_max_order"), vb_order_);
-    glUniform1ui(glGetUniformLocation(prog_free_evicted_chunks_mesh_.id, "ib_max_order"), ib_order_);
 
     glDispatchComputeIndirect(0);
 
@@ -421,6 +464,7 @@ void VoxelGridGPU::reset_evicted_list_and_buckets() {
     bucket_heads_.bind_base_as_ssbo(0);
     evicted_chunks_list_.bind_base_as_ssbo(1);
     free_list_.bind_base_as_ssbo(2);
+    evict_freed_count_.bind_base_as_ssbo(3);
 
     prog_reset_evicted_list_and_buckets_.use();
     glUniform1ui(glGetUniformLocation(prog_reset_evicted_list_and_buckets_.id, "u_bucket_count"), count_evict_buckets);
@@ -430,16 +474,21 @@ void VoxelGridGPU::reset_evicted_list_and_buckets() {
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::ensure_free_chunks_gpu(const glm::vec3& cam_pos, uint32_t pack_bits, uint32_t pack_offset) {
+void VoxelGridGPU::ensure_free_chunks_gpu(const glm::vec3& cam_pos, uint32_t pack_bits, uint32_t pack_offset, const glm::vec3& focus_dir) {
+    // забираем готовые партии прошлых кадров, чтобы освободить место для этого выселения
+    poll_spill_readbacks();
+    begin_spill_batch();
+
     GPUTimestamp t0;
     reset_heads();
     GPUTimestamp t1;
-    build_bucket_lists(cam_pos);
+    build_bucket_lists(cam_pos, focus_dir);
     
     GPUTimestamp t2;
     prepare_evict_lowpriority_chunks(dispatch_args);
     GPUTimestamp t3;
     evict_lowpriority_chunks(dispatch_args);
+    spill_evicted_chunks(); // до переиспользования id, пока воксели чанков целы
     
     GPUTimestamp t4;
     free_evicted_chunks_mesh(dispatch_args); // dispatch_args здесь уже подготовлен
@@ -471,6 +520,201 @@ void VoxelGridGPU::ensure_voxel_write_list(size_t count) {
     voxel_write_list_.ensure_capacity(sizeof(uint32_t) + sizeof(VoxelWriteGPU) * count);
 }
 
+bool VoxelGridGPU::begin_spill_batch() {
+    spill_capacity_ = 0;
+
+    for (uint32_t i = 0; i < count_spill_batches; i++) {
+        uint32_t b = (spill_batch_current_ + i) % count_spill_batches;
+        if (spill_batches_[b].fence != nullptr) continue; // ещё читается
+
+        spill_batch_current_ = b;
+        spill_capacity_ = spill_batch_slots;
+        spill_batches_[b].records.update_subdata_fill<uint32_t>(0u, 0u, sizeof(SpillBatchHeaderGPU), *shader_manager);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        return true;
+    }
+    return false;
+}
+
+void VoxelGridGPU::spill_evicted_chunks() {
+    if (spill_capacity_ == 0) return;
+    SpillBatch& batch = spill_batches_[spill_batch_current_];
+
+    // dispatch_args ещё нужен free_evicted_chunks_mesh
+    prepare_dispatch_args(dispatch_args_additional, ValueDispatchArg(vox_per_chunk), BufferDispatchArg(&batch.records, 0u));
+
+    voxels_.bind_base_as_ssbo(0);
+    batch.records.bind_base_as_ssbo(1);
+    batch.voxels.bind_base_as_ssbo(2);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args_additional.id());
+
+    prog_evict_spill_copy_.use();
+    glUniform1ui(glGetUniformLocation(prog_evict_spill_copy_.id, "u_voxels_per_chunk"), vox_per_chunk);
+    glUniform1ui(glGetUniformLocation(prog_evict_spill_copy_.id, "u_spill_capacity"), spill_capacity_);
+
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    spill_batch_current_ = (spill_batch_current_ + 1) % count_spill_batches;
+    spill_capacity_ = 0;
+}
+
+void VoxelGridGPU::poll_spill_readbacks() {
+    std::vector<SpillRecordGPU> records;
+    std::vector<uint64_t> voxels;
+
+    for (SpillBatch& batch : spill_batches_) {
+        if (batch.fence == nullptr) continue;
+
+        // таймаут 0: только проверить fence, не ждать GPU
+        GLenum state = glClientWaitSync(batch.fence, 0, 0);
+        if (state == GL_TIMEOUT_EXPIRED) continue;
+
+        glDeleteSync(batch.fence);
+        batch.fence = nullptr;
+
+        if (state == GL_WAIT_FAILED) {
+            std::cout << "VoxelGridGPU::poll_spill_readbacks: glClientWaitSync failed" << std::endl;
+            throw std::runtime_error("VoxelGridGPU::poll_spill_readbacks: glClientWaitSync failed");
+        }
+
+        SpillBatchHeaderGPU header = batch.records.read_scalar<SpillBatchHeaderGPU>(0);
+        count_spill_overflow_ += header.overflow;
+
+        uint32_t n = std::min(header.count, spill_batch_slots);
+        if (n == 0) continue;
+
+        records.resize(n);
+        voxels.resize((size_t)n * vox_per_chunk);
+        batch.records.read_subdata(sizeof(SpillBatchHeaderGPU), sizeof(SpillRecordGPU) * n, records.data());
+        batch.voxels.read_subdata(0, sizeof(VoxelDataGPU) * voxels.size(), voxels.data());
+
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t key = ((uint64_t)records[i].key_hi << 32) | records[i].key_lo;
+            spill_cache.store(key, voxels.data() + (size_t)i * vox_per_chunk, vox_per_chunk);
+
+            // чанк успели восстановить и снова выселить - новые данные не удаляем по старому статусу
+            for (size_t r = 0; r < restore_in_flight_.size(); r++)
+                if (restore_in_flight_[r].key_lo == records[i].key_lo && restore_in_flight_[r].key_hi == records[i].key_hi)
+                    restore_in_flight_valid_[r] = false;
+        }
+    }
+}
+
+bool VoxelGridGPU::poll_restores() {
+    if (restore_fence_ == nullptr) return true;
+
+    GLenum state = glClientWaitSync(restore_fence_, 0, 0);
+    if (state == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(restore_fence_);
+    restore_fence_ = nullptr;
+
+    if (state == GL_WAIT_FAILED) {
+        std::cout << "VoxelGridGPU::poll_restores: glClientWaitSync failed" << std::endl;
+        throw std::runtime_error("VoxelGridGPU::poll_restores: glClientWaitSync failed");
+    }
+
+    restore_records_.read_subdata(0, sizeof(RestoreRecordGPU) * restore_in_flight_.size(), restore_in_flight_.data());
+
+    for (size_t i = 0; i < restore_in_flight_.size(); i++) {
+        const RestoreRecordGPU& record = restore_in_flight_[i];
+        if (!restore_in_flight_valid_[i] || record.status == RESTORE_FAILED) continue; // FAILED - попробуем в другой раз
+
+        uint64_t key = ((uint64_t)record.key_hi << 32) | record.key_lo;
+        spill_cache.erase(key, record.status == RESTORE_OK);
+    }
+
+    restore_in_flight_.clear();
+    restore_in_flight_valid_.clear();
+    return true;
+}
+
+void VoxelGridGPU::restore_spilled_chunks(const glm::vec3& center_world_pos, int radius_chunks) {
+    if (!poll_restores()) return; // прошлое восстановление ещё на GPU, ключи из кеша пока не удалены
+    if (spill_cache.size() == 0) return;
+
+    // тот же центр, что в mark_chunk_to_generate
+    glm::mat4 invM = glm::inverse(get_model_matrix());
+    glm::vec3 chunk_world_size = glm::vec3(chunk_size) * voxel_size;
+    glm::vec3 center_local = glm::vec3(invM * glm::vec4(center_world_pos, 1.0f));
+    glm::ivec3 center_chunk = glm::ivec3(glm::floor(center_local / chunk_world_size));
+
+    std::vector<std::pair<int, uint64_t>> candidates;
+    spill_cache.for_each_key([&](uint64_t key) {
+        glm::ivec3 d = unpack_chunk_key(key) - center_chunk;
+        int d2 = d.x * d.x + d.y * d.y + d.z * d.z;
+        if (d2 <= radius_chunks * radius_chunks) candidates.emplace_back(d2, key);
+    });
+    if (candidates.empty()) return;
+
+    // ближние первыми
+    uint32_t n = std::min((uint32_t)candidates.size(), max_restores_per_frame);
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end());
+
+    restore_in_flight_.resize(n);
+    restore_in_flight_valid_.assign(n, true);
+    std::vector<uint64_t> voxels((size_t)n * vox_per_chunk);
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t key = candidates[i].second;
+        restore_in_flight_[i] = RestoreRecordGPU{ (uint32_t)key, (uint32_t)(key >> 32), INVALID_ID, RESTORE_FAILED };
+        spill_cache.load(key, voxels.data() + (size_t)i * vox_per_chunk, vox_per_chunk);
+    }
+
+    restore_records_.update_subdata(0, sizeof(RestoreRecordGPU) * n, restore_in_flight_.data());
+    restore_voxels_.update_subdata(0, sizeof(VoxelDataGPU) * voxels.size(), voxels.data());
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // ---- pass 1: get_or_create ----
+    chunk_hash_keys_.bind_base_as_ssbo(0);
+    chunk_hash_vals_.bind_base_as_ssbo(1);
+    free_list_.bind_base_as_ssbo(2);
+    chunk_meta_.bind_base_as_ssbo(3);
+    enqueued_.bind_base_as_ssbo(4);
+    restore_records_.bind_base_as_ssbo(5);
+
+    prog_stream_restore_select_.use();
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_select_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_select_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_select_.id, "u_restore_count"), n);
+
+    prog_stream_restore_select_.dispatch_compute(math_utils::div_up_u32(n, 256u), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // ---- pass 2: воксели ----
+    chunk_hash_keys_.bind_base_as_ssbo(0);
+    chunk_hash_vals_.bind_base_as_ssbo(1);
+    restore_records_.bind_base_as_ssbo(2);
+    restore_voxels_.bind_base_as_ssbo(3);
+    voxels_.bind_base_as_ssbo(4);
+    chunk_meta_.bind_base_as_ssbo(5);
+    enqueued_.bind_base_as_ssbo(6);
+    dirty_list_.bind_base_as_ssbo(7);
+    chunk_last_visible_.bind_base_as_ssbo(8);
+
+    prog_stream_restore_copy_.use();
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_restore_count"), n);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_voxels_per_chunk"), vox_per_chunk);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_frame_index"), frame_index_);
+    glUniform1ui(glGetUniformLocation(prog_stream_restore_copy_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_stream_restore_copy_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
+
+    prog_stream_restore_copy_.dispatch_compute(math_utils::div_up_u32(vox_per_chunk, 256u), n, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    restore_fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    stream_lod_visibility_dirty_ = true;
+}
+
 void VoxelGridGPU::mesh_reset(const BufferObject& dispatch_args) {
     dirty_list_.bind_base_as_ssbo(0);
     dirty_quad_count_.bind_base_as_ssbo(1);
@@ -497,6 +741,7 @@ void VoxelGridGPU::mesh_count(const BufferObject& dispatch_args, uint32_t pack_b
 
     prog_mesh_count_.use();
     glUniform1ui(glGetUniformLocation(prog_mesh_count_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_mesh_count_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform3i(glGetUniformLocation(prog_mesh_count_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
     glUniform1ui(glGetUniformLocation(prog_mesh_count_.id, "u_voxels_per_chunk"), vox_per_chunk);
     glUniform1ui(glGetUniformLocation(prog_mesh_count_.id, "u_pack_bits"), pack_bits);
@@ -511,7 +756,7 @@ void VoxelGridGPU::mesh_count(const BufferObject& dispatch_args, uint32_t pack_b
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::mesh_alloc_vb(const BufferObject& dispatch_args) {
+void VoxelGridGPU::mesh_alloc(const BufferObject& dispatch_args) {
     mesh_buffers_status_.bind_base_as_ssbo(0);
     dirty_list_.bind_base_as_ssbo(1);
     dirty_quad_count_.bind_base_as_ssbo(2);
@@ -532,39 +777,6 @@ void VoxelGridGPU::mesh_alloc_vb(const BufferObject& dispatch_args) {
     glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_page_elements"), vb_page_size_);
     glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_max_order"), vb_order_);
     glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_quad_size"), 4u);
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "u_is_vb_phase"), 1u);
-
-    glDispatchComputeIndirect(0);
-
-    // uint32_t dirty_count = read_dirty_count_cpu();
-    // uint32_t groups_dirty = math_utils::div_up_u32(dirty_count, 256u);
-
-    // prog_mesh_alloc_.dispatch_compute(groups_dirty, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-}
-
-void VoxelGridGPU::mesh_alloc_ib(const BufferObject& dispatch_args) {
-    mesh_buffers_status_.bind_base_as_ssbo(0);
-    dirty_list_.bind_base_as_ssbo(1);
-    dirty_quad_count_.bind_base_as_ssbo(2);
-    chunk_meta_.bind_base_as_ssbo(3);
-    chunk_mesh_alloc_local_.bind_base_as_ssbo(4);
-    chunk_mesh_alloc_.bind_base_as_ssbo(5);
-
-    ib_heads_.bind_base_as_ssbo(6);
-    ib_state_.bind_base_as_ssbo(7);
-    ib_nodes_.bind_base_as_ssbo(8);
-    ib_free_nodes_list_.bind_base_as_ssbo(9);
-    ib_returned_nodes_list.bind_base_as_ssbo(10);
-
-    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
-
-    prog_mesh_alloc_.use();
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_pages"), count_ib_pages_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_page_elements"), ib_page_size_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_max_order"), ib_order_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "bb_quad_size"), 6u);
-    glUniform1ui(glGetUniformLocation(prog_mesh_alloc_.id, "u_is_vb_phase"), 0u);
 
     glDispatchComputeIndirect(0);
 
@@ -575,11 +787,6 @@ void VoxelGridGPU::mesh_alloc_ib(const BufferObject& dispatch_args) {
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::mesh_alloc(const BufferObject& dispatch_args) {
-    mesh_alloc_vb(dispatch_args);
-    mesh_alloc_ib(dispatch_args);
-}
-
 void VoxelGridGPU::verify_mesh_allocation(const BufferObject& dispatch_args) {
     chunk_mesh_alloc_local_.bind_base_as_ssbo(0);
     chunk_mesh_alloc_.bind_base_as_ssbo(1);
@@ -591,18 +798,11 @@ void VoxelGridGPU::verify_mesh_allocation(const BufferObject& dispatch_args) {
     vb_nodes_.bind_base_as_ssbo(6);
     vb_free_nodes_list_.bind_base_as_ssbo(7);
     vb_returned_nodes_list.bind_base_as_ssbo(8);
-    
-    ib_heads_.bind_base_as_ssbo(9);
-    ib_state_.bind_base_as_ssbo(10);
-    ib_nodes_.bind_base_as_ssbo(11);
-    ib_free_nodes_list_.bind_base_as_ssbo(12);
-    ib_returned_nodes_list.bind_base_as_ssbo(13);
 
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_verify_mesh_allocation_.use();
     glUniform1ui(glGetUniformLocation(prog_verify_mesh_allocation_.id, "vb_max_order"),  vb_order_);
-    glUniform1ui(glGetUniformLocation(prog_verify_mesh_allocation_.id, "ib_max_order"),  ib_order_);
 
     glDispatchComputeIndirect(0);
 
@@ -615,8 +815,7 @@ void VoxelGridGPU::verify_mesh_allocation(const BufferObject& dispatch_args) {
 
 void VoxelGridGPU::prepare_return_free_alloc_nodes(BufferObject& dispatch_args) {
     vb_returned_nodes_list.bind_base_as_ssbo(0);
-    ib_returned_nodes_list.bind_base_as_ssbo(1);
-    dispatch_args.bind_base_as_ssbo(2);
+    dispatch_args.bind_base_as_ssbo(1);
 
     prog_return_free_alloc_nodes_dispatch_adapter_.use();
     prog_return_free_alloc_nodes_dispatch_adapter_.dispatch_compute(1, 1, 1);
@@ -627,17 +826,12 @@ void VoxelGridGPU::return_free_alloc_nodes(const BufferObject& dispatch_args) {
     vb_free_nodes_list_.bind_base_as_ssbo(0);
     vb_returned_nodes_list.bind_base_as_ssbo(1);
 
-    ib_free_nodes_list_.bind_base_as_ssbo(2);
-    ib_returned_nodes_list.bind_base_as_ssbo(3);
-
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_return_free_alloc_nodes_.use();
     glUniform3ui(glGetUniformLocation(prog_return_free_alloc_nodes_.id, "u3_chunk_size"), chunk_size.x, chunk_size.y, chunk_size.z);
     // uint32_t count_returned_nodes_vb = vb_returned_nodes_list.read_scalar<uint32_t>(0);
-    // uint32_t count_returned_nodes_ib = ib_returned_nodes_list.read_scalar<uint32_t>(0);
-    // uint32_t max_count_returned_nodes = std::max(count_returned_nodes_vb, count_returned_nodes_ib);
-    // uint32_t returned_node_groups = math_utils::div_up_u32(max_count_returned_nodes, 256u);
+    // uint32_t returned_node_groups = math_utils::div_up_u32(count_returned_nodes_vb, 256u);
 
     glDispatchComputeIndirect(0);
 
@@ -659,21 +853,19 @@ void VoxelGridGPU::mesh_emit(const BufferObject& dispatch_args, uint32_t pack_bi
     chunk_meta_.bind_base_as_ssbo(7);
 
     global_vertex_buffer_.bind_base_as_ssbo(8);
-    global_index_buffer_.bind_base_as_ssbo(9);
 
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_mesh_emit_.use();
     glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform3i(glGetUniformLocation(prog_mesh_emit_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
     glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_voxels_per_chunk"), vox_per_chunk);
-    glUniform3f(glGetUniformLocation(prog_mesh_emit_.id, "u_voxel_size"), voxel_size.x, voxel_size.y, voxel_size.z);
 
     glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_pack_bits"), pack_bits);
     glUniform1i(glGetUniformLocation(prog_mesh_emit_.id, "u_pack_offset"), pack_offset);
 
     glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_vb_page_verts"), vb_page_size_);
-    glUniform1ui(glGetUniformLocation(prog_mesh_emit_.id, "u_ib_page_inds"), ib_page_size_);
 
     glDispatchComputeIndirect(0);
 
@@ -694,7 +886,7 @@ void VoxelGridGPU::mesh_finalize(const BufferObject& dispatch_args) {
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_mesh_finalize_.use();
-    glUniform1ui(glGetUniformLocation(prog_mesh_finalize_.id, "u_dirty_flag_bits"), 1u);
+    glUniform1ui(glGetUniformLocation(prog_mesh_finalize_.id, "u_dirty_flag_bits"), DIRTY_FLAG_MESH);
 
     glDispatchComputeIndirect(0);
     
@@ -711,9 +903,6 @@ void VoxelGridGPU::reset_dirty_count() {
     vb_free_nodes_list_.bind_base_as_ssbo(1);
     vb_returned_nodes_list.bind_base_as_ssbo(2);
 
-    ib_free_nodes_list_.bind_base_as_ssbo(3);
-    ib_returned_nodes_list.bind_base_as_ssbo(4);
-
     prog_reset_dirty_count_.use();
     prog_reset_dirty_count_.dispatch_compute(1, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
@@ -737,12 +926,13 @@ void VoxelGridGPU::apply_writes_to_world_gpu(uint32_t write_count) {
     prog_apply_writes_.use();
 
     glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
     glUniform3i(glGetUniformLocation(prog_apply_writes_.id, "u_chunk_dim"),
                 chunk_size.x, chunk_size.y, chunk_size.z);
     glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_voxels_per_chunk"), vox_per_chunk);
-    glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_set_dirty_flag_bits"), 1u);
-    glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_pack_bits"), math_utils::BITS);
-    glUniform1i(glGetUniformLocation(prog_apply_writes_.id, "u_pack_offset"), math_utils::OFFSET);
+    glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_set_dirty_flag_bits"), DIRTY_FLAG_MESH | DIRTY_FLAG_USER_MODIFIED);
+    glUniform1ui(glGetUniformLocation(prog_apply_writes_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_apply_writes_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
 
 
     uint32_t groups_x = math_utils::div_up_u32(write_count, 256u);
@@ -768,7 +958,7 @@ void VoxelGridGPU::apply_writes_to_world_from_cpu(const std::vector<glm::ivec3>&
 }
 
 void VoxelGridGPU::apply_writes_to_world_gpu_with_evict(uint32_t write_count, const glm::vec3& cam_pos) {
-    ensure_free_chunks_gpu(cam_pos, math_utils::BITS, math_utils::OFFSET);
+    ensure_free_chunks_gpu(cam_pos, CHUNK_KEY_BITS, CHUNK_KEY_OFFSET);
     apply_writes_to_world_gpu(write_count);
 }
 
@@ -776,7 +966,7 @@ void VoxelGridGPU::apply_writes_to_world_from_cpu_with_evict(
     const std::vector<glm::ivec3>& positions, 
     const std::vector<VoxelDataGPU>& voxels,
     const glm::vec3& cam_pos) {
-    ensure_free_chunks_gpu(cam_pos, math_utils::BITS, math_utils::OFFSET);
+    ensure_free_chunks_gpu(cam_pos, CHUNK_KEY_BITS, CHUNK_KEY_OFFSET);
     apply_writes_to_world_from_cpu(positions, voxels);
 }
 
@@ -785,43 +975,240 @@ void VoxelGridGPU::reset_load_list_counter() {
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::mark_chunk_to_generate(const glm::vec3& cam_world_pos, int radius_chunks)
+// Смещения чанков сферы радиуса R вокруг нового центра, которых не было в сфере вокруг старого (old = new - delta).
+// Идём по столбцам (y, z): в каждом столбце новая сфера - отрезок по x, старая - тоже отрезок, разность - максимум два отрезка.
+// Возвращает число чанков в сфере целиком.
+static uint32_t build_sphere_shell(int R, const glm::ivec3& delta, std::vector<glm::ivec4>& out) {
+    auto isqrt = [](int v) {
+        int r = (int)std::sqrt((double)v);
+        while (r * r > v) r--;
+        while ((r + 1) * (r + 1) <= v) r++;
+        return r;
+    };
+
+    out.clear();
+    uint32_t sphere_count = 0;
+    const int R2 = R * R;
+
+    for (int z = -R; z <= R; z++) {
+        for (int y = -R; y <= R; y++) {
+            int rest = R2 - y * y - z * z;
+            if (rest < 0) continue;
+
+            int w = isqrt(rest);
+            sphere_count += (uint32_t)(2 * w + 1);
+
+            // тот же столбец в координатах старого центра
+            int oy = y + delta.y;
+            int oz = z + delta.z;
+            int old_rest = R2 - oy * oy - oz * oz;
+
+            int old_lo = 1, old_hi = 0; // пустой отрезок
+            if (old_rest >= 0) {
+                int ow = isqrt(old_rest);
+                old_lo = -ow - delta.x;
+                old_hi = ow - delta.x;
+            }
+
+            for (int x = -w; x <= w; x++) {
+                if (x >= old_lo && x <= old_hi) {
+                    x = old_hi;
+                    continue;
+                }
+                out.emplace_back(x, y, z, 0);
+            }
+        }
+    }
+
+    return sphere_count;
+}
+
+// С LOD уровень 0 берёт чанк, только если весь его родитель (блок 2x2x2) лежит в шаре, поэтому после сдвига
+// в кольцо входят и соседи по блоку чанков оболочки. Лишние отсечёт lod_chunk_selected в stream_select_chunks.glsl.
+static void expand_shell_to_parent_blocks(const glm::ivec3& cam_chunk, std::vector<glm::ivec4>& shell) {
+    std::vector<glm::ivec4> blocks;
+    blocks.reserve(shell.size() * 8);
+    for (const glm::ivec4& o : shell) {
+        glm::ivec3 c = cam_chunk + glm::ivec3(o);
+        glm::ivec3 base(math_utils::floor_div(c.x, 2) * 2, math_utils::floor_div(c.y, 2) * 2, math_utils::floor_div(c.z, 2) * 2);
+        for (int i = 0; i < 8; i++) {
+            glm::ivec3 d = base + glm::ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1) - cam_chunk;
+            blocks.emplace_back(d.x, d.y, d.z, 0);
+        }
+    }
+
+    auto less = [](const glm::ivec4& a, const glm::ivec4& b) {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    };
+    std::sort(blocks.begin(), blocks.end(), less);
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    shell.swap(blocks);
+}
+
+void VoxelGridGPU::mark_chunk_to_generate(const glm::vec3& cam_world_pos, int radius_chunks) {
+    mark_chunk_to_generate(StreamFocus(cam_world_pos), radius_chunks);
+}
+
+void VoxelGridGPU::mark_chunk_to_generate(const StreamFocus& focus, int radius_chunks)
 {
     // GPUTimestamp t0;
     // камера в локальные координаты грида (важно, если VoxelGridGPU трансформируется)
     glm::mat4 invM = glm::inverse(get_model_matrix());
-    glm::vec3 cam_local = glm::vec3(invM * glm::vec4(cam_world_pos, 1.0f));
+    glm::vec3 chunk_world_size = glm::vec3(chunk_size) * voxel_size;
+
+    // центр шара - между камерой и предсказанной позицией
+    float max_shift = stream_max_center_shift * (float)radius_chunks * std::min({chunk_world_size.x, chunk_world_size.y, chunk_world_size.z});
+    glm::vec3 center_local = glm::vec3(invM * glm::vec4(focus.stream_center(max_shift), 1.0f));
+    glm::vec3 predicted_local = glm::vec3(invM * glm::vec4(focus.predicted_position, 1.0f));
+
+    glm::ivec3 cam_chunk = glm::ivec3(glm::floor(center_local / chunk_world_size));
+
+    // Полный отбор по кубу - при первом вызове, смене радиуса и телепорте (оболочка больше половины сферы).
+    // Выселение чанков внутри сферы и неудачное создание замечаются на GPU (StreamState::rescan_requested).
+    // С LOD оболочка только у уровня 0: его кольцо зависит лишь от его центра. Кольцо уровня L > 0 зависит ещё
+    // от центра уровня мельче (дыра под ним), и сдвиг этого центра меняет покрытие - такой уровень отбирается целиком.
+    uint32_t levels = std::clamp(lod_levels, 1u, MAX_LOD_LEVELS);
+    bool use_lod = levels > 1;
+    bool force_full = !stream_has_center_ || radius_chunks != stream_radius_ || levels != stream_lod_levels_;
+    glm::ivec3 delta = cam_chunk - stream_cam_chunk_;
+    stream_shell_.clear();
+
+    if (!force_full && delta != glm::ivec3(0)) {
+        int max_delta = std::max({std::abs(delta.x), std::abs(delta.y), std::abs(delta.z)});
+        if (max_delta > radius_chunks) {
+            force_full = true;
+        } else {
+            uint32_t sphere_count = build_sphere_shell(radius_chunks, delta, stream_shell_);
+            if (use_lod) expand_shell_to_parent_blocks(cam_chunk, stream_shell_);
+            if (stream_shell_.size() * 2 > sphere_count) force_full = true;
+        }
+    }
+
+    if (force_full) stream_shell_.clear();
+    uint32_t shell_count = (uint32_t)stream_shell_.size();
+
+    // Свободных id может не хватить на всю оболочку - первыми их получат чанки ближе к предсказанной позиции
+    if (shell_count > 1 && focus.predicted_position != focus.position) {
+        glm::vec3 target = predicted_local / chunk_world_size - glm::vec3(cam_chunk) - glm::vec3(0.5f);
+        auto dist2 = [&](const glm::ivec4& o) {
+            glm::vec3 d = glm::vec3(o.x, o.y, o.z) - target;
+            return glm::dot(d, d);
+        };
+        std::sort(stream_shell_.begin(), stream_shell_.end(), [&](const glm::ivec4& a, const glm::ivec4& b) {
+            return dist2(a) < dist2(b);
+        });
+    }
+
+    if (shell_count > 0) {
+        stream_shell_offsets_.ensure_capacity(sizeof(glm::ivec4) * shell_count);
+        stream_shell_offsets_.update_subdata(0, sizeof(glm::ivec4) * shell_count, stream_shell_.data());
+    }
+
+    // центр уровня L - чанк камеры в чанках уровня L
+    auto lod_center = [](const glm::ivec3& c, uint32_t lod) {
+        int s = 1 << lod;
+        return glm::ivec3(math_utils::floor_div(c.x, s), math_utils::floor_div(c.y, s), math_utils::floor_div(c.z, s));
+    };
+
+    glm::ivec3 prev_cam_chunk = stream_cam_chunk_;
+    bool visibility_dirty = force_full || stream_lod_visibility_dirty_;
+
+    stream_cam_chunk_ = cam_chunk;
+    stream_radius_ = radius_chunks;
+    stream_has_center_ = true;
+    stream_lod_levels_ = levels;
+    stream_lod_visibility_dirty_ = false;
+
+    glm::ivec3 lod_centers[MAX_LOD_LEVELS];
+    for (uint32_t lod = 0; lod < MAX_LOD_LEVELS; lod++) lod_centers[lod] = lod_center(cam_chunk, lod);
+
+    for (uint32_t lod = 0; lod < levels; lod++) {
+        glm::ivec3 center = lod_centers[lod];
+        glm::ivec3 finer_center = lod_centers[lod > 0 ? lod - 1 : 0];
+
+        bool level_full = force_full;
+        uint32_t level_shell_count = lod == 0 ? shell_count : 0u;
+        if (use_lod) {
+            bool moved = center != lod_center(prev_cam_chunk, lod);
+            bool coverage_changed = lod > 0 && finer_center != lod_center(prev_cam_chunk, lod - 1);
+            level_full = level_full || coverage_changed;
+            visibility_dirty = visibility_dirty || moved || coverage_changed;
+        }
+
+        // ---- pass 1: full или shell ----
+        stream_state_.bind_base_as_ssbo(0);
+        dispatch_args.bind_base_as_ssbo(1);
+
+        prog_stream_select_dispatch_adapter_.use();
+        glUniform3i(glGetUniformLocation(prog_stream_select_dispatch_adapter_.id, "u_cam_chunk"), center.x, center.y, center.z);
+        glUniform1i(glGetUniformLocation(prog_stream_select_dispatch_adapter_.id, "u_radius_chunks"), radius_chunks);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_dispatch_adapter_.id, "u_shell_count"), level_shell_count);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_dispatch_adapter_.id, "u_force_full"), level_full ? 1u : 0u);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_dispatch_adapter_.id, "u_lod"), lod);
+
+        prog_stream_select_dispatch_adapter_.dispatch_compute(1, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+        // ---- pass 2: select/create ----
+        chunk_hash_keys_.bind_base_as_ssbo(0);
+        chunk_hash_vals_.bind_base_as_ssbo(1);
+        free_list_.bind_base_as_ssbo(2);
+        chunk_meta_.bind_base_as_ssbo(3);
+        enqueued_.bind_base_as_ssbo(4);
+        load_list_.bind_base_as_ssbo(5);
+        stream_state_.bind_base_as_ssbo(6);
+        stream_shell_offsets_.bind_base_as_ssbo(7);
+
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
+
+        prog_stream_select_chunks_.use();
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_hash_table_size"), chunk_hash_table_size);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_max_load_entries"), count_active_chunks);
+        glUniform3i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_cam_chunk"), center.x, center.y, center.z);
+        glUniform1i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_radius_chunks"), radius_chunks);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_shell_count"), level_shell_count);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_lod"), lod);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_lod_levels"), levels);
+        glUniform3i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_finer_cam_chunk"), finer_center.x, finer_center.y, finer_center.z);
+        glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+        glUniform1i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
+
+        glDispatchComputeIndirect(0);
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    if (use_lod && visibility_dirty) update_lod_visibility(lod_centers, levels, radius_chunks);
 
-    // ---- pass 1: select/create ----
-    chunk_hash_keys_.bind_base_as_ssbo(0);
-    chunk_hash_vals_.bind_base_as_ssbo(1);
-    free_list_.bind_base_as_ssbo(2);
-    chunk_meta_.bind_base_as_ssbo(3);
-    enqueued_.bind_base_as_ssbo(4);
-    load_list_.bind_base_as_ssbo(5);
-
-    prog_stream_select_chunks_.use();
-    glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_hash_table_size"), chunk_hash_table_size);
-    glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_max_load_entries"), count_active_chunks);
-    glUniform3i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
-    glUniform3f(glGetUniformLocation(prog_stream_select_chunks_.id, "u_voxel_size"), voxel_size.x, voxel_size.y, voxel_size.z);
-    glUniform3f(glGetUniformLocation(prog_stream_select_chunks_.id, "u_cam_pos_local"), cam_local.x, cam_local.y, cam_local.z);
-    glUniform1i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_radius_chunks"), radius_chunks);
-    glUniform1ui(glGetUniformLocation(prog_stream_select_chunks_.id, "u_pack_bits"), math_utils::BITS);
-    glUniform1i(glGetUniformLocation(prog_stream_select_chunks_.id, "u_pack_offset"), math_utils::OFFSET);
-
-    const uint32_t side = (uint32_t)(2 * radius_chunks + 1);
-    const uint32_t gx = math_utils::div_up_u32(side, 8u);
-    const uint32_t gy = math_utils::div_up_u32(side, 8u);
-    const uint32_t gz = math_utils::div_up_u32(side, 8u);
-
-    prog_stream_select_chunks_.dispatch_compute(gx, gy, gz);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
     // GPUTimestamp t1;
 
     // std::cout << "mark_chunk_to_generate(): " << t1 - t0 << std::endl;
 }
 
+void VoxelGridGPU::update_lod_visibility(const glm::ivec3* lod_centers, uint32_t levels, int radius_chunks) {
+    chunk_hash_keys_.bind_base_as_ssbo(0);
+    chunk_hash_vals_.bind_base_as_ssbo(1);
+    chunk_meta_.bind_base_as_ssbo(2);
+    enqueued_.bind_base_as_ssbo(3);
+    dirty_list_.bind_base_as_ssbo(4);
+
+    prog_stream_lod_visibility_.use();
+    glUniform1ui(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
+    glUniform1ui(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_max_chunks"), count_active_chunks);
+    glUniform1ui(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_lod_levels"), levels);
+    glUniform3iv(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_lod_centers"), MAX_LOD_LEVELS, &lod_centers[0].x);
+    glUniform1i(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_radius_chunks"), radius_chunks);
+    glUniform1ui(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_stream_lod_visibility_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
+
+    prog_stream_lod_visibility_.dispatch_compute(math_utils::div_up_u32(count_active_chunks, 256u), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
 void VoxelGridGPU::generate_terrain(const BufferObject& dispatch_args, uint32_t seed) {
     // GPUTimestamp t0;
     chunk_hash_keys_.bind_base_as_ssbo(0);
@@ -833,17 +1220,20 @@ void VoxelGridGPU::generate_terrain(const BufferObject& dispatch_args, uint32_t
     chunk_meta_.bind_base_as_ssbo(4);
     enqueued_.bind_base_as_ssbo(5);
     dirty_list_.bind_base_as_ssbo(6);
+    chunk_last_visible_.bind_base_as_ssbo(7);
 
     glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
 
     prog_stream_generate_terrain_.use();
     glUniform3i(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
     glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_voxels_per_chunk"), vox_per_chunk);
-    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_pack_bits"), math_utils::BITS);
-    glUniform1i(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_pack_offset"), math_utils::OFFSET);
-    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_set_dirty_flag_bits"), 1u);
+    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
+    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_set_dirty_flag_bits"), DIRTY_FLAG_MESH);
     glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_seed"), seed);
+    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_frame_index"), frame_index_);
     glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_stream_generate_terrain_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
 
     glDispatchComputeIndirect(0);
 
@@ -855,14 +1245,25 @@ void VoxelGridGPU::generate_terrain(const BufferObject& dispatch_args, uint32_t
 }
 
 void VoxelGridGPU::stream_chunks_sphere(const glm::vec3& cam_world_pos, int radius_chunks, uint32_t seed) {
+    stream_chunks_sphere(StreamFocus(cam_world_pos), radius_chunks, seed);
+}
+
+void VoxelGridGPU::stream_chunks_sphere(const StreamFocus& focus, int radius_chunks, uint32_t seed) {
+    stream_seed_ = seed;
+    glm::vec3 chunk_world_size = glm::vec3(chunk_size) * voxel_size;
+    float max_shift = stream_max_center_shift * (float)radius_chunks * std::min({chunk_world_size.x, chunk_world_size.y, chunk_world_size.z});
+
     GPUTimestamp t0;
-    ensure_free_chunks_gpu(cam_world_pos, math_utils::BITS, math_utils::OFFSET);
+    // выселяем по удалённости от центра шара, а не от камеры, иначе выселятся чанки, которые шар тут же запросит снова
+    ensure_free_chunks_gpu(focus.stream_center(max_shift), CHUNK_KEY_BITS, CHUNK_KEY_OFFSET, focus.direction);
 
     GPUTimestamp t1;
+    // до отбора: восстановленные чанки уже будут в таблице и генерироваться не станут
+    restore_spilled_chunks(focus.stream_center(max_shift), radius_chunks);
     reset_load_list_counter();
 
     GPUTimestamp t2;
-    mark_chunk_to_generate(cam_world_pos, radius_chunks);
+    mark_chunk_to_generate(focus, radius_chunks);
 
     GPUTimestamp t3;
     prepare_dispatch_args(dispatch_args, ValueDispatchArg(vox_per_chunk), BufferDispatchArg(&load_list_, 0u));
@@ -871,14 +1272,66 @@ void VoxelGridGPU::stream_chunks_sphere(const glm::vec3& cam_world_pos, int radi
     generate_terrain(dispatch_args, seed);
     GPUTimestamp t5;
 
+    if (!log_stream_timings) return;
+
     std::cout << "ensure_free_chunks_gpu(): " << t1 - t0 << std::endl;
-    std::cout << "reset_load_list_counter(): " << t2 - t1 << std::endl;
+    std::cout << "restore_spilled_chunks() + reset_load_list_counter(): " << t2 - t1 << std::endl;
     std::cout << "mark_chunk_to_generate(): " << t3 - t2 << std::endl;
     std::cout << "prepare_dispatch_args(): " << t4 - t3 << std::endl;
     std::cout << "generate_terrain(): " << t5 - t4 << std::endl;
+    std::cout << "stream_chunks_sphere(): " << t5 - t0 << " (shell: " << stream_shell_.size() << ")" << std::endl;
     std::cout << std::endl;
 }
 
+std::future<VoxelGridGPU::StreamHoleStatsGPU> VoxelGridGPU::request_stream_holes(const glm::mat4& view_proj, const glm::vec3& cam_pos) {
+    auto planes = math_utils::extract_frustum_planes(view_proj);
+
+    glm::vec3 chunk_world_size = glm::vec3(chunk_size) * voxel_size;
+    glm::ivec3 cam_chunk = glm::ivec3(glm::floor(cam_pos / chunk_world_size));
+
+    // С LOD ищутся только ключи уровня 0, поэтому считаем в пределах его кольца (шар R без крайних ~2 чанков)
+    float distance = render_distance;
+    if (stream_lod_levels_ > 1 && stream_radius_ > 0) {
+        float min_chunk = std::min({chunk_world_size.x, chunk_world_size.y, chunk_world_size.z});
+        distance = std::min(distance, (float)std::max(stream_radius_ - 2, 0) * min_chunk);
+    }
+
+    glm::ivec3 radius_chunks = glm::ivec3(glm::ceil(glm::vec3(distance) / chunk_world_size));
+    glm::ivec3 side = radius_chunks * 2 + 1;
+
+    stream_hole_stats_.update_subdata_fill<uint32_t>(0u, 0u, sizeof(StreamHoleStatsGPU), *shader_manager);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    chunk_hash_keys_.bind_base_as_ssbo(0);
+    chunk_hash_vals_.bind_base_as_ssbo(1);
+    chunk_meta_.bind_base_as_ssbo(2);
+    stream_hole_stats_.bind_base_as_ssbo(3);
+
+    prog_stream_hole_stats_.use();
+    glUniform1ui(glGetUniformLocation(prog_stream_hole_stats_.id, "u_hash_table_size"), chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_stream_hole_stats_.id, "u_hash_table_mode"), (uint32_t)hash_table_mode);
+    glUniform3i(glGetUniformLocation(prog_stream_hole_stats_.id, "u_cam_chunk"), cam_chunk.x, cam_chunk.y, cam_chunk.z);
+    glUniform3i(glGetUniformLocation(prog_stream_hole_stats_.id, "u_radius_chunks"), radius_chunks.x, radius_chunks.y, radius_chunks.z);
+    glUniform3i(glGetUniformLocation(prog_stream_hole_stats_.id, "u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
+    glUniform3f(glGetUniformLocation(prog_stream_hole_stats_.id, "u_voxel_size"), voxel_size.x, voxel_size.y, voxel_size.z);
+    glUniform1ui(glGetUniformLocation(prog_stream_hole_stats_.id, "u_pack_bits"), CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_stream_hole_stats_.id, "u_pack_offset"), CHUNK_KEY_OFFSET);
+    glUniform3f(glGetUniformLocation(prog_stream_hole_stats_.id, "cam_pos"), cam_pos.x, cam_pos.y, cam_pos.z);
+    glUniform1f(glGetUniformLocation(prog_stream_hole_stats_.id, "render_distance"), distance);
+    glUniform4fv(glGetUniformLocation(prog_stream_hole_stats_.id, "u_frustum_planes"), 6, &planes[0].x);
+
+    prog_stream_hole_stats_.dispatch_compute(math_utils::div_up_u32(side.x, 8u), math_utils::div_up_u32(side.y, 8u), math_utils::div_up_u32(side.z, 8u));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    return readback.request_scalar<StreamHoleStatsGPU>(stream_hole_stats_);
+}
+
+VoxelGridGPU::StreamHoleStatsGPU VoxelGridGPU::measure_stream_holes(const glm::mat4& view_proj, const glm::vec3& cam_pos) {
+    std::future<StreamHoleStatsGPU> stats = request_stream_holes(view_proj, cam_pos);
+    readback.wait_all();
+    return stats.get();
+}
+
 void VoxelGridGPU::build_mesh_from_dirty(uint32_t pack_bits, int pack_offset) {
     prepare_dispatch_args(dispatch_args, BufferDispatchArg(&dirty_list_, 0u));
 
@@ -905,17 +1358,127 @@ void VoxelGridGPU::build_mesh_from_dirty(uint32_t pack_bits, int pack_offset) {
     reset_dirty_count();
 }
 
+void VoxelGridGPU::compute_mesh_pool_stats() {
+    mesh_pool_stats_.update_subdata_fill<uint32_t>(0u, 0u, sizeof(MeshPoolStatsGPU), *shader_manager);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    prog_mesh_pool_stats_.use();
+    mesh_pool_stats_.bind_base_as_ssbo(1);
+
+    // vb
+    vb_state_.bind_base_as_ssbo(0);
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_stats_.id, "bb_pages"), count_vb_pages_);
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_stats_.id, "bb_max_order"), vb_order_);
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_stats_.id, "u_pool_index"), 0u);
+    prog_mesh_pool_stats_.dispatch_compute(math_utils::div_up_u32(count_vb_pages_, 256u), 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+std::future<VoxelGridGPU::MeshPoolStatsGPU> VoxelGridGPU::request_mesh_pool_stats() {
+    compute_mesh_pool_stats();
+    return readback.request_scalar<MeshPoolStatsGPU>(mesh_pool_stats_);
+}
+
+void VoxelGridGPU::mesh_pool_defrag_plan(uint32_t max_moves) {
+    mesh_defrag_moves_.update_subdata_fill<uint32_t>(0u, 0u, sizeof(uint32_t), *shader_manager);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    chunk_mesh_alloc_.bind_base_as_ssbo(0);
+
+    vb_heads_.bind_base_as_ssbo(1);
+    vb_state_.bind_base_as_ssbo(2);
+    vb_nodes_.bind_base_as_ssbo(3);
+    vb_free_nodes_list_.bind_base_as_ssbo(4);
+    vb_returned_nodes_list.bind_base_as_ssbo(5);
+
+    chunk_meta_.bind_base_as_ssbo(6);
+    enqueued_.bind_base_as_ssbo(7);
+    mesh_defrag_moves_.bind_base_as_ssbo(8);
+
+    prog_mesh_pool_defrag_plan_.use();
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_defrag_plan_.id, "vb_max_order"), vb_order_);
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_defrag_plan_.id, "u_max_chunks"), count_active_chunks);
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_defrag_plan_.id, "u_max_moves"), std::min(max_moves, max_mesh_defrag_moves));
+
+    prog_mesh_pool_defrag_plan_.dispatch_compute(math_utils::div_up_u32(count_active_chunks, 256u), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void VoxelGridGPU::mesh_pool_defrag_copy(const BufferObject& dispatch_args) {
+    mesh_defrag_moves_.bind_base_as_ssbo(0);
+    global_vertex_buffer_.bind_base_as_ssbo(1);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
+
+    prog_mesh_pool_defrag_copy_.use();
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_defrag_copy_.id, "u_vb_page_verts"), vb_page_size_);
+
+    glDispatchComputeIndirect(0);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void VoxelGridGPU::mesh_pool_defrag_free(const BufferObject& dispatch_args) {
+    mesh_defrag_moves_.bind_base_as_ssbo(0);
+
+    vb_heads_.bind_base_as_ssbo(1);
+    vb_state_.bind_base_as_ssbo(2);
+    vb_nodes_.bind_base_as_ssbo(3);
+    vb_free_nodes_list_.bind_base_as_ssbo(4);
+    vb_returned_nodes_list.bind_base_as_ssbo(5);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
+
+    prog_mesh_pool_defrag_free_.use();
+    glUniform1ui(glGetUniformLocation(prog_mesh_pool_defrag_free_.id, "vb_max_order"), vb_order_);
+
+    glDispatchComputeIndirect(0);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Инкрементальная дефрагментация: не больше max_moves чанков за вызов, без чтения на CPU.
+// Запускается до build_mesh_from_dirty: chunk_mesh_alloc_ в этот момент согласован, а чанки из dirty списка пропускаются.
+void VoxelGridGPU::defrag_mesh_pool(uint32_t max_moves) {
+    mesh_pool_defrag_plan(max_moves);
+
+    prepare_dispatch_args(dispatch_args, ValueDispatchArg(mesh_defrag_copy_groups * 256u), BufferDispatchArg(&mesh_defrag_moves_, 0u));
+    mesh_pool_defrag_copy(dispatch_args);
+
+    prepare_dispatch_args(dispatch_args, BufferDispatchArg(&mesh_defrag_moves_, 0u));
+    mesh_pool_defrag_free(dispatch_args);
+
+    prepare_return_free_alloc_nodes(dispatch_args);
+    return_free_alloc_nodes(dispatch_args);
+}
+
 void VoxelGridGPU::reset_cmd_count() {
     indirect_cmds_.update_subdata_fill<uint32_t>(0u, 0u, sizeof(uint32_t), *shader_manager);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelGridGPU::build_draw_commands(const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset) {
+void VoxelGridGPU::clear_indirect_cmds_tail() {
+    uint32_t max_draws = count_active_chunks * max_draws_per_chunk;
+
+    indirect_cmds_.bind_base_as_ssbo(0);
+
+    prog_clear_indirect_cmds_tail_.use();
+    glUniform1ui(glGetUniformLocation(prog_clear_indirect_cmds_tail_.id, "u_max_draws"), max_draws);
+    prog_clear_indirect_cmds_tail_.dispatch_compute(math_utils::div_up_u32(max_draws, 256u), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void VoxelGridGPU::build_draw_commands(const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset,
+                                       uint32_t cull_phase, const glm::mat4& occlusion_view_proj) {
     auto planes = math_utils::extract_frustum_planes(view_proj);
 
     chunk_meta_.bind_base_as_ssbo(0);
     chunk_mesh_alloc_.bind_base_as_ssbo(1);
     indirect_cmds_.bind_base_as_ssbo(2);
+    chunk_last_visible_.bind_base_as_ssbo(3);
+    chunk_visible_.bind_base_as_ssbo(4);
+    occlusion_stats_.bind_base_as_ssbo(5);
 
     prog_build_indirect_cmds_.use();
 
@@ -927,31 +1490,74 @@ void VoxelGridGPU::build_draw_commands(const glm::mat4& view_proj, const glm::ve
     glUniform1i(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_pack_offset"), pack_offset);
 
     glUniform1ui(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_vb_page_verts"), vb_page_size_);
-    glUniform1ui(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_ib_page_inds"), ib_page_size_);
 
     glUniform3f(glGetUniformLocation(prog_build_indirect_cmds_.id, "cam_pos"), cam_pos.x, cam_pos.y, cam_pos.z);
     glUniform1f(glGetUniformLocation(prog_build_indirect_cmds_.id, "render_distance"), render_distance);
+    glUniform1ui(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_frame_index"), frame_index_);
 
     // u_frustum_planes[6]
     GLint loc = glGetUniformLocation(prog_build_indirect_cmds_.id, "u_frustum_planes");
     glUniform4fv(loc, 6, &planes[0].x);
 
+    bool use_hiz = cull_phase == CULL_PHASE_OCCLUSION && hiz_pyramid_.valid();
+    glm::ivec2 hiz_size = hiz_pyramid_.size();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, use_hiz ? hiz_pyramid_.texture() : 0);
+
+    glUniform1ui(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_cull_phase"), cull_phase);
+    glUniform1ui(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_face_culling"), face_direction_culling ? 1u : 0u);
+    glUniform1i(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_hiz"), 0);
+    glUniform2i(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_hiz_size"), hiz_size.x, hiz_size.y);
+    glUniform1i(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_hiz_levels"), use_hiz ? (GLint)hiz_pyramid_.levels() : 0);
+    glUniformMatrix4fv(glGetUniformLocation(prog_build_indirect_cmds_.id, "u_occlusion_view_proj"), 1, GL_FALSE, &occlusion_view_proj[0][0]);
+
     uint32_t chunk_groups = math_utils::div_up_u32(count_active_chunks, 256u);
     prog_build_indirect_cmds_.dispatch_compute(chunk_groups, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // draw_indirect без ARB_indirect_parameters рисует все max_draws команд - хвост должен быть пустым
+    if (!GLEW_ARB_indirect_parameters) clear_indirect_cmds_tail();
 }
 
 void VoxelGridGPU::build_indirect_draw_commands_frustum(const glm::mat4& viewProj,
                                                         const glm::vec3& cam_pos,
                                                         uint32_t pack_bits,
                                                         int pack_offset) {
+    frame_index_++;
+    OcclusionStatsGPU zero_stats{};
+    occlusion_stats_.update_subdata(0, sizeof(OcclusionStatsGPU), &zero_stats);
     reset_cmd_count();
     build_draw_commands(viewProj, cam_pos, pack_bits, pack_offset);
 }
 
+void VoxelGridGPU::draw_occlusion_culled(const glm::mat4& world, const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset) {
+    frame_index_++;
+    OcclusionStatsGPU zero_stats{};
+    occlusion_stats_.update_subdata(0, sizeof(OcclusionStatsGPU), &zero_stats);
+
+    // ---- фаза 1: видимые в прошлом кадре, они же основные окклюдеры ----
+    reset_cmd_count();
+    build_draw_commands(view_proj, cam_pos, pack_bits, pack_offset, CULL_PHASE_VISIBLE_LAST_FRAME);
+    draw_indirect(vao.id, world, view_proj, cam_pos);
+
+    // Hi-Z из глубины этого кадра - репроекция не нужна
+    hiz_pyramid_.build(prog_hiz_copy_depth_, prog_hiz_downsample_);
+
+    // ---- фаза 2: остальные чанки фрустума по Hi-Z ----
+    reset_cmd_count();
+    build_draw_commands(view_proj, cam_pos, pack_bits, pack_offset, CULL_PHASE_OCCLUSION, view_proj * world);
+    draw_indirect(vao.id, world, view_proj, cam_pos);
+}
+
+std::future<VoxelGridGPU::OcclusionStatsGPU> VoxelGridGPU::request_occlusion_stats() {
+    return readback.request_scalar<OcclusionStatsGPU>(occlusion_stats_);
+}
+
 void VoxelGridGPU::draw_indirect(const GLuint vao, const glm::mat4& world, const glm::mat4& proj_view, const glm::vec3& cam_pos) {
-    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
-            GL_ELEMENT_ARRAY_BARRIER_BIT |
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
             GL_COMMAND_BARRIER_BIT);
 
     glBindVertexArray(vao);
@@ -959,14 +1565,19 @@ void VoxelGridGPU::draw_indirect(const GLuint vao, const glm::mat4& world, const
     // command buffer
     glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_cmds_.id());
 
-    // индексы
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, global_index_buffer_.id());
+    const GLsizei stride = (GLsizei)sizeof(DrawArraysIndirectCommand);
+    const GLsizei maxDraws = (GLsizei)(count_active_chunks * max_draws_per_chunk);
 
-    const GLsizei stride = (GLsizei)sizeof(DrawElementsIndirectCommand);
-    const GLsizei maxDraws = (GLsizei)count_active_chunks;
+    // начало чанка вершинный шейдер берёт из ChunkMeta, вершины квадов - из VB
+    chunk_meta_.bind_base_as_ssbo(0);
+    global_vertex_buffer_.bind_base_as_ssbo(1);
 
     auto attash_shader_program = [&](){
         prog_vf_voxel_mesh_diffusion_spec_.use();
+        glUniform3i(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"u_chunk_dim"), chunk_size.x, chunk_size.y, chunk_size.z);
+        glUniform3f(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"u_voxel_size"), voxel_size.x, voxel_size.y, voxel_size.z);
+        glUniform1ui(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"u_pack_bits"), CHUNK_KEY_BITS);
+        glUniform1i(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"u_pack_offset"), CHUNK_KEY_OFFSET);
         glUniformMatrix4fv(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"uWorld"), 1, GL_FALSE, &world[0][0]);
         glUniformMatrix4fv(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"uProjView"), 1, GL_FALSE, &proj_view[0][0]);
         glUniform3f(glGetUniformLocation(prog_vf_voxel_mesh_diffusion_spec_.id,"uViewPos"), cam_pos.x, cam_pos.y, cam_pos.z);
@@ -983,9 +1594,8 @@ void VoxelGridGPU::draw_indirect(const GLuint vao, const glm::mat4& world, const
 
         attash_shader_program();
 
-        glMultiDrawElementsIndirectCountARB(
+        glMultiDrawArraysIndirectCountARB(
             GL_TRIANGLES,
-            GL_UNSIGNED_INT,
             reinterpret_cast<const void*>(indirectOffset),
             countOffset,
             maxDraws,
@@ -993,16 +1603,13 @@ void VoxelGridGPU::draw_indirect(const GLuint vao, const glm::mat4& world, const
         );
     }
     else {
-        // Fallback: читаем только 4 байта cmdCount
-        uint32_t cmdCount = indirect_cmds_.read_scalar<uint32_t>(0);
-
+        // Fallback без readback: рисуем все maxDraws команд, команды после cmdCount обнулены clear_indirect_cmds_tail
         attash_shader_program();
 
-        glMultiDrawElementsIndirect(
+        glMultiDrawArraysIndirect(
             GL_TRIANGLES,
-            GL_UNSIGNED_INT,
             reinterpret_cast<const void*>(indirectOffset),
-            (GLsizei)cmdCount,
+            maxDraws,
             stride
         );
     }
@@ -1013,32 +1620,27 @@ void VoxelGridGPU::draw_indirect(const GLuint vao, const glm::mat4& world, const
 void VoxelGridGPU::init_draw_buffers() {
     vao = VAO().init_vao();
 
+    // Вершины вершинный шейдер читает сам из global_vertex_buffer_ (SSBO), атрибут один - id чанка.
+    // Атрибут с divisor 1 читается по индексу baseInstance + gl_InstanceID, а baseInstance = chunkId
+    std::vector<uint32_t> chunk_ids(count_active_chunks);
+    for (uint32_t i = 0; i < count_active_chunks; i++) chunk_ids[i] = i;
+    draw_chunk_ids_ = BufferObject(sizeof(uint32_t) * (size_t)count_active_chunks, GL_STATIC_DRAW, chunk_ids.data());
+
     static VertexLayout vertex_layout;
     if (vertex_layout.attributes.size() == 0) {
         vertex_layout.add(
-            "position",
-            0, 4, GL_FLOAT, GL_FALSE,
-            sizeof(VertexGPU),
-            offsetof(VertexGPU, pos), 
-            0, {0.0f, 0.0f, 0.0f, 1.0f}
-        );
-        vertex_layout.add(
-            "color",
-            1, 1, GL_UNSIGNED_INT, GL_FALSE,
-            sizeof(VertexGPU),
-            offsetof(VertexGPU, color), 
-            0, {0xffffffffu} // белый
-        );
-        vertex_layout.add(
-            "face",
-            2, 1, GL_UNSIGNED_INT, GL_FALSE,
-            sizeof(VertexGPU),
-            offsetof(VertexGPU, face), 
-            0, {0u} // Направление 0 (хз куда это, вверх мб?)
+            "chunk_id",
+            0, 1, GL_UNSIGNED_INT, GL_FALSE,
+            sizeof(uint32_t),
+            0, 
+            1, {0u}
         );
     }
 
-    vao.setup(global_vertex_buffer_, global_index_buffer_, vertex_layout);
+    vao.bind();
+    draw_chunk_ids_.bind_as_vbo();
+    vertex_layout.apply();
+    VAO::unbind();
 }
 
 void VoxelGridGPU::mark_all_used_chunks_as_dirty() {
@@ -1049,7 +1651,7 @@ void VoxelGridGPU::mark_all_used_chunks_as_dirty() {
     prog_mark_all_user_chunks_as_dirty_.use();
 
     glUniform1ui(glGetUniformLocation(prog_mark_all_user_chunks_as_dirty_.id, "u_max_chunks"), count_active_chunks);
-    glUniform1ui(glGetUniformLocation(prog_mark_all_user_chunks_as_dirty_.id, "u_set_dirty_flag_bits"), 1u);
+    glUniform1ui(glGetUniformLocation(prog_mark_all_user_chunks_as_dirty_.id, "u_set_dirty_flag_bits"), DIRTY_FLAG_MESH);
 
     uint32_t groups_x = math_utils::div_up_u32(count_active_chunks, 256u);
     prog_mark_all_user_chunks_as_dirty_.dispatch_compute(groups_x, 1, 1);
@@ -25,6 +25,11 @@
 #include "buffer_dispatch_arg.h"
 #include "value_dispatch_arg.h"
 #include "gpu_timestamp.h"
+#include "chunk_hash_table_mode.h"
+#include "stream_focus.h"
+#include "chunk_spill_cache.h"
+#include "hi_z_pyramid.h"
+#include "gpu_readback.h"
 
 #define DONT_CHANGE 0xFFFFFFFF
 
@@ -47,6 +52,27 @@ public:
     static constexpr uint32_t SLOT_LOCKED = 0xFFFFFFFEu;
     static constexpr uint32_t SLOT_TOMB = 0xFFFFFFFDu; 
 
+    // биты ChunkMetaGPU::dirty_flags, как DIRTY_FLAG_* в buffer_structures.glsl
+    static constexpr uint32_t DIRTY_FLAG_MESH = 1u;
+    static constexpr uint32_t DIRTY_FLAG_USER_MODIFIED = 2u;
+    static constexpr uint32_t DIRTY_FLAG_LOD_HIDDEN = 4u;
+
+    // уровень LOD чанка - key_hi >> CHUNK_KEY_LOD_SHIFT, как в common/lod.glsl
+    static constexpr uint32_t CHUNK_KEY_LOD_SHIFT = 29u;
+    static constexpr uint32_t MAX_LOD_LEVELS = 8u;
+
+    // Ключ чанка на GPU (u_pack_bits/u_pack_offset): 3 * 20 бит координат, выше - уровень LOD.
+    // Своя упаковка, а не math_utils::pack_key: ключи CPU-сетки пишутся в WAL и остаются 21-битными
+    static constexpr uint32_t CHUNK_KEY_BITS = 20u;
+    static constexpr uint32_t CHUNK_KEY_OFFSET = 1u << (CHUNK_KEY_BITS - 1u);
+    static_assert(3 * CHUNK_KEY_BITS <= 32 + CHUNK_KEY_LOD_SHIFT);
+
+    static glm::ivec3 unpack_chunk_key(uint64_t key) {
+        const uint64_t mask = (uint64_t(1) << CHUNK_KEY_BITS) - 1;
+        auto dec = [&](uint32_t shift) { return (int32_t)((key >> shift) & mask) - (int32_t)CHUNK_KEY_OFFSET; };
+        return { dec(2 * CHUNK_KEY_BITS), dec(CHUNK_KEY_BITS), dec(0) };
+    }
+
     glm::ivec3 chunk_size;
     uint32_t count_active_chunks;
     glm::vec3 voxel_size;
@@ -54,12 +80,63 @@ public:
     uint32_t count_evict_buckets;
     uint32_t min_free_chunks;
     float tomb_fraction_to_rebuild;
+    ChunkHashTableMode hash_table_mode;
     uint32_t eviction_bucket_shell_thickness;
     uint32_t vox_per_chunk;
     float render_distance;
 
     const uint32_t min_free_pages = 1024;
 
+    // Дефрагментация пула мешей: сколько чанков можно перенести за кадр (0 - выключена)
+    const uint32_t max_mesh_defrag_moves = 256;
+    const uint32_t mesh_defrag_copy_groups = 4; // групп на копирование одного меша
+    uint32_t mesh_defrag_budget = 32;
+
+    // Подгрузка с упреждением (stream_chunks_sphere со StreamFocus): центр шара сдвигается к предсказанной позиции
+    // не дальше stream_max_center_shift * R, оболочка грузится от ближних к предсказанной позиции,
+    // а при выселении чанки позади камеры считаются дальше в (1 + stream_behind_eviction_weight) раз.
+    float stream_max_center_shift = 0.5f;
+    float stream_behind_eviction_weight = 1.0f;
+    bool log_stream_timings = false; // тайминги фаз stream_chunks_sphere в stdout каждый кадр
+
+    // Клипмап LOD (common/lod.glsl): уровень L - чанки с вокселем в 2^L раз больше, каждый уровень грузит кольцо
+    // радиуса R своих чанков, т.е. дальность растёт в 2^(lod_levels - 1) раз при числе чанков ~lod_levels * шар R.
+    // 1 - без LOD, не больше MAX_LOD_LEVELS. Чанки убранных уровней не выселяются сами: после уменьшения нужен world_init_gpu().
+    uint32_t lod_levels = 1;
+
+    // Приоритет выселения: к оболочке по расстоянию добавляется +1 за каждые eviction_visibility_frames_per_shell
+    // кадров, которые чанк не проходил фрустум-тест (не больше eviction_max_visibility_shells, 0 - выключено).
+    uint32_t eviction_visibility_frames_per_shell = 30;
+    uint32_t eviction_max_visibility_shells = 16;
+
+    // Спилл: выселяемые чанки с DIRTY_FLAG_USER_MODIFIED копируются в одну из count_spill_batches партий
+    // (до spill_batch_slots чанков), читаются после fence и сжатыми лежат в spill_cache. Без свободной партии
+    // такие чанки не выселяются. При подгрузке сферы из кеша восстанавливается до max_restores_per_frame чанков.
+    const uint32_t count_spill_batches = 3;
+    const uint32_t spill_batch_slots = 32;
+    const uint32_t max_restores_per_frame = 32;
+
+    ChunkSpillCache spill_cache;
+
+    // Чтение счётчиков и статистики без остановки конвейера (отладчик, fallback draw_indirect).
+    // Готовые запросы завершаются в начале draw()
+    GPUReadback readback;
+
+    // Двухфазный occlusion culling в draw(): сначала рисуются чанки, видимые в прошлом кадре, по получившейся
+    // глубине строится Hi-Z, затем остальные чанки фрустума проверяются по нему и видимые дорисовываются.
+    bool occlusion_culling = true;
+
+    // фазы build_indirect_cmds.glsl
+    static constexpr uint32_t CULL_PHASE_FRUSTUM = 0u;
+    static constexpr uint32_t CULL_PHASE_VISIBLE_LAST_FRAME = 1u;
+    static constexpr uint32_t CULL_PHASE_OCCLUSION = 2u;
+
+    // Квады меша чанка сгруппированы по направлению граней (ChunkMeshAlloc::face_quads), build_indirect_cmds
+    // пропускает направления, которые не могут смотреть на камеру. Видимые соседние диапазоны склеиваются,
+    // поэтому на чанк приходится не больше max_draws_per_chunk команд.
+    bool face_direction_culling = true;
+    static constexpr uint32_t max_draws_per_chunk = 3u;
+
     struct BucketHead {
         uint32_t id;
         uint32_t count;
@@ -110,33 +187,28 @@ public:
     static_assert(sizeof(VoxelWriteGPU) == 32);
     static_assert(alignof(VoxelWriteGPU) == 16);
 
-    struct DrawElementsIndirectCommand {
+    struct DrawArraysIndirectCommand {
         uint32_t count;
         uint32_t instanceCount;
-        uint32_t firstIndex;
-        int32_t  baseVertex;
+        uint32_t first;
         uint32_t baseInstance;
     };
-    static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+    static_assert(sizeof(DrawArraysIndirectCommand) == 16);
 
-    struct alignas(16) VertexGPU {
-        glm::vec4 pos;    // xyz position, w=1
-        uint32_t color;  // RGBA8
-        uint32_t face;   // 0..5
-        uint32_t pad0;
-        uint32_t pad1;
+    // Упакованная вершина, см. Vertex в buffer_structures.glsl
+    struct VertexGPU {
+        uint32_t pos_face; // x | y << 8 | z << 16 | face << 24, координаты угла вокселя внутри чанка
+        uint32_t color;    // RGB8 + AO в младшем байте
     };
-    static_assert(sizeof(VertexGPU) == 32);
-    static_assert(alignof(VertexGPU) == 16);
+    static_assert(sizeof(VertexGPU) == 8);
+    static constexpr int max_vertex_chunk_dim = 255; // 8 бит на координату
 
     struct ChunkMeshAlloc {
         uint32_t v_startPage; 
         uint32_t v_order; 
         uint32_t needV; 
-        uint32_t i_startPage; 
-        uint32_t i_order; 
-        uint32_t needI;
         uint32_t need_rebuild;
+        uint32_t face_quads[6]; // +X -X +Y -Y +Z -Z, квады в меше идут в этом порядке
     };
 
 
@@ -188,6 +260,90 @@ public:
         uint32_t next;
     };
 
+    static constexpr uint32_t MESH_POOL_MAX_ORDERS = 32u;
+
+    struct MeshPoolStatsGPU {
+        uint32_t free_blocks[MESH_POOL_MAX_ORDERS];
+        uint32_t alloc_blocks[MESH_POOL_MAX_ORDERS];
+        uint32_t free_pages;
+        uint32_t alloc_pages;
+        uint32_t largest_free_order; // order + 1, 0 - свободных блоков нет
+        uint32_t stranded_blocks;    // занятые блоки со свободным buddy
+    };
+    static_assert(sizeof(MeshPoolStatsGPU) == 272);
+
+    struct StreamStateGPU {
+        glm::ivec4 center;
+        int32_t radius;
+        uint32_t full_pass;
+        uint32_t rescan_requested;
+        uint32_t pad0;
+    };
+    static_assert(sizeof(StreamStateGPU) == 32);
+
+    // Видимые чанки без готового меша (stream_hole_stats.glsl)
+    struct StreamHoleStatsGPU {
+        uint32_t visible_count;
+        uint32_t missing_count;   // нет в таблице
+        uint32_t unmeshed_count;  // есть, но ещё грязный
+        uint32_t pad0;
+
+        float hole_rate() const { return visible_count ? (float)(missing_count + unmeshed_count) / (float)visible_count : 0.0f; }
+    };
+    static_assert(sizeof(StreamHoleStatsGPU) == 16);
+
+    struct MeshDefragMoveGPU {
+        uint32_t chunk_id;
+        uint32_t old_v_startPage;
+        uint32_t new_v_startPage;
+        uint32_t v_order;
+        uint32_t needV;
+    };
+    static_assert(sizeof(MeshDefragMoveGPU) == 20);
+
+    // как SpillRecord / RestoreRecord в buffer_structures.glsl
+    struct SpillRecordGPU {
+        uint32_t chunk_id;
+        uint32_t key_lo;
+        uint32_t key_hi;
+        uint32_t pad0;
+    };
+    static_assert(sizeof(SpillRecordGPU) == 16);
+
+    // Заголовок партии спилла, за ним spill_batch_slots записей SpillRecordGPU
+    struct SpillBatchHeaderGPU {
+        uint32_t count;    // может быть больше spill_batch_slots - лишние чанки не выселены
+        uint32_t overflow;
+        uint32_t pad0;
+        uint32_t pad1;
+    };
+    static_assert(sizeof(SpillBatchHeaderGPU) == 16);
+
+    static constexpr uint32_t RESTORE_FAILED = 0u;
+    static constexpr uint32_t RESTORE_OK = 1u;
+    static constexpr uint32_t RESTORE_SKIPPED = 2u;
+
+    struct RestoreRecordGPU {
+        uint32_t key_lo;
+        uint32_t key_hi;
+        uint32_t chunk_id;
+        uint32_t status;
+    };
+    static_assert(sizeof(RestoreRecordGPU) == 16);
+
+    // Счётчики отсечения за последний кадр (OcclusionStats в buffer_structures.glsl)
+    struct OcclusionStatsGPU {
+        uint32_t distance_culled;
+        uint32_t frustum_culled;
+        uint32_t occlusion_culled;
+        uint32_t drawn_first_pass;
+        uint32_t drawn_second_pass;
+        uint32_t drawn_quads;
+        uint32_t face_culled_quads;
+        uint32_t pad0;
+    };
+    static_assert(sizeof(OcclusionStatsGPU) == 32);
+
 
     VoxelGridGPU(
         glm::ivec3 chunk_size, 
@@ -200,10 +356,11 @@ public:
         float tomb_fraction_to_rebuild,
         float eviction_bucket_shell_thickness,
         uint32_t vb_page_size_order_of_two,
-        uint32_t ib_page_size_order_of_two,
         float buddy_allocator_nodes_factor,
         float render_distance,
-        ShaderManager& shader_manager);
+        ShaderManager& shader_manager,
+        ChunkHashTableMode hash_table_mode = ChunkHashTableMode::Linear);
+    ~VoxelGridGPU();
 
     void apply_writes_to_world_gpu(uint32_t write_count);
     void apply_writes_to_world_from_cpu(const std::vector<glm::ivec3>& positions, const std::vector<VoxelDataGPU>& voxels);
@@ -213,8 +370,16 @@ public:
                                                     const glm::vec3& cam_pos);
     void reset_load_list_counter();
     void mark_chunk_to_generate(const glm::vec3& cam_world_pos, int radius_chunks);
+    void mark_chunk_to_generate(const StreamFocus& focus, int radius_chunks);
+    void update_lod_visibility(const glm::ivec3* lod_centers, uint32_t levels, int radius_chunks);
     void generate_terrain(const BufferObject& dispatch_args, uint32_t seed);
     void stream_chunks_sphere(const glm::vec3& cam_world_pos, int radius_chunks, uint32_t seed);
+    void stream_chunks_sphere(const StreamFocus& focus, int radius_chunks, uint32_t seed);
+
+    // Готово через readback через несколько кадров
+    std::future<StreamHoleStatsGPU> request_stream_holes(const glm::mat4& view_proj, const glm::vec3& cam_pos);
+    // С ожиданием GPU, для замеров
+    StreamHoleStatsGPU measure_stream_holes(const glm::mat4& view_proj, const glm::vec3& cam_pos);
     
     virtual void draw(RenderState state) override;
 
@@ -232,12 +397,21 @@ public:
     ComputeProgram prog_mesh_finalize_;
     ComputeProgram prog_cmdcount_reset_;
     ComputeProgram prog_build_indirect_cmds_;
+    ComputeProgram prog_clear_indirect_cmds_tail_;
     ComputeProgram prog_reset_dirty_count_;
     ComputeProgram prog_evict_buckets_build_;
     ComputeProgram prog_evict_low_priority_;
     ComputeProgram prog_evict_low_priority_dispatch_adapter_;
     ComputeProgram prog_stream_select_chunks_;
+    ComputeProgram prog_stream_select_dispatch_adapter_;
     ComputeProgram prog_stream_generate_terrain_;
+    ComputeProgram prog_stream_hole_stats_;
+    ComputeProgram prog_stream_restore_select_;
+    ComputeProgram prog_stream_restore_copy_;
+    ComputeProgram prog_stream_lod_visibility_;
+    ComputeProgram prog_evict_spill_copy_;
+    ComputeProgram prog_hiz_copy_depth_;
+    ComputeProgram prog_hiz_downsample_;
     ComputeProgram prog_mark_all_user_chunks_as_dirty_;
     ComputeProgram prog_mesh_pool_clear_;
     ComputeProgram prog_mesh_pool_seed_;
@@ -249,6 +423,10 @@ public:
     ComputeProgram prog_clear_chunk_hash_table_;
     ComputeProgram prog_reset_evicted_list_and_buckets_;
     ComputeProgram prog_hash_table_conditional_dispatch_adapter_;
+    ComputeProgram prog_mesh_pool_stats_;
+    ComputeProgram prog_mesh_pool_defrag_plan_;
+    ComputeProgram prog_mesh_pool_defrag_copy_;
+    ComputeProgram prog_mesh_pool_defrag_free_;
     VfProgram prog_vf_voxel_mesh_diffusion_spec_;
 
     BufferObject dispatch_args;
@@ -263,7 +441,7 @@ public:
     BufferObject enqueued_;
     BufferObject dirty_list_;
     BufferObject global_vertex_buffer_;
-    BufferObject global_index_buffer_;
+    BufferObject draw_chunk_ids_; // 0..count_active_chunks-1, instanced атрибут: при instanceCount = 1 даёт baseInstance
     BufferObject voxel_prifab_;
     BufferObject dirty_quad_count_;
     BufferObject emit_counters_;
@@ -271,9 +449,33 @@ public:
     BufferObject bucket_heads_;
     BufferObject bucket_next_;
     BufferObject load_list_;
+    BufferObject stream_state_;
+    BufferObject stream_shell_offsets_;
+    BufferObject stream_hole_stats_;
+    BufferObject chunk_last_visible_; // кадр, когда чанк последний раз прошёл фрустум-тест (или был сгенерирован)
+    BufferObject chunk_visible_;      // 1 - чанк прошёл Hi-Z тест в прошлом кадре, рисуется в первой фазе
+    BufferObject occlusion_stats_;
     BufferObject failed_dirty_list_;
     BufferObject verify_debug_stack_;
     BufferObject evicted_chunks_list_;
+    BufferObject evict_freed_count_; // сколько id вернул в free_list текущий проход выселения
+
+    // Партии спилла: у каждой свой буфер, чтобы чтение одной после fence не ждало записи в следующие
+    struct SpillBatch {
+        BufferObject records; // SpillBatchHeaderGPU + SpillRecordGPU[spill_batch_slots]
+        BufferObject voxels;  // VoxelDataGPU[spill_batch_slots * vox_per_chunk]
+        GLsync fence = nullptr;
+    };
+    std::vector<SpillBatch> spill_batches_;
+    uint32_t spill_batch_current_ = 0;
+    uint32_t spill_capacity_ = 0; // мест в партии текущего выселения, 0 - партии нет
+    uint64_t count_spill_overflow_ = 0;
+
+    BufferObject restore_records_;
+    BufferObject restore_voxels_;
+    GLsync restore_fence_ = nullptr;
+    std::vector<RestoreRecordGPU> restore_in_flight_;
+    std::vector<bool> restore_in_flight_valid_; // false - ключ снова выселен до чтения статуса, из кеша не удалять
 
     BufferObject vb_heads_;
     BufferObject vb_state_;
@@ -281,26 +483,30 @@ public:
     BufferObject vb_free_nodes_list_;
     BufferObject vb_returned_nodes_list;
 
-    BufferObject ib_heads_;
-    BufferObject ib_state_;
-    BufferObject ib_nodes_;
-    BufferObject ib_free_nodes_list_;
-    BufferObject ib_returned_nodes_list;
-
     BufferObject chunk_mesh_alloc_local_;
     BufferObject chunk_mesh_alloc_;
 
+    BufferObject mesh_pool_stats_;
+    BufferObject mesh_defrag_moves_;
+
     uint32_t vb_page_size_ = 0;
     uint32_t count_vb_pages_ = 0;
     uint32_t count_vb_nodes_ = 0;
     uint32_t vb_order_ = 0;
     uint32_t max_mesh_vertices_ = 0;
     
-    uint32_t ib_page_size_ = 0;
-    uint32_t count_ib_pages_ = 0;
-    uint32_t count_ib_nodes_ = 0;
-    uint32_t ib_order_ = 0;
-    uint32_t max_mesh_indices_ = 0;
+    // Последний отбор mark_chunk_to_generate: следующий идёт только по вошедшей в сферу оболочке
+    glm::ivec3 stream_cam_chunk_ = glm::ivec3(0);
+    int stream_radius_ = -1;
+    bool stream_has_center_ = false;
+    uint32_t stream_lod_levels_ = 0;
+    bool stream_lod_visibility_dirty_ = false; // восстановлены чанки из спилла - их кольцо ещё не проверено
+    std::vector<glm::ivec4> stream_shell_;
+    uint32_t stream_seed_ = 0; // seed последнего stream_chunks_sphere: им же VoxelRasterizatorGPU генерирует созданные чанки
+
+    uint32_t frame_index_ = 0; // растёт в build_indirect_draw_commands_frustum и draw_occlusion_culled
+
+    HiZPyramid hiz_pyramid_;
 
     VAO vao;
 
@@ -320,19 +526,25 @@ public:
         const DispatchArg& arg_z = ValueDispatchArg(1u)
     );
 
+    uint32_t visibility_age_shells(uint32_t last_visible_frame) const;
+
     void reset_heads(); 
-    void build_bucket_lists(const glm::vec3& cam_pos); 
+    void build_bucket_lists(const glm::vec3& cam_pos, const glm::vec3& focus_dir = glm::vec3(0.0f)); 
     void prepare_evict_lowpriority_chunks(const BufferObject& dispatch_args); 
     void evict_lowpriority_chunks(const BufferObject& dispatch_args); 
     void free_evicted_chunks_mesh(const BufferObject& dispatch_args); 
     void reset_evicted_list_and_buckets();
-    void ensure_free_chunks_gpu(const glm::vec3& cam_pos, uint32_t pack_bits, uint32_t pack_offset); 
+    void ensure_free_chunks_gpu(const glm::vec3& cam_pos, uint32_t pack_bits, uint32_t pack_offset, const glm::vec3& focus_dir = glm::vec3(0.0f)); 
     void ensure_voxel_write_list(size_t count); 
 
+    bool begin_spill_batch();
+    void spill_evicted_chunks();
+    void poll_spill_readbacks();
+    void restore_spilled_chunks(const glm::vec3& center_world_pos, int radius_chunks);
+    bool poll_restores();
+
     void mesh_reset(const BufferObject& dispatch_args); 
     void mesh_count(const BufferObject& dispatch_args, uint32_t pack_bits, uint32_t pack_offset); 
-    void mesh_alloc_vb(const BufferObject& dispatch_args); 
-    void mesh_alloc_ib(const BufferObject& dispatch_args); 
     void mesh_alloc(const BufferObject& dispatch_args); 
     void verify_mesh_allocation(const BufferObject& dispatch_args); 
     void prepare_return_free_alloc_nodes(BufferObject& dispatch_args); 
@@ -342,9 +554,20 @@ public:
     void reset_dirty_count(); 
     void build_mesh_from_dirty(uint32_t pack_bits, int pack_offset); 
 
+    void compute_mesh_pool_stats();
+    std::future<MeshPoolStatsGPU> request_mesh_pool_stats(); // через readback, для отладки
+    void mesh_pool_defrag_plan(uint32_t max_moves);
+    void mesh_pool_defrag_copy(const BufferObject& dispatch_args);
+    void mesh_pool_defrag_free(const BufferObject& dispatch_args);
+    void defrag_mesh_pool(uint32_t max_moves);
+
     void reset_cmd_count();
-    void build_draw_commands(const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset); 
+    void clear_indirect_cmds_tail(); // без ARB_indirect_parameters, после build_draw_commands
+    void build_draw_commands(const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset,
+                             uint32_t cull_phase = CULL_PHASE_FRUSTUM, const glm::mat4& occlusion_view_proj = glm::mat4(1.0f)); 
     void build_indirect_draw_commands_frustum(const glm::mat4& viewProj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset); 
+    void draw_occlusion_culled(const glm::mat4& world, const glm::mat4& view_proj, const glm::vec3& cam_pos, uint32_t pack_bits, int pack_offset);
+    std::future<OcclusionStatsGPU> request_occlusion_stats(); // через readback, для отладки
 
     void draw_indirect(const GLuint vao, const glm::mat4& world, const glm::mat4& proj_view, const glm::vec3& cam_pos); 
 
@@ -3,7 +3,7 @@
 VoxelGridGPUDebugger::VoxelGridGPUDebugger(std::shared_ptr<VoxelGridGPU> voxel_grid, std::shared_ptr<Window> window) 
 : voxel_grid(voxel_grid), window(window) {
     std::function<void()> build_mesh_from_dirty_fn = [&](){
-        voxel_grid->build_mesh_from_dirty(math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->build_mesh_from_dirty(VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     };
 
     std::function<void()> build_indirect_draw_commands_frustum_fn = [&]() {
@@ -11,7 +11,7 @@ VoxelGridGPUDebugger::VoxelGridGPUDebugger(std::shared_ptr<VoxelGridGPU> voxel_g
         glm::mat4 view_matrix = window->camera->get_view_matrix();
         glm::mat4 proj_matrix = window->camera->get_projection_matrix(aspect);
         glm::mat4 view_proj_matrix = proj_matrix * view_matrix;
-        voxel_grid->build_indirect_draw_commands_frustum(view_proj_matrix, window->camera->position, math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->build_indirect_draw_commands_frustum(view_proj_matrix, window->camera->position, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     };
 
     std::function<void()> draw_indirect_fn = [&]() {
@@ -26,7 +26,10 @@ VoxelGridGPUDebugger::VoxelGridGPUDebugger(std::shared_ptr<VoxelGridGPU> voxel_g
     voxel_grid_draw_steps = {build_mesh_from_dirty_fn, build_indirect_draw_commands_frustum_fn, draw_indirect_fn};
 
     std::function<void()> ensure_free_chunks_fn = [&]() {
-        voxel_grid->ensure_free_chunks_gpu(window->camera->position, math_utils::BITS, math_utils::OFFSET);
+        StreamFocus focus = stream_focus();
+        glm::vec3 chunk_world_size = glm::vec3(voxel_grid->chunk_size) * voxel_grid->voxel_size;
+        float max_shift = voxel_grid->stream_max_center_shift * stream_radius_chunks * std::min({chunk_world_size.x, chunk_world_size.y, chunk_world_size.z});
+        voxel_grid->ensure_free_chunks_gpu(focus.stream_center(max_shift), VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET, focus.direction);
     };
 
     std::function<void()> reset_load_list_counter_fn = [&]() {
@@ -34,8 +37,7 @@ VoxelGridGPUDebugger::VoxelGridGPUDebugger(std::shared_ptr<VoxelGridGPU> voxel_g
     };
 
     std::function<void()> mark_chunk_to_generate_fn = [&]() {
-        int radius_chunks = 15;
-        voxel_grid->mark_chunk_to_generate(window->camera->position, radius_chunks);
+        voxel_grid->mark_chunk_to_generate(stream_focus(), stream_radius_chunks);
     };
 
     std::function<void()> generate_terrain_fn = [&]() {
@@ -48,467 +50,533 @@ VoxelGridGPUDebugger::VoxelGridGPUDebugger(std::shared_ptr<VoxelGridGPU> voxel_g
 }
 
 
-void VoxelGridGPUDebugger::print_counters() {
-    uint32_t load_list_count = voxel_grid->load_list_.read_scalar<uint32_t>(0u);
-    uint32_t write_count = voxel_grid->voxel_write_list_.read_scalar<uint32_t>(0);
-    uint32_t dirty_count = voxel_grid->dirty_list_.read_scalar<uint32_t>(0);
-    uint32_t cmd_count = voxel_grid->indirect_cmds_.read_scalar<uint32_t>(0);
-    uint32_t free_count = voxel_grid->free_list_.read_scalar<uint32_t>(0);
-    uint32_t failed_dirty_count = voxel_grid->failed_dirty_list_.read_scalar<uint32_t>(0);
-    uint32_t is_vb_full = voxel_grid->mesh_buffers_status_.read_scalar<uint32_t>(0);
-    uint32_t is_ib_full = voxel_grid->mesh_buffers_status_.read_scalar<uint32_t>(sizeof(uint32_t));
-
-    std::cout << "write_count: " << write_count << std::endl;
-    std::cout << "dirty_count: " << dirty_count << std::endl;
-    std::cout << "cmd_count: " << cmd_count << std::endl;
-    std::cout << "free_count: " << free_count << std::endl;
-    std::cout << "failed_dirty_count: " << failed_dirty_count << std::endl;
-    std::cout << "is_vb_full: " << (is_vb_full == 1u ? "TRUE" : "FALSE") << std::endl;
-    std::cout << "count_ib_free_pages: " << (is_ib_full == 1u ? "TRUE" : "FALSE") << std::endl;
-    std::cout << "load_list_count: " << load_list_count << std::endl;
-
-    uint32_t count_free_nodes_vb = voxel_grid->vb_free_nodes_list_.read_scalar<uint32_t>(0);
-    uint32_t count_free_nodes_ib = voxel_grid->ib_free_nodes_list_.read_scalar<uint32_t>(0);
-
-    std::cout << "count_free_nodes_vb: " << count_free_nodes_vb << std::endl;
-    std::cout << "count_free_nodes_ib: " << count_free_nodes_ib << std::endl;
-
-    std::cout << std::endl;
+StreamFocus VoxelGridGPUDebugger::stream_focus() const {
+    if (stream_prediction && camera_controller != nullptr)
+        return camera_controller->stream_focus(stream_lookahead_seconds);
+    return StreamFocus(window->camera->position);
+}
 
-    print_count_free_mesh_alloc();
+void VoxelGridGPUDebugger::reset_streamed_world() {
+    voxel_grid->world_init_gpu();
+    voxel_grid->init_mesh_pool();
+    voxel_grid->stream_state_.update_subdata_fill<uint32_t>(0u, 0u, sizeof(VoxelGridGPU::StreamStateGPU) * VoxelGridGPU::MAX_LOD_LEVELS, *voxel_grid->shader_manager);
+    voxel_grid->stream_has_center_ = false;
 }
 
-void VoxelGridGPUDebugger::print_count_free_mesh_alloc() {
-    std::vector<VoxelGridGPU::ChunkMeshAlloc> alloc_meta(voxel_grid->count_active_chunks);
-    std::vector<uint32_t> vb_states(voxel_grid->count_vb_pages_);
-    std::vector<uint32_t> ib_states(voxel_grid->count_ib_pages_);
-    std::vector<uint32_t> vb_heads(voxel_grid->vb_order_ + 1);
-    std::vector<uint32_t> ib_heads(voxel_grid->ib_order_ + 1);
-    std::vector<VoxelGridGPU::AllocNode> vb_nodes(voxel_grid->count_vb_nodes_);
-    std::vector<VoxelGridGPU::AllocNode> ib_nodes(voxel_grid->count_ib_nodes_);
-    std::vector<uint32_t> dirty_list;
-    uint32_t dirty_count;
-
-    voxel_grid->chunk_mesh_alloc_.read_subdata(0, sizeof(VoxelGridGPU::ChunkMeshAlloc) * voxel_grid->count_active_chunks, alloc_meta.data());
-    voxel_grid->vb_state_.read_subdata(0, sizeof(uint32_t) * voxel_grid->count_vb_pages_, vb_states.data());
-    voxel_grid->ib_state_.read_subdata(0, sizeof(uint32_t) * voxel_grid->count_ib_pages_, ib_states.data());
-    voxel_grid->vb_heads_.read_subdata(0, sizeof(uint32_t) * (voxel_grid->vb_order_ + 1), vb_heads.data());
-    voxel_grid->ib_heads_.read_subdata(0, sizeof(uint32_t) * (voxel_grid->ib_order_ + 1), ib_heads.data());
-    voxel_grid->vb_nodes_.read_subdata(0, sizeof(VoxelGridGPU::AllocNode) * voxel_grid->count_vb_nodes_, vb_nodes.data());
-    voxel_grid->ib_nodes_.read_subdata(0, sizeof(VoxelGridGPU::AllocNode) * voxel_grid->count_ib_nodes_, ib_nodes.data());
-    voxel_grid->dirty_list_.read_subdata(0, sizeof(uint32_t), &dirty_count);
-    dirty_list.resize(dirty_count);
-    voxel_grid->dirty_list_.read_subdata(sizeof(uint32_t), sizeof(uint32_t) * dirty_count, dirty_list.data());
-
-    //=================РАСЧЁТ ДАННЫХ ПО MESH_ALLOC=================
-    std::unordered_set<uint32_t> allocated_mesh;
-    uint32_t count_alloc_vb_pages_from_meta = 0, count_alloc_ib_pages_from_meta = 0;
-    uint32_t count_vb_alloc_chunks_from_meta = 0, count_ib_alloc_chunks_from_meta = 0;
-    for (uint32_t i = 0; i < voxel_grid->count_active_chunks; i++) {
-        VoxelGridGPU::ChunkMeshAlloc& meta = alloc_meta[i];
-        if (meta.v_startPage != voxel_grid->INVALID_ID) {
-            count_alloc_vb_pages_from_meta += 1 << meta.v_order;
-            count_vb_alloc_chunks_from_meta++;
-            allocated_mesh.insert(i);
-        }
+float VoxelGridGPUDebugger::run_stream_hole_benchmark(bool prediction, float& worst_hole_rate) {
+    Camera* camera = window->camera;
+    glm::vec3 start_position = camera->position;
+    glm::vec3 dir = glm::normalize(camera->front);
+    glm::vec3 velocity = dir * hole_benchmark_speed;
+    float aspect = window->get_fbuffer_aspect_ratio();
 
-        if (meta.i_startPage != voxel_grid->INVALID_ID) {
-            count_alloc_ib_pages_from_meta += 1 << meta.i_order;
-            count_ib_alloc_chunks_from_meta++;
-            allocated_mesh.insert(i);
-        }
-    }
+    // с чистого мира, чтобы прогоны с упреждением и без были в равных условиях
+    reset_streamed_world();
 
-    //=================РАСЧЁТ ПЕРЕСЕЧЕНИЙ ПО MESH_ALLOC=================
-    std::vector<uint32_t> ids(allocated_mesh.begin(), allocated_mesh.end());
-    std::vector<std::pair<uint32_t,uint32_t>> v_pairs, i_pairs;
-    v_pairs.reserve(64); i_pairs.reserve(64);
+    bool log_stream_timings = voxel_grid->log_stream_timings;
+    voxel_grid->log_stream_timings = false;
 
-    for (size_t a = 0; a < ids.size(); ++a) {
-        for (size_t b = a + 1; b < ids.size(); ++b) {
-            uint32_t ida = ids[a], idb = ids[b];
-            const auto &A = alloc_meta[ida];
-            const auto &B = alloc_meta[idb];
+    double sum_hole_rate = 0.0;
+    uint64_t sum_visible = 0, sum_missing = 0, sum_unmeshed = 0;
+    worst_hole_rate = 0.0f;
 
-            uint64_t vsA = A.v_startPage, vsB = B.v_startPage;
-            uint64_t vlA = (A.v_order < 64) ? (1ull << A.v_order) : UINT64_MAX;
-            uint64_t vlB = (B.v_order < 64) ? (1ull << B.v_order) : UINT64_MAX;
-            if (math_utils::intersects(vsA, vlA, vsB, vlB)) v_pairs.emplace_back(ida, idb);
+    for (int frame = 0; frame < hole_benchmark_frames; frame++) {
+        camera->position = start_position + velocity * (hole_benchmark_dt * (float)frame);
 
-            uint64_t isA = A.i_startPage, isB = B.i_startPage;
-            uint64_t ilA = (A.i_order < 64) ? (1ull << A.i_order) : UINT64_MAX;
-            uint64_t ilB = (B.i_order < 64) ? (1ull << B.i_order) : UINT64_MAX;
-            if (math_utils::intersects(isA, ilA, isB, ilB)) i_pairs.emplace_back(ida, idb);
-        }
-    }
-    
-    //=================РАСЧЁТ ДАННЫХ VB ПО STATES=================
-    uint32_t count_vb_free = 0, vb_free_pages = 0;
-    uint32_t count_vb_alloc = 0, vb_alloc_pages = 0;
-    uint32_t count_vb_merged = 0, vb_merged_pages = 0;
-    uint32_t count_vb_merging = 0, vb_merging_pages = 0;
-    uint32_t count_vb_ready = 0, vb_ready_pages = 0;
-    uint32_t count_vb_conceded = 0, vb_conceded_pages = 0;
-    for (uint32_t i = 0; i < voxel_grid->count_vb_pages_; i++) {
-        uint32_t kind = vb_states[i] & voxel_grid->ST_MASK;
-        uint32_t order = vb_states[i] >> voxel_grid->ST_MASK_BITS;
-        uint32_t count_pages = 1u << order;
-        if (kind == voxel_grid->ST_FREE) {count_vb_free++; vb_free_pages += count_pages; }
-        if (kind == voxel_grid->ST_ALLOC) {count_vb_alloc++; vb_alloc_pages += count_pages; }
-        if (kind == voxel_grid->ST_MERGED) {count_vb_merged++; vb_merged_pages += count_pages; }
-    }
-
-    //=================РАСЧЁТ ДАННЫХ IB ПО STATES=================
-    uint32_t count_ib_free = 0, ib_free_pages = 0;
-    uint32_t count_ib_alloc = 0, ib_alloc_pages = 0;
-    uint32_t count_ib_merged = 0, ib_merged_pages = 0;
-    uint32_t count_ib_merging = 0, ib_merging_pages = 0;
-    uint32_t count_ib_ready = 0, ib_ready_pages = 0;
-    uint32_t count_ib_conceded = 0, ib_conceded_pages = 0;
-    for (uint32_t i = 0; i < voxel_grid->count_ib_pages_; i++) {
-        uint32_t kind = ib_states[i] & voxel_grid->ST_MASK;
-        uint32_t order = ib_states[i] >> voxel_grid->ST_MASK_BITS;
-        uint32_t count_pages = 1u << order;
-        if (kind == voxel_grid->ST_FREE) {count_ib_free++; ib_free_pages += count_pages; }
-        if (kind == voxel_grid->ST_ALLOC) {count_ib_alloc++; ib_alloc_pages += count_pages; }
-        if (kind == voxel_grid->ST_MERGED) {count_ib_merged++; ib_merged_pages += count_pages; }
-    }
-
-    //=================РАСЧЁТ ДАННЫХ VB ПО HEADS=================
-    std::vector<uint32_t> count_free_states_by_vb_order(voxel_grid->vb_order_ + 1, 0);
-    std::vector<uint32_t> count_free_pages_by_vb_order(voxel_grid->vb_order_ + 1, 0);
-    uint32_t count_free_states_by_vb_heads = 0, count_free_pages_by_vb_heads = 0;
-    for (uint32_t order = 0; order <= voxel_grid->vb_order_; order++) {
-        uint32_t head_idx = vb_heads[order] >> voxel_grid->HEAD_TAG_BITS;
-        uint32_t cur_node = head_idx != voxel_grid->INVALID_HEAD_IDX ? head_idx : voxel_grid->INVALID_ID;
-        uint32_t order_size = 1u << order;
-        while (cur_node != voxel_grid->INVALID_ID) {
-            uint32_t page_id = vb_nodes[cur_node].page;
-            uint32_t kind = vb_states[page_id] & voxel_grid->ST_MASK;
-            uint32_t real_order = vb_states[page_id] >> voxel_grid->ST_MASK_BITS;
-            if (kind == voxel_grid->ST_FREE && real_order == order) {
-                count_free_states_by_vb_order[order]++;
-                count_free_pages_by_vb_order[order] += order_size;
-
-                count_free_states_by_vb_heads++;
-                count_free_pages_by_vb_heads += order_size;
-            }
-            cur_node = vb_nodes[cur_node].next;
-        }
-    }
+        StreamFocus focus = prediction ? StreamFocus::predict(camera->position, velocity, dir, stream_lookahead_seconds)
+                                       : StreamFocus(camera->position);
+        voxel_grid->stream_chunks_sphere(focus, stream_radius_chunks, 45345345u);
+        voxel_grid->build_mesh_from_dirty(VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
 
-    //=================РАСЧЁТ ДАННЫХ IB ПО HEADS=================
-    std::vector<uint32_t> count_free_states_by_ib_order(voxel_grid->ib_order_ + 1, 0);
-    std::vector<uint32_t> count_free_pages_by_ib_order(voxel_grid->ib_order_ + 1, 0);
-    uint32_t count_free_states_by_ib_heads = 0, count_free_pages_by_ib_heads = 0;
-    for (uint32_t order = 0; order <= voxel_grid->ib_order_; order++) {
-        uint32_t head_idx = ib_heads[order] >> voxel_grid->HEAD_TAG_BITS;
-        uint32_t cur_node = head_idx != voxel_grid->INVALID_HEAD_IDX ? head_idx : voxel_grid->INVALID_ID;
-        uint32_t order_size = 1u << order;
-        while (cur_node != voxel_grid->INVALID_ID) {
-            uint32_t page_id = ib_nodes[cur_node].page;
-            uint32_t kind = ib_states[page_id] & voxel_grid->ST_MASK;
-            uint32_t real_order = ib_states[page_id] >> voxel_grid->ST_MASK_BITS;
-            if (kind == voxel_grid->ST_FREE && real_order == order) {
-                count_free_states_by_ib_order[order]++;
-                count_free_pages_by_ib_order[order] += order_size;
-
-                count_free_states_by_ib_heads++;
-                count_free_pages_by_ib_heads += order_size;
-            }
-            cur_node = ib_nodes[cur_node].next;
-        }
+        glm::mat4 view_proj = camera->get_projection_matrix(aspect) * camera->get_view_matrix();
+        VoxelGridGPU::StreamHoleStatsGPU stats = voxel_grid->measure_stream_holes(view_proj, camera->position);
+
+        float hole_rate = stats.hole_rate();
+        sum_hole_rate += hole_rate;
+        worst_hole_rate = std::max(worst_hole_rate, hole_rate);
+        sum_visible += stats.visible_count;
+        sum_missing += stats.missing_count;
+        sum_unmeshed += stats.unmeshed_count;
     }
 
+    voxel_grid->log_stream_timings = log_stream_timings;
+    camera->position = start_position;
 
-    std::cout << "---INTERSECTIONS---" << std::endl;
-    std::cout << "==Vertex buffer==" << std::endl;
-    std::cout << "Count vb intersections: " << v_pairs.size() << std::endl;
-    std::cout << std::endl;
-    std::cout << "==Index buffer==" << std::endl;
-    std::cout << "Count ib intersections: " << i_pairs.size() << std::endl;
-    std::cout << std::endl;
+    float mean_hole_rate = hole_benchmark_frames > 0 ? (float)(sum_hole_rate / hole_benchmark_frames) : 0.0f;
 
-    std::cout << "---DATA FROM STATES BUFFER---" << std::endl;
-    std::cout << "==Vertex buffer==" << std::endl;
-    std::cout << "ST_FREE:      count states = " << count_vb_free     << "  count pages = " << vb_free_pages << std::endl;
-    std::cout << "ST_ALLOC:     count states = " << count_vb_alloc    << "  count pages = " << vb_alloc_pages << std::endl;
-    std::cout << "ST_MERGED:    count states = " << count_vb_merged   << "  count pages = " << vb_merged_pages << std::endl;
-    std::cout << "ST_MERGING:   count states = " << count_vb_merging  << "  count pages = " << vb_merging_pages << std::endl;
-    std::cout << "ST_READY:     count states = " << count_vb_ready    << "  count pages = " << vb_ready_pages << std::endl;
-    std::cout << "ST_CONCEDED:  count states = " << count_vb_conceded << "  count pages = " << vb_conceded_pages << std::endl;
-    std::cout << "SUM (free + alloc): count states = " << count_vb_free + count_vb_alloc << "  count pages = " << vb_free_pages + vb_alloc_pages << std::endl;
-    std::cout << "REAL_COUNT_PAGES: " << voxel_grid->count_vb_pages_ << std::endl;
-    std::cout << "LIMBO: " << (int)voxel_grid->count_vb_pages_ - (vb_free_pages + vb_alloc_pages) << std::endl;
-    std::cout << std::endl;
-    std::cout << "==Index buffer==" << std::endl;
-    std::cout << "ST_FREE:      count states = " << count_ib_free     << "  count pages = " << ib_free_pages << std::endl;
-    std::cout << "ST_ALLOC:     count states = " << count_ib_alloc    << "  count pages = " << ib_alloc_pages << std::endl;
-    std::cout << "ST_MERGED:    count states = " << count_ib_merged   << "  count pages = " << ib_merged_pages << std::endl;
-    std::cout << "ST_MERGING:   count states = " << count_ib_merging  << "  count pages = " << ib_merging_pages << std::endl;
-    std::cout << "ST_READY:     count states = " << count_ib_ready    << "  count pages = " << ib_ready_pages << std::endl;
-    std::cout << "ST_CONCEDED:  count states = " << count_ib_conceded << "  count pages = " << ib_conceded_pages << std::endl;
-    std::cout << "SUM (free + alloc): count states = " << count_ib_free + count_ib_alloc << "  count pages = " << ib_free_pages + ib_alloc_pages << std::endl;
-    std::cout << "REAL_COUNT_PAGES: " << voxel_grid->count_ib_pages_ << std::endl;
-    std::cout << "LIMBO: " << (int)voxel_grid->count_ib_pages_ - (ib_free_pages + ib_alloc_pages) << std::endl;
+    std::cout << "stream hole benchmark (" << (prediction ? "prediction" : "no prediction")
+              << ", speed " << hole_benchmark_speed << ", lookahead " << stream_lookahead_seconds << " s, R " << stream_radius_chunks
+              << ", frames " << hole_benchmark_frames << ")" << std::endl;
+    std::cout << "  visible: " << sum_visible << ", missing: " << sum_missing << ", unmeshed: " << sum_unmeshed << std::endl;
+    std::cout << "  mean hole rate: " << mean_hole_rate * 100.0f << "%, worst: " << worst_hole_rate * 100.0f << "%" << std::endl;
     std::cout << std::endl;
 
-    std::cout << "---DATA FROM META---"      << std::endl;
-    std::cout << "==Vertex buffer==" << std::endl;
-    std::cout << "ST_ALLOC:      count chunks = " << count_vb_alloc_chunks_from_meta << " count pages = " << count_alloc_vb_pages_from_meta << std::endl;
-    std::cout << "COUNT_ALLOC_PAGES_BY_STATES: " << vb_alloc_pages << std::endl;
-    std::cout << "LIMBO (by STATES): " << (int)vb_alloc_pages - count_alloc_vb_pages_from_meta << std::endl;
-    std::cout << std::endl;
+    return mean_hole_rate;
+}
 
-    std::cout << "==Index buffer==" << std::endl;
-    std::cout << "ST_ALLOC:      count chunks = " << count_ib_alloc_chunks_from_meta << " count pages = " << count_alloc_ib_pages_from_meta << std::endl;
-    std::cout << "COUNT_ALLOC_PAGES_BY_STATES: " << ib_alloc_pages << std::endl;
-    std::cout << "LIMBO (by STATES): " << (int)ib_alloc_pages - count_alloc_ib_pages_from_meta << std::endl;
-    std::cout << std::endl;
+void VoxelGridGPUDebugger::print_counters() {
+    GPUReadback& rb = voxel_grid->readback;
+    std::array<std::shared_future<uint32_t>, 8> counters = {
+        rb.request_scalar<uint32_t>(voxel_grid->load_list_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->voxel_write_list_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->dirty_list_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->indirect_cmds_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->free_list_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->failed_dirty_list_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->mesh_buffers_status_).share(),
+        rb.request_scalar<uint32_t>(voxel_grid->vb_free_nodes_list_).share()
+    };
 
-    std::cout << "---DATA FROM HEADS---" << std::endl;
-    std::cout << "==Vertex buffer==" << std::endl;
-    std::cout << "ST_FREE:      count states = " << count_free_states_by_vb_heads << "  count pages = " << count_free_pages_by_vb_heads << std::endl;
-    std::cout << "COUNT_FREE_PAGES_BY_STATES: " << vb_free_pages << std::endl;
-    std::cout << "LIMBO (by STATES): " << (int)vb_free_pages - count_free_pages_by_vb_heads << std::endl;
-    std::cout << std::endl;
-    std::cout << "VB data per order:" << std::endl;
-    for (uint32_t order = 0; order <= voxel_grid->vb_order_; order++) {
-        std::cout << std::left << std::setw(10) << ("ORDER " + std::to_string(order) + ":")
-                  << std::right << std::setw(14 + 5) << "count states ="
-                  << std::right << std::setw(7) << count_free_states_by_vb_order[order]
-                  << std::right << std::setw(13 + 5) << "count pages ="
-                  << std::right << std::setw(7) << count_free_pages_by_vb_order[order]
-                  << std::endl;
-    }
-    std::cout << std::endl;
+    print_when_ready([](uint32_t load_list_count, uint32_t write_count, uint32_t dirty_count, uint32_t cmd_count,
+                        uint32_t free_count, uint32_t failed_dirty_count, uint32_t is_vb_full, uint32_t count_free_nodes_vb) {
+        std::cout << "write_count: " << write_count << std::endl;
+        std::cout << "dirty_count: " << dirty_count << std::endl;
+        std::cout << "cmd_count: " << cmd_count << std::endl;
+        std::cout << "free_count: " << free_count << std::endl;
+        std::cout << "failed_dirty_count: " << failed_dirty_count << std::endl;
+        std::cout << "is_vb_full: " << (is_vb_full == 1u ? "TRUE" : "FALSE") << std::endl;
+        std::cout << "load_list_count: " << load_list_count << std::endl;
 
-    std::cout << "==Index buffer==" << std::endl;
-    std::cout << "ST_FREE:      count states = " << count_free_states_by_ib_heads << "  count pages = " << count_free_pages_by_ib_heads << std::endl;
-    std::cout << "COUNT_FREE_PAGES_BY_STATES: " << ib_free_pages << std::endl;
-    std::cout << "LIMBO (by STATES): " << (int)ib_free_pages - count_free_pages_by_ib_heads << std::endl;
-    std::cout << std::endl;
-    std::cout << "IB data per order:" << std::endl;
-    for (uint32_t order = 0; order <= voxel_grid->ib_order_; order++) {
-        std::cout << std::left << std::setw(10) << ("ORDER " + std::to_string(order) + ":")
-                  << std::right << std::setw(14 + 5) << "count states ="
-                  << std::right << std::setw(7) << count_free_states_by_ib_order[order]
-                  << std::right << std::setw(13 + 5) << "count pages ="
-                  << std::right << std::setw(7) << count_free_pages_by_ib_order[order]
-                  << std::endl;
-    }
-    std::cout << std::endl;
+        std::cout << "count_free_nodes_vb: " << count_free_nodes_vb << std::endl;
+
+        std::cout << std::endl;
+    }, counters[0], counters[1], counters[2], counters[3], counters[4], counters[5], counters[6], counters[7]);
+
+    print_count_free_mesh_alloc();
 }
 
-void VoxelGridGPUDebugger::print_chunks_hash_table_log() {
-    std::vector<uint32_t> hash_table_vals(voxel_grid->chunk_hash_table_size);
-    uint32_t count_tombs_gpu = voxel_grid->chunk_hash_vals_.read_scalar<uint32_t>(0u);
+void VoxelGridGPUDebugger::print_count_free_mesh_alloc() {
+    GPUReadback& rb = voxel_grid->readback;
+    auto alloc_meta_f = rb.request_array<VoxelGridGPU::ChunkMeshAlloc>(voxel_grid->chunk_mesh_alloc_, 0, voxel_grid->count_active_chunks).share();
+    auto vb_states_f = rb.request_array<uint32_t>(voxel_grid->vb_state_, 0, voxel_grid->count_vb_pages_).share();
+    auto vb_heads_f = rb.request_array<uint32_t>(voxel_grid->vb_heads_, 0, voxel_grid->vb_order_ + 1).share();
+    auto vb_nodes_f = rb.request_array<VoxelGridGPU::AllocNode>(voxel_grid->vb_nodes_, 0, voxel_grid->count_vb_nodes_).share();
+
+    print_when_ready([this](const std::vector<VoxelGridGPU::ChunkMeshAlloc>& alloc_meta, const std::vector<uint32_t>& vb_states,
+                            const std::vector<uint32_t>& vb_heads, const std::vector<VoxelGridGPU::AllocNode>& vb_nodes) {
+        //=================РАСЧЁТ ДАННЫХ ПО MESH_ALLOC=================
+        std::unordered_set<uint32_t> allocated_mesh;
+        uint32_t count_alloc_vb_pages_from_meta = 0;
+        uint32_t count_vb_alloc_chunks_from_meta = 0;
+        for (uint32_t i = 0; i < voxel_grid->count_active_chunks; i++) {
+            const VoxelGridGPU::ChunkMeshAlloc& meta = alloc_meta[i];
+            if (meta.v_startPage != voxel_grid->INVALID_ID) {
+                count_alloc_vb_pages_from_meta += 1 << meta.v_order;
+                count_vb_alloc_chunks_from_meta++;
+                allocated_mesh.insert(i);
+            }
+        }
+
+        //=================РАСЧЁТ ПЕРЕСЕЧЕНИЙ ПО MESH_ALLOC=================
+        std::vector<uint32_t> ids(allocated_mesh.begin(), allocated_mesh.end());
+        std::vector<std::pair<uint32_t,uint32_t>> v_pairs;
+        v_pairs.reserve(64);
+
+        for (size_t a = 0; a < ids.size(); ++a) {
+            for (size_t b = a + 1; b < ids.size(); ++b) {
+                uint32_t ida = ids[a], idb = ids[b];
+                const auto &A = alloc_meta[ida];
+                const auto &B = alloc_meta[idb];
+
+                uint64_t vsA = A.v_startPage, vsB = B.v_startPage;
+                uint64_t vlA = (A.v_order < 64) ? (1ull << A.v_order) : UINT64_MAX;
+                uint64_t vlB = (B.v_order < 64) ? (1ull << B.v_order) : UINT64_MAX;
+                if (math_utils::intersects(vsA, vlA, vsB, vlB)) v_pairs.emplace_back(ida, idb);
+            }
+        }
+    
+        //=================РАСЧЁТ ДАННЫХ VB ПО STATES=================
+        uint32_t count_vb_free = 0, vb_free_pages = 0;
+        uint32_t count_vb_alloc = 0, vb_alloc_pages = 0;
+        uint32_t count_vb_merged = 0, vb_merged_pages = 0;
+        uint32_t count_vb_merging = 0, vb_merging_pages = 0;
+        uint32_t count_vb_ready = 0, vb_ready_pages = 0;
+        uint32_t count_vb_conceded = 0, vb_conceded_pages = 0;
+        for (uint32_t i = 0; i < voxel_grid->count_vb_pages_; i++) {
+            uint32_t kind = vb_states[i] & voxel_grid->ST_MASK;
+            uint32_t order = vb_states[i] >> voxel_grid->ST_MASK_BITS;
+            uint32_t count_pages = 1u << order;
+            if (kind == voxel_grid->ST_FREE) {count_vb_free++; vb_free_pages += count_pages; }
+            if (kind == voxel_grid->ST_ALLOC) {count_vb_alloc++; vb_alloc_pages += count_pages; }
+            if (kind == voxel_grid->ST_MERGED) {count_vb_merged++; vb_merged_pages += count_pages; }
+        }
+
+        //=================РАСЧЁТ ДАННЫХ VB ПО HEADS=================
+        std::vector<uint32_t> count_free_states_by_vb_order(voxel_grid->vb_order_ + 1, 0);
+        std::vector<uint32_t> count_free_pages_by_vb_order(voxel_grid->vb_order_ + 1, 0);
+        uint32_t count_free_states_by_vb_heads = 0, count_free_pages_by_vb_heads = 0;
+        for (uint32_t order = 0; order <= voxel_grid->vb_order_; order++) {
+            uint32_t head_idx = vb_heads[order] >> voxel_grid->HEAD_TAG_BITS;
+            uint32_t cur_node = head_idx != voxel_grid->INVALID_HEAD_IDX ? head_idx : voxel_grid->INVALID_ID;
+            uint32_t order_size = 1u << order;
+            while (cur_node != voxel_grid->INVALID_ID) {
+                uint32_t page_id = vb_nodes[cur_node].page;
+                uint32_t kind = vb_states[page_id] & voxel_grid->ST_MASK;
+                uint32_t real_order = vb_states[page_id] >> voxel_grid->ST_MASK_BITS;
+                if (kind == voxel_grid->ST_FREE && real_order == order) {
+                    count_free_states_by_vb_order[order]++;
+                    count_free_pages_by_vb_order[order] += order_size;
+
+                    count_free_states_by_vb_heads++;
+                    count_free_pages_by_vb_heads += order_size;
+                }
+                cur_node = vb_nodes[cur_node].next;
+            }
+        }
 
-    voxel_grid->chunk_hash_vals_.read_subdata(sizeof(uint32_t), sizeof(uint32_t) * voxel_grid->chunk_hash_table_size, hash_table_vals.data());
+        std::cout << "---INTERSECTIONS---" << std::endl;
+        std::cout << "==Vertex buffer==" << std::endl;
+        std::cout << "Count vb intersections: " << v_pairs.size() << std::endl;
+        std::cout << std::endl;
 
-    uint32_t count_empty_slots = 0u, count_lock_slots = 0u, count_tomb_slots = 0u, count_alloc_slots = 0u;
-    for (uint32_t slot_id = 0u; slot_id < voxel_grid->chunk_hash_table_size; slot_id++) {
-        uint32_t v = hash_table_vals[slot_id];
+        std::cout << "---DATA FROM STATES BUFFER---" << std::endl;
+        std::cout << "==Vertex buffer==" << std::endl;
+        std::cout << "ST_FREE:      count states = " << count_vb_free     << "  count pages = " << vb_free_pages << std::endl;
+        std::cout << "ST_ALLOC:     count states = " << count_vb_alloc    << "  count pages = " << vb_alloc_pages << std::endl;
+        std::cout << "ST_MERGED:    count states = " << count_vb_merged   << "  count pages = " << vb_merged_pages << std::endl;
+        std::cout << "ST_MERGING:   count states = " << count_vb_merging  << "  count pages = " << vb_merging_pages << std::endl;
+        std::cout << "ST_READY:     count states = " << count_vb_ready    << "  count pages = " << vb_ready_pages << std::endl;
+        std::cout << "ST_CONCEDED:  count states = " << count_vb_conceded << "  count pages = " << vb_conceded_pages << std::endl;
+        std::cout << "SUM (free + alloc): count states = " << count_vb_free + count_vb_alloc << "  count pages = " << vb_free_pages + vb_alloc_pages << std::endl;
+        std::cout << "REAL_COUNT_PAGES: " << voxel_grid->count_vb_pages_ << std::endl;
+        std::cout << "LIMBO: " << (int)voxel_grid->count_vb_pages_ - (vb_free_pages + vb_alloc_pages) << std::endl;
+        std::cout << std::endl;
 
-        if (v == voxel_grid->SLOT_EMPTY) count_empty_slots++;
-        else if (v == voxel_grid->SLOT_LOCKED) count_lock_slots++;
-        else if (v == voxel_grid->SLOT_TOMB) count_tomb_slots++;
-        else count_alloc_slots++;
-    }
+        std::cout << "---DATA FROM META---"      << std::endl;
+        std::cout << "==Vertex buffer==" << std::endl;
+        std::cout << "ST_ALLOC:      count chunks = " << count_vb_alloc_chunks_from_meta << " count pages = " << count_alloc_vb_pages_from_meta << std::endl;
+        std::cout << "COUNT_ALLOC_PAGES_BY_STATES: " << vb_alloc_pages << std::endl;
+        std::cout << "LIMBO (by STATES): " << (int)vb_alloc_pages - count_alloc_vb_pages_from_meta << std::endl;
+        std::cout << std::endl;
+
+        std::cout << "---DATA FROM HEADS---" << std::endl;
+        std::cout << "==Vertex buffer==" << std::endl;
+        std::cout << "ST_FREE:      count states = " << count_free_states_by_vb_heads << "  count pages = " << count_free_pages_by_vb_heads << std::endl;
+        std::cout << "COUNT_FREE_PAGES_BY_STATES: " << vb_free_pages << std::endl;
+        std::cout << "LIMBO (by STATES): " << (int)vb_free_pages - count_free_pages_by_vb_heads << std::endl;
+        std::cout << std::endl;
+        std::cout << "VB data per order:" << std::endl;
+        for (uint32_t order = 0; order <= voxel_grid->vb_order_; order++) {
+            std::cout << std::left << std::setw(10) << ("ORDER " + std::to_string(order) + ":")
+                      << std::right << std::setw(14 + 5) << "count states ="
+                      << std::right << std::setw(7) << count_free_states_by_vb_order[order]
+                      << std::right << std::setw(13 + 5) << "count pages ="
+                      << std::right << std::setw(7) << count_free_pages_by_vb_order[order]
+                      << std::endl;
+        }
+        std::cout << std::endl;
+    }, alloc_meta_f, vb_states_f, vb_heads_f, vb_nodes_f);
+}
+
+void VoxelGridGPUDebugger::print_chunks_hash_table_log() {
+    // count_tomb, слоты и (в Bucketed) счётчики переполнения корзин - одним запросом
+    uint32_t count_vals = 1u + voxel_grid->chunk_hash_table_size;
+    if (voxel_grid->hash_table_mode == ChunkHashTableMode::Bucketed)
+        count_vals += voxel_grid->chunk_hash_table_size / HASH_TABLE_BUCKET_SLOTS;
+    auto vals_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->chunk_hash_vals_, 0, count_vals).share();
+
+    print_when_ready([this](const std::vector<uint32_t>& vals) {
+        uint32_t count_tombs_gpu = vals[0];
+        const uint32_t* hash_table_vals = vals.data() + 1;
+
+        uint32_t count_empty_slots = 0u, count_lock_slots = 0u, count_tomb_slots = 0u, count_alloc_slots = 0u;
+        for (uint32_t slot_id = 0u; slot_id < voxel_grid->chunk_hash_table_size; slot_id++) {
+            uint32_t v = hash_table_vals[slot_id];
+
+            if (v == voxel_grid->SLOT_EMPTY) count_empty_slots++;
+            else if (v == voxel_grid->SLOT_LOCKED) count_lock_slots++;
+            else if (v == voxel_grid->SLOT_TOMB) count_tomb_slots++;
+            else count_alloc_slots++;
+        }
 
-    std::cout << "======= CHUNKS HASH TABLE LOG =======" << std::endl;
-    std::cout << "Total count hash table slots: " << voxel_grid->chunk_hash_table_size << std::endl;
-    std::cout << "SLOT_EMPTY: " << count_empty_slots << "(" 
-              << std::fixed << std::setprecision(2) << (float)count_empty_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
+        std::cout << "======= CHUNKS HASH TABLE LOG =======" << std::endl;
+        std::cout << "Total count hash table slots: " << voxel_grid->chunk_hash_table_size << std::endl;
+        std::cout << "SLOT_EMPTY: " << count_empty_slots << "(" 
+                  << std::fixed << std::setprecision(2) << (float)count_empty_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
     
-    std::cout << "SLOT_LOCKED: " << count_lock_slots << "(" 
-              << std::fixed << std::setprecision(2) << (float)count_lock_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
+        std::cout << "SLOT_LOCKED: " << count_lock_slots << "(" 
+                  << std::fixed << std::setprecision(2) << (float)count_lock_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
     
-    std::cout << "SLOT_TOMB: " << count_tomb_slots << "(" 
-              << std::fixed << std::setprecision(2) << (float)count_tomb_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
+        std::cout << "SLOT_TOMB: " << count_tomb_slots << "(" 
+                  << std::fixed << std::setprecision(2) << (float)count_tomb_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
     
-    std::cout << "SLOT_TOMB_GPU: " << count_tombs_gpu << std::endl;
+        std::cout << "SLOT_TOMB_GPU: " << count_tombs_gpu << std::endl;
     
-    std::cout << "SLOT_ALLOC: " << count_alloc_slots << "(" 
-              << std::fixed << std::setprecision(2) << (float)count_alloc_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
+        std::cout << "SLOT_ALLOC: " << count_alloc_slots << "(" 
+                  << std::fixed << std::setprecision(2) << (float)count_alloc_slots / voxel_grid->chunk_hash_table_size * 100.0f << "%)" << std::endl;
+
+        if (voxel_grid->hash_table_mode == ChunkHashTableMode::Bucketed) {
+            uint32_t count_buckets = voxel_grid->chunk_hash_table_size / HASH_TABLE_BUCKET_SLOTS;
+            const uint32_t* bucket_overflow = hash_table_vals + voxel_grid->chunk_hash_table_size;
+
+            uint32_t count_overflowed_buckets = 0u, count_secondary_keys = 0u;
+            for (uint32_t b = 0u; b < count_buckets; b++) {
+                uint32_t c = bucket_overflow[b];
+                if (c != 0u) count_overflowed_buckets++;
+                count_secondary_keys += c;
+            }
 
-    std::cout << std::endl;
+            std::cout << "Buckets: " << count_buckets << ", overflowed: " << count_overflowed_buckets
+                      << ", keys in secondary bucket: " << count_secondary_keys << std::endl;
+        }
+
+        std::cout << std::endl;
+    }, vals_f);
 }
 
 void VoxelGridGPUDebugger::print_eviction_log(const glm::vec3& camera_pos) {
-    std::vector<uint32_t> bucket_heads(voxel_grid->count_evict_buckets);
-    std::vector<uint32_t> bucket_next(voxel_grid->count_active_chunks);
-    std::vector<VoxelGridGPU::ChunkMetaGPU> chunk_meta(voxel_grid->count_active_chunks);
-
-    voxel_grid->bucket_heads_.read_subdata(0, sizeof(uint32_t) * voxel_grid->count_evict_buckets, bucket_heads.data());
-    voxel_grid->bucket_next_.read_subdata(0, sizeof(uint32_t) * voxel_grid->count_active_chunks, bucket_next.data());
-    voxel_grid->chunk_meta_.read_subdata(0, sizeof(VoxelGridGPU::ChunkMetaGPU) * voxel_grid->count_active_chunks, chunk_meta.data());
-
-
-    struct ChunkInBucketData {
-        uint32_t chunk_id;
-        glm::ivec3 coords;
-        double distance_to_chunk;
-        uint32_t bucket_id_by_distance;
-    };
+    GPUReadback& rb = voxel_grid->readback;
+    auto bucket_heads_f = rb.request_array<uint32_t>(voxel_grid->bucket_heads_, 0, voxel_grid->count_evict_buckets).share();
+    auto bucket_next_f = rb.request_array<uint32_t>(voxel_grid->bucket_next_, 0, voxel_grid->count_active_chunks).share();
+    auto chunk_meta_f = rb.request_array<VoxelGridGPU::ChunkMetaGPU>(voxel_grid->chunk_meta_, 0, voxel_grid->count_active_chunks).share();
+    auto last_visible_f = rb.request_array<uint32_t>(voxel_grid->chunk_last_visible_, 0, voxel_grid->count_active_chunks).share();
+
+    // кадр и позиция камеры - на момент запроса, а не печати
+    uint32_t frame_index = voxel_grid->frame_index_;
+
+    print_when_ready([this, camera_pos, frame_index](const std::vector<uint32_t>& bucket_heads, const std::vector<uint32_t>& bucket_next,
+                                                     const std::vector<VoxelGridGPU::ChunkMetaGPU>& chunk_meta, const std::vector<uint32_t>& last_visible) {
+        uint32_t count_user_modified = 0u;
+        for (const VoxelGridGPU::ChunkMetaGPU& meta : chunk_meta)
+            if (meta.used != 0u && (meta.dirty_flags & VoxelGridGPU::DIRTY_FLAG_USER_MODIFIED) != 0u)
+                count_user_modified++;
+
+        struct ChunkInBucketData {
+            uint32_t chunk_id;
+            glm::ivec3 coords;
+            double distance_to_chunk;
+            uint32_t bucket_id_by_distance;
+        };
     
-    // ==================Подсчёт по HEADS==================
-    std::vector<uint32_t> count_chunks_per_bucket(voxel_grid->count_evict_buckets, 0u);
-    std::vector<uint32_t> count_chunk_mismatches_per_bucket(voxel_grid->count_evict_buckets, 0u);
-    uint32_t total_chunks_number_in_buckets = 0u, total_chunk_mismatches_in_buckets = 0u;
-    std::vector<std::vector<ChunkInBucketData>> chunks_per_bucket(voxel_grid->count_evict_buckets);
-    for (uint32_t bucket_id = 0; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
-        uint32_t cur_id = bucket_heads[bucket_id];
+        // ==================Подсчёт по HEADS==================
+        std::vector<uint32_t> count_chunks_per_bucket(voxel_grid->count_evict_buckets, 0u);
+        std::vector<uint32_t> count_chunk_mismatches_per_bucket(voxel_grid->count_evict_buckets, 0u);
+        uint32_t total_chunks_number_in_buckets = 0u, total_chunk_mismatches_in_buckets = 0u;
+        std::vector<std::vector<ChunkInBucketData>> chunks_per_bucket(voxel_grid->count_evict_buckets);
+        for (uint32_t bucket_id = 0; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
+            uint32_t cur_id = bucket_heads[bucket_id];
         
-        while (cur_id != VoxelGridGPU::INVALID_ID) {
-            count_chunks_per_bucket[bucket_id]++;
-            total_chunks_number_in_buckets++;
+            while (cur_id != VoxelGridGPU::INVALID_ID) {
+                count_chunks_per_bucket[bucket_id]++;
+                total_chunks_number_in_buckets++;
 
-            ChunkInBucketData chunk_in_bucket;
-            chunk_in_bucket.chunk_id = cur_id;
+                ChunkInBucketData chunk_in_bucket;
+                chunk_in_bucket.chunk_id = cur_id;
 
-            uint64_t coords_key = ((uint64_t)(chunk_meta[cur_id].key_hi) << 32u) | (uint64_t)(chunk_meta[cur_id].key_lo);
-            chunk_in_bucket.coords = math_utils::unpack_key(coords_key);
+                uint64_t coords_key = ((uint64_t)(chunk_meta[cur_id].key_hi) << 32u) | (uint64_t)(chunk_meta[cur_id].key_lo);
+                chunk_in_bucket.coords = VoxelGridGPU::unpack_chunk_key(coords_key);
 
-            glm::vec3 render_chunk_pos = glm::vec3(chunk_in_bucket.coords * voxel_grid->chunk_size) * voxel_grid->voxel_size;
-            glm::vec3 render_chunk_center = render_chunk_pos + glm::vec3(0.5) * glm::vec3(voxel_grid->chunk_size) * voxel_grid->voxel_size;
-            chunk_in_bucket.distance_to_chunk = glm::length(render_chunk_center - camera_pos);
-            chunk_in_bucket.bucket_id_by_distance = (uint32_t)(chunk_in_bucket.distance_to_chunk / voxel_grid->eviction_bucket_shell_thickness);
+                glm::vec3 render_chunk_pos = glm::vec3(chunk_in_bucket.coords * voxel_grid->chunk_size) * voxel_grid->voxel_size;
+                glm::vec3 render_chunk_center = render_chunk_pos + glm::vec3(0.5) * glm::vec3(voxel_grid->chunk_size) * voxel_grid->voxel_size;
+                chunk_in_bucket.distance_to_chunk = glm::length(render_chunk_center - camera_pos);
+                chunk_in_bucket.bucket_id_by_distance = (uint32_t)(chunk_in_bucket.distance_to_chunk / voxel_grid->eviction_bucket_shell_thickness);
+                chunk_in_bucket.bucket_id_by_distance += voxel_grid->visibility_age_shells(last_visible[cur_id]);
+                chunk_in_bucket.bucket_id_by_distance = std::min(chunk_in_bucket.bucket_id_by_distance, voxel_grid->count_evict_buckets - 1u);
 
-            chunks_per_bucket[bucket_id].push_back(chunk_in_bucket);
+                chunks_per_bucket[bucket_id].push_back(chunk_in_bucket);
 
-            if (bucket_id != chunk_in_bucket.bucket_id_by_distance) {
-                count_chunk_mismatches_per_bucket[bucket_id]++;
-                total_chunk_mismatches_in_buckets++;
-            }
+                if (bucket_id != chunk_in_bucket.bucket_id_by_distance) {
+                    count_chunk_mismatches_per_bucket[bucket_id]++;
+                    total_chunk_mismatches_in_buckets++;
+                }
 
-            cur_id = bucket_next[cur_id];
+                cur_id = bucket_next[cur_id];
+            }
         }
-    }
 
-    std::vector<double> min_distance_in_shell(voxel_grid->count_evict_buckets, std::numeric_limits<double>::max());
-    std::vector<double> max_distance_in_shell(voxel_grid->count_evict_buckets, 0.0);
-    for (uint32_t bucket_id = 0; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
-        for (const ChunkInBucketData& chunk_data : chunks_per_bucket[bucket_id]) {
-            if (chunk_data.distance_to_chunk < min_distance_in_shell[bucket_id])
-                min_distance_in_shell[bucket_id] = chunk_data.distance_to_chunk;
+        std::vector<double> min_distance_in_shell(voxel_grid->count_evict_buckets, std::numeric_limits<double>::max());
+        std::vector<double> max_distance_in_shell(voxel_grid->count_evict_buckets, 0.0);
+        for (uint32_t bucket_id = 0; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
+            for (const ChunkInBucketData& chunk_data : chunks_per_bucket[bucket_id]) {
+                if (chunk_data.distance_to_chunk < min_distance_in_shell[bucket_id])
+                    min_distance_in_shell[bucket_id] = chunk_data.distance_to_chunk;
             
-            if (chunk_data.distance_to_chunk > max_distance_in_shell[bucket_id])
-                max_distance_in_shell[bucket_id] = chunk_data.distance_to_chunk;
+                if (chunk_data.distance_to_chunk > max_distance_in_shell[bucket_id])
+                    max_distance_in_shell[bucket_id] = chunk_data.distance_to_chunk;
+            }
         }
-    }
     
 
-    // ==================Вывод==================
+        // ==================Вывод==================
 
-    std::cout << "========= DATA BY HEADS =========" << std::endl;
-    std::cout << "Total number of chunks in buckets: " << total_chunks_number_in_buckets << std::endl;
-    std::cout << "Total number of chunk mismatches in buckets: " << total_chunk_mismatches_in_buckets << std::endl;
-    std::cout << std::endl;
-    std::cout << "Data per heads:" << std::endl;
+        std::cout << "========= DATA BY HEADS =========" << std::endl;
+        std::cout << "Total number of chunks in buckets: " << total_chunks_number_in_buckets << std::endl;
+        std::cout << "Total number of chunk mismatches in buckets: " << total_chunk_mismatches_in_buckets << std::endl;
+        std::cout << "User modified chunks (not evictable): " << count_user_modified << std::endl;
+        std::cout << "Frame index: " << frame_index << std::endl;
+        std::cout << std::endl;
+        std::cout << "Data per heads:" << std::endl;
     
-    for (uint32_t bucket_id = 0u; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
-        std::cout << std::left << std::setw(11 + 3) << ("BUCKET_ID " + std::to_string(bucket_id) + ":")
-                  << std::right << std::setw(14 + 5) << "count chunks ="
-                  << std::right << std::setw(5) << count_chunks_per_bucket[bucket_id]
-                  << std::right << std::setw(18 + 5) << "count mismatches ="
-                  << std::right << std::setw(5) << count_chunk_mismatches_per_bucket[bucket_id]
-                  << std::right << std::setw(15 + 5) << "min distance ="
-                  << std::right << std::setw(7) << min_distance_in_shell[bucket_id]
-                  << std::right << std::setw(14 + 5) << "max distance ="
-                  << std::right << std::setw(7) << max_distance_in_shell[bucket_id] << std::endl;
-    }
-    std::cout << std::endl;
+        for (uint32_t bucket_id = 0u; bucket_id < voxel_grid->count_evict_buckets; bucket_id++) {
+            std::cout << std::left << std::setw(11 + 3) << ("BUCKET_ID " + std::to_string(bucket_id) + ":")
+                      << std::right << std::setw(14 + 5) << "count chunks ="
+                      << std::right << std::setw(5) << count_chunks_per_bucket[bucket_id]
+                      << std::right << std::setw(18 + 5) << "count mismatches ="
+                      << std::right << std::setw(5) << count_chunk_mismatches_per_bucket[bucket_id]
+                      << std::right << std::setw(15 + 5) << "min distance ="
+                      << std::right << std::setw(7) << min_distance_in_shell[bucket_id]
+                      << std::right << std::setw(14 + 5) << "max distance ="
+                      << std::right << std::setw(7) << max_distance_in_shell[bucket_id] << std::endl;
+        }
+        std::cout << std::endl;
+    }, bucket_heads_f, bucket_next_f, chunk_meta_f, last_visible_f);
 }
 
 void VoxelGridGPUDebugger::print_dirty_list() {
-    uint32_t dirty_count = voxel_grid->dirty_list_.read_scalar<uint32_t>(0u);
-    std::vector<uint32_t> dirty_list(dirty_count);
-    voxel_grid->dirty_list_.read_subdata(sizeof(uint32_t), sizeof(uint32_t) * dirty_count, dirty_list.data());
+    auto dirty_buf_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->dirty_list_, 0, 1 + voxel_grid->count_active_chunks).share();
 
-    std::cout << "DIRTY_LIST: " << std::endl;
-    for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
-        std::cout << "dirty_id " << dirty_id << ": " << dirty_list[dirty_id] << std::endl;
-    }
-    std::cout << std::endl;
+    print_when_ready([](const std::vector<uint32_t>& dirty_buf) {
+        uint32_t dirty_count = dirty_buf[0];
+        const uint32_t* dirty_list = dirty_buf.data() + 1;
+
+        std::cout << "DIRTY_LIST: " << std::endl;
+        for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
+            std::cout << "dirty_id " << dirty_id << ": " << dirty_list[dirty_id] << std::endl;
+        }
+        std::cout << std::endl;
+    }, dirty_buf_f);
 }
 
 void VoxelGridGPUDebugger::print_dirty_list_emit_counters() {
-    uint32_t dirty_count = voxel_grid->dirty_list_.read_scalar<uint32_t>(0u);
-    std::vector<uint32_t> dirty_list(dirty_count);
-    std::vector<uint32_t> emit_counters(voxel_grid->count_active_chunks);
-    
-    voxel_grid->dirty_list_.read_subdata(sizeof(uint32_t), sizeof(uint32_t) * dirty_count, dirty_list.data());
-    voxel_grid->emit_counters_.read_subdata(0, sizeof(uint32_t) * voxel_grid->count_active_chunks, emit_counters.data());
-
-    std::cout << "EMIT COUNTERS: " << std::endl;
-    for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
-        uint32_t chunk_id = dirty_list[dirty_id];
-        std::cout << "dirty_id " << dirty_id << " chunk_id " << chunk_id << ": " << emit_counters[chunk_id] << std::endl;
-    }
-    std::cout << std::endl;
+    auto dirty_buf_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->dirty_list_, 0, 1 + voxel_grid->count_active_chunks).share();
+    auto emit_counters_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->emit_counters_, 0, (size_t)voxel_grid->count_active_chunks * 6u).share();
+
+    print_when_ready([](const std::vector<uint32_t>& dirty_buf, const std::vector<uint32_t>& emit_counters) {
+        uint32_t dirty_count = dirty_buf[0];
+        const uint32_t* dirty_list = dirty_buf.data() + 1;
+
+        // по направлениям +X -X +Y -Y +Z -Z
+        std::cout << "EMIT COUNTERS: " << std::endl;
+        for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
+            uint32_t chunk_id = dirty_list[dirty_id];
+            std::cout << "dirty_id " << dirty_id << " chunk_id " << chunk_id << ":";
+            for (uint32_t f = 0u; f < 6u; f++) std::cout << " " << emit_counters[(size_t)chunk_id * 6u + f];
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    }, dirty_buf_f, emit_counters_f);
 }
 
 void VoxelGridGPUDebugger::print_dirty_list_quad_count() {
-    uint32_t dirty_count = voxel_grid->dirty_list_.read_scalar<uint32_t>(0u);
-    std::vector<uint32_t> dirty_list(dirty_count);
-    std::vector<uint32_t> dirty_quad_count(dirty_count);
-    
-    voxel_grid->dirty_list_.read_subdata(sizeof(uint32_t), sizeof(uint32_t) * dirty_count, dirty_list.data());
-    voxel_grid->dirty_quad_count_.read_subdata(0, sizeof(uint32_t) * dirty_count, dirty_quad_count.data());
-
-    std::cout << "DIRTY QUAD COUNTERS: " << std::endl;
-    for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
-        std::cout << "dirty_id " << dirty_id << ": " << dirty_quad_count[dirty_id] << std::endl;
-    }
-    std::cout << std::endl;
+    // dirty_count станет известен только вместе с данными - читаем счётчики на весь буфер
+    auto dirty_count_f = voxel_grid->readback.request_scalar<uint32_t>(voxel_grid->dirty_list_).share();
+    auto dirty_quad_count_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->dirty_quad_count_, 0, (size_t)voxel_grid->count_active_chunks * 6u).share();
+
+    print_when_ready([](uint32_t dirty_count, const std::vector<uint32_t>& dirty_quad_count) {
+        std::cout << "DIRTY QUAD COUNTERS: " << std::endl;
+        for (uint32_t dirty_id = 0u; dirty_id < dirty_count && dirty_id < 100u; dirty_id++) {
+            uint32_t quads = 0u;
+            for (uint32_t f = 0u; f < 6u; f++) quads += dirty_quad_count[(size_t)dirty_id * 6u + f];
+            std::cout << "dirty_id " << dirty_id << ": " << quads << std::endl;
+        }
+        std::cout << std::endl;
+    }, dirty_count_f, dirty_quad_count_f);
 }
 
 void VoxelGridGPUDebugger::print_mesh_alloc_by_dirty_list(const std::string& prefix, uint32_t mesh_alloc_page_offset_bytes, uint32_t mesh_alloc_order_offset_bytes) {
-    std::vector<VoxelGridGPU::ChunkMeshAlloc> alloc_meta(voxel_grid->count_active_chunks);
-    std::vector<uint32_t> dirty_list;
-    uint32_t dirty_count;
-
-    voxel_grid->chunk_mesh_alloc_.read_subdata(0, sizeof(VoxelGridGPU::ChunkMeshAlloc) * voxel_grid->count_active_chunks, alloc_meta.data());
-    voxel_grid->mesh_buffers_status_.read_subdata(sizeof(uint32_t), sizeof(uint32_t), &dirty_count);
-    dirty_list.resize(dirty_count);
-    voxel_grid->dirty_list_.read_subdata(0, sizeof(uint32_t) * dirty_count, dirty_list.data());
-        
-    if (dirty_count > 0) {
-        std::cout << prefix + " mesh allocs of dirty list:" << std::endl;
-        uint32_t count_alloc_pages = 0, count_alloc_states = 0; 
-        for (uint32_t dirty_idx = 0; dirty_idx < dirty_count; dirty_idx++) {
-            uint32_t chunk_id = dirty_list[dirty_idx];
-            uint32_t start_page = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_page_offset_bytes);
-            uint32_t alloc_order = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_order_offset_bytes);
-            if (start_page == VoxelGridGPU::INVALID_ID) continue;
-            count_alloc_pages += 1u << alloc_order;
-            count_alloc_states++;
-        }
+    auto alloc_meta_f = voxel_grid->readback.request_array<VoxelGridGPU::ChunkMeshAlloc>(voxel_grid->chunk_mesh_alloc_, 0, voxel_grid->count_active_chunks).share();
+    auto dirty_buf_f = voxel_grid->readback.request_array<uint32_t>(voxel_grid->dirty_list_, 0, 1 + voxel_grid->count_active_chunks).share();
+
+    print_when_ready([prefix, mesh_alloc_page_offset_bytes, mesh_alloc_order_offset_bytes](
+        std::vector<VoxelGridGPU::ChunkMeshAlloc> alloc_meta, const std::vector<uint32_t>& dirty_buf) {
+        uint32_t dirty_count = dirty_buf[0];
+        const uint32_t* dirty_list = dirty_buf.data() + 1;
+
+        if (dirty_count > 0) {
+            std::cout << prefix + " mesh allocs of dirty list:" << std::endl;
+            uint32_t count_alloc_pages = 0, count_alloc_states = 0; 
+            for (uint32_t dirty_idx = 0; dirty_idx < dirty_count; dirty_idx++) {
+                uint32_t chunk_id = dirty_list[dirty_idx];
+                uint32_t start_page = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_page_offset_bytes);
+                uint32_t alloc_order = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_order_offset_bytes);
+                if (start_page == VoxelGridGPU::INVALID_ID) continue;
+                count_alloc_pages += 1u << alloc_order;
+                count_alloc_states++;
+            }
 
-        std::cout << "ST_ALLOC:     " << "count states = " << count_alloc_states << "   count pages = " << count_alloc_pages << std::endl;
-        std::cout << std::endl;
+            std::cout << "ST_ALLOC:     " << "count states = " << count_alloc_states << "   count pages = " << count_alloc_pages << std::endl;
+            std::cout << std::endl;
 
-        for (uint32_t dirty_idx = 0; dirty_idx < dirty_count; dirty_idx++) {
-            uint32_t chunk_id = dirty_list[dirty_idx];
-            uint32_t start_page = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_page_offset_bytes);
-            uint32_t alloc_order = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_order_offset_bytes);
-            if (start_page == VoxelGridGPU::INVALID_ID) continue;
+            for (uint32_t dirty_idx = 0; dirty_idx < dirty_count; dirty_idx++) {
+                uint32_t chunk_id = dirty_list[dirty_idx];
+                uint32_t start_page = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_page_offset_bytes);
+                uint32_t alloc_order = *reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(&alloc_meta[chunk_id]) + mesh_alloc_order_offset_bytes);
+                if (start_page == VoxelGridGPU::INVALID_ID) continue;
             
-            std::cout << std::left << std::setw(9 + 8) << ("DIRTY_ID " + std::to_string(dirty_idx))
-                    << std::left << std::setw(5) << "  |"
-                    << std::left << std::setw(9 + 8) << ("CHUNK_ID " + std::to_string(chunk_id) + ":")
-                    << std::right << std::setw(13 + 5) << "start page = "
-                    << std::right << std::setw(6 + 5) << start_page
-                    << std::right << std::setw(8 + 5) << "order = "
-                    << std::right << std::setw(3 + 5) << alloc_order
-                    << std::endl;
+                std::cout << std::left << std::setw(9 + 8) << ("DIRTY_ID " + std::to_string(dirty_idx))
+                        << std::left << std::setw(5) << "  |"
+                        << std::left << std::setw(9 + 8) << ("CHUNK_ID " + std::to_string(chunk_id) + ":")
+                        << std::right << std::setw(13 + 5) << "start page = "
+                        << std::right << std::setw(6 + 5) << start_page
+                        << std::right << std::setw(8 + 5) << "order = "
+                        << std::right << std::setw(3 + 5) << alloc_order
+                        << std::endl;
+            }
+            std::cout << std::endl;
+        } else {
+            std::cout << "===DIRTY LIST IS EMPTY===" << std::endl;
+            std::cout << std::endl;
         }
+    }, alloc_meta_f, dirty_buf_f);
+}
+
+void VoxelGridGPUDebugger::print_occlusion_stats() {
+    bool occlusion_culling = voxel_grid->occlusion_culling;
+    bool face_direction_culling = voxel_grid->face_direction_culling;
+
+    print_when_ready([occlusion_culling, face_direction_culling](const VoxelGridGPU::OcclusionStatsGPU& stats) {
+        uint32_t drawn = stats.drawn_first_pass + stats.drawn_second_pass;
+        uint32_t with_mesh = drawn + stats.occlusion_culled;
+
+        std::cout << "======================OCCLUSION CULLING======================" << std::endl;
+        std::cout << "occlusion_culling: " << (occlusion_culling ? "on" : "off") << std::endl;
+        std::cout << "distance_culled: " << stats.distance_culled << std::endl;
+        std::cout << "frustum_culled: " << stats.frustum_culled << std::endl;
+        std::cout << "occlusion_culled: " << stats.occlusion_culled;
+        if (with_mesh != 0) std::cout << " (" << 100.0f * (float)stats.occlusion_culled / (float)with_mesh << "% of meshed chunks in frustum)";
+        std::cout << std::endl;
+        std::cout << "drawn_first_pass: " << stats.drawn_first_pass << std::endl;
+        std::cout << "drawn_second_pass: " << stats.drawn_second_pass << std::endl;
+
+        uint32_t total_quads = stats.drawn_quads + stats.face_culled_quads;
+        std::cout << "face_direction_culling: " << (face_direction_culling ? "on" : "off") << std::endl;
+        std::cout << "drawn_quads: " << stats.drawn_quads << std::endl;
+        std::cout << "face_culled_quads: " << stats.face_culled_quads;
+        if (total_quads != 0) std::cout << " (" << 100.0f * (float)stats.face_culled_quads / (float)total_quads << "%)";
         std::cout << std::endl;
-    } else {
-        std::cout << "===DIRTY LIST IS EMPTY===" << std::endl;
         std::cout << std::endl;
+    }, voxel_grid->request_occlusion_stats().share());
+}
+
+void VoxelGridGPUDebugger::print_mesh_pool_stats() {
+    print_when_ready([this](const VoxelGridGPU::MeshPoolStatsGPU& vb_stats) {
+        print_mesh_pool_stats("VB", vb_stats, voxel_grid->count_vb_pages_, voxel_grid->vb_order_);
+    }, voxel_grid->request_mesh_pool_stats().share());
+}
+
+void VoxelGridGPUDebugger::print_mesh_pool_stats(const std::string& prefix, const VoxelGridGPU::MeshPoolStatsGPU& stats, uint32_t count_pages, uint32_t max_order) {
+    uint32_t largest_free_pages = stats.largest_free_order == 0u ? 0u : 1u << (stats.largest_free_order - 1u);
+    // Внешняя фрагментация: доля свободных страниц, которые не попадают в самый большой свободный блок
+    float fragmentation = stats.free_pages == 0u ? 0.0f : 1.0f - (float)largest_free_pages / (float)stats.free_pages;
+    uint32_t lost_pages = count_pages - stats.free_pages - stats.alloc_pages;
+
+    std::cout << "======================" << prefix << " MESH POOL======================" << std::endl;
+    std::cout << "pages: " << count_pages << std::endl;
+    std::cout << "free_pages: " << stats.free_pages << std::endl;
+    std::cout << "alloc_pages: " << stats.alloc_pages << std::endl;
+    std::cout << "lost_pages: " << lost_pages << std::endl;
+    std::cout << "largest_free_block: " << largest_free_pages << " pages";
+    if (stats.largest_free_order != 0u) std::cout << " (order " << stats.largest_free_order - 1u << ")";
+    std::cout << std::endl;
+    std::cout << "fragmentation: " << fragmentation << std::endl;
+    std::cout << "stranded_blocks: " << stats.stranded_blocks << std::endl;
+
+    for (uint32_t order = 0; order <= max_order && order < VoxelGridGPU::MESH_POOL_MAX_ORDERS; order++) {
+        if (stats.free_blocks[order] == 0u && stats.alloc_blocks[order] == 0u) continue;
+        std::cout << "order " << order << ": free " << stats.free_blocks[order] << ", alloc " << stats.alloc_blocks[order] << std::endl;
     }
+
+    std::cout << std::endl;
 }
 
 void VoxelGridGPUDebugger::print_free_lists(
@@ -519,36 +587,42 @@ void VoxelGridGPUDebugger::print_free_lists(
     uint32_t count_pages,
     uint32_t max_order) 
 {
-    std::vector<VoxelGridGPU::AllocNode> nodes(count_nodes);
-    nodes_buffer.read_subdata(0, sizeof(VoxelGridGPU::AllocNode) * count_nodes, nodes.data());
-
-    std::vector<uint32_t> heads(max_order + 1);
-    heads_buffer.read_subdata(0, sizeof(uint32_t) * (max_order + 1), heads.data());
-
-    std::vector<uint32_t> states(count_pages);
-    states_buffer.read_subdata(0, sizeof(uint32_t) * count_pages, states.data());
-
-    for (uint32_t i = 0; i < max_order + 1; i++) {
-        uint32_t order = i;
-        std::cout << "======================ORDER " << order << "======================" << std::endl;
-        uint32_t head_idx = heads[order] >> VoxelGridGPU::HEAD_TAG_BITS;
-        uint32_t cur_node = head_idx != VoxelGridGPU::INVALID_HEAD_IDX ? head_idx : VoxelGridGPU::INVALID_ID;
-        while (cur_node != VoxelGridGPU::INVALID_ID) {
-            uint32_t page_id = nodes[cur_node].page;
-            uint32_t kind = states[page_id] & VoxelGridGPU::ST_MASK;
-            uint32_t real_order = states[page_id] >> VoxelGridGPU::ST_MASK_BITS;
-            if (real_order == order) {
-                std::cout << page_id << " ";
-                if (kind == 0u) std::cout << "ST_FREE" << std::endl;
+    GPUReadback& rb = voxel_grid->readback;
+    auto nodes_f = rb.request_array<VoxelGridGPU::AllocNode>(nodes_buffer, 0, count_nodes).share();
+    auto heads_f = rb.request_array<uint32_t>(heads_buffer, 0, max_order + 1).share();
+    auto states_f = rb.request_array<uint32_t>(states_buffer, 0, count_pages).share();
+
+    print_when_ready([max_order](const std::vector<VoxelGridGPU::AllocNode>& nodes, const std::vector<uint32_t>& heads, const std::vector<uint32_t>& states) {
+        for (uint32_t i = 0; i < max_order + 1; i++) {
+            uint32_t order = i;
+            std::cout << "======================ORDER " << order << "======================" << std::endl;
+            uint32_t head_idx = heads[order] >> VoxelGridGPU::HEAD_TAG_BITS;
+            uint32_t cur_node = head_idx != VoxelGridGPU::INVALID_HEAD_IDX ? head_idx : VoxelGridGPU::INVALID_ID;
+            while (cur_node != VoxelGridGPU::INVALID_ID) {
+                uint32_t page_id = nodes[cur_node].page;
+                uint32_t kind = states[page_id] & VoxelGridGPU::ST_MASK;
+                uint32_t real_order = states[page_id] >> VoxelGridGPU::ST_MASK_BITS;
+                if (real_order == order) {
+                    std::cout << page_id << " ";
+                    if (kind == 0u) std::cout << "ST_FREE" << std::endl;
+                }
+                cur_node = nodes[cur_node].next;
             }
-            cur_node = nodes[cur_node].next;
-        }
         
-        std::cout << std::endl;
-    }
+            std::cout << std::endl;
+        }
+    }, nodes_f, heads_f, states_f);
+}
+
+void VoxelGridGPUDebugger::poll_pending_prints() {
+    voxel_grid->readback.poll();
+    while (!pending_prints_.empty() && pending_prints_.front()())
+        pending_prints_.pop_front();
 }
 
 void VoxelGridGPUDebugger::dispay_debug_window() {
+    poll_pending_prints();
+
     ImGui::Begin("Debug");
 
     ImGui::TextUnformatted("Camera position");
@@ -567,7 +641,7 @@ void VoxelGridGPUDebugger::dispay_debug_window() {
 
     if (ImGui::Button("Print counters")) {
         print_counters();
-        std::cout << "-----------------------" << std::endl << std::endl;
+        print_when_ready([]() { std::cout << "-----------------------" << std::endl << std::endl; });
     }
     if (ImGui::Button("Print dirty list")) {
         print_dirty_list();
@@ -578,7 +652,7 @@ void VoxelGridGPUDebugger::dispay_debug_window() {
     }
 
     float render_distance_in_chunks = voxel_grid->render_distance / (voxel_grid->voxel_size.x * voxel_grid->chunk_size.x);
-    if (ImGui::SliderFloat("Render distance", &render_distance_in_chunks, 0.0f, 30.0f)) {
+    if (ImGui::SliderFloat("Render distance", &render_distance_in_chunks, 0.0f, 160.0f)) {
         voxel_grid->render_distance = render_distance_in_chunks * voxel_grid->voxel_size.x * voxel_grid->chunk_size.x;
     }
 
@@ -594,15 +668,17 @@ void VoxelGridGPUDebugger::dispay_debug_window() {
         );
     }
 
-    if (ImGui::Button("Print ib free list")) {
-        print_free_lists(
-            voxel_grid->ib_heads_,
-            voxel_grid->ib_nodes_,
-            voxel_grid->ib_state_,
-            voxel_grid->count_ib_nodes_,
-            voxel_grid->count_ib_pages_,
-            voxel_grid->ib_order_
-        );
+    if (ImGui::Button("Print mesh pool stats")) {
+        print_mesh_pool_stats();
+    }
+
+    int mesh_defrag_budget = (int)voxel_grid->mesh_defrag_budget;
+    if (ImGui::SliderInt("Mesh defrag budget", &mesh_defrag_budget, 0, (int)voxel_grid->max_mesh_defrag_moves)) {
+        voxel_grid->mesh_defrag_budget = (uint32_t)mesh_defrag_budget;
+    }
+
+    if (ImGui::Button("Defrag mesh pool")) {
+        voxel_grid->defrag_mesh_pool(voxel_grid->max_mesh_defrag_moves);
     }
 
     if (ImGui::CollapsingHeader("Dirty list data", 
@@ -617,16 +693,6 @@ void VoxelGridGPUDebugger::dispay_debug_window() {
             );
         }
 
-        ImGui::SameLine();
-
-        if (ImGui::Button("Print IB")) {
-            print_mesh_alloc_by_dirty_list(
-                "IB", 
-                offsetof(VoxelGridGPU::ChunkMeshAlloc, i_startPage), 
-                offsetof(VoxelGridGPU::ChunkMeshAlloc, i_order)
-            );
-        }
-
         ImGui::Separator();
     }
 
@@ -636,7 +702,7 @@ void VoxelGridGPUDebugger::dispay_debug_window() {
 void VoxelGridGPUDebugger::display_build_from_dirty_window() {
     ImGui::Begin("Build mesh from dirty pipeline");
     if (ImGui::Button("Run all pipeline")) {
-        voxel_grid->build_mesh_from_dirty(math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->build_mesh_from_dirty(VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     }
 
     ImGui::Spacing();
@@ -656,7 +722,7 @@ void VoxelGridGPUDebugger::display_build_from_dirty_window() {
             ValueDispatchArg(vox_per_chunk), 
             BufferDispatchArg(&voxel_grid->mesh_buffers_status_, 1u)
         );
-        voxel_grid->mesh_count(voxel_grid->dispatch_args, math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->mesh_count(voxel_grid->dispatch_args, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     }
 
     if (ImGui::Button("mesh_alloc()")) {
@@ -681,7 +747,7 @@ void VoxelGridGPUDebugger::display_build_from_dirty_window() {
             ValueDispatchArg(vox_per_chunk), 
             BufferDispatchArg(&voxel_grid->mesh_buffers_status_, 1u)
         );
-        voxel_grid->mesh_emit(voxel_grid->dispatch_args, math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->mesh_emit(voxel_grid->dispatch_args, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     }
 
     if (ImGui::Button("mesh_finalize()")) {
@@ -702,9 +768,13 @@ void VoxelGridGPUDebugger::display_build_cmd_window() {
         glm::mat4 view_matrix = window->camera->get_view_matrix();
         glm::mat4 proj_matrix = window->camera->get_projection_matrix(aspect);
         glm::mat4 view_proj_matrix = proj_matrix * view_matrix;
-        voxel_grid->build_indirect_draw_commands_frustum(view_proj_matrix, window->camera->position, math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->build_indirect_draw_commands_frustum(view_proj_matrix, window->camera->position, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     }
 
+    ImGui::Checkbox("Occlusion culling (Hi-Z)", &voxel_grid->occlusion_culling);
+    ImGui::Checkbox("Face direction culling", &voxel_grid->face_direction_culling);
+    if (ImGui::Button("print occlusion stats")) print_occlusion_stats();
+
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::TextDisabled("Pipeline steps");
@@ -719,7 +789,7 @@ void VoxelGridGPUDebugger::display_build_cmd_window() {
         glm::mat4 view_matrix = window->camera->get_view_matrix();
         glm::mat4 proj_matrix = window->camera->get_projection_matrix(aspect);
         glm::mat4 view_proj_matrix = proj_matrix * view_matrix;
-        voxel_grid->build_draw_commands(view_proj_matrix, window->camera->position, math_utils::BITS, math_utils::OFFSET);
+        voxel_grid->build_draw_commands(view_proj_matrix, window->camera->position, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
     }
     ImGui::End();
 }
@@ -762,7 +832,7 @@ void VoxelGridGPUDebugger::display_draw_pipline_window() {
 void VoxelGridGPUDebugger::display_chunk_eviction_window() {
     ImGui::Begin("Chunk enviction");
 
-    if (ImGui::Button("Run all pipeline")) voxel_grid->ensure_free_chunks_gpu(window->camera->position, math_utils::BITS, math_utils::OFFSET);
+    if (ImGui::Button("Run all pipeline")) voxel_grid->ensure_free_chunks_gpu(window->camera->position, VoxelGridGPU::CHUNK_KEY_BITS, VoxelGridGPU::CHUNK_KEY_OFFSET);
 
     ImGui::Spacing();
     ImGui::Separator();
@@ -771,6 +841,20 @@ void VoxelGridGPUDebugger::display_chunk_eviction_window() {
 
     if (ImGui::Button("print eviction log")) print_eviction_log(window->camera->position);
 
+    int frames_per_shell = (int)voxel_grid->eviction_visibility_frames_per_shell;
+    int max_visibility_shells = (int)voxel_grid->eviction_max_visibility_shells;
+    if (ImGui::SliderInt("Invisible frames per shell", &frames_per_shell, 0, 600))
+        voxel_grid->eviction_visibility_frames_per_shell = (uint32_t)frames_per_shell;
+    if (ImGui::SliderInt("Max visibility shells", &max_visibility_shells, 0, 64))
+        voxel_grid->eviction_max_visibility_shells = (uint32_t)max_visibility_shells;
+
+    const ChunkSpillCache::Stats& spill = voxel_grid->spill_cache.stats();
+    ImGui::Text("Spill cache: %zu chunks, %.2f / %.2f MB", spill.count_chunks,
+                spill.compressed_bytes / (1024.0 * 1024.0), spill.raw_bytes / (1024.0 * 1024.0));
+    ImGui::Text("Spilled: %llu, restored: %llu, kept (no batch slot): %llu",
+                (unsigned long long)spill.count_stored, (unsigned long long)spill.count_restored,
+                (unsigned long long)voxel_grid->count_spill_overflow_);
+
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::TextDisabled("Pipeline steps");
@@ -798,7 +882,44 @@ void VoxelGridGPUDebugger::display_stream_chunks_pipeline() {
     ImGui::Begin("Steam chunks pipeline");
     
     if (ImGui::Button("Run all pipeline")) {
-        voxel_grid->stream_chunks_sphere(window->camera->position, 15, 45345345u);
+        voxel_grid->stream_chunks_sphere(stream_focus(), stream_radius_chunks, 45345345u);
+    }
+
+    ImGui::SliderInt("Radius (chunks)", &stream_radius_chunks, 1, 40);
+
+    // чанки убранных уровней сами не выселяются - мир грузится заново
+    int lod_levels = (int)voxel_grid->lod_levels;
+    if (ImGui::SliderInt("LOD levels", &lod_levels, 1, (int)VoxelGridGPU::MAX_LOD_LEVELS)) {
+        voxel_grid->lod_levels = (uint32_t)lod_levels;
+        reset_streamed_world();
+    }
+    ImGui::Checkbox("Velocity prediction", &stream_prediction);
+    ImGui::SliderFloat("Lookahead (s)", &stream_lookahead_seconds, 0.0f, 2.0f);
+    ImGui::SliderFloat("Max center shift (R)", &voxel_grid->stream_max_center_shift, 0.0f, 1.0f);
+    ImGui::SliderFloat("Behind eviction weight", &voxel_grid->stream_behind_eviction_weight, 0.0f, 4.0f);
+    ImGui::Checkbox("Log timings", &voxel_grid->log_stream_timings);
+
+    ImGui::Separator();
+    ImGui::TextDisabled("Hole benchmark (scripted path along view direction)");
+    ImGui::SliderFloat("Speed", &hole_benchmark_speed, 1.0f, 400.0f);
+    ImGui::SliderInt("Frames", &hole_benchmark_frames, 1, 2000);
+
+    if (ImGui::Button("Measure holes now")) {
+        float aspect = window->get_fbuffer_aspect_ratio();
+        glm::mat4 view_proj = window->camera->get_projection_matrix(aspect) * window->camera->get_view_matrix();
+        print_when_ready([](const VoxelGridGPU::StreamHoleStatsGPU& stats) {
+            std::cout << "visible: " << stats.visible_count << ", missing: " << stats.missing_count
+                      << ", unmeshed: " << stats.unmeshed_count << ", hole rate: " << stats.hole_rate() * 100.0f << "%" << std::endl;
+        }, voxel_grid->request_stream_holes(view_proj, window->camera->position).share());
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Compare prediction on/off")) {
+        float worst_off = 0.0f, worst_on = 0.0f;
+        float mean_off = run_stream_hole_benchmark(false, worst_off);
+        float mean_on = run_stream_hole_benchmark(true, worst_on);
+        std::cout << "hole rate without prediction: " << mean_off * 100.0f << "% (worst " << worst_off * 100.0f << "%), "
+                  << "with prediction: " << mean_on * 100.0f << "% (worst " << worst_on * 100.0f << "%)" << std::endl;
+        std::cout << std::endl;
     }
 
     ImGui::Separator();
@@ -10,11 +10,13 @@ VoxelRasterizatorGPU::VoxelRasterizatorGPU(Gridable* gridable, ShaderManager& sh
     prog_copy_offsets_to_cursor_ = ComputeProgram(&shader_manager.copy_offsets_to_cursor_cs);
     prog_fill_ = ComputeProgram(&shader_manager.fill_triangle_indices_cs);
     prog_voxelize_ = ComputeProgram(&shader_manager.voxelize_cs);
-    prog_clear_ = ComputeProgram(&shader_manager.clear_voxels_cs);
     prog_roi_reduce_indices_ = ComputeProgram(&shader_manager.roi_reduce_indices_cs);
     prog_roi_reduce_pairs_ = ComputeProgram(&shader_manager.roi_reduce_pairs_cs);
     prog_roi_finalize_ = ComputeProgram(&shader_manager.roi_finalize_cs);
     prog_build_active_chunks_ = ComputeProgram(&shader_manager.build_active_chunks_cs);
+    prog_dispatch_adapter_ = ComputeProgram(&shader_manager.dispatch_adapter_cs);
+    prog_gather_instances_ = ComputeProgram(&shader_manager.gather_instance_triangles_cs);
+    prog_voxelize_to_grid_ = ComputeProgram(&shader_manager.voxelize_to_grid_cs);
 
     total_pairs_BufferObject_ = BufferObject(sizeof(uint32_t), GL_DYNAMIC_DRAW, nullptr);
     active_chunks_BufferObject_ = BufferObject(sizeof(uint32_t), GL_DYNAMIC_DRAW, nullptr);
@@ -25,10 +27,15 @@ VoxelRasterizatorGPU::VoxelRasterizatorGPU(Gridable* gridable, ShaderManager& sh
 
     roi_out_cap_bytes_ = sizeof(int) * 4 + sizeof(uint32_t) * 4;
     roi_out_BufferObject_ = BufferObject(roi_out_cap_bytes_, GL_DYNAMIC_DRAW, nullptr);
+
+    status_BufferObject_ = BufferObject(sizeof(RasterStatus), GL_DYNAMIC_DRAW, nullptr);
+
+    const uint32_t one_groups[3] = {1u, 1u, 1u};
+    dispatch_args_ = BufferObject(sizeof(uint32_t) * 3u, GL_DYNAMIC_DRAW, one_groups);
 }
 
 VoxelRasterizatorGPU::~VoxelRasterizatorGPU() {
-
+    if (job_fence_) glDeleteSync(job_fence_);
 }
 
 void VoxelRasterizatorGPU::set_roi(glm::ivec3 chunk_origin, glm::uvec3 grid_dim) {
@@ -49,22 +56,21 @@ void VoxelRasterizatorGPU::ensure_roi_reduce_level(uint32_t level, uint32_t numP
     }
 }
 
-void VoxelRasterizatorGPU::calculate_roi(const Mesh& mesh, float voxel_size, int chunk_size, int pad_voxels) {
-    glm::mat4 transform = mesh.get_model_matrix();
+void VoxelRasterizatorGPU::calculate_roi(const TriangleSource& src, float voxel_size, int chunk_size, int pad_voxels) {
+    const glm::mat4& transform = src.transform;
 
-    uint32_t indexCount = uint32_t(mesh.ebo->size_bytes() / sizeof(uint32_t));
-    if (indexCount == 0) { set_roi({0,0,0}, {0,0,0}); return; }
+    uint32_t indexCount = src.tri_count * 3u;
+    if (indexCount == 0) return;
 
-    const uint32_t strideF = mesh.vertex_layout->attributes[0].stride / sizeof(float);
-    const int posAttr = mesh.vertex_layout->find_attribute_id_by_name("position");
-    const uint32_t posOffF = mesh.vertex_layout->attributes[posAttr].offset / sizeof(float);
+    const uint32_t strideF = src.stride_f;
+    const uint32_t posOffF = src.pos_offset_f;
 
     // level 0: indices -> group AABB
     uint32_t numPairs = math_utils::div_up_u32(indexCount, 256u);
     ensure_roi_reduce_level(0, numPairs);
 
-    mesh.vbo->bind_base_as_ssbo(0);
-    mesh.ebo->bind_base_as_ssbo(1);
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
     roi_reduce_levels_[0].bind_base_as_ssbo(2);
 
     prog_roi_reduce_indices_.use();
@@ -95,59 +101,48 @@ void VoxelRasterizatorGPU::calculate_roi(const Mesh& mesh, float voxel_size, int
         level++;
     }
 
-    // finalize
+    // finalize: ROI остаётся в roi_out, проходы читают её оттуда
     roi_reduce_levels_[level].bind_base_as_ssbo(0);
     roi_out_BufferObject_.bind_base_as_ssbo(1);
+    status_BufferObject_.bind_base_as_ssbo(2);
 
     prog_roi_finalize_.use();
     glUniform1i(glGetUniformLocation(prog_roi_finalize_.id, "uChunkSize"), chunk_size);
     glUniform1i(glGetUniformLocation(prog_roi_finalize_.id, "uPadVoxels"), pad_voxels);
     glUniform1f(glGetUniformLocation(prog_roi_finalize_.id, "uEps"), 1e-4f);
+    glUniform1ui(glGetUniformLocation(prog_roi_finalize_.id, "uChunkCapacity"), chunk_capacity);
     prog_roi_finalize_.dispatch_compute(1,1,1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-    // readback 32 байта
-    struct RoiGPU { glm::ivec4 origin; glm::uvec4 dim; } roi{};
-    roi_out_BufferObject_.read_subdata(0, sizeof(RoiGPU), &roi);
-    set_roi(glm::ivec3(roi.origin), glm::uvec3(roi.dim));
 }
 
 
-void VoxelRasterizatorGPU::ensure_roi_buffers(size_t vertex_count, size_t tri_count, uint32_t chunk_count, uint32_t chunk_voxel_count) {
+void VoxelRasterizatorGPU::ensure_capacity_buffers(uint32_t chunk_voxel_count) {
     #ifdef VOXEL_RAST_DEBUG
         const GLenum readUsage = GL_STREAM_READ;
     #else
         const GLenum readUsage = GL_DYNAMIC_DRAW; // в релизе мы почти не читаем
     #endif
 
-    // counters uint[chunk_count] GPU->CPU
-    size_t need_counters = (size_t)chunk_count * sizeof(uint32_t);
+    // counters uint[chunk_capacity] GPU->CPU
+    size_t need_counters = (size_t)chunk_capacity * sizeof(uint32_t);
     if (need_counters > counters_cap_bytes_) {
         counters_BufferObject_ = BufferObject(need_counters, readUsage, nullptr);
         counters_cap_bytes_ = need_counters;
     }
 
-    // offsets uint[chunk_count+1]
-    size_t need_offsets = ((size_t)chunk_count + 1) * sizeof(uint32_t);
+    // offsets uint[chunk_capacity+1]
+    size_t need_offsets = ((size_t)chunk_capacity + 1) * sizeof(uint32_t);
     if (need_offsets > offsets_cap_bytes_) {
         offsets_BufferObject_ = BufferObject(need_offsets, GL_DYNAMIC_DRAW, nullptr);
         offsets_cap_bytes_ = need_offsets;
     }
 
-    // cursor uint[chunk_count] GPU->CPU (только дебаг)
-    size_t need_cursor = (size_t)chunk_count * sizeof(uint32_t);
+    // cursor uint[chunk_capacity] GPU->CPU (только дебаг)
+    size_t need_cursor = (size_t)chunk_capacity * sizeof(uint32_t);
     if (need_cursor > cursor_cap_bytes_) {
         cursor_BufferObject_ = BufferObject(need_cursor, readUsage, nullptr);
         cursor_cap_bytes_ = need_cursor;
     }
-}
-
-void VoxelRasterizatorGPU::ensure_active_chunk_buffers(uint32_t chunk_voxel_count, uint32_t pair_capacity, uint32_t activeCount) {
-    #ifdef VOXEL_RAST_DEBUG
-        const GLenum readUsage = GL_STREAM_READ;
-    #else
-        const GLenum readUsage = GL_DYNAMIC_DRAW;
-    #endif
 
     // triangleIndices uint[pair_capacity]
     size_t need_pairs = (size_t)pair_capacity * sizeof(uint32_t);
@@ -156,19 +151,20 @@ void VoxelRasterizatorGPU::ensure_active_chunk_buffers(uint32_t chunk_voxel_coun
         tri_indices_cap_bytes_ = need_pairs;
     }
 
-    // voxels uint[chunk_count * chunk_voxel_count] GPU->CPU (только дебаг)
-    const uint64_t total_vox = uint64_t(activeCount) * uint64_t(chunk_voxel_count);
+    // activeChunks uint[active_capacity]
+    size_t need_active = std::max<size_t>(1, active_capacity) * sizeof(uint32_t);
+    if (need_active > active_cap_bytes_) {
+        active_chunks_BufferObject_ = BufferObject(need_active, GL_DYNAMIC_DRAW, nullptr);
+        active_cap_bytes_ = need_active;
+    }
+
+    // voxels uint[active_capacity * chunk_voxel_count] GPU->CPU
+    const uint64_t total_vox = uint64_t(active_capacity) * uint64_t(chunk_voxel_count);
     size_t need_vox = size_t(total_vox * sizeof(uint32_t));
     if (need_vox > vox_cap_bytes_) {
         voxels_BufferObject_ = BufferObject(need_vox, readUsage, nullptr);
         vox_cap_bytes_ = need_vox;
     }
-
-    size_t need_active = std::max<size_t>(1, activeCount) * sizeof(uint32_t);
-    if (need_active > active_cap_bytes_) {
-        active_chunks_BufferObject_ = BufferObject(need_active, GL_DYNAMIC_DRAW, nullptr);
-        active_cap_bytes_ = need_active;
-    }
 }
 
 void VoxelRasterizatorGPU::ensure_scan_level(uint32_t level, uint32_t numBlocks) {
@@ -235,27 +231,25 @@ void VoxelRasterizatorGPU::clear_counters() {
 }
 
 void VoxelRasterizatorGPU::count_triangles_in_chunks(
-    const Mesh& mesh,
+    const TriangleSource& src,
     float voxel_size, 
-    int chunk_size, 
-    uint32_t tri_count) 
+    int chunk_size) 
 {
-    glm::mat4 transform = mesh.get_model_matrix();
-
-    const uint32_t vertex_stride_f = mesh.vertex_layout->attributes[0].stride / sizeof(float);
-    const int pos_attr_id = mesh.vertex_layout->find_attribute_id_by_name("position");
-    const uint32_t pos_offset_f = mesh.vertex_layout->attributes[pos_attr_id].offset / sizeof(float);
+    const glm::mat4& transform = src.transform;
+    const uint32_t tri_count = src.tri_count;
+    const uint32_t vertex_stride_f = src.stride_f;
+    const uint32_t pos_offset_f = src.pos_offset_f;
 
-    mesh.vbo->bind_base_as_ssbo(0);
-    mesh.ebo->bind_base_as_ssbo(1);
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
     counters_BufferObject_.bind_base_as_ssbo(2);
+    roi_out_BufferObject_.bind_base_as_ssbo(3);
+    status_BufferObject_.bind_base_as_ssbo(4);
 
     prog_count_.use();
     glUniformMatrix4fv(glGetUniformLocation(prog_count_.id, "uTransform"), 1, GL_FALSE, &transform[0][0]);
     glUniform1f       (glGetUniformLocation(prog_count_.id, "uVoxelSize"), voxel_size);
     glUniform1i       (glGetUniformLocation(prog_count_.id, "uChunkSize"), chunk_size);
-    glUniform3i       (glGetUniformLocation(prog_count_.id, "uChunkOrigin"), roi_origin_.x, roi_origin_.y, roi_origin_.z);
-    glUniform3ui      (glGetUniformLocation(prog_count_.id, "uGridDim"), roi_dim_.x, roi_dim_.y, roi_dim_.z);
     glUniform1ui      (glGetUniformLocation(prog_count_.id, "uTriCount"), tri_count);
     glUniform1ui(glGetUniformLocation(prog_count_.id, "uStrideF"), vertex_stride_f);
     glUniform1ui(glGetUniformLocation(prog_count_.id, "uPosOffF"), pos_offset_f);
@@ -269,30 +263,28 @@ void VoxelRasterizatorGPU::count_triangles_in_chunks(
 }
 
 void VoxelRasterizatorGPU::fill_triangle_indices(
-    const Mesh& mesh,
+    const TriangleSource& src,
     float voxel_size, 
-    int chunk_size, 
-    size_t tri_count
+    int chunk_size
 ) {
-    glm::mat4 transform = mesh.get_model_matrix();
+    const glm::mat4& transform = src.transform;
+    const uint32_t tri_count = src.tri_count;
+    const uint32_t vertex_stride_f = src.stride_f;
+    const uint32_t pos_offset_f = src.pos_offset_f;
 
-    const uint32_t vertex_stride_f = mesh.vertex_layout->attributes[0].stride / sizeof(float);
-    const int pos_attr_id = mesh.vertex_layout->find_attribute_id_by_name("position");
-    const uint32_t pos_offset_f = mesh.vertex_layout->attributes[pos_attr_id].offset / sizeof(float);
-
-    mesh.vbo->bind_base_as_ssbo(0);
-    mesh.ebo->bind_base_as_ssbo(1);
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
     cursor_BufferObject_.bind_base_as_ssbo(2);
     tri_indices_BufferObject_.bind_base_as_ssbo(3);
+    roi_out_BufferObject_.bind_base_as_ssbo(4);
+    status_BufferObject_.bind_base_as_ssbo(5);
 
     prog_fill_.use();
     glUniformMatrix4fv(glGetUniformLocation(prog_fill_.id, "uTransform"), 1, GL_FALSE, &transform[0][0]);
     glUniform1f(glGetUniformLocation(prog_fill_.id, "uVoxelSize"), voxel_size);
     glUniform1i(glGetUniformLocation(prog_fill_.id, "uChunkSize"), chunk_size);
-    glUniform3i(glGetUniformLocation(prog_fill_.id, "uChunkOrigin"), roi_origin_.x, roi_origin_.y, roi_origin_.z);
-    glUniform3ui(glGetUniformLocation(prog_fill_.id, "uGridDim"), roi_dim_.x, roi_dim_.y, roi_dim_.z);
     glUniform1ui(glGetUniformLocation(prog_fill_.id, "uTriCount"), tri_count);
-    glUniform1ui(glGetUniformLocation(prog_fill_.id, "uOutCapacity"), last_total_pairs_);
+    glUniform1ui(glGetUniformLocation(prog_fill_.id, "uOutCapacity"), pair_capacity);
     glUniform1ui(glGetUniformLocation(prog_fill_.id, "uStrideF"), vertex_stride_f);
     glUniform1ui(glGetUniformLocation(prog_fill_.id, "uPosOffF"), pos_offset_f);
 
@@ -303,96 +295,137 @@ void VoxelRasterizatorGPU::fill_triangle_indices(
     }
 }
 
-void VoxelRasterizatorGPU::clear_active_voxels(int chunk_size, uint32_t active_count) {
-    const uint32_t chunkVoxelCount = chunk_size * chunk_size * chunk_size;
-    const uint32_t total_voxels = chunk_count_ * chunkVoxelCount;
-    
-
-    // 16 для chunk_size=16 и local_size_x=256
-    uint32_t groupsX = math_utils::div_up_u32(chunkVoxelCount, 256u); // 4096/256 = 16
-    uint32_t groupsY = active_count;
-    uint32_t groupsZ = 1;
-
-    voxels_BufferObject_.bind_base_as_ssbo(0);
-
-    prog_clear_.use();
-    glUniform1ui(glGetUniformLocation(prog_clear_.id, "uChunkVoxelCount"), chunkVoxelCount);
-    glUniform1ui(glGetUniformLocation(prog_clear_.id, "uActiveCount"), active_count);
-    prog_clear_.dispatch_compute(groupsX, groupsY, groupsZ);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-}
-
 void VoxelRasterizatorGPU::voxelize_chunks(
-    const Mesh& mesh,
+    const BufferObject& dispatch_args,
+    const TriangleSource& src,
     float voxel_size, 
-    int chunk_size, 
-    uint32_t active_count, 
-    uint32_t tri_count
+    int chunk_size
 ) {
     const uint32_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
-    const uint32_t total_voxels = chunk_count_ * chunk_voxel_count;
-
-    glm::mat4 transform = mesh.get_model_matrix();
 
-    const uint32_t vertex_stride_f = mesh.vertex_layout->attributes[0].stride / sizeof(float);
-    const int pos_attr_id = mesh.vertex_layout->find_attribute_id_by_name("position");
-    const uint32_t pos_offset_f = mesh.vertex_layout->attributes[pos_attr_id].offset / sizeof(float);
-
-    // 16 для chunk_size=16 и local_size_x=256
-    uint32_t groupsX = math_utils::div_up_u32(chunk_voxel_count, 256u); // 4096/256 = 16
-    uint32_t groupsY = active_count;
-    uint32_t groupsZ = 1;
+    const glm::mat4& transform = src.transform;
+    const uint32_t tri_count = src.tri_count;
+    const uint32_t vertex_stride_f = src.stride_f;
+    const uint32_t pos_offset_f = src.pos_offset_f;
 
-    mesh.vbo->bind_base_as_ssbo(0);
-    mesh.ebo->bind_base_as_ssbo(1);
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
     offsets_BufferObject_.bind_base_as_ssbo(2);
     tri_indices_BufferObject_.bind_base_as_ssbo(3);
     voxels_BufferObject_.bind_base_as_ssbo(4);
     active_chunks_BufferObject_.bind_base_as_ssbo(5);
+    active_count_BufferObject_.bind_base_as_ssbo(6);
+    roi_out_BufferObject_.bind_base_as_ssbo(7);
+    status_BufferObject_.bind_base_as_ssbo(8);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
     
     prog_voxelize_.use();
     glUniformMatrix4fv(glGetUniformLocation(prog_voxelize_.id, "uTransform"), 1, GL_FALSE, &transform[0][0]);
     glUniform1f(glGetUniformLocation(prog_voxelize_.id, "uVoxelSize"), voxel_size);
     glUniform1i(glGetUniformLocation(prog_voxelize_.id, "uChunkSize"), chunk_size);
-    glUniform3i(glGetUniformLocation(prog_voxelize_.id, "uChunkOrigin"), roi_origin_.x, roi_origin_.y, roi_origin_.z);
-    glUniform3ui(glGetUniformLocation(prog_voxelize_.id, "uGridDim"), roi_dim_.x, roi_dim_.y, roi_dim_.z);
     glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "uChunkVoxelCount"), chunk_voxel_count);
-    glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "uChunkCount"), chunk_count_);
-    glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "uActiveCount"), active_count);
     glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "uTriCount"), tri_count);
     glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "vertex_stride_f"), vertex_stride_f);
     glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "pos_offset_f"), pos_offset_f);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_.id, "generator_id_offset_f"), src.generator_id_offset_f);
 
-    prog_voxelize_.dispatch_compute(groupsX, groupsY, groupsZ);
+    glDispatchComputeIndirect(0);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelRasterizatorGPU::ensure_active_index_capacity(uint32_t chunk_count) {
-    size_t need = std::max<uint32_t>(1u, chunk_count) * sizeof(uint32_t);
-    if (need > active_cap_bytes_) {
-        active_chunks_BufferObject_ = BufferObject(need, GL_DYNAMIC_DRAW, nullptr);
-        active_cap_bytes_ = need;
-    }
+void VoxelRasterizatorGPU::voxelize_to_grid(
+    const BufferObject& dispatch_args,
+    VoxelGridGPU& grid,
+    const TriangleSource& src,
+    float voxel_size,
+    int chunk_size
+) {
+    const uint32_t chunk_voxel_count = chunk_size * chunk_size * chunk_size;
+
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
+    offsets_BufferObject_.bind_base_as_ssbo(2);
+    tri_indices_BufferObject_.bind_base_as_ssbo(3);
+    active_chunks_BufferObject_.bind_base_as_ssbo(4);
+    roi_out_BufferObject_.bind_base_as_ssbo(5);
+    status_BufferObject_.bind_base_as_ssbo(6);
+    palette_BufferObject_.bind_base_as_ssbo(7);
+
+    grid.chunk_hash_keys_.bind_base_as_ssbo(8);
+    grid.chunk_hash_vals_.bind_base_as_ssbo(9);
+    grid.voxels_.bind_base_as_ssbo(10);
+    grid.free_list_.bind_base_as_ssbo(11);
+    grid.chunk_meta_.bind_base_as_ssbo(12);
+    grid.enqueued_.bind_base_as_ssbo(13);
+    grid.dirty_list_.bind_base_as_ssbo(14);
+    grid.chunk_last_visible_.bind_base_as_ssbo(15);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatch_args.id());
+
+    prog_voxelize_to_grid_.use();
+    glUniformMatrix4fv(glGetUniformLocation(prog_voxelize_to_grid_.id, "uTransform"), 1, GL_FALSE, &src.transform[0][0]);
+    glUniform1f(glGetUniformLocation(prog_voxelize_to_grid_.id, "uVoxelSize"), voxel_size);
+    glUniform1i(glGetUniformLocation(prog_voxelize_to_grid_.id, "uChunkSize"), chunk_size);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "uChunkVoxelCount"), chunk_voxel_count);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "vertex_stride_f"), src.stride_f);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "pos_offset_f"), src.pos_offset_f);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "generator_id_offset_f"), src.generator_id_offset_f);
+
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_hash_table_size"), grid.chunk_hash_table_size);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_hash_table_mode"), (uint32_t)grid.hash_table_mode);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_set_dirty_flag_bits"), VoxelGridGPU::DIRTY_FLAG_MESH | VoxelGridGPU::DIRTY_FLAG_USER_MODIFIED);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_pack_bits"), VoxelGridGPU::CHUNK_KEY_BITS);
+    glUniform1i(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_pack_offset"), VoxelGridGPU::CHUNK_KEY_OFFSET);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_seed"), grid.stream_seed_);
+    glUniform1ui(glGetUniformLocation(prog_voxelize_to_grid_.id, "u_frame_index"), grid.frame_index_);
+
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void VoxelRasterizatorGPU::prepare_dispatch_args(BufferObject& dispatch_args, const DispatchArg& arg_x, const DispatchArg& arg_y, const DispatchArg& arg_z)
+{
+    if (arg_x.arg_buffer != nullptr) arg_x.arg_buffer->bind_base_as_ssbo(0);
+    if (arg_y.arg_buffer != nullptr) arg_y.arg_buffer->bind_base_as_ssbo(1);
+    if (arg_z.arg_buffer != nullptr) arg_z.arg_buffer->bind_base_as_ssbo(2);
+
+    dispatch_args.bind_base_as_ssbo(3);
+
+    prog_dispatch_adapter_.use();
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_offset_bytes_0"), arg_x.offset_bytes);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_offset_bytes_1"), arg_y.offset_bytes);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_offset_bytes_2"), arg_z.offset_bytes);
+
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_direct_value_0"), arg_x.direct_value);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_direct_value_1"), arg_y.direct_value);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_direct_value_2"), arg_z.direct_value);
+
+    uint32_t x_workgroup_size = arg_x.workgroup_size == DispatchArg::USE_DEFAULT_WORKGROUP_SIZE ? 256u : arg_x.workgroup_size;
+    uint32_t y_workgroup_size = arg_y.workgroup_size == DispatchArg::USE_DEFAULT_WORKGROUP_SIZE ? 1u : arg_y.workgroup_size;
+    uint32_t z_workgroup_size = arg_z.workgroup_size == DispatchArg::USE_DEFAULT_WORKGROUP_SIZE ? 1u : arg_z.workgroup_size;
+
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_x_workgroup_size"), x_workgroup_size);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_y_workgroup_size"), y_workgroup_size);
+    glUniform1ui(glGetUniformLocation(prog_dispatch_adapter_.id, "u_z_workgroup_size"), z_workgroup_size);
+
+    prog_dispatch_adapter_.dispatch_compute(1u, 1u, 1u);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
 void VoxelRasterizatorGPU::pass2_build_offsets_and_active_gpu(uint32_t chunk_count) {
     // 1) offsets[0..n-1] = exclusive_scan(counters)
     gpu_exclusive_scan_u32(counters_BufferObject_, offsets_BufferObject_, chunk_count);
 
-    uint32_t o0=0, o1=0, o255=0, o256=0, olast=0;
-    offsets_BufferObject_.read_subdata(0 * 4, 4, &o0);
-    offsets_BufferObject_.read_subdata(1 * 4, 4, &o1);
-    offsets_BufferObject_.read_subdata(255 * 4, 4, &o255);
-    offsets_BufferObject_.read_subdata(256 * 4, 4, &o256);
-    offsets_BufferObject_.read_subdata((chunk_count_-1) * 4, 4, &olast);
-
-    // 2) offsets[n] + totalPairs[0]
+    // 2) offsets[n] + totalPairs[0], переполнение tri_indices -> status
     counters_BufferObject_.bind_base_as_ssbo(0);
     offsets_BufferObject_.bind_base_as_ssbo(1);
     total_pairs_BufferObject_.bind_base_as_ssbo(2);
+    status_BufferObject_.bind_base_as_ssbo(3);
 
     prog_fix_last_.use();
     glUniform1ui(glGetUniformLocation(prog_fix_last_.id, "uN"), chunk_count);
+    glUniform1ui(glGetUniformLocation(prog_fix_last_.id, "uPairCapacity"), pair_capacity);
     prog_fix_last_.dispatch_compute(1, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
@@ -407,134 +440,313 @@ void VoxelRasterizatorGPU::pass2_build_offsets_and_active_gpu(uint32_t chunk_cou
     if (tg > 0) prog_copy_offsets_to_cursor_.dispatch_compute(tg, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-    // 4) activeCount = 0
-    {
-        uint32_t zero = 0;
-        active_count_BufferObject_.bind_as_ssbo();
-        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
-    }
-
-    // 5) activeChunks capacity >= chunk_count
-    ensure_active_index_capacity(chunk_count);
-
-    // 6) build activeChunks + activeCount
+    // 4) build activeChunks + activeCount (activeCount обнулён в submit)
     counters_BufferObject_.bind_base_as_ssbo(0);
     active_chunks_BufferObject_.bind_base_as_ssbo(1);
     active_count_BufferObject_.bind_base_as_ssbo(2);
+    status_BufferObject_.bind_base_as_ssbo(3);
 
     prog_build_active_chunks_.use();
     glUniform1ui(glGetUniformLocation(prog_build_active_chunks_.id, "uN"), chunk_count);
+    glUniform1ui(glGetUniformLocation(prog_build_active_chunks_.id, "uActiveCapacity"), active_capacity);
 
     if (tg > 0) prog_build_active_chunks_.dispatch_compute(tg, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void VoxelRasterizatorGPU::rasterize(const Mesh& mesh,
-                                    float voxel_size,
-                                    int chunk_size) {
-    #ifdef RASTERIZE_DEBUG
-        double t0 = math_utils::ms_now();
-    #endif
+VoxelRasterizatorGPU::TriangleSource VoxelRasterizatorGPU::mesh_source(const Mesh& mesh, const glm::mat4& transform) {
+    TriangleSource src;
+    src.vbo = mesh.vbo;
+    src.ebo = mesh.ebo;
+    src.transform = transform;
+    src.stride_f = mesh.vertex_layout->attributes[0].stride / sizeof(float);
+    const int pos_attr_id = mesh.vertex_layout->find_attribute_id_by_name("position");
+    src.pos_offset_f = mesh.vertex_layout->attributes[pos_attr_id].offset / sizeof(float);
 
-    prog_voxelize_.print_program_log("voxelize");
-    prog_clear_.print_program_log("clear");
+    const size_t vertex_count = src.stride_f ? mesh.vbo->size_bytes() / (sizeof(float) * src.stride_f) : 0;
+    src.tri_count = vertex_count ? uint32_t(mesh.ebo->size_bytes() / (sizeof(uint32_t) * 3)) : 0u;
+    return src;
+}
 
-    // 0) ROI (пока на CPU)
-    calculate_roi(mesh, voxel_size, chunk_size, 1);
-    
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t1 = math_utils::ms_now();
-    #endif
+VoxelRasterizatorGPU::JobStatus VoxelRasterizatorGPU::rasterize(const Mesh& mesh,
+                                                                float voxel_size,
+                                                                int chunk_size,
+                                                                VoxelGenerator voxel_generator) {
+    if (busy()) return JobStatus::Busy;
+    return start_job(mesh_source(mesh, mesh.get_model_matrix()), voxel_size, chunk_size, std::move(voxel_generator));
+}
 
-    chunk_count_ = roi_dim_.x * roi_dim_.y * roi_dim_.z;
-    if (chunk_count_ == 0 || roi_dim_.x == 0 || roi_dim_.y == 0 || roi_dim_.z == 0) {
-        last_total_pairs_ = 0;
-        return;
+void VoxelRasterizatorGPU::ensure_batch_buffers(uint32_t tri_count) {
+    if (tri_count <= batch_tri_cap_) return;
+
+    uint32_t cap = std::max(tri_count, batch_tri_cap_ + batch_tri_cap_ / 2);
+    batch_vertices_ = BufferObject(size_t(cap) * 3 * sizeof(glm::vec4), GL_DYNAMIC_DRAW, nullptr);
+
+    // индексы общего потока тождественные, пишутся один раз на рост
+    std::vector<uint32_t> indices(size_t(cap) * 3);
+    for (size_t i = 0; i < indices.size(); i++) indices[i] = uint32_t(i);
+    batch_indices_ = BufferObject(indices.size() * sizeof(uint32_t), GL_DYNAMIC_DRAW, indices.data());
+
+    batch_tri_cap_ = cap;
+}
+
+void VoxelRasterizatorGPU::gather_instance(const Instance& instance, uint32_t base_tri) {
+    TriangleSource src = mesh_source(*instance.mesh, instance.transform);
+    if (src.tri_count == 0) return;
+
+    src.vbo->bind_base_as_ssbo(0);
+    src.ebo->bind_base_as_ssbo(1);
+    batch_vertices_.bind_base_as_ssbo(2);
+
+    prog_gather_instances_.use();
+    glUniformMatrix4fv(glGetUniformLocation(prog_gather_instances_.id, "uTransform"), 1, GL_FALSE, &src.transform[0][0]);
+    glUniform1ui(glGetUniformLocation(prog_gather_instances_.id, "uTriCount"), src.tri_count);
+    glUniform1ui(glGetUniformLocation(prog_gather_instances_.id, "uBaseTri"), base_tri);
+    glUniform1ui(glGetUniformLocation(prog_gather_instances_.id, "uGeneratorId"), instance.generator_id);
+    glUniform1ui(glGetUniformLocation(prog_gather_instances_.id, "uStrideF"), src.stride_f);
+    glUniform1ui(glGetUniformLocation(prog_gather_instances_.id, "uPosOffF"), src.pos_offset_f);
+
+    prog_gather_instances_.dispatch_compute(math_utils::div_up_u32(src.tri_count, 256u), 1, 1);
+}
+
+VoxelRasterizatorGPU::TriangleSource VoxelRasterizatorGPU::gather_batch(const std::vector<Instance>& instances) {
+    // смещения инстансов в общем потоке известны на CPU по размерам EBO, без чтения с GPU
+    std::vector<uint32_t> base_tris(instances.size());
+    uint32_t total_tris = 0;
+    for (size_t i = 0; i < instances.size(); i++) {
+        base_tris[i] = total_tris;
+        total_tris += mesh_source(*instances[i].mesh, instances[i].transform).tri_count;
+    }
+
+    if (total_tris == 0) return TriangleSource();
+
+    ensure_batch_buffers(total_tris);
+    for (size_t i = 0; i < instances.size(); i++)
+        gather_instance(instances[i], base_tris[i]);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    TriangleSource src;
+    src.vbo = &batch_vertices_;
+    src.ebo = &batch_indices_;
+    src.transform = glm::mat4(1.0f);
+    src.stride_f = 4;
+    src.pos_offset_f = 0;
+    src.generator_id_offset_f = 3;
+    src.tri_count = total_tris;
+    return src;
+}
+
+VoxelRasterizatorGPU::JobStatus VoxelRasterizatorGPU::rasterize_batch(const std::vector<Instance>& instances,
+                                                                      float voxel_size,
+                                                                      int chunk_size,
+                                                                      VoxelGenerator voxel_generator) {
+    // gather_batch перезаписал бы общий поток треугольников, который читает перезапуск текущей задачи
+    if (busy()) return JobStatus::Busy;
+    return start_job(gather_batch(instances), voxel_size, chunk_size, std::move(voxel_generator));
+}
+
+glm::mat4 VoxelRasterizatorGPU::grid_voxel_transform(const VoxelGridGPU& grid) {
+    return glm::scale(glm::mat4(1.0f), 1.0f / grid.voxel_size) * glm::inverse(grid.get_model_matrix());
+}
+
+int VoxelRasterizatorGPU::grid_chunk_size(const VoxelGridGPU& grid) {
+    if (grid.chunk_size.x != grid.chunk_size.y || grid.chunk_size.x != grid.chunk_size.z) {
+        std::cout << "VoxelRasterizatorGPU: grid chunk must be a cube, got " << grid.chunk_size.x << "x"
+                  << grid.chunk_size.y << "x" << grid.chunk_size.z << std::endl;
+        throw std::runtime_error("VoxelRasterizatorGPU: grid chunk must be a cube");
+    }
+    return grid.chunk_size.x;
+}
+
+void VoxelRasterizatorGPU::upload_palette(const std::vector<VoxelGridGPU::VoxelDataGPU>& palette) {
+    if (palette.empty()) {
+        std::cout << "VoxelRasterizatorGPU: palette is empty" << std::endl;
+        throw std::runtime_error("VoxelRasterizatorGPU: palette is empty");
     }
 
-    const size_t stride_f = mesh.vertex_layout->attributes[0].stride / sizeof(float);
+    size_t need = palette.size() * sizeof(VoxelGridGPU::VoxelDataGPU);
+    if (need > palette_cap_bytes_) {
+        palette_BufferObject_ = BufferObject(need, GL_DYNAMIC_DRAW, palette.data());
+        palette_cap_bytes_ = need;
+    } else {
+        palette_BufferObject_.update_subdata(0, need, palette.data());
+    }
+}
+
+VoxelRasterizatorGPU::JobStatus VoxelRasterizatorGPU::rasterize_into_grid(VoxelGridGPU& grid,
+                                                                          const Mesh& mesh,
+                                                                          const std::vector<VoxelGridGPU::VoxelDataGPU>& palette) {
+    if (busy()) return JobStatus::Busy; // палитру текущей задачи не перезаписываем
+    const int chunk_size = grid_chunk_size(grid);
+    upload_palette(palette);
 
-    const size_t vertex_count = mesh.vbo->size_bytes() / (sizeof(float) * stride_f);
-    const uint32_t tri_count  = mesh.ebo->size_bytes() / (sizeof(uint32_t) * 3);
-    if (vertex_count == 0 || tri_count == 0) {
+    TriangleSource src = mesh_source(mesh, grid_voxel_transform(grid) * mesh.get_model_matrix());
+    return start_job(src, 1.0f, chunk_size, nullptr, &grid);
+}
+
+VoxelRasterizatorGPU::JobStatus VoxelRasterizatorGPU::rasterize_batch_into_grid(VoxelGridGPU& grid,
+                                                                                const std::vector<Instance>& instances,
+                                                                                const std::vector<VoxelGridGPU::VoxelDataGPU>& palette) {
+    if (busy()) return JobStatus::Busy;
+    const int chunk_size = grid_chunk_size(grid);
+    upload_palette(palette);
+
+    const glm::mat4 to_grid = grid_voxel_transform(grid);
+    std::vector<Instance> local = instances;
+    for (Instance& instance : local) instance.transform = to_grid * instance.transform;
+
+    return start_job(gather_batch(local), 1.0f, chunk_size, nullptr, &grid);
+}
+
+VoxelRasterizatorGPU::JobStatus VoxelRasterizatorGPU::start_job(const TriangleSource& source, float voxel_size, int chunk_size,
+                                                                VoxelGenerator voxel_generator, VoxelGridGPU* grid) {
+    prog_voxelize_.print_program_log("voxelize");
+
+    if (source.tri_count == 0) {
         last_total_pairs_ = 0;
-        return;
+        chunk_count_ = 0;
+        return JobStatus::Empty;
     }
 
-    const uint32_t chunk_voxel_count = uint32_t(chunk_size) * uint32_t(chunk_size) * uint32_t(chunk_size);
+    job_source_ = source;
+    job_generator_ = std::move(voxel_generator);
+    job_grid_ = grid;
+    job_voxel_size_ = voxel_size;
+    job_chunk_size_ = chunk_size;
+    job_retries_ = 0;
 
-    // 1) Буферы (pair_capacity пока 1, после scan расширим)
-    ensure_roi_buffers(vertex_count, tri_count, chunk_count_, chunk_voxel_count);
+    submit();
+    return JobStatus::Submitted;
+}
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t2 = math_utils::ms_now();
-    #endif
+void VoxelRasterizatorGPU::submit() {
+    const TriangleSource& src = job_source_;
+    const float voxel_size = job_voxel_size_;
+    const int chunk_size = job_chunk_size_;
 
-    // 3) Очистить counters
-    clear_counters();
+    const uint32_t chunk_voxel_count = uint32_t(chunk_size) * uint32_t(chunk_size) * uint32_t(chunk_size);
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t3 = math_utils::ms_now();
-    #endif
+    double t0 = math_utils::ms_now();
+    job_timestamps_.clear();
+    job_timestamps_.emplace_back();
+
+    // 0) Буферы с запасом, status и activeCount = 0
+    ensure_capacity_buffers(chunk_voxel_count);
+    {
+        uint32_t zero = 0;
+        status_BufferObject_.bind_as_ssbo();
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        active_count_BufferObject_.bind_as_ssbo();
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
-    // 4) Pass1: COUNT (GPU)
-    count_triangles_in_chunks(mesh, voxel_size, chunk_size, tri_count);
+    // 1) ROI -> roi_out (на GPU, без чтения)
+    calculate_roi(src, voxel_size, chunk_size, 1);
+    job_timestamps_.emplace_back();
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t4 = math_utils::ms_now();
-    #endif
+    // 2) Pass1: COUNT
+    clear_counters();
+    count_triangles_in_chunks(src, voxel_size, chunk_size);
+    job_timestamps_.emplace_back();
+
+    // 3) Pass2: offsets/cursor/activeChunks по всей ёмкости (хвост counters нулевой)
+    pass2_build_offsets_and_active_gpu(chunk_capacity);
+    job_timestamps_.emplace_back();
+
+    // 4) Pass3: fill triangleIndices
+    fill_triangle_indices(src, voxel_size, chunk_size);
+    job_timestamps_.emplace_back();
+
+    // 5) Pass4: groups.y = activeCount с GPU
+    if (job_grid_) {
+        // один workgroup на весь чанк: он же решает, создавать ли чанк, и заполняет новый
+        prepare_dispatch_args(dispatch_args_, ValueDispatchArg(1u, 1u), BufferDispatchArg(&active_count_BufferObject_, 0u));
+        voxelize_to_grid(dispatch_args_, *job_grid_, src, voxel_size, chunk_size);
+    } else {
+        // workgroup на 256 вокселей чанка; очистка не нужна: voxelize пишет каждый воксель активного чанка, пустые - нулём
+        prepare_dispatch_args(dispatch_args_, ValueDispatchArg(chunk_voxel_count), BufferDispatchArg(&active_count_BufferObject_, 0u));
+        voxelize_chunks(dispatch_args_, src, voxel_size, chunk_size);
+    }
+    job_timestamps_.emplace_back();
 
-    // ---------- Pass2 (CPU): counters -> offsets/cursor (debugged) ----------
-    pass2_build_offsets_and_active_gpu(chunk_count_);
+    job_fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t5 = math_utils::ms_now();
-    #endif
+    job_submit_ms_ = math_utils::ms_now() - t0;
+}
 
-    uint32_t totalPairs = 0;
-    total_pairs_BufferObject_.read_subdata(0, sizeof(uint32_t), &totalPairs);
+bool VoxelRasterizatorGPU::poll() {
+    if (job_fence_ == nullptr) return false;
 
-    uint32_t activeCount = 0;
-    active_count_BufferObject_.read_subdata(0, sizeof(uint32_t), &activeCount);
+    // таймаут 0: только проверить fence, не ждать GPU
+    GLenum state = glClientWaitSync(job_fence_, 0, 0);
+    if (state == GL_TIMEOUT_EXPIRED) return false;
 
-    last_total_pairs_ = totalPairs;
+    glDeleteSync(job_fence_);
+    job_fence_ = nullptr;
 
-    if (totalPairs == 0 || activeCount == 0) return;
+    if (state == GL_WAIT_FAILED) {
+        std::cout << "VoxelRasterizatorGPU::poll: glClientWaitSync failed" << std::endl;
+        throw std::runtime_error("VoxelRasterizatorGPU::poll: glClientWaitSync failed");
+    }
 
-    // Теперь можно аллоцировать tri_indices + voxels под реальные размеры
-    ensure_active_chunk_buffers(chunk_voxel_count, totalPairs, activeCount);
+    // GPU закончил — чтения ниже не ждут
+    status_BufferObject_.read_subdata(0, sizeof(RasterStatus), &last_status_);
 
     #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t6 = math_utils::ms_now();
+        std::cout << "submit (CPU): " << job_submit_ms_ << " ms" << std::endl;
+        std::cout << "calculate_roi: " << job_timestamps_[1] - job_timestamps_[0] << " ms" << std::endl;
+        std::cout << "count_triangles_in_chunks: " << job_timestamps_[2] - job_timestamps_[1] << " ms" << std::endl;
+        std::cout << "pass2: " << job_timestamps_[3] - job_timestamps_[2] << " ms" << std::endl;
+        std::cout << "fill_triangle_indices: " << job_timestamps_[4] - job_timestamps_[3] << " ms" << std::endl;
+        std::cout << "voxelize: " << job_timestamps_[5] - job_timestamps_[4] << " ms" << std::endl;
+        std::cout << "--------------------------" << std::endl;
+        std::cout << "raterization (GPU): " << job_timestamps_[5] - job_timestamps_[0] << " ms" << std::endl;
     #endif
 
-    // ---------- end Pass2 ----------
-    // Pass 3: fill triangleIndices
-    fill_triangle_indices(mesh, voxel_size, chunk_size, tri_count);
+    if (last_status_.overflow != 0) {
+        // need_* валидны только для переполнившихся буферов: остальные проходы кадра были пропущены
+        auto grow = [](uint32_t capacity, uint32_t need) { return need > capacity ? need + need / 2 : capacity; };
+        if (last_status_.overflow & OVERFLOW_CHUNKS) chunk_capacity = grow(chunk_capacity, last_status_.need_chunks);
+        if (last_status_.overflow & OVERFLOW_PAIRS) pair_capacity = grow(pair_capacity, last_status_.need_pairs);
+        if (last_status_.overflow & OVERFLOW_ACTIVE) active_capacity = grow(active_capacity, last_status_.need_active);
+
+        #ifdef RASTERIZE_DEBUG
+            std::cout << "overflow " << last_status_.overflow << ", retry with capacities: chunks " << chunk_capacity
+                      << ", pairs " << pair_capacity << ", active " << active_capacity << std::endl;
+        #endif
+
+        job_retries_++;
+        submit();
+        return false;
+    }
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t7 = math_utils::ms_now();
-    #endif
+    chunk_count_ = last_status_.need_chunks;
+    last_total_pairs_ = last_status_.need_pairs;
+    if (!job_grid_) read_result();
+    else if (last_status_.failed_chunks != 0) {
+        std::cout << "VoxelRasterizatorGPU::poll: " << last_status_.failed_chunks
+                  << " chunks got no id in the grid (free list empty or bucket full), their voxels are lost" << std::endl;
+    }
 
-    // На этом этапе на GPU готов CSR:
-    // offsets_BufferObject_ (uint[chunkCount+1])
-    // tri_indices_BufferObject_ (uint[totalPairs])
-    //
-    // Дальше Pass 4: "один workgroup на чанк" и растеризация по списку треугольников.
-    clear_active_voxels(chunk_size, activeCount);
-    voxelize_chunks(mesh, voxel_size, chunk_size, activeCount, tri_count);
+    job_source_ = TriangleSource();
+    job_generator_ = nullptr;
+    job_grid_ = nullptr;
+    return true;
+}
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t8 = math_utils::ms_now();
-    #endif
+void VoxelRasterizatorGPU::read_result() {
+    const int chunk_size = job_chunk_size_;
+    const uint32_t chunk_voxel_count = uint32_t(chunk_size) * uint32_t(chunk_size) * uint32_t(chunk_size);
+
+    struct RoiGPU { glm::ivec4 origin; glm::uvec4 dim; } roi{};
+    roi_out_BufferObject_.read_subdata(0, sizeof(RoiGPU), &roi);
+    set_roi(glm::ivec3(roi.origin), glm::uvec3(roi.dim));
+
+    const uint32_t activeCount = last_status_.need_active;
+
+    if (last_total_pairs_ == 0 || activeCount == 0) return;
 
     // Pass 5: Считывание данных
     std::vector<uint32_t> active(activeCount);
@@ -543,55 +755,37 @@ void VoxelRasterizatorGPU::rasterize(const Mesh& mesh,
     std::vector<uint32_t> vox(activeCount * chunk_voxel_count);
     voxels_BufferObject_.read_subdata(0, vox.size() * sizeof(uint32_t), vox.data());
 
-    std::vector<glm::ivec3> voxel_positions;
-    voxel_positions.reserve(activeCount * chunk_voxel_count);
+    // одна правка на чанк: packed = id генератора + 1
+    std::vector<ChunkVoxels> chunks;
+    chunks.reserve(activeCount);
     for (uint32_t a = 0; a < activeCount; ++a) {
         glm::ivec3 cpos = idx_to_chunk(active[a]); // chunk coords in world-chunk-space
 
         const uint32_t* src = vox.data() + size_t(a) * chunk_voxel_count;
 
+        ChunkVoxels chunk;
+        chunk.chunk_pos = cpos;
         for (uint32_t i = 0; i < chunk_voxel_count; ++i) {
             uint32_t packed = src[i];
-            if (packed != 0) {
+            if (packed == 0) continue;
+
+            Voxel voxel;
+            if (job_generator_) {
                 uint32_t lvp_x = i % chunk_size;
                 uint32_t lvp_y = (i / chunk_size) % chunk_size;
                 uint32_t lvp_z = i / (chunk_size * chunk_size);
                 glm::ivec3 voxel_pos = cpos * chunk_size + glm::ivec3(lvp_x, lvp_y, lvp_z);
-                voxel_positions.push_back(voxel_pos);
+                voxel = job_generator_(packed - 1u, voxel_pos);
+            } else {
+                voxel.visible = true;
+                voxel.color = glm::vec3(1.0f, 0.0f, 0.0f);
             }
-        }
-    }
 
-    std::vector<Voxel> voxels;
-    voxels.resize(voxel_positions.size());
-    for (int i = 0; i < voxels.size(); i++) {
-        Voxel voxel;
-        voxel.visible = true;
-        voxel.color = glm::vec3(1.0f, 0.0f, 0.0f);
-
-        voxels[i] = std::move(voxel);
+            chunk.local_ids.push_back(i);
+            chunk.voxels.push_back(voxel);
+        }
+        if (!chunk.local_ids.empty()) chunks.push_back(std::move(chunk));
     }
 
-    #ifdef RASTERIZE_DEBUG
-        glFinish();
-        double t9 = math_utils::ms_now();
-    #endif
-
-    gridable->set_voxels(voxels, voxel_positions);
-
-    #ifdef RASTERIZE_DEBUG
-        double t10 = math_utils::ms_now();
-
-        std::cout << "calculate_roi: " << t1-t0 << " ms" << std::endl;
-        std::cout << "ensure_roi_buffers: " << t2-t1 << " ms" << std::endl;
-        std::cout << "clear_counters: " << t3-t2 << " ms" << std::endl;
-        std::cout << "count_triangles_in_chunks: " << t4-t3 << " ms" << std::endl;
-        std::cout << "pass2: " << t5-t4 << " ms" << std::endl;
-        std::cout << "ensure_active_chunk_buffers: " << t6-t5 << " ms" << std::endl;
-        std::cout << "fill_triangle_indices: " << t7-t6 << " ms" << std::endl;
-        std::cout << "clear+voxelize: " << t8-t7 << " ms" << std::endl;
-        std::cout << "read_voxels: " << t10-t8 << " ms" << std::endl;
-        std::cout << "--------------------------" << std::endl;
-        std::cout << "raterization: " << t10-t0 << "ms" << std::endl;
-    #endif
+    gridable->set_chunk_voxels(glm::ivec3(chunk_size), chunks);
 }
@@ -10,6 +10,7 @@
 #include <vector>
 #include <stdexcept>
 #include <iostream>
+#include <functional>
 
 #include "gridable.h"
 #include "mesh.h"
@@ -20,12 +21,55 @@
 #include "compute_program.h"
 #include "math_utils.h"
 #include "shader_manager.h"
+#include "buffer_dispatch_arg.h"
+#include "value_dispatch_arg.h"
+#include "gpu_timestamp.h"
+#include "voxel_grid_gpu.h"
 
 // GPU CSR: плотная ROI (Nx*Ny*Nz чанков)
+// Проходы не читают данные обратно: ROI и размеры берутся шейдерами из буферов, voxelize запускается
+// через glDispatchComputeIndirect. Буферы выделяются с запасом; если запаса не хватило, GPU ставит флаг
+// в status, кадр отбрасывается и повторяется на следующем poll() с расширенными буферами.
 class VoxelRasterizatorGPU {
 public:
+    // биты RasterStatus::overflow
+    static constexpr uint32_t OVERFLOW_CHUNKS = 1u; // ROI больше chunk_capacity
+    static constexpr uint32_t OVERFLOW_PAIRS  = 2u; // пар треугольник-чанк больше pair_capacity
+    static constexpr uint32_t OVERFLOW_ACTIVE = 4u; // непустых чанков больше active_capacity
+
+    // раскладка Status в шейдерах voxel_rasterization
+    struct RasterStatus {
+        uint32_t overflow = 0;
+        uint32_t need_chunks = 0;
+        uint32_t need_pairs = 0;
+        uint32_t need_active = 0;
+        uint32_t failed_chunks = 0; // rasterize_into_grid: чанки с попаданиями, не найденные и не созданные в grid
+    };
+
+    // инстанс батча: меш со своей трансформацией (вместо mesh->get_model_matrix()) и id генератора вокселей
+    struct Instance {
+        const Mesh* mesh = nullptr;
+        glm::mat4 transform = glm::mat4(1.0f);
+        uint32_t generator_id = 0; // < 2^24
+    };
+
+    // результат постановки задачи
+    enum class JobStatus {
+        Submitted, // задача на GPU, результат отдаст poll()
+        Empty,     // треугольников нет, задачи нет
+        Busy,      // предыдущая задача не завершена (poll() ещё не вернул true), вызов ничего не сделал
+    };
+
+    // Voxel F(generator_id, point); для одиночного rasterize generator_id = 0
+    using VoxelGenerator = std::function<Voxel(uint32_t generator_id, glm::ivec3 point)>;
+
     Gridable* gridable = nullptr;
 
+    // стартовые ёмкости, при переполнении растут до need * 3 / 2
+    uint32_t chunk_capacity = 4096;
+    uint32_t pair_capacity = 1u << 16;
+    uint32_t active_capacity = 256;
+
     VoxelRasterizatorGPU(Gridable* gridable, ShaderManager& shader_manager);
     ~VoxelRasterizatorGPU();
 
@@ -38,18 +82,65 @@ public:
     //                           int chunk_size,
     //                           int pad_voxels = 0);
 
-    // Основная функция: построить CSR на GPU для mesh_data в ROI.
+    // Основная функция: поставить в очередь GPU построение CSR и вокселизацию mesh, без ожидания.
     // voxel_size: размер вокселя в world units
     // chunk_size: размер чанка в ВОКСЕЛЯХ по стороне (например 16)
-    void rasterize(const Mesh& mesh,
-                   float voxel_size,
-                   int chunk_size);
+    // mesh должен жить до завершения poll(). Пока задача не завершена (busy()), новые вызовы
+    // возвращают Busy и не трогают её буферы, в том числе при перезапуске после переполнения.
+    // voxel_generator пустой — красный воксель.
+    JobStatus rasterize(const Mesh& mesh,
+                        float voxel_size,
+                        int chunk_size,
+                        VoxelGenerator voxel_generator = nullptr);
+
+    // То же для многих мешей за один прогон: треугольники инстансов собираются на GPU в общий поток
+    // (уже в world, id генератора в w вершины), дальше ROI, count, scan, fill и voxelize идут один раз
+    // на весь батч, результат уходит в gridable одним set_chunk_voxels. Меши можно удалять сразу после вызова.
+    JobStatus rasterize_batch(const std::vector<Instance>& instances,
+                              float voxel_size,
+                              int chunk_size,
+                              VoxelGenerator voxel_generator = nullptr);
+
+    // Запись прямо в пул чанков grid, без буфера voxels и без CPU: чанки берутся или создаются через
+    // хеш-таблицу grid и ставятся в dirty_list, как в apply_writes_to_world_gpu. Меш переводится в локальные
+    // координаты grid, размер вокселя и чанка берутся из grid (чанк должен быть кубом).
+    // palette[generator_id] — VoxelData вокселей инстанса (одиночный меш — palette[0]).
+    // Созданный чанк сначала заполняется рельефом (seed последнего stream_chunks_sphere grid), потом попаданиями.
+    // grid должен жить до завершения poll(); свободные чанки grid обеспечивает вызывающий: если free_list пуст
+    // или бакет полон, попадания чанка теряются и считаются в last_status().failed_chunks.
+    JobStatus rasterize_into_grid(VoxelGridGPU& grid,
+                                  const Mesh& mesh,
+                                  const std::vector<VoxelGridGPU::VoxelDataGPU>& palette);
+
+    JobStatus rasterize_batch_into_grid(VoxelGridGPU& grid,
+                                        const std::vector<Instance>& instances,
+                                        const std::vector<VoxelGridGPU::VoxelDataGPU>& palette);
+
+    // Зовётся раз в кадр. false — GPU ещё работает (без ожидания) или кадр переполнился и перезапущен.
+    // true — задача завершена, воксели отданы в gridable.
+    bool poll();
+    bool busy() const { return job_fence_ != nullptr; }
 
     // Полезно для дебага/аллоков
     uint32_t last_total_pairs() const { return last_total_pairs_; }
     uint32_t chunk_count() const { return chunk_count_; }
+    uint32_t last_retry_count() const { return job_retries_; }
+    const RasterStatus& last_status() const { return last_status_; }
 
 private:
+    static constexpr uint32_t NO_GENERATOR_ID = 0xFFFFFFFFu;
+
+    // треугольники, которые читают проходы: VBO/EBO одного меша или общий поток батча
+    struct TriangleSource {
+        BufferObject* vbo = nullptr;
+        BufferObject* ebo = nullptr;
+        glm::mat4 transform = glm::mat4(1.0f);
+        uint32_t stride_f = 0;
+        uint32_t pos_offset_f = 0;
+        uint32_t generator_id_offset_f = NO_GENERATOR_ID;
+        uint32_t tri_count = 0;
+    };
+
     // ROI
     glm::ivec3 roi_origin_{0,0,0};
     glm::uvec3 roi_dim_{1,1,1};
@@ -62,11 +153,13 @@ private:
     ComputeProgram prog_copy_offsets_to_cursor_;
     ComputeProgram prog_fill_;
     ComputeProgram prog_voxelize_;
-    ComputeProgram prog_clear_;
     ComputeProgram prog_roi_reduce_indices_;
     ComputeProgram prog_roi_reduce_pairs_;
     ComputeProgram prog_roi_finalize_;
     ComputeProgram prog_build_active_chunks_;
+    ComputeProgram prog_dispatch_adapter_;
+    ComputeProgram prog_gather_instances_;
+    ComputeProgram prog_voxelize_to_grid_;
 
     // GPU buffers
     BufferObject counters_BufferObject_;        // uint counters[chunkCount]
@@ -80,6 +173,11 @@ private:
     BufferObject roi_out_BufferObject_;
     BufferObject active_chunks_BufferObject_;
     BufferObject active_count_BufferObject_;
+    BufferObject status_BufferObject_;          // RasterStatus
+    BufferObject dispatch_args_;                // uvec3 для glDispatchComputeIndirect
+    BufferObject batch_vertices_;               // vec4 batchVert[3 * batchTris]: xyz world, w = generator id
+    BufferObject batch_indices_;                // uint batchIdx[3 * batchTris] = 0, 1, 2, ...
+    BufferObject palette_BufferObject_;         // VoxelDataGPU palette[], для rasterize_into_grid
     std::vector<BufferObject> roi_reduce_levels_;
 
     BufferObject debug_BufferObject_; // int dbg[32]
@@ -94,10 +192,24 @@ private:
     size_t active_cap_bytes_ = 0;
     size_t roi_out_cap_bytes_ = 0;
     size_t active_count_cap_bytes_ = 0;
+    uint32_t batch_tri_cap_ = 0;
+    size_t palette_cap_bytes_ = 0;
     std::vector<size_t> roi_reduce_caps_;
 
     uint32_t last_total_pairs_ = 0;
     uint32_t chunk_count_ = 1;
+    RasterStatus last_status_;
+
+    // текущая задача
+    TriangleSource job_source_;
+    VoxelGenerator job_generator_;
+    VoxelGridGPU* job_grid_ = nullptr; // != nullptr — пишем в пул чанков grid, читать нечего
+    float job_voxel_size_ = 1.0f;
+    int job_chunk_size_ = 16;
+    GLsync job_fence_ = nullptr;
+    uint32_t job_retries_ = 0;
+    double job_submit_ms_ = 0.0;
+    std::vector<GPUTimestamp> job_timestamps_; // границы проходов, читаются в poll() после fence
 
     // scan scratch уровни (чтобы не было ограничения numBlocks<=256)
     std::vector<std::unique_ptr<BufferObject>> scan_sums_;
@@ -105,19 +217,40 @@ private:
     std::vector<size_t> scan_caps_; // bytes per level
 
 private:
-    void calculate_roi(const Mesh& mesh, float voxel_size, int chunk_size, int pad_voxels);
+    JobStatus start_job(const TriangleSource& source, float voxel_size, int chunk_size, VoxelGenerator voxel_generator,
+                   VoxelGridGPU* grid = nullptr);
+    void submit();
+    void read_result();
+
+    static TriangleSource mesh_source(const Mesh& mesh, const glm::mat4& transform);
+    void ensure_batch_buffers(uint32_t tri_count);
+    void gather_instance(const Instance& instance, uint32_t base_tri);
+    TriangleSource gather_batch(const std::vector<Instance>& instances);
+
+    // world -> координаты вокселей grid (voxel_size проходов тогда = 1)
+    static glm::mat4 grid_voxel_transform(const VoxelGridGPU& grid);
+    static int grid_chunk_size(const VoxelGridGPU& grid);
+    void upload_palette(const std::vector<VoxelGridGPU::VoxelDataGPU>& palette);
+
+    void calculate_roi(const TriangleSource& src, float voxel_size, int chunk_size, int pad_voxels);
     void clear_counters();
-    void count_triangles_in_chunks(const Mesh& mesh, float voxel_size, int chunk_size, uint32_t tri_count); //pass 1
-    void fill_triangle_indices(const Mesh& mesh, float voxel_size, int chunk_size, size_t tri_count); //pass 3
-    void clear_active_voxels(int chunk_size, uint32_t active_count);
-    void voxelize_chunks(const Mesh& mesh, float voxel_size, int chunk_size, uint32_t active_count, uint32_t tri_count);
+    void count_triangles_in_chunks(const TriangleSource& src, float voxel_size, int chunk_size); //pass 1
+    void fill_triangle_indices(const TriangleSource& src, float voxel_size, int chunk_size); //pass 3
+    void voxelize_chunks(const BufferObject& dispatch_args, const TriangleSource& src, float voxel_size, int chunk_size);
+    void voxelize_to_grid(const BufferObject& dispatch_args, VoxelGridGPU& grid, const TriangleSource& src, float voxel_size, int chunk_size);
 
     void pass2_build_offsets_and_active_gpu(uint32_t chunk_count);
 
+    void prepare_dispatch_args(
+        BufferObject& dispatch_args,
+        const DispatchArg& arg_x = ValueDispatchArg(1u),
+        const DispatchArg& arg_y = ValueDispatchArg(1u),
+        const DispatchArg& arg_z = ValueDispatchArg(1u)
+    );
+
     void ensure_roi_reduce_level(uint32_t level, uint32_t numPairs); 
-    void ensure_active_index_capacity(uint32_t chunk_count);
-    void ensure_roi_buffers(size_t vertex_count, size_t tri_count, uint32_t chunk_count, uint32_t chunk_voxel_count);
-    void ensure_active_chunk_buffers(uint32_t chunk_voxel_count, uint32_t pair_capacity, uint32_t activeCount);
+    // буферы под chunk_capacity / pair_capacity / active_capacity
+    void ensure_capacity_buffers(uint32_t chunk_voxel_count);
 
     void ensure_scan_level(uint32_t level, uint32_t numBlocks);
     void gpu_exclusive_scan_u32_impl(BufferObject& in_u32, BufferObject& out_u32, uint32_t n, uint32_t level);
@@ -1,8 +1,22 @@
 #include "voxel_rastorizator.h"
 
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
-VoxelRastorizator::VoxelRastorizator(Gridable* gridable) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VOXEL_RASTER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#include "math_utils.h"
+
+VoxelRastorizator::VoxelRastorizator(Gridable* gridable, glm::ivec3 chunk_size) {
     this->gridable = gridable;
+    this->chunk_size = chunk_size;
 }
 
 float VoxelRastorizator::fmin3(float a, float b, float c) { return std::min(a, std::min(b,c)); }
@@ -84,6 +98,375 @@ bool VoxelRastorizator::tri_box_overlap(const glm::vec3& boxcenter,
 
 std::vector<glm::ivec3> VoxelRastorizator::rasterize_triangle_to_points(
     glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float voxel_size)
+{
+    std::vector<glm::ivec3> out;
+    rasterize_triangle_to_points(v0, v1, v2, voxel_size, out);
+    return out;
+}
+
+bool VoxelRastorizator::tri_column_overlap(int axis,
+                                           const glm::vec3& boxcenter,
+                                           const glm::vec3& boxhalf,
+                                           const glm::vec3& v0,
+                                           const glm::vec3& v1,
+                                           const glm::vec3& v2)
+{
+    // Те же выражения, что и в tri_box_overlap, но только тесты, не зависящие от координаты axis:
+    // три теста по осям axis x edge и AABB по двум остальным осям. Поэтому отказ здесь
+    // означает отказ tri_box_overlap для любого вокселя столбца.
+    glm::vec3 tv0 = v0 - boxcenter;
+    glm::vec3 tv1 = v1 - boxcenter;
+    glm::vec3 tv2 = v2 - boxcenter;
+
+    glm::vec3 e0 = tv1 - tv0;
+    glm::vec3 e1 = tv2 - tv1;
+    glm::vec3 e2 = tv0 - tv2;
+
+    auto axisTest = [&](float a, float b, float fa, float fb,
+                        float v0a, float v0b, float v1a, float v1b, float v2a, float v2b,
+                        float boxA, float boxB) -> bool
+    {
+        float p0 = a * v0a - b * v0b;
+        float p1 = a * v1a - b * v1b;
+        float p2 = a * v2a - b * v2b;
+        float minp = std::min(p0, std::min(p1, p2));
+        float maxp = std::max(p0, std::max(p1, p2));
+        float rad  = fa * boxA + fb * boxB;
+        return !(minp > rad || maxp < -rad);
+    };
+
+    const glm::vec3 edges[3] = {e0, e1, e2};
+    for (const glm::vec3& e : edges) {
+        float fex = std::abs(e.x), fey = std::abs(e.y), fez = std::abs(e.z);
+        if (axis == 0) {
+            if (!axisTest(e.z, e.y, fez, fey, tv0.z, tv0.y, tv1.z, tv1.y, tv2.z, tv2.y, boxhalf.z, boxhalf.y)) return false;
+        } else if (axis == 1) {
+            if (!axisTest(e.z, e.x, fez, fex, tv0.x, tv0.z, tv1.x, tv1.z, tv2.x, tv2.z, boxhalf.x, boxhalf.z)) return false;
+        } else {
+            if (!axisTest(e.y, e.x, fey, fex, tv0.y, tv0.x, tv1.y, tv1.x, tv2.y, tv2.x, boxhalf.y, boxhalf.x)) return false;
+        }
+    }
+
+    for (int q = 0; q < 3; ++q) {
+        if (q == axis) continue;
+        float mn = fmin3(tv0[q], tv1[q], tv2[q]), mx = fmax3(tv0[q], tv1[q], tv2[q]);
+        if (mn > boxhalf[q] || mx < -boxhalf[q]) return false;
+    }
+
+    return true;
+}
+
+// ---- пакетный tri_box_overlap ----
+// SIMD-ядра повторяют tri_box_overlap операция в операцию (без FMA, тот же порядок сложений,
+// min/max с той же семантикой для NaN), ранние выходы заменены накоплением маски отказа.
+// Рёбра считаются по лейнам из уже сдвинутых вершин, как в скалярной версии: (v1 - c) - (v0 - c)
+// округляется иначе, чем v1 - v0, а результат должен совпадать бит в бит.
+
+struct TriBoxConsts {
+    float v0[3], v1[3], v2[3];
+    float half[3];
+};
+
+using TriBoxBatchFn = uint32_t (*)(const float* cx, const float* cy, const float* cz, uint32_t count, const TriBoxConsts& t);
+
+static uint32_t tri_box_batch_scalar(const float* cx, const float* cy, const float* cz, uint32_t count, const TriBoxConsts& t) {
+    glm::vec3 half(t.half[0], t.half[1], t.half[2]);
+    glm::vec3 v0(t.v0[0], t.v0[1], t.v0[2]);
+    glm::vec3 v1(t.v1[0], t.v1[1], t.v1[2]);
+    glm::vec3 v2(t.v2[0], t.v2[1], t.v2[2]);
+
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (VoxelRastorizator::tri_box_overlap(glm::vec3(cx[i], cy[i], cz[i]), half, v0, v1, v2))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+#ifdef VOXEL_RASTER_X86_SIMD
+
+#define AVX2_FN __attribute__((target("avx2")))
+
+AVX2_FN static inline __m256 avx2_neg(__m256 x) {
+    return _mm256_xor_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000u)));
+}
+
+AVX2_FN static inline __m256 avx2_abs(__m256 x) {
+    return _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+}
+
+// std::min(a, std::min(b, c)): min_ps(x, y) == (x < y) ? x : y
+AVX2_FN static inline __m256 avx2_min3(__m256 a, __m256 b, __m256 c) {
+    return _mm256_min_ps(_mm256_min_ps(c, b), a);
+}
+
+// std::max(a, std::max(b, c)): max_ps(x, y) == (x > y) ? x : y
+AVX2_FN static inline __m256 avx2_max3(__m256 a, __m256 b, __m256 c) {
+    return _mm256_max_ps(_mm256_max_ps(c, b), a);
+}
+
+// маска отказа axisTest
+AVX2_FN static inline __m256 avx2_axis_fail(__m256 a, __m256 b, __m256 fa, __m256 fb,
+                                            __m256 v0a, __m256 v0b, __m256 v1a, __m256 v1b, __m256 v2a, __m256 v2b,
+                                            __m256 box_a, __m256 box_b) {
+    __m256 p0 = _mm256_sub_ps(_mm256_mul_ps(a, v0a), _mm256_mul_ps(b, v0b));
+    __m256 p1 = _mm256_sub_ps(_mm256_mul_ps(a, v1a), _mm256_mul_ps(b, v1b));
+    __m256 p2 = _mm256_sub_ps(_mm256_mul_ps(a, v2a), _mm256_mul_ps(b, v2b));
+    __m256 minp = avx2_min3(p0, p1, p2);
+    __m256 maxp = avx2_max3(p0, p1, p2);
+    __m256 rad = _mm256_add_ps(_mm256_mul_ps(fa, box_a), _mm256_mul_ps(fb, box_b));
+    return _mm256_or_ps(_mm256_cmp_ps(minp, rad, _CMP_GT_OQ), _mm256_cmp_ps(maxp, avx2_neg(rad), _CMP_LT_OQ));
+}
+
+AVX2_FN static uint32_t tri_box_batch8_avx2(const float* cx, const float* cy, const float* cz, const TriBoxConsts& t) {
+    const __m256 hx = _mm256_set1_ps(t.half[0]), hy = _mm256_set1_ps(t.half[1]), hz = _mm256_set1_ps(t.half[2]);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 bx = _mm256_loadu_ps(cx), by = _mm256_loadu_ps(cy), bz = _mm256_loadu_ps(cz);
+
+    __m256 t0x = _mm256_sub_ps(_mm256_set1_ps(t.v0[0]), bx);
+    __m256 t0y = _mm256_sub_ps(_mm256_set1_ps(t.v0[1]), by);
+    __m256 t0z = _mm256_sub_ps(_mm256_set1_ps(t.v0[2]), bz);
+    __m256 t1x = _mm256_sub_ps(_mm256_set1_ps(t.v1[0]), bx);
+    __m256 t1y = _mm256_sub_ps(_mm256_set1_ps(t.v1[1]), by);
+    __m256 t1z = _mm256_sub_ps(_mm256_set1_ps(t.v1[2]), bz);
+    __m256 t2x = _mm256_sub_ps(_mm256_set1_ps(t.v2[0]), bx);
+    __m256 t2y = _mm256_sub_ps(_mm256_set1_ps(t.v2[1]), by);
+    __m256 t2z = _mm256_sub_ps(_mm256_set1_ps(t.v2[2]), bz);
+
+    __m256 e0x = _mm256_sub_ps(t1x, t0x), e0y = _mm256_sub_ps(t1y, t0y), e0z = _mm256_sub_ps(t1z, t0z);
+    __m256 e1x = _mm256_sub_ps(t2x, t1x), e1y = _mm256_sub_ps(t2y, t1y), e1z = _mm256_sub_ps(t2z, t1z);
+    __m256 e2x = _mm256_sub_ps(t0x, t2x), e2y = _mm256_sub_ps(t0y, t2y), e2z = _mm256_sub_ps(t0z, t2z);
+
+    __m256 fail = zero;
+    const __m256 ex[3] = {e0x, e1x, e2x};
+    const __m256 ey[3] = {e0y, e1y, e2y};
+    const __m256 ez[3] = {e0z, e1z, e2z};
+    for (int k = 0; k < 3; k++) {
+        __m256 fex = avx2_abs(ex[k]), fey = avx2_abs(ey[k]), fez = avx2_abs(ez[k]);
+        fail = _mm256_or_ps(fail, avx2_axis_fail(ez[k], ey[k], fez, fey, t0z, t0y, t1z, t1y, t2z, t2y, hz, hy));
+        fail = _mm256_or_ps(fail, avx2_axis_fail(ez[k], ex[k], fez, fex, t0x, t0z, t1x, t1z, t2x, t2z, hx, hz));
+        fail = _mm256_or_ps(fail, avx2_axis_fail(ey[k], ex[k], fey, fex, t0y, t0x, t1y, t1x, t2y, t2x, hy, hx));
+    }
+
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_min3(t0x, t1x, t2x), hx, _CMP_GT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_max3(t0x, t1x, t2x), avx2_neg(hx), _CMP_LT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_min3(t0y, t1y, t2y), hy, _CMP_GT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_max3(t0y, t1y, t2y), avx2_neg(hy), _CMP_LT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_min3(t0z, t1z, t2z), hz, _CMP_GT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(avx2_max3(t0z, t1z, t2z), avx2_neg(hz), _CMP_LT_OQ));
+
+    // normal = glm::cross(e0, e1), plane_box_overlap(normal, tv0, half)
+    __m256 nx = _mm256_sub_ps(_mm256_mul_ps(e0y, e1z), _mm256_mul_ps(e1y, e0z));
+    __m256 ny = _mm256_sub_ps(_mm256_mul_ps(e0z, e1x), _mm256_mul_ps(e1z, e0x));
+    __m256 nz = _mm256_sub_ps(_mm256_mul_ps(e0x, e1y), _mm256_mul_ps(e1x, e0y));
+
+    const __m256 n[3] = {nx, ny, nz};
+    const __m256 tv[3] = {t0x, t0y, t0z};
+    const __m256 h[3] = {hx, hy, hz};
+    __m256 vmin[3], vmax[3];
+    for (int q = 0; q < 3; q++) {
+        __m256 pos = _mm256_cmp_ps(n[q], zero, _CMP_GT_OQ);
+        __m256 lo = _mm256_sub_ps(avx2_neg(h[q]), tv[q]); // -maxbox - v
+        __m256 hi = _mm256_sub_ps(h[q], tv[q]);           //  maxbox - v
+        vmin[q] = _mm256_blendv_ps(hi, lo, pos);
+        vmax[q] = _mm256_blendv_ps(lo, hi, pos);
+    }
+    // glm::dot: (x + y) + z
+    __m256 dmin = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, vmin[0]), _mm256_mul_ps(ny, vmin[1])), _mm256_mul_ps(nz, vmin[2]));
+    __m256 dmax = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, vmax[0]), _mm256_mul_ps(ny, vmax[1])), _mm256_mul_ps(nz, vmax[2]));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(dmin, zero, _CMP_GT_OQ));
+    fail = _mm256_or_ps(fail, _mm256_cmp_ps(dmax, zero, _CMP_NGE_UQ));
+
+    return (uint32_t)(~_mm256_movemask_ps(fail)) & 0xFFu;
+}
+
+AVX2_FN static uint32_t tri_box_batch_avx2(const float* cx, const float* cy, const float* cz, uint32_t count, const TriBoxConsts& t) {
+    // хвост добиваем копией, лишние биты отрезаются маской
+    alignas(32) float bx[VoxelRastorizator::TRI_BOX_BATCH];
+    alignas(32) float by[VoxelRastorizator::TRI_BOX_BATCH];
+    alignas(32) float bz[VoxelRastorizator::TRI_BOX_BATCH];
+    for (uint32_t i = 0; i < VoxelRastorizator::TRI_BOX_BATCH; i++) {
+        uint32_t j = i < count ? i : 0;
+        bx[i] = cx[j]; by[i] = cy[j]; bz[i] = cz[j];
+    }
+
+    uint32_t mask = tri_box_batch8_avx2(bx, by, bz, t);
+    if (count > 8)
+        mask |= tri_box_batch8_avx2(bx + 8, by + 8, bz + 8, t) << 8;
+    return mask & ((count >= 32u) ? ~0u : ((1u << count) - 1u));
+}
+
+#define AVX512_FN __attribute__((target("avx512f")))
+
+AVX512_FN static inline __m512 avx512_neg(__m512 x) {
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x), _mm512_set1_epi32((int)0x80000000u)));
+}
+
+AVX512_FN static inline __m512 avx512_min3(__m512 a, __m512 b, __m512 c) {
+    return _mm512_min_ps(_mm512_min_ps(c, b), a);
+}
+
+AVX512_FN static inline __m512 avx512_max3(__m512 a, __m512 b, __m512 c) {
+    return _mm512_max_ps(_mm512_max_ps(c, b), a);
+}
+
+AVX512_FN static inline __mmask16 avx512_axis_fail(__m512 a, __m512 b, __m512 fa, __m512 fb,
+                                                   __m512 v0a, __m512 v0b, __m512 v1a, __m512 v1b, __m512 v2a, __m512 v2b,
+                                                   __m512 box_a, __m512 box_b) {
+    __m512 p0 = _mm512_sub_ps(_mm512_mul_ps(a, v0a), _mm512_mul_ps(b, v0b));
+    __m512 p1 = _mm512_sub_ps(_mm512_mul_ps(a, v1a), _mm512_mul_ps(b, v1b));
+    __m512 p2 = _mm512_sub_ps(_mm512_mul_ps(a, v2a), _mm512_mul_ps(b, v2b));
+    __m512 minp = avx512_min3(p0, p1, p2);
+    __m512 maxp = avx512_max3(p0, p1, p2);
+    __m512 rad = _mm512_add_ps(_mm512_mul_ps(fa, box_a), _mm512_mul_ps(fb, box_b));
+    return _mm512_cmp_ps_mask(minp, rad, _CMP_GT_OQ) | _mm512_cmp_ps_mask(maxp, avx512_neg(rad), _CMP_LT_OQ);
+}
+
+AVX512_FN static uint32_t tri_box_batch_avx512(const float* cx, const float* cy, const float* cz, uint32_t count, const TriBoxConsts& t) {
+    const __mmask16 lanes = (__mmask16)((count >= 16u) ? 0xFFFFu : ((1u << count) - 1u));
+    const __m512 hx = _mm512_set1_ps(t.half[0]), hy = _mm512_set1_ps(t.half[1]), hz = _mm512_set1_ps(t.half[2]);
+    const __m512 zero = _mm512_setzero_ps();
+
+    // маскированная загрузка не читает за концом массивов
+    __m512 bx = _mm512_maskz_loadu_ps(lanes, cx);
+    __m512 by = _mm512_maskz_loadu_ps(lanes, cy);
+    __m512 bz = _mm512_maskz_loadu_ps(lanes, cz);
+
+    __m512 t0x = _mm512_sub_ps(_mm512_set1_ps(t.v0[0]), bx);
+    __m512 t0y = _mm512_sub_ps(_mm512_set1_ps(t.v0[1]), by);
+    __m512 t0z = _mm512_sub_ps(_mm512_set1_ps(t.v0[2]), bz);
+    __m512 t1x = _mm512_sub_ps(_mm512_set1_ps(t.v1[0]), bx);
+    __m512 t1y = _mm512_sub_ps(_mm512_set1_ps(t.v1[1]), by);
+    __m512 t1z = _mm512_sub_ps(_mm512_set1_ps(t.v1[2]), bz);
+    __m512 t2x = _mm512_sub_ps(_mm512_set1_ps(t.v2[0]), bx);
+    __m512 t2y = _mm512_sub_ps(_mm512_set1_ps(t.v2[1]), by);
+    __m512 t2z = _mm512_sub_ps(_mm512_set1_ps(t.v2[2]), bz);
+
+    __m512 e0x = _mm512_sub_ps(t1x, t0x), e0y = _mm512_sub_ps(t1y, t0y), e0z = _mm512_sub_ps(t1z, t0z);
+    __m512 e1x = _mm512_sub_ps(t2x, t1x), e1y = _mm512_sub_ps(t2y, t1y), e1z = _mm512_sub_ps(t2z, t1z);
+    __m512 e2x = _mm512_sub_ps(t0x, t2x), e2y = _mm512_sub_ps(t0y, t2y), e2z = _mm512_sub_ps(t0z, t2z);
+
+    __mmask16 fail = 0;
+    const __m512 ex[3] = {e0x, e1x, e2x};
+    const __m512 ey[3] = {e0y, e1y, e2y};
+    const __m512 ez[3] = {e0z, e1z, e2z};
+    for (int k = 0; k < 3; k++) {
+        __m512 fex = _mm512_abs_ps(ex[k]), fey = _mm512_abs_ps(ey[k]), fez = _mm512_abs_ps(ez[k]);
+        fail |= avx512_axis_fail(ez[k], ey[k], fez, fey, t0z, t0y, t1z, t1y, t2z, t2y, hz, hy);
+        fail |= avx512_axis_fail(ez[k], ex[k], fez, fex, t0x, t0z, t1x, t1z, t2x, t2z, hx, hz);
+        fail |= avx512_axis_fail(ey[k], ex[k], fey, fex, t0y, t0x, t1y, t1x, t2y, t2x, hy, hx);
+    }
+
+    fail |= _mm512_cmp_ps_mask(avx512_min3(t0x, t1x, t2x), hx, _CMP_GT_OQ);
+    fail |= _mm512_cmp_ps_mask(avx512_max3(t0x, t1x, t2x), avx512_neg(hx), _CMP_LT_OQ);
+    fail |= _mm512_cmp_ps_mask(avx512_min3(t0y, t1y, t2y), hy, _CMP_GT_OQ);
+    fail |= _mm512_cmp_ps_mask(avx512_max3(t0y, t1y, t2y), avx512_neg(hy), _CMP_LT_OQ);
+    fail |= _mm512_cmp_ps_mask(avx512_min3(t0z, t1z, t2z), hz, _CMP_GT_OQ);
+    fail |= _mm512_cmp_ps_mask(avx512_max3(t0z, t1z, t2z), avx512_neg(hz), _CMP_LT_OQ);
+
+    __m512 nx = _mm512_sub_ps(_mm512_mul_ps(e0y, e1z), _mm512_mul_ps(e1y, e0z));
+    __m512 ny = _mm512_sub_ps(_mm512_mul_ps(e0z, e1x), _mm512_mul_ps(e1z, e0x));
+    __m512 nz = _mm512_sub_ps(_mm512_mul_ps(e0x, e1y), _mm512_mul_ps(e1x, e0y));
+
+    const __m512 n[3] = {nx, ny, nz};
+    const __m512 tv[3] = {t0x, t0y, t0z};
+    const __m512 h[3] = {hx, hy, hz};
+    __m512 vmin[3], vmax[3];
+    for (int q = 0; q < 3; q++) {
+        __mmask16 pos = _mm512_cmp_ps_mask(n[q], zero, _CMP_GT_OQ);
+        __m512 lo = _mm512_sub_ps(avx512_neg(h[q]), tv[q]);
+        __m512 hi = _mm512_sub_ps(h[q], tv[q]);
+        vmin[q] = _mm512_mask_blend_ps(pos, hi, lo);
+        vmax[q] = _mm512_mask_blend_ps(pos, lo, hi);
+    }
+    __m512 dmin = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(nx, vmin[0]), _mm512_mul_ps(ny, vmin[1])), _mm512_mul_ps(nz, vmin[2]));
+    __m512 dmax = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(nx, vmax[0]), _mm512_mul_ps(ny, vmax[1])), _mm512_mul_ps(nz, vmax[2]));
+    fail |= _mm512_cmp_ps_mask(dmin, zero, _CMP_GT_OQ);
+    fail |= _mm512_cmp_ps_mask(dmax, zero, _CMP_NGE_UQ);
+
+    return (uint32_t)(~fail & lanes);
+}
+
+#endif // VOXEL_RASTER_X86_SIMD
+
+struct TriBoxBatchKernel {
+    TriBoxBatchFn fn;
+    const char* isa;
+};
+
+// от лучшего к худшему
+static std::vector<TriBoxBatchKernel> supported_tri_box_batch_kernels() {
+    std::vector<TriBoxBatchKernel> kernels;
+#ifdef VOXEL_RASTER_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) kernels.push_back({tri_box_batch_avx512, "avx512"});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({tri_box_batch_avx2, "avx2"});
+#endif
+    kernels.push_back({tri_box_batch_scalar, "scalar"});
+    return kernels;
+}
+
+static TriBoxBatchKernel select_tri_box_batch_kernel() {
+    return supported_tri_box_batch_kernels().front();
+}
+
+static const TriBoxBatchKernel& tri_box_batch_kernel() {
+    static const TriBoxBatchKernel kernel = select_tri_box_batch_kernel();
+    return kernel;
+}
+
+static uint32_t run_tri_box_batch_kernel(TriBoxBatchFn fn, const float* cx, const float* cy, const float* cz, uint32_t count,
+                                         const glm::vec3& boxhalf, const glm::vec3& v0,
+                                         const glm::vec3& v1, const glm::vec3& v2)
+{
+    if (count == 0) return 0;
+    if (count > VoxelRastorizator::TRI_BOX_BATCH) {
+        std::cout << "VoxelRastorizator::tri_box_overlap_batch: count > TRI_BOX_BATCH" << std::endl;
+        throw std::runtime_error("VoxelRastorizator::tri_box_overlap_batch: count > TRI_BOX_BATCH");
+    }
+
+    TriBoxConsts t = {
+        {v0.x, v0.y, v0.z},
+        {v1.x, v1.y, v1.z},
+        {v2.x, v2.y, v2.z},
+        {boxhalf.x, boxhalf.y, boxhalf.z},
+    };
+    return fn(cx, cy, cz, count, t);
+}
+
+uint32_t VoxelRastorizator::tri_box_overlap_batch(const float* cx, const float* cy, const float* cz, uint32_t count,
+                                                  const glm::vec3& boxhalf, const glm::vec3& v0,
+                                                  const glm::vec3& v1, const glm::vec3& v2)
+{
+    return run_tri_box_batch_kernel(tri_box_batch_kernel().fn, cx, cy, cz, count, boxhalf, v0, v1, v2);
+}
+
+const char* VoxelRastorizator::tri_box_batch_isa() {
+    return tri_box_batch_kernel().isa;
+}
+
+std::vector<const char*> VoxelRastorizator::tri_box_batch_isas() {
+    std::vector<const char*> isas;
+    for (const TriBoxBatchKernel& kernel : supported_tri_box_batch_kernels())
+        isas.push_back(kernel.isa);
+    return isas;
+}
+
+uint32_t VoxelRastorizator::tri_box_overlap_batch_isa(const char* isa, const float* cx, const float* cy, const float* cz, uint32_t count,
+                                                      const glm::vec3& boxhalf, const glm::vec3& v0,
+                                                      const glm::vec3& v1, const glm::vec3& v2)
+{
+    for (const TriBoxBatchKernel& kernel : supported_tri_box_batch_kernels()) {
+        if (std::strcmp(kernel.isa, isa) == 0)
+            return run_tri_box_batch_kernel(kernel.fn, cx, cy, cz, count, boxhalf, v0, v1, v2);
+    }
+    std::cout << "VoxelRastorizator::tri_box_overlap_batch_isa: kernel " << isa << " is not supported on this CPU" << std::endl;
+    throw std::runtime_error("VoxelRastorizator::tri_box_overlap_batch_isa: kernel is not supported on this CPU");
+}
+
+void VoxelRastorizator::rasterize_triangle_to_points(
+    glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float voxel_size, std::vector<glm::ivec3>& out)
 {
     glm::vec3 p0 = v0 / voxel_size;
     glm::vec3 p1 = v1 / voxel_size;
@@ -95,20 +478,530 @@ std::vector<glm::ivec3> VoxelRastorizator::rasterize_triangle_to_points(
     glm::ivec3 imin = glm::ivec3(glm::floor(mn)) - glm::ivec3(1);
     glm::ivec3 imax = glm::ivec3(glm::floor(mx)) + glm::ivec3(1);
 
-    std::vector<glm::ivec3> out;
-    out.reserve((imax.x-imin.x+1)*(imax.y-imin.y+1)*(imax.z-imin.z+1));
-
     const glm::vec3 half(0.5f);
 
-    for (int x = imin.x; x <= imax.x; ++x) {
-        for (int y = imin.y; y <= imax.y; ++y) {
-            for (int z = imin.z; z <= imax.z; ++z) {
-                glm::vec3 center = glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f);
-                if (VoxelRastorizator::tri_box_overlap(center, half, p0, p1, p2)) {
-                    out.emplace_back(x, y, z);
+    // Обходим столбцы вдоль доминирующей оси нормали (w), в каждом столбце (u, v)
+    // берём только диапазон w, где плоскость треугольника пересекает столбец.
+    // SAT остаётся финальной проверкой, поэтому множество точек совпадает с полным перебором AABB.
+    glm::vec3 n = glm::cross(p1 - p0, p2 - p1);
+    glm::vec3 an = glm::abs(n);
+    int w = (an.x >= an.y && an.x >= an.z) ? 0 : (an.y >= an.z ? 1 : 2);
+    int u = (w + 1) % 3;
+    int v = (w + 2) % 3;
+
+    // У вырожденного (почти вырожденного) треугольника нормаль — шум округления, и SAT по плоскости
+    // может пропустить воксели далеко от неё. Тогда берём весь диапазон w.
+    float edge_len = glm::length(p1 - p0) * glm::length(p2 - p1);
+    float sin_angle = edge_len > 0.0f ? glm::length(n) / edge_len : 0.0f;
+    bool has_plane = an[w] > 0.0f && sin_angle > 1e-4f;
+
+    // полуширина разброса w по квадрату столбца 1x1
+    float slope_r = has_plane ? 0.5f * (an[u] + an[v]) / an[w] : 0.0f;
+    // запас: воксель на округление floor + ошибка нормали, растущая с размером треугольника
+    float extent = std::max(mx.x - mn.x, std::max(mx.y - mn.y, mx.z - mn.z));
+    int margin = has_plane ? 1 + (int)std::ceil(extent * 2e-6f / sin_angle) : 0;
+
+    float bx[TRI_BOX_BATCH], by[TRI_BOX_BATCH], bz[TRI_BOX_BATCH];
+    glm::ivec3 cell;
+    for (int cu = imin[u]; cu <= imax[u]; ++cu) {
+        for (int cv = imin[v]; cv <= imax[v]; ++cv) {
+            glm::vec3 center;
+            center[u] = cu + 0.5f;
+            center[v] = cv + 0.5f;
+            center[w] = 0.5f; // тесты столбца от w не зависят
+
+            if (!tri_column_overlap(w, center, half, p0, p1, p2))
+                continue;
+
+            int w_begin = imin[w];
+            int w_end = imax[w];
+            if (has_plane) {
+                float wc = p0[w] - (n[u] * (center[u] - p0[u]) + n[v] * (center[v] - p0[v])) / n[w];
+                // лишних кандидатов из запаса отсеет SAT
+                w_begin = std::max(w_begin, (int)std::floor(wc - slope_r) - margin);
+                w_end = std::min(w_end, (int)std::floor(wc + slope_r) + margin);
+            }
+
+            // столбец проверяем пачками по TRI_BOX_BATCH вокселей
+            float* cw_centers = w == 0 ? bx : (w == 1 ? by : bz);
+            float* cu_centers = u == 0 ? bx : (u == 1 ? by : bz);
+            float* cv_centers = v == 0 ? bx : (v == 1 ? by : bz);
+            for (uint32_t i = 0; i < TRI_BOX_BATCH; i++) {
+                cu_centers[i] = cu + 0.5f;
+                cv_centers[i] = cv + 0.5f;
+            }
+
+            cell[u] = cu;
+            cell[v] = cv;
+            for (int cw0 = w_begin; cw0 <= w_end; cw0 += (int)TRI_BOX_BATCH) {
+                uint32_t count = (uint32_t)std::min<int>((int)TRI_BOX_BATCH, w_end - cw0 + 1);
+                for (uint32_t i = 0; i < count; i++)
+                    cw_centers[i] = (cw0 + (int)i) + 0.5f;
+
+                uint64_t hits = tri_box_overlap_batch(bx, by, bz, count, half, p0, p1, p2);
+                while (hits) {
+                    uint32_t i = math_utils::ctz_u64(hits);
+                    hits &= hits - 1;
+                    cell[w] = cw0 + (int)i;
+                    out.emplace_back(cell.x, cell.y, cell.z);
+                }
+            }
+        }
+    }
+}
+
+// бит на воксель чанка: 16^3 -> 64 слова по 64 бита
+using ChunkBitsets = std::unordered_map<uint64_t, std::vector<uint64_t>>;
+
+static uint32_t chunk_words(glm::ivec3 chunk_size) {
+    return ((uint32_t)(chunk_size.x * chunk_size.y * chunk_size.z) + 63u) / 64u;
+}
+
+// поверхность меша -> битсеты занятости по чанкам (уже слитые по потокам)
+static ChunkBitsets rasterize_mesh_to_bitsets(const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+                                              int position_offset, int vertex_stride, glm::ivec3 chunk_size,
+                                              unsigned count_threads, uint64_t* out_count_points,
+                                              double* out_merge_ms = nullptr)
+{
+    const uint32_t chunk_voxel_count = (uint32_t)(chunk_size.x * chunk_size.y * chunk_size.z);
+    const uint32_t words_per_chunk = (chunk_voxel_count + 63u) / 64u;
+
+    const size_t count_triangles = mesh_data.indices.size() / 3;
+    const size_t block_size = 256; // треугольников на одну выдачу — крупные треугольники распределяются динамически
+    const size_t count_blocks = (count_triangles + block_size - 1) / block_size;
+
+    unsigned n = count_threads;
+    if (n == 0) n = std::thread::hardware_concurrency();
+    if (n == 0) n = 4;
+    n = (unsigned)std::max<size_t>(1, std::min<size_t>(n, count_blocks));
+
+    std::vector<ChunkBitsets> thread_bitsets(n);
+    std::vector<uint64_t> thread_count_points(n, 0);
+    std::atomic<size_t> next_block{0};
+
+    auto worker = [&](unsigned thread_id) {
+        ChunkBitsets& bitsets = thread_bitsets[thread_id];
+        std::vector<glm::ivec3> points;
+        uint64_t count_points = 0;
+
+        // соседние точки почти всегда в одном чанке — кэшируем последний битсет
+        uint64_t last_key = ~0ull;
+        uint64_t* last_bits = nullptr;
+
+        while (true) {
+            size_t block = next_block.fetch_add(1, std::memory_order_relaxed);
+            if (block >= count_blocks) break;
+
+            size_t tri_begin = block * block_size;
+            size_t tri_end = std::min(tri_begin + block_size, count_triangles);
+
+            for (size_t i = tri_begin; i < tri_end; i++) {
+                size_t base1 = (size_t)mesh_data.indices[i * 3] * vertex_stride + position_offset;
+                size_t base2 = (size_t)mesh_data.indices[i * 3 + 1] * vertex_stride + position_offset;
+                size_t base3 = (size_t)mesh_data.indices[i * 3 + 2] * vertex_stride + position_offset;
+
+                glm::vec3 v0 = glm::vec3(transform * glm::vec4(mesh_data.vertices[base1 + 0], mesh_data.vertices[base1 + 1], mesh_data.vertices[base1 + 2], 1.0f));
+                glm::vec3 v1 = glm::vec3(transform * glm::vec4(mesh_data.vertices[base2 + 0], mesh_data.vertices[base2 + 1], mesh_data.vertices[base2 + 2], 1.0f));
+                glm::vec3 v2 = glm::vec3(transform * glm::vec4(mesh_data.vertices[base3 + 0], mesh_data.vertices[base3 + 1], mesh_data.vertices[base3 + 2], 1.0f));
+
+                points.clear();
+                VoxelRastorizator::rasterize_triangle_to_points(v0, v1, v2, voxel_size, points);
+                count_points += points.size();
+
+                for (const glm::ivec3& p : points) {
+                    glm::ivec3 cpos = glm::ivec3(
+                        math_utils::floor_div(p.x, chunk_size.x),
+                        math_utils::floor_div(p.y, chunk_size.y),
+                        math_utils::floor_div(p.z, chunk_size.z)
+                    );
+                    uint64_t key = math_utils::pack_key(cpos.x, cpos.y, cpos.z);
+                    if (key != last_key) {
+                        std::vector<uint64_t>& bits = bitsets[key]; // ссылки на элементы unordered_map переживают rehash
+                        if (bits.empty()) bits.assign(words_per_chunk, 0ull);
+                        last_bits = bits.data();
+                        last_key = key;
+                    }
+
+                    glm::ivec3 l = p - cpos * chunk_size;
+                    uint32_t id = (uint32_t)l.x + (uint32_t)chunk_size.x * ((uint32_t)l.y + (uint32_t)chunk_size.y * (uint32_t)l.z);
+                    last_bits[id >> 6] |= 1ull << (id & 63u);
+                }
+            }
+        }
+
+        thread_count_points[thread_id] = count_points;
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    for (unsigned t = 1; t < n; t++)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : workers)
+        t.join();
+
+    // слияние по ключу чанка: OR битсетов остальных потоков в битсет первого
+    double merge_t0 = math_utils::ms_now();
+    ChunkBitsets& merged = thread_bitsets[0];
+    for (unsigned t = 1; t < n; t++) {
+        for (auto& [key, bits] : thread_bitsets[t]) {
+            auto [it, inserted] = merged.try_emplace(key);
+            if (inserted) {
+                it->second = std::move(bits);
+                continue;
+            }
+            for (uint32_t w = 0; w < words_per_chunk; w++)
+                it->second[w] |= bits[w];
+        }
+        thread_bitsets[t].clear();
+    }
+
+    if (out_count_points) {
+        *out_count_points = 0;
+        for (uint64_t c : thread_count_points)
+            *out_count_points += c;
+    }
+    if (out_merge_ms) *out_merge_ms = math_utils::ms_now() - merge_t0;
+
+    return std::move(merged);
+}
+
+// битсет -> отсортированные уникальные local id
+static std::vector<VoxelRastorizator::ChunkPoints> chunk_bitsets_to_points(const ChunkBitsets& bitsets, uint32_t words_per_chunk,
+                                                                           uint64_t* out_count_points)
+{
+    std::vector<VoxelRastorizator::ChunkPoints> out;
+    out.reserve(bitsets.size());
+    uint64_t count_unique_points = 0;
+    for (auto& [key, bits] : bitsets) {
+        VoxelRastorizator::ChunkPoints chunk_points;
+        chunk_points.chunk_pos = math_utils::unpack_key(key);
+
+        uint32_t count_bits = 0;
+        for (uint32_t w = 0; w < words_per_chunk; w++)
+            count_bits += math_utils::popcount_u64(bits[w]);
+        chunk_points.local_ids.reserve(count_bits);
+
+        for (uint32_t w = 0; w < words_per_chunk; w++) {
+            uint64_t word = bits[w];
+            while (word) {
+                chunk_points.local_ids.push_back(w * 64u + math_utils::ctz_u64(word));
+                word &= word - 1ull;
+            }
+        }
+
+        count_unique_points += count_bits;
+        out.push_back(std::move(chunk_points));
+    }
+
+    if (out_count_points) *out_count_points = count_unique_points;
+    return out;
+}
+
+std::vector<VoxelRastorizator::ChunkPoints> VoxelRastorizator::rasterize_mesh_to_chunks(
+    const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+    int position_offset, int vertex_stride, glm::ivec3 chunk_size, unsigned count_threads, RasterizeStats* stats)
+{
+    uint64_t count_points = 0;
+    uint64_t count_unique_points = 0;
+    double merge_ms = 0.0;
+    ChunkBitsets bitsets = rasterize_mesh_to_bitsets(mesh_data, transform, voxel_size, position_offset, vertex_stride,
+                                                     chunk_size, count_threads, &count_points, &merge_ms);
+    double t0 = math_utils::ms_now();
+    std::vector<ChunkPoints> out = chunk_bitsets_to_points(bitsets, chunk_words(chunk_size), &count_unique_points);
+
+    if (stats) {
+        stats->merge_ms = merge_ms + (math_utils::ms_now() - t0);
+        stats->count_points = count_points;
+        stats->count_unique_points = count_unique_points;
+        stats->count_chunks = (uint32_t)out.size();
+    }
+
+    return out;
+}
+
+// ---- сплошная вокселизация ----
+
+static glm::vec3 read_position(const MeshData& mesh_data, unsigned int index, int position_offset, int vertex_stride) {
+    size_t base = (size_t)index * vertex_stride + position_offset;
+    return glm::vec3(mesh_data.vertices[base + 0], mesh_data.vertices[base + 1], mesh_data.vertices[base + 2]);
+}
+
+void VoxelRastorizator::check_watertight(const MeshData& mesh_data, int position_offset, int vertex_stride, SolidStats& stats) {
+    // сварка вершин по побитово равным позициям: у VTK точки общие, но другие загрузчики дублируют вершины
+    struct PositionHash {
+        size_t operator()(const std::array<uint32_t, 3>& p) const {
+            uint64_t h = (uint64_t)p[0] * 0x9E3779B97F4A7C15ull;
+            h ^= (uint64_t)p[1] * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+            h ^= (uint64_t)p[2] * 0x165667B19E3779F9ull + (h >> 32);
+            return (size_t)h;
+        }
+    };
+    std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> welded;
+
+    auto weld = [&](unsigned int index) -> uint32_t {
+        glm::vec3 p = read_position(mesh_data, index, position_offset, vertex_stride);
+        std::array<uint32_t, 3> bits;
+        std::memcpy(bits.data(), &p.x, sizeof(float));
+        std::memcpy(bits.data() + 1, &p.y, sizeof(float));
+        std::memcpy(bits.data() + 2, &p.z, sizeof(float));
+        auto [it, inserted] = welded.try_emplace(bits, (uint32_t)welded.size());
+        return it->second;
+    };
+
+    // ребро (min, max) -> сколько треугольников и сумма направлений обхода (+1 для min -> max)
+    struct EdgeUse {
+        uint32_t count = 0;
+        int32_t direction = 0;
+    };
+    std::unordered_map<uint64_t, EdgeUse> edges;
+
+    stats.boundary_edges = 0;
+    stats.nonmanifold_edges = 0;
+    stats.flipped_edges = 0;
+    stats.degenerate_triangles = 0;
+
+    const size_t count_triangles = mesh_data.indices.size() / 3;
+    edges.reserve(count_triangles * 2);
+    for (size_t i = 0; i < count_triangles; i++) {
+        uint32_t id[3] = {
+            weld(mesh_data.indices[i * 3 + 0]),
+            weld(mesh_data.indices[i * 3 + 1]),
+            weld(mesh_data.indices[i * 3 + 2]),
+        };
+        if (id[0] == id[1] || id[1] == id[2] || id[2] == id[0]) {
+            stats.degenerate_triangles++;
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = id[k];
+            uint32_t b = id[(k + 1) % 3];
+            uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+            EdgeUse& use = edges[key];
+            use.count++;
+            use.direction += a < b ? 1 : -1;
+        }
+    }
+
+    for (const auto& [key, use] : edges) {
+        if (use.count == 1) stats.boundary_edges++;
+        else if (use.count > 2) stats.nonmanifold_edges++;
+        else if (use.direction != 0) stats.flipped_edges++;
+    }
+}
+
+// Ориентированная площадь (b - a) x (p - a) в проекции на (y, z).
+// Ребро считается в каноническом порядке концов, поэтому общее ребро двух треугольников даёт
+// ровно противоположные значения. Ноль получает знак канонического направления — это символическое
+// смещение луча, и луч через ребро или вершину засчитывается ровно одному треугольнику.
+static bool edge_side(const glm::vec3& a, const glm::vec3& b, double py, double pz, double& e) {
+    bool swap = (b.y < a.y) || (b.y == a.y && b.z < a.z);
+    const glm::vec3& s = swap ? b : a;
+    const glm::vec3& t = swap ? a : b;
+    double value = ((double)t.y - (double)s.y) * (pz - (double)s.z) - ((double)t.z - (double)s.z) * (py - (double)s.y);
+    bool positive = value > 0.0 || (value == 0.0 && (t.y > s.y || t.z > s.z));
+    e = swap ? -value : value;
+    return swap ? !positive : positive;
+}
+
+struct RayCrossing {
+    double x;
+    int sign; // +1 — луч входит (нормаль против x), -1 — выходит
+};
+
+// Заливка бит [first, last] целыми словами
+static void fill_bits(uint64_t* bits, uint32_t first, uint32_t last) {
+    uint32_t w0 = first >> 6, w1 = last >> 6;
+    uint64_t m0 = ~0ull << (first & 63u);
+    uint64_t m1 = ~0ull >> (63u - (last & 63u));
+    if (w0 == w1) {
+        bits[w0] |= m0 & m1;
+        return;
+    }
+    bits[w0] |= m0;
+    for (uint32_t w = w0 + 1; w < w1; w++)
+        bits[w] = ~0ull;
+    bits[w1] |= m1;
+}
+
+std::vector<VoxelRastorizator::ChunkPoints> VoxelRastorizator::voxelize_solid_to_chunks(
+    const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+    int position_offset, int vertex_stride, glm::ivec3 chunk_size, FillRule fill_rule, unsigned count_threads, SolidStats* stats)
+{
+    double t0 = math_utils::ms_now();
+    const uint32_t words_per_chunk = chunk_words(chunk_size);
+
+    // оболочка: воксели, задетые поверхностью, внутренность к ним добавится спанами
+    uint64_t count_points = 0;
+    ChunkBitsets bitsets = rasterize_mesh_to_bitsets(mesh_data, transform, voxel_size, position_offset, vertex_stride,
+                                                     chunk_size, count_threads, &count_points);
+
+    // треугольники в координатах вокселей
+    const size_t count_triangles = mesh_data.indices.size() / 3;
+    std::vector<glm::vec3> tri(count_triangles * 3);
+    for (size_t i = 0; i < count_triangles * 3; i++) {
+        glm::vec3 p = read_position(mesh_data, mesh_data.indices[i], position_offset, vertex_stride);
+        tri[i] = glm::vec3(transform * glm::vec4(p, 1.0f)) / voxel_size;
+    }
+
+    // Раскладка по столбцам чанков (cy, cz): луч (y, z) идёт через центр (y + 0.5, z + 0.5).
+    // Ключ столбца — pack_key(0, cy, cz).
+    std::unordered_map<uint64_t, std::vector<uint32_t>> columns;
+    for (size_t i = 0; i < count_triangles; i++) {
+        const glm::vec3& a = tri[i * 3 + 0];
+        const glm::vec3& b = tri[i * 3 + 1];
+        const glm::vec3& c = tri[i * 3 + 2];
+        int y0 = (int)std::ceil(fmin3(a.y, b.y, c.y) - 0.5f), y1 = (int)std::floor(fmax3(a.y, b.y, c.y) - 0.5f);
+        int z0 = (int)std::ceil(fmin3(a.z, b.z, c.z) - 0.5f), z1 = (int)std::floor(fmax3(a.z, b.z, c.z) - 0.5f);
+        if (y0 > y1 || z0 > z1) continue; // не накрывает ни одного центра луча
+
+        for (int cz = math_utils::floor_div(z0, chunk_size.z); cz <= math_utils::floor_div(z1, chunk_size.z); cz++)
+            for (int cy = math_utils::floor_div(y0, chunk_size.y); cy <= math_utils::floor_div(y1, chunk_size.y); cy++)
+                columns[math_utils::pack_key(0, cy, cz)].push_back((uint32_t)i);
+    }
+
+    std::vector<std::pair<uint64_t, std::vector<uint32_t>>> column_list(
+        std::make_move_iterator(columns.begin()), std::make_move_iterator(columns.end()));
+    columns.clear();
+
+    unsigned n = count_threads;
+    if (n == 0) n = std::thread::hardware_concurrency();
+    if (n == 0) n = 4;
+    n = (unsigned)std::max<size_t>(1, std::min<size_t>(n, column_list.size()));
+
+    struct ThreadResult {
+        ChunkBitsets bitsets;
+        uint64_t count_rays = 0;
+        uint64_t count_crossings = 0;
+        uint64_t count_open_rays = 0;
+    };
+    std::vector<ThreadResult> results(n);
+    std::atomic<size_t> next_column{0};
+
+    auto worker = [&](unsigned thread_id) {
+        ThreadResult& result = results[thread_id];
+        const uint32_t rays_per_column = (uint32_t)(chunk_size.y * chunk_size.z);
+        std::vector<std::vector<RayCrossing>> rays(rays_per_column);
+
+        while (true) {
+            size_t column = next_column.fetch_add(1, std::memory_order_relaxed);
+            if (column >= column_list.size()) break;
+
+            glm::ivec3 cpos = math_utils::unpack_key(column_list[column].first);
+            const int base_y = cpos.y * chunk_size.y;
+            const int base_z = cpos.z * chunk_size.z;
+
+            for (auto& ray : rays) ray.clear();
+
+            for (uint32_t t : column_list[column].second) {
+                const glm::vec3& a = tri[(size_t)t * 3 + 0];
+                const glm::vec3& b = tri[(size_t)t * 3 + 1];
+                const glm::vec3& c = tri[(size_t)t * 3 + 2];
+
+                int y0 = std::max(base_y, (int)std::ceil(fmin3(a.y, b.y, c.y) - 0.5f));
+                int y1 = std::min(base_y + chunk_size.y - 1, (int)std::floor(fmax3(a.y, b.y, c.y) - 0.5f));
+                int z0 = std::max(base_z, (int)std::ceil(fmin3(a.z, b.z, c.z) - 0.5f));
+                int z1 = std::min(base_z + chunk_size.z - 1, (int)std::floor(fmax3(a.z, b.z, c.z) - 0.5f));
+
+                for (int z = z0; z <= z1; z++) {
+                    double pz = z + 0.5;
+                    for (int y = y0; y <= y1; y++) {
+                        double py = y + 0.5;
+                        double e0, e1, e2; // e0 — вес вершины a (ребро b -> c) и т.д.
+                        bool s0 = edge_side(b, c, py, pz, e0);
+                        bool s1 = edge_side(c, a, py, pz, e1);
+                        bool s2 = edge_side(a, b, py, pz, e2);
+                        if (s0 != s1 || s1 != s2) continue;
+
+                        double area = e0 + e1 + e2;
+                        if (area == 0.0) continue;
+                        double x = (e0 * a.x + e1 * b.x + e2 * c.x) / area;
+
+                        // положительная площадь в (y, z) — нормаль смотрит по +x, луч выходит
+                        uint32_t ray_id = (uint32_t)(y - base_y) + (uint32_t)chunk_size.y * (uint32_t)(z - base_z);
+                        rays[ray_id].push_back(RayCrossing{x, s0 ? -1 : 1});
+                    }
                 }
             }
+
+            for (uint32_t ray_id = 0; ray_id < rays_per_column; ray_id++) {
+                std::vector<RayCrossing>& ray = rays[ray_id];
+                if (ray.empty()) continue;
+
+                result.count_rays++;
+                result.count_crossings += ray.size();
+                std::sort(ray.begin(), ray.end(), [](const RayCrossing& l, const RayCrossing& r) { return l.x < r.x; });
+
+                const uint32_t ly = ray_id % (uint32_t)chunk_size.y;
+                const uint32_t lz = ray_id / (uint32_t)chunk_size.y;
+                const uint32_t row_base = (uint32_t)chunk_size.x * (ly + (uint32_t)chunk_size.y * lz);
+
+                int winding = 0;
+                for (size_t k = 0; k + 1 < ray.size(); k++) {
+                    winding += fill_rule == FillRule::Parity ? 1 : ray[k].sign;
+                    bool inside = fill_rule == FillRule::Parity ? (winding & 1) != 0 : winding != 0;
+                    if (!inside) continue;
+
+                    // воксели с центром в [x_k, x_k+1)
+                    int x0 = (int)std::ceil(ray[k].x - 0.5);
+                    int x1 = (int)std::ceil(ray[k + 1].x - 0.5) - 1;
+                    if (x0 > x1) continue;
+
+                    // спан режется по чанкам вдоль x
+                    for (int cx = math_utils::floor_div(x0, chunk_size.x); cx <= math_utils::floor_div(x1, chunk_size.x); cx++) {
+                        int lx0 = std::max(x0 - cx * chunk_size.x, 0);
+                        int lx1 = std::min(x1 - cx * chunk_size.x, chunk_size.x - 1);
+
+                        std::vector<uint64_t>& bits = result.bitsets[math_utils::pack_key(cx, cpos.y, cpos.z)];
+                        if (bits.empty()) bits.assign(words_per_chunk, 0ull);
+                        fill_bits(bits.data(), row_base + (uint32_t)lx0, row_base + (uint32_t)lx1);
+                    }
+                }
+
+                winding += fill_rule == FillRule::Parity ? 1 : ray.back().sign;
+                bool closed = (ray.size() % 2) == 0 && (fill_rule == FillRule::Parity || winding == 0);
+                if (!closed) result.count_open_rays++;
+            }
         }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    for (unsigned t = 1; t < n; t++)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : workers)
+        t.join();
+
+    // столбцы не пересекаются по чанкам, но чанки оболочки общие — OR.
+    // Спаны разных лучей не пересекаются, поэтому внутренность без оболочки — биты спанов, которых нет в оболочке.
+    SolidStats solid;
+    for (ThreadResult& result : results) {
+        for (auto& [key, bits] : result.bitsets) {
+            auto [it, inserted] = bitsets.try_emplace(key);
+            if (inserted) {
+                for (uint32_t w = 0; w < words_per_chunk; w++)
+                    solid.count_interior_voxels += math_utils::popcount_u64(bits[w]);
+                it->second = std::move(bits);
+                continue;
+            }
+            for (uint32_t w = 0; w < words_per_chunk; w++) {
+                solid.count_interior_voxels += math_utils::popcount_u64(bits[w] & ~it->second[w]);
+                it->second[w] |= bits[w];
+            }
+        }
+        solid.count_rays += result.count_rays;
+        solid.count_crossings += result.count_crossings;
+        solid.count_open_rays += result.count_open_rays;
+    }
+    solid.count_points = count_points;
+
+    std::vector<ChunkPoints> out = chunk_bitsets_to_points(bitsets, words_per_chunk, &solid.count_unique_points);
+
+    if (stats) {
+        check_watertight(mesh_data, position_offset, vertex_stride, solid);
+        solid.voxelize_ms = math_utils::ms_now() - t0;
+        *stats = solid;
     }
 
     return out;
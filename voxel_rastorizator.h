@@ -4,24 +4,114 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 #include "mesh_data.h"
 #include "gridable.h"
+#include "math_utils.h"
 #include "voxel_engine/voxel.h"
 
 
 class VoxelRastorizator {
 public:
+    // точки одного чанка: local id = x + sx * (y + sy * z)
+    struct ChunkPoints {
+        glm::ivec3 chunk_pos;
+        std::vector<uint32_t> local_ids;
+    };
+
+    struct RasterizeStats {
+        uint64_t count_points = 0;        // все попадания треугольник-воксель
+        uint64_t count_unique_points = 0; // после дедупликации
+        uint32_t count_chunks = 0;
+        double rasterize_ms = 0.0;
+        double merge_ms = 0.0;            // последовательная часть rasterize: слияние битсетов потоков и перевод в local id
+        double generate_ms = 0.0;
+        double apply_ms = 0.0;
+
+        double duplicate_ratio() const {
+            return count_points ? 1.0 - (double)count_unique_points / (double)count_points : 0.0;
+        }
+    };
+
+    // правило заполнения внутренности вдоль луча
+    enum class FillRule {
+        Parity,  // внутри, если пересечений слева нечётно — для мешей с произвольной ориентацией граней
+        NonZero, // внутри, если сумма ориентированных пересечений != 0 — переживает вложенные и пересекающиеся оболочки
+    };
+
+    struct SolidStats {
+        uint64_t count_rays = 0;            // лучи вдоль x через центры вокселей, задевшие меш
+        uint64_t count_crossings = 0;
+        uint64_t count_open_rays = 0;       // луч вышел с нечётным числом пересечений или ненулевой обмоткой
+        uint64_t count_interior_voxels = 0; // залито спанами и не задето оболочкой
+        uint64_t count_points = 0;          // попадания треугольник-воксель оболочки, как RasterizeStats::count_points
+        uint64_t count_unique_points = 0;   // оболочка + внутренность после дедупликации
+        uint32_t boundary_edges = 0;        // ребро у одного треугольника — дыра
+        uint32_t nonmanifold_edges = 0;     // ребро у трёх и более треугольников
+        uint32_t flipped_edges = 0;         // соседи по ребру с несогласованной ориентацией
+        uint32_t degenerate_triangles = 0;
+        double voxelize_ms = 0.0;
+
+        bool watertight() const {
+            return boundary_edges == 0 && nonmanifold_edges == 0 && count_open_rays == 0;
+        }
+    };
+
     Gridable* gridable;
+    glm::ivec3 chunk_size;
+    RasterizeStats last_stats;
+    SolidStats last_solid_stats;
 
-    VoxelRastorizator(Gridable* gridable);
+    VoxelRastorizator(Gridable* gridable, glm::ivec3 chunk_size = glm::ivec3(16));
 
     static float fmin3(float a, float b, float c);
     static float fmax3(float a, float b, float c);
     static bool plane_box_overlap(const glm::vec3& normal, const glm::vec3& vert, const glm::vec3& maxbox);
     static bool tri_box_overlap(const glm::vec3& boxcenter, const glm::vec3& boxhalf, const glm::vec3& v0,
                                 const glm::vec3& v1, const glm::vec3& v2);
+    // тесты SAT, не зависящие от координаты axis (0 = x, 1 = y, 2 = z) — отсев целого столбца вокселей
+    static bool tri_column_overlap(int axis, const glm::vec3& boxcenter, const glm::vec3& boxhalf, const glm::vec3& v0,
+                                   const glm::vec3& v1, const glm::vec3& v2);
+
+    static constexpr uint32_t TRI_BOX_BATCH = 16;
+    // Один треугольник против count <= TRI_BOX_BATCH боксов (центры в SoA: cx, cy, cz).
+    // Бит i результата == tri_box_overlap(center_i, ...), побитово тот же результат.
+    // Ядро выбирается при первом вызове: AVX-512 (16 боксов), AVX2 (2 x 8), иначе скалярный цикл.
+    static uint32_t tri_box_overlap_batch(const float* cx, const float* cy, const float* cz, uint32_t count,
+                                          const glm::vec3& boxhalf, const glm::vec3& v0,
+                                          const glm::vec3& v1, const glm::vec3& v2);
+    static const char* tri_box_batch_isa();
+    // Ядра, которые может исполнить этот CPU ("scalar" всегда есть), и вызов конкретного ядра по имени -
+    // чтобы тест сравнил каждое со скалярным tri_box_overlap, а не только выбранное при первом вызове.
+    static std::vector<const char*> tri_box_batch_isas();
+    static uint32_t tri_box_overlap_batch_isa(const char* isa, const float* cx, const float* cy, const float* cz, uint32_t count,
+                                              const glm::vec3& boxhalf, const glm::vec3& v0,
+                                              const glm::vec3& v1, const glm::vec3& v2);
+
     static std::vector<glm::ivec3> rasterize_triangle_to_points(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float voxel_size);
+    // то же, но дописывает в out (без аллокации на каждый треугольник)
+    static void rasterize_triangle_to_points(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float voxel_size, std::vector<glm::ivec3>& out);
+
+    // Треугольники делятся на блоки между потоками, каждый поток пишет в свои битсеты занятости по чанкам,
+    // затем битсеты сливаются по ключу чанка через OR — дубликаты от соседних треугольников схлопываются.
+    // local_ids на выходе уникальны и отсортированы. count_threads = 0 — по числу ядер.
+    static std::vector<ChunkPoints> rasterize_mesh_to_chunks(const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+                                                             int position_offset, int vertex_stride, glm::ivec3 chunk_size,
+                                                             unsigned count_threads = 0, RasterizeStats* stats = nullptr);
+
+    // Топология меша: рёбра по сваренным (совпадающим побитово) позициям вершин.
+    // Заполняет boundary/nonmanifold/flipped_edges и degenerate_triangles.
+    static void check_watertight(const MeshData& mesh_data, int position_offset, int vertex_stride, SolidStats& stats);
+
+    // Сплошная вокселизация: оболочка (как rasterize_mesh_to_chunks) плюс внутренность.
+    // Лучи идут вдоль x через центры вокселей, треугольники раскладываются по столбцам чанков (y, z),
+    // столбцы обрабатываются параллельно, каждый интервал внутри луча заливается в битсет чанка целыми словами.
+    // Вдоль x local id подряд, поэтому спан — непрерывный диапазон бит.
+    static std::vector<ChunkPoints> voxelize_solid_to_chunks(const MeshData& mesh_data, const glm::mat4& transform, float voxel_size,
+                                                             int position_offset, int vertex_stride, glm::ivec3 chunk_size,
+                                                             FillRule fill_rule = FillRule::NonZero, unsigned count_threads = 0,
+                                                             SolidStats* stats = nullptr);
 
     // voxel_generator = Voxel F(glm::ivec3 point)
     template <class F>
@@ -40,55 +130,97 @@ public:
     }
 
     // voxel_generator = Voxel F(glm::ivec3 point)
+    // растеризация параллельная, voxel_generator зовётся на текущем потоке ровно один раз на уникальный воксель
     template <class F>
     void rasterize_mesh(MeshData& mesh_data, glm::mat4 transform, F& voxel_generator, float voxel_size, int position_offset, int vertex_stride) {
-        int count_vertices = mesh_data.indices.size() / 3;
-
-        std::vector<std::vector<glm::ivec3>> triangle_points_batch;
-
-        size_t count_points = 0;
-        for (size_t i = 0; i < count_vertices; i++) {
-            size_t v_id1 = mesh_data.indices[i * 3];
-            size_t v_id2 = mesh_data.indices[i * 3 + 1];
-            size_t v_id3 = mesh_data.indices[i * 3 + 2];
-
-            size_t base1 = v_id1 * vertex_stride + position_offset;
-            size_t base2 = v_id2 * vertex_stride + position_offset;
-            size_t base3 = v_id3 * vertex_stride + position_offset;
-
-            glm::vec4 v0_vec4 = glm::vec4(mesh_data.vertices[base1 + 0], mesh_data.vertices[base1 + 1], mesh_data.vertices[base1 + 2], 1.0f);
-            glm::vec4 v1_vec4 = glm::vec4(mesh_data.vertices[base2 + 0], mesh_data.vertices[base2 + 1], mesh_data.vertices[base2 + 2], 1.0f);
-            glm::vec4 v2_vec4 = glm::vec4(mesh_data.vertices[base3 + 0], mesh_data.vertices[base3 + 1], mesh_data.vertices[base3 + 2], 1.0f);
-
-            glm::vec3 v0 = glm::vec3(transform * v0_vec4);
-            glm::vec3 v1 = glm::vec3(transform * v1_vec4);
-            glm::vec3 v2 = glm::vec3(transform * v2_vec4);
-
-            std::vector<glm::ivec3> triangle_points = rasterize_triangle_to_points(v0, v1, v2, voxel_size);
-            count_points += triangle_points.size();
+        last_stats = RasterizeStats();
+        double t0 = math_utils::ms_now();
+
+        std::vector<ChunkPoints> chunk_points = rasterize_mesh_to_chunks(
+            mesh_data, transform, voxel_size, position_offset, vertex_stride, chunk_size, 0, &last_stats
+        );
+
+        double t1 = math_utils::ms_now();
+        apply_chunk_points(chunk_points, voxel_generator);
+        last_stats.rasterize_ms = t1 - t0;
+
+    #ifdef RASTERIZE_DEBUG
+        std::cout << "points: " << last_stats.count_points << ", unique: " << last_stats.count_unique_points
+                  << " (duplicates " << last_stats.duplicate_ratio() * 100.0 << "%)" << std::endl;
+        std::cout << "chunks: " << last_stats.count_chunks << std::endl;
+        std::cout << "tri_box_overlap: " << tri_box_batch_isa() << std::endl;
+        std::cout << "rasterize: " << last_stats.rasterize_ms << " ms" << std::endl;
+        std::cout << "voxel_generator: " << last_stats.generate_ms << " ms" << std::endl;
+        std::cout << "set_chunk_voxels: " << last_stats.apply_ms << " ms" << std::endl;
+    #endif
+    }
 
-            triangle_points_batch.push_back(std::move(triangle_points));
+    // то же, что rasterize_mesh, но заполняет и внутренность замкнутого меша (см. voxelize_solid_to_chunks)
+    template <class F>
+    void voxelize_mesh_solid(MeshData& mesh_data, glm::mat4 transform, F& voxel_generator, float voxel_size,
+                             int position_offset, int vertex_stride, FillRule fill_rule = FillRule::NonZero) {
+        last_stats = RasterizeStats();
+        last_solid_stats = SolidStats();
+
+        std::vector<ChunkPoints> chunk_points = voxelize_solid_to_chunks(
+            mesh_data, transform, voxel_size, position_offset, vertex_stride, chunk_size, fill_rule, 0, &last_solid_stats
+        );
+        last_stats.count_points = last_solid_stats.count_points;
+        last_stats.count_unique_points = last_solid_stats.count_unique_points;
+        last_stats.count_chunks = (uint32_t)chunk_points.size();
+        last_stats.rasterize_ms = last_solid_stats.voxelize_ms;
+
+        apply_chunk_points(chunk_points, voxel_generator);
+
+        if (!last_solid_stats.watertight()) {
+            std::cout << "VoxelRastorizator::voxelize_mesh_solid: mesh is not watertight (boundary edges: "
+                      << last_solid_stats.boundary_edges << ", non-manifold edges: " << last_solid_stats.nonmanifold_edges
+                      << ", open rays: " << last_solid_stats.count_open_rays << " of " << last_solid_stats.count_rays
+                      << "), interior may leak" << std::endl;
         }
 
-        std::vector<glm::ivec3> triangle_points_batch_flatten;
-        triangle_points_batch_flatten.reserve(count_points);
+    #ifdef RASTERIZE_DEBUG
+        std::cout << "rays: " << last_solid_stats.count_rays << ", crossings: " << last_solid_stats.count_crossings << std::endl;
+        std::cout << "interior voxels: " << last_solid_stats.count_interior_voxels << std::endl;
+        std::cout << "flipped edges: " << last_solid_stats.flipped_edges
+                  << ", degenerate triangles: " << last_solid_stats.degenerate_triangles << std::endl;
+        std::cout << "voxelize: " << last_solid_stats.voxelize_ms << " ms" << std::endl;
+        std::cout << "voxel_generator: " << last_stats.generate_ms << " ms" << std::endl;
+        std::cout << "set_chunk_voxels: " << last_stats.apply_ms << " ms" << std::endl;
+    #endif
+    }
 
-        for (std::vector<glm::ivec3>& points : triangle_points_batch) {
-            triangle_points_batch_flatten.insert(
-                triangle_points_batch_flatten.end(),
-                points.begin(),
-                points.end()
-            );
+private:
+    // зовёт voxel_generator на каждый воксель и отдаёт результат в gridable одной пачкой по чанкам
+    template <class F>
+    void apply_chunk_points(std::vector<ChunkPoints>& chunk_points, F& voxel_generator) {
+        double t1 = math_utils::ms_now();
+
+        std::vector<ChunkVoxels> chunks(chunk_points.size());
+        for (size_t c = 0; c < chunk_points.size(); c++) {
+            ChunkVoxels& chunk = chunks[c];
+            chunk.chunk_pos = chunk_points[c].chunk_pos;
+            chunk.local_ids = std::move(chunk_points[c].local_ids);
+            chunk.voxels.reserve(chunk.local_ids.size());
+
+            glm::ivec3 origin = chunk.chunk_pos * chunk_size;
+            for (uint32_t id : chunk.local_ids) {
+                uint32_t lx = id % (uint32_t)chunk_size.x;
+                uint32_t t  = id / (uint32_t)chunk_size.x;
+                uint32_t ly = t % (uint32_t)chunk_size.y;
+                uint32_t lz = t / (uint32_t)chunk_size.y;
+
+                glm::ivec3 point = origin + glm::ivec3((int)lx, (int)ly, (int)lz);
+                chunk.voxels.push_back(voxel_generator(point));
+            }
         }
 
-        std::vector<Voxel> voxels;
-        voxels.reserve(count_points);
+        double t2 = math_utils::ms_now();
 
-        for (glm::ivec3& point : triangle_points_batch_flatten) {
-            Voxel voxel = voxel_generator(point);
-            voxels.push_back(voxel);
-        }
+        gridable->set_chunk_voxels(chunk_size, chunks);
 
-        gridable->set_voxels(voxels, triangle_points_batch_flatten);
+        double t3 = math_utils::ms_now();
+        last_stats.generate_ms = t2 - t1;
+        last_stats.apply_ms = t3 - t2;
     }
 };
\ No newline at end of file